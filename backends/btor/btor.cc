@@ -45,6 +45,7 @@ struct BtorWorker
 	bool single_bad;
 	bool cover_mode;
 	bool print_internal_names;
+	bool sharemode;
 
 	int next_nid = 1;
 	int initstate_nid = -1;
@@ -69,6 +70,13 @@ struct BtorWorker
 
 	// nids for constants
 	dict<Const, int> consts;
+	dict<int, Const> const_values;
+
+	// <sid> => <bvwidth>
+	dict<int, int> sid_width;
+
+	// (<op>, <sid>, <args>, <imms>) => <nid>
+	dict<std::tuple<string, int, vector<int>, vector<int>>, int> node_nids;
 
 	// ff inputs that need to be evaluated (<nid>, <ff_cell>)
 	vector<pair<int, Cell*>> ff_todo;
@@ -211,6 +219,7 @@ struct BtorWorker
 			int nid = next_nid++;
 			btorf("%d sort bitvec %d\n", nid, width);
 			sorts_bv[width] = nid;
+			sid_width[nid] = width;
 		}
 		return sorts_bv.at(width);
 	}
@@ -240,6 +249,115 @@ struct BtorWorker
 		nid_width[nid] = GetSize(sig);
 	}
 
+	int get_const_nid(const Const &c)
+	{
+		if (consts.count(c) == 0) {
+			int sid = get_bv_sid(GetSize(c));
+			int nid = next_nid++;
+			btorf("%d const %d %s\n", nid, sid, c.as_string().c_str());
+			consts[c] = nid;
+			const_values[nid] = c;
+			nid_width[nid] = GetSize(c);
+		}
+		return consts.at(c);
+	}
+
+	// Evaluates a node with constant arguments, returns false if the
+	// operation is not supported.
+	bool fold_node(const string &op, int width, const vector<Const> &args, const vector<int> &imms, Const &result)
+	{
+		auto bin = [&](RTLIL::Const (*fn)(const RTLIL::Const&, const RTLIL::Const&, bool, bool, int), bool signed1, bool signed2, int result_width) {
+			result = fn(args[0], args[1], signed1, signed2, result_width);
+			return true;
+		};
+		bool is_signed = op[0] == 's';
+
+		if (op == "not") { result = const_not(args[0], Const(), false, false, width); return true; }
+		if (op == "neg") { result = const_neg(args[0], Const(), false, false, width); return true; }
+		if (op == "and") return bin(RTLIL::const_and, false, false, width);
+		if (op == "or") return bin(RTLIL::const_or, false, false, width);
+		if (op == "xor") return bin(RTLIL::const_xor, false, false, width);
+		if (op == "xnor") return bin(RTLIL::const_xnor, false, false, width);
+		if (op == "nand") { bin(RTLIL::const_and, false, false, width); result = const_not(result, Const(), false, false, width); return true; }
+		if (op == "nor") { bin(RTLIL::const_or, false, false, width); result = const_not(result, Const(), false, false, width); return true; }
+		if (op == "add") return bin(RTLIL::const_add, false, false, width);
+		if (op == "sub") return bin(RTLIL::const_sub, false, false, width);
+		if (op == "mul") return bin(RTLIL::const_mul, false, false, width);
+		if (op == "sll") return bin(RTLIL::const_shl, false, false, width);
+		if (op == "srl") return bin(RTLIL::const_shr, false, false, width);
+		if (op == "sra") return bin(RTLIL::const_sshr, true, false, width);
+		if (op == "eq") return bin(RTLIL::const_eq, false, false, 1);
+		if (op == "neq") return bin(RTLIL::const_ne, false, false, 1);
+		if (op == "ult" || op == "slt") return bin(RTLIL::const_lt, is_signed, is_signed, 1);
+		if (op == "ulte" || op == "slte") return bin(RTLIL::const_le, is_signed, is_signed, 1);
+		if (op == "ugt" || op == "sgt") return bin(RTLIL::const_gt, is_signed, is_signed, 1);
+		if (op == "ugte" || op == "sgte") return bin(RTLIL::const_ge, is_signed, is_signed, 1);
+		if (op == "redor") { result = const_reduce_or(args[0], Const(), false, false, 1); return true; }
+		if (op == "redand") { result = const_reduce_and(args[0], Const(), false, false, 1); return true; }
+		if (op == "redxor") { result = const_reduce_xor(args[0], Const(), false, false, 1); return true; }
+		if (op == "slice") { result = args[0].extract(imms[1], imms[0] - imms[1] + 1); return true; }
+		if (op == "uext" || op == "sext") { result = const_pos(args[0], Const(), op == "sext", false, width); return true; }
+		if (op == "concat") {
+			result = args[1];
+			for (auto bit : args[0])
+				result.bits().push_back(bit);
+			return true;
+		}
+		return false;
+	}
+
+	// Returns the nid of the combinational node `<op> <sid> <args> <imms>`.
+	// Nodes are hash-consed: a node with the same operation, sort and
+	// arguments is only emitted once, and nodes with constant arguments are
+	// folded to constants where possible. The symbol is only used when a new
+	// node is emitted. Without sharemode every call emits a new node.
+	int get_node_nid(const string &op, int sid, const vector<int> &args, const vector<int> &imms = {}, const string &symbol = string())
+	{
+		auto key = std::make_tuple(op, sid, args, imms);
+
+		if (sharemode)
+		{
+			if (op == "ite") {
+				auto c = const_values.find(args[0]);
+				if (c != const_values.end() && c->second.is_fully_def())
+					return c->second.as_bool() ? args[1] : args[2];
+				if (args[1] == args[2])
+					return args[1];
+			}
+
+			auto it = node_nids.find(key);
+			if (it != node_nids.end())
+				return it->second;
+
+			if (sid_width.count(sid)) {
+				vector<Const> const_args;
+				for (int arg : args) {
+					auto c = const_values.find(arg);
+					if (c == const_values.end() || !c->second.is_fully_def())
+						break;
+					const_args.push_back(c->second);
+				}
+				Const result;
+				if (GetSize(const_args) == GetSize(args) && fold_node(op, sid_width.at(sid), const_args, imms, result) && result.is_fully_def()) {
+					int nid = get_const_nid(result);
+					node_nids[key] = nid;
+					return nid;
+				}
+			}
+		}
+
+		int nid = next_nid++;
+		string line = stringf("%d %s %d", nid, op.c_str(), sid);
+		for (int arg : args)
+			line += stringf(" %d", arg);
+		for (int imm : imms)
+			line += stringf(" %d", imm);
+		btorf("%s%s\n", line.c_str(), symbol.c_str());
+		if (sharemode)
+			node_nids[key] = nid;
+		return nid;
+	}
+
 	void export_cell(Cell *cell)
 	{
 		if (cell_recursion_guard.count(cell)) {
@@ -297,8 +415,7 @@ struct BtorWorker
 
 				// zero-extend the rest
 				int zeroes = get_sig_nid(Const(0, width-width_ay));
-				nid_a = next_nid++;
-				btorf("%d concat %d %d %d\n", nid_a, sid, zeroes, nid_a_padded);
+				nid_a = get_node_nid("concat", sid, {zeroes, nid_a_padded});
 			} else {
 				nid_a = get_sig_nid(cell->getPort(ID::A), width, a_signed);
 			}
@@ -307,36 +424,26 @@ struct BtorWorker
 
 			if (btor_op == "shift")
 			{
-				int nid_r = next_nid++;
-				btorf("%d srl %d %d %d\n", nid_r, sid, nid_a, nid_b);
-
-				int nid_b_neg = next_nid++;
-				btorf("%d neg %d %d\n", nid_b_neg, sid, nid_b);
-
-				int nid_l = next_nid++;
-				btorf("%d sll %d %d %d\n", nid_l, sid, nid_a, nid_b_neg);
+				int nid_r = get_node_nid("srl", sid, {nid_a, nid_b});
+				int nid_b_neg = get_node_nid("neg", sid, {nid_b});
+				int nid_l = get_node_nid("sll", sid, {nid_a, nid_b_neg});
 
 				int sid_bit = get_bv_sid(1);
 				int nid_zero = get_sig_nid(Const(0, width));
-				int nid_b_ltz = next_nid++;
-				btorf("%d slt %d %d %d\n", nid_b_ltz, sid_bit, nid_b, nid_zero);
+				int nid_b_ltz = get_node_nid("slt", sid_bit, {nid_b, nid_zero});
 
-				nid = next_nid++;
-				btorf("%d ite %d %d %d %d%s\n", nid, sid, nid_b_ltz, nid_l, nid_r, getinfo(cell).c_str());
+				nid = get_node_nid("ite", sid, {nid_b_ltz, nid_l, nid_r}, {}, getinfo(cell));
 			}
 			else
 			{
-				nid = next_nid++;
-				btorf("%d %s %d %d %d%s\n", nid, btor_op.c_str(), sid, nid_a, nid_b, getinfo(cell).c_str());
+				nid = get_node_nid(btor_op, sid, {nid_a, nid_b}, {}, getinfo(cell));
 			}
 
 			SigSpec sig = sigmap(cell->getPort(ID::Y));
 
 			if (GetSize(sig) < width) {
 				int sid = get_bv_sid(GetSize(sig));
-				int nid2 = next_nid++;
-				btorf("%d slice %d %d %d 0\n", nid2, sid, nid, GetSize(sig)-1);
-				nid = nid2;
+				nid = get_node_nid("slice", sid, {nid}, {GetSize(sig)-1, 0});
 			}
 
 			add_nid_sig(nid, sig);
@@ -367,16 +474,13 @@ struct BtorWorker
 			int nid_b = get_sig_nid(cell->getPort(ID::B), width, b_signed);
 
 			int sid = get_bv_sid(width);
-			int nid = next_nid++;
-			btorf("%d %c%s %d %d %d%s\n", nid, a_signed || b_signed ? 's' : 'u', btor_op.c_str(), sid, nid_a, nid_b, getinfo(cell).c_str());
+			int nid = get_node_nid(stringf("%c%s", a_signed || b_signed ? 's' : 'u', btor_op.c_str()), sid, {nid_a, nid_b}, {}, getinfo(cell));
 
 			SigSpec sig = sigmap(cell->getPort(ID::Y));
 
 			if (GetSize(sig) < width) {
 				int sid = get_bv_sid(GetSize(sig));
-				int nid2 = next_nid++;
-				btorf("%d slice %d %d %d 0\n", nid2, sid, nid, GetSize(sig)-1);
-				nid = nid2;
+				nid = get_node_nid("slice", sid, {nid}, {GetSize(sig)-1, 0});
 			}
 
 			add_nid_sig(nid, sig);
@@ -389,18 +493,8 @@ struct BtorWorker
 			int nid_a = get_sig_nid(cell->getPort(ID::A));
 			int nid_b = get_sig_nid(cell->getPort(ID::B));
 
-			int nid1 = next_nid++;
-			int nid2 = next_nid++;
-
-			if (cell->type == ID($_ANDNOT_)) {
-				btorf("%d not %d %d\n", nid1, sid, nid_b);
-				btorf("%d and %d %d %d%s\n", nid2, sid, nid_a, nid1, getinfo(cell).c_str());
-			}
-
-			if (cell->type == ID($_ORNOT_)) {
-				btorf("%d not %d %d\n", nid1, sid, nid_b);
-				btorf("%d or %d %d %d%s\n", nid2, sid, nid_a, nid1, getinfo(cell).c_str());
-			}
+			int nid1 = get_node_nid("not", sid, {nid_b});
+			int nid2 = get_node_nid(cell->type == ID($_ANDNOT_) ? "and" : "or", sid, {nid_a, nid1}, {}, getinfo(cell));
 
 			SigSpec sig = sigmap(cell->getPort(ID::Y));
 			add_nid_sig(nid2, sig);
@@ -414,21 +508,12 @@ struct BtorWorker
 			int nid_b = get_sig_nid(cell->getPort(ID::B));
 			int nid_c = get_sig_nid(cell->getPort(ID::C));
 
-			int nid1 = next_nid++;
-			int nid2 = next_nid++;
-			int nid3 = next_nid++;
-
-			if (cell->type == ID($_OAI3_)) {
-				btorf("%d or %d %d %d\n", nid1, sid, nid_a, nid_b);
-				btorf("%d and %d %d %d\n", nid2, sid, nid1, nid_c);
-				btorf("%d not %d %d%s\n", nid3, sid, nid2, getinfo(cell).c_str());
-			}
+			const char *op1 = cell->type == ID($_OAI3_) ? "or" : "and";
+			const char *op2 = cell->type == ID($_OAI3_) ? "and" : "or";
 
-			if (cell->type == ID($_AOI3_)) {
-				btorf("%d and %d %d %d\n", nid1, sid, nid_a, nid_b);
-				btorf("%d or %d %d %d\n", nid2, sid, nid1, nid_c);
-				btorf("%d not %d %d%s\n", nid3, sid, nid2, getinfo(cell).c_str());
-			}
+			int nid1 = get_node_nid(op1, sid, {nid_a, nid_b});
+			int nid2 = get_node_nid(op2, sid, {nid1, nid_c});
+			int nid3 = get_node_nid("not", sid, {nid2}, {}, getinfo(cell));
 
 			SigSpec sig = sigmap(cell->getPort(ID::Y));
 			add_nid_sig(nid3, sig);
@@ -443,24 +528,13 @@ struct BtorWorker
 			int nid_c = get_sig_nid(cell->getPort(ID::C));
 			int nid_d = get_sig_nid(cell->getPort(ID::D));
 
-			int nid1 = next_nid++;
-			int nid2 = next_nid++;
-			int nid3 = next_nid++;
-			int nid4 = next_nid++;
+			const char *op1 = cell->type == ID($_OAI4_) ? "or" : "and";
+			const char *op2 = cell->type == ID($_OAI4_) ? "and" : "or";
 
-			if (cell->type == ID($_OAI4_)) {
-				btorf("%d or %d %d %d\n", nid1, sid, nid_a, nid_b);
-				btorf("%d or %d %d %d\n", nid2, sid, nid_c, nid_d);
-				btorf("%d and %d %d %d\n", nid3, sid, nid1, nid2);
-				btorf("%d not %d %d%s\n", nid4, sid, nid3, getinfo(cell).c_str());
-			}
-
-			if (cell->type == ID($_AOI4_)) {
-				btorf("%d and %d %d %d\n", nid1, sid, nid_a, nid_b);
-				btorf("%d and %d %d %d\n", nid2, sid, nid_c, nid_d);
-				btorf("%d or %d %d %d\n", nid3, sid, nid1, nid2);
-				btorf("%d not %d %d%s\n", nid4, sid, nid3, getinfo(cell).c_str());
-			}
+			int nid1 = get_node_nid(op1, sid, {nid_a, nid_b});
+			int nid2 = get_node_nid(op1, sid, {nid_c, nid_d});
+			int nid3 = get_node_nid(op2, sid, {nid1, nid2});
+			int nid4 = get_node_nid("not", sid, {nid3}, {}, getinfo(cell));
 
 			SigSpec sig = sigmap(cell->getPort(ID::Y));
 			add_nid_sig(nid4, sig);
@@ -489,20 +563,15 @@ struct BtorWorker
 			int nid_a = get_sig_nid(cell->getPort(ID::A), width, a_signed);
 			int nid_b = get_sig_nid(cell->getPort(ID::B), width, b_signed);
 
-			int nid = next_nid++;
-			if (cell->type.in(ID($lt), ID($le), ID($ge), ID($gt))) {
-				btorf("%d %c%s %d %d %d%s\n", nid, a_signed || b_signed ? 's' : 'u', btor_op.c_str(), sid, nid_a, nid_b, getinfo(cell).c_str());
-			} else {
-				btorf("%d %s %d %d %d%s\n", nid, btor_op.c_str(), sid, nid_a, nid_b, getinfo(cell).c_str());
-			}
+			if (cell->type.in(ID($lt), ID($le), ID($ge), ID($gt)))
+				btor_op = stringf("%c%s", a_signed || b_signed ? 's' : 'u', btor_op.c_str());
+			int nid = get_node_nid(btor_op, sid, {nid_a, nid_b}, {}, getinfo(cell));
 
 			SigSpec sig = sigmap(cell->getPort(ID::Y));
 
 			if (GetSize(sig) > 1) {
 				int sid = get_bv_sid(GetSize(sig));
-				int nid2 = next_nid++;
-				btorf("%d uext %d %d %d\n", nid2, sid, nid, GetSize(sig) - 1);
-				nid = nid2;
+				nid = get_node_nid("uext", sid, {nid}, {GetSize(sig) - 1});
 			}
 
 			add_nid_sig(nid, sig);
@@ -527,15 +596,12 @@ struct BtorWorker
 			{
 				log_assert(!btor_op.empty());
 				int sid = get_bv_sid(width);
-				nid = next_nid++;
-				btorf("%d %s %d %d%s\n", nid, btor_op.c_str(), sid, nid_a, getinfo(cell).c_str());
+				nid = get_node_nid(btor_op, sid, {nid_a}, {}, getinfo(cell));
 			}
 
 			if (GetSize(sig) < width) {
 				int sid = get_bv_sid(GetSize(sig));
-				int nid2 = next_nid++;
-				btorf("%d slice %d %d %d 0\n", nid2, sid, nid, GetSize(sig)-1);
-				nid = nid2;
+				nid = get_node_nid("slice", sid, {nid}, {GetSize(sig)-1, 0});
 			}
 
 			add_nid_sig(nid, sig);
@@ -554,32 +620,24 @@ struct BtorWorker
 			int nid_a = get_sig_nid(cell->getPort(ID::A));
 			int nid_b = btor_op != "not" ? get_sig_nid(cell->getPort(ID::B)) : 0;
 
-			if (GetSize(cell->getPort(ID::A)) > 1) {
-				int nid_red_a = next_nid++;
-				btorf("%d redor %d %d\n", nid_red_a, sid, nid_a);
-				nid_a = nid_red_a;
-			}
+			if (GetSize(cell->getPort(ID::A)) > 1)
+				nid_a = get_node_nid("redor", sid, {nid_a});
 
-			if (btor_op != "not" && GetSize(cell->getPort(ID::B)) > 1) {
-				int nid_red_b = next_nid++;
-				btorf("%d redor %d %d\n", nid_red_b, sid, nid_b);
-				nid_b = nid_red_b;
-			}
+			if (btor_op != "not" && GetSize(cell->getPort(ID::B)) > 1)
+				nid_b = get_node_nid("redor", sid, {nid_b});
 
-			int nid = next_nid++;
+			int nid;
 			if (btor_op != "not")
-				btorf("%d %s %d %d %d%s\n", nid, btor_op.c_str(), sid, nid_a, nid_b, getinfo(cell).c_str());
+				nid = get_node_nid(btor_op, sid, {nid_a, nid_b}, {}, getinfo(cell));
 			else
-				btorf("%d %s %d %d%s\n", nid, btor_op.c_str(), sid, nid_a, getinfo(cell).c_str());
+				nid = get_node_nid(btor_op, sid, {nid_a}, {}, getinfo(cell));
 
 			SigSpec sig = sigmap(cell->getPort(ID::Y));
 
 			if (GetSize(sig) > 1) {
 				int sid = get_bv_sid(GetSize(sig));
 				int zeros_nid = get_sig_nid(Const(0, GetSize(sig)-1));
-				int nid2 = next_nid++;
-				btorf("%d concat %d %d %d\n", nid2, sid, zeros_nid, nid);
-				nid = nid2;
+				nid = get_node_nid("concat", sid, {zeros_nid, nid});
 			}
 
 			add_nid_sig(nid, sig);
@@ -597,25 +655,17 @@ struct BtorWorker
 			int sid = get_bv_sid(1);
 			int nid_a = get_sig_nid(cell->getPort(ID::A));
 
-			int nid = next_nid++;
+			int nid = get_node_nid(btor_op, sid, {nid_a}, {}, getinfo(cell));
 
-			if (cell->type == ID($reduce_xnor)) {
-				int nid2 = next_nid++;
-				btorf("%d %s %d %d%s\n", nid, btor_op.c_str(), sid, nid_a, getinfo(cell).c_str());
-				btorf("%d not %d %d\n", nid2, sid, nid);
-				nid = nid2;
-			} else {
-				btorf("%d %s %d %d%s\n", nid, btor_op.c_str(), sid, nid_a, getinfo(cell).c_str());
-			}
+			if (cell->type == ID($reduce_xnor))
+				nid = get_node_nid("not", sid, {nid});
 
 			SigSpec sig = sigmap(cell->getPort(ID::Y));
 
 			if (GetSize(sig) > 1) {
 				int sid = get_bv_sid(GetSize(sig));
 				int zeros_nid = get_sig_nid(Const(0, GetSize(sig)-1));
-				int nid2 = next_nid++;
-				btorf("%d concat %d %d %d\n", nid2, sid, zeros_nid, nid);
-				nid = nid2;
+				nid = get_node_nid("concat", sid, {zeros_nid, nid});
 			}
 
 			add_nid_sig(nid, sig);
@@ -634,15 +684,13 @@ struct BtorWorker
 			int nid_s = get_sig_nid(sig_s);
 
 			int sid = get_bv_sid(GetSize(sig_y));
-			int nid = next_nid++;
+			int nid;
 
 			if (cell->type == ID($_NMUX_)) {
-				int tmp = nid;
-				nid = next_nid++;
-				btorf("%d ite %d %d %d %d\n", tmp, sid, nid_s, nid_b, nid_a);
-				btorf("%d not %d %d%s\n", nid, sid, tmp, getinfo(cell).c_str());
+				int tmp = get_node_nid("ite", sid, {nid_s, nid_b, nid_a});
+				nid = get_node_nid("not", sid, {tmp}, {}, getinfo(cell));
 			} else {
-				btorf("%d ite %d %d %d %d%s\n", nid, sid, nid_s, nid_b, nid_a, getinfo(cell).c_str());
+				nid = get_node_nid("ite", sid, {nid_s, nid_b, nid_a}, {}, getinfo(cell));
 			}
 
 			add_nid_sig(nid, sig_y);
@@ -663,12 +711,7 @@ struct BtorWorker
 			for (int i = 0; i < GetSize(sig_s); i++) {
 				int nid_b = get_sig_nid(sig_b.extract(i*width, width));
 				int nid_s = get_sig_nid(sig_s.extract(i));
-				int nid2 = next_nid++;
-				if (i == GetSize(sig_s)-1)
-					btorf("%d ite %d %d %d %d%s\n", nid2, sid, nid_s, nid_b, nid, getinfo(cell).c_str());
-				else
-					btorf("%d ite %d %d %d %d\n", nid2, sid, nid_s, nid_b, nid);
-				nid = nid2;
+				nid = get_node_nid("ite", sid, {nid_s, nid_b, nid}, {}, i == GetSize(sig_s)-1 ? getinfo(cell) : string());
 			}
 
 			add_nid_sig(nid, sig_y);
@@ -896,26 +939,16 @@ struct BtorWorker
 					int nid2 = next_nid++;
 					btorf("%d read %d %d %d\n", nid2, data_sid, nid_head, wa_nid);
 
-					int nid3 = next_nid++;
-					btorf("%d not %d %d\n", nid3, data_sid, we_nid);
-
-					int nid4 = next_nid++;
-					btorf("%d and %d %d %d\n", nid4, data_sid, nid2, nid3);
-
-					int nid5 = next_nid++;
-					btorf("%d and %d %d %d\n", nid5, data_sid, wd_nid, we_nid);
-
-					int nid6 = next_nid++;
-					btorf("%d or %d %d %d\n", nid6, data_sid, nid5, nid4);
+					int nid3 = get_node_nid("not", data_sid, {we_nid});
+					int nid4 = get_node_nid("and", data_sid, {nid2, nid3});
+					int nid5 = get_node_nid("and", data_sid, {wd_nid, we_nid});
+					int nid6 = get_node_nid("or", data_sid, {nid5, nid4});
 
 					int nid7 = next_nid++;
 					btorf("%d write %d %d %d %d\n", nid7, sid, nid_head, wa_nid, nid6);
 
-					int nid8 = next_nid++;
-					btorf("%d redor %d %d\n", nid8, bool_sid, we_nid);
-
-					int nid9 = next_nid++;
-					btorf("%d ite %d %d %d %d\n", nid9, sid, nid8, nid7, nid_head);
+					int nid8 = get_node_nid("redor", bool_sid, {we_nid});
+					int nid9 = get_node_nid("ite", sid, {nid8, nid7, nid_head});
 
 					nid_head = nid9;
 				}
@@ -1011,16 +1044,14 @@ struct BtorWorker
 					nid_masked_input = nid_input;
 				} else {
 					int nid_mask_undef = get_sig_nid(sig_mask_undef);
-					nid_masked_input = next_nid++;
-					btorf("%d and %d %d %d\n", nid_masked_input, sid, nid_input, nid_mask_undef);
+					nid_masked_input = get_node_nid("and", sid, {nid_input, nid_mask_undef});
 				}
 
 				if (sig_noundef.is_fully_zero()) {
 					nid = nid_masked_input;
 				} else {
 					int nid_noundef = get_sig_nid(sig_noundef);
-					nid = next_nid++;
-					btorf("%d or %d %d %d\n", nid, sid, nid_masked_input, nid_noundef);
+					nid = get_node_nid("or", sid, {nid_masked_input, nid_noundef});
 				}
 
 				goto extend_or_trim;
@@ -1048,15 +1079,7 @@ struct BtorWorker
 						while (i+GetSize(c) < GetSize(sig) && sig[i+GetSize(c)].wire == nullptr)
 							c.bits().push_back(sig[i+GetSize(c)].data);
 
-						if (consts.count(c) == 0) {
-							int sid = get_bv_sid(GetSize(c));
-							int nid = next_nid++;
-							btorf("%d const %d %s\n", nid, sid, c.as_string().c_str());
-							consts[c] = nid;
-							nid_width[nid] = GetSize(c);
-						}
-
-						int nid = consts.at(c);
+						int nid = get_const_nid(c);
 
 						for (int j = 0; j < GetSize(c); j++)
 							nidbits.push_back(make_pair(nid, j));
@@ -1118,16 +1141,14 @@ struct BtorWorker
 
 				if (lower != 0 || upper+1 != nid_width.at(nid2)) {
 					int sid = get_bv_sid(upper-lower+1);
-					nid3 = next_nid++;
-					btorf("%d slice %d %d %d %d\n", nid3, sid, nid2, upper, lower);
+					nid3 = get_node_nid("slice", sid, {nid2}, {upper, lower});
 				}
 
 				int nid4 = nid3;
 
 				if (nid >= 0) {
 					int sid = get_bv_sid(width+upper-lower+1);
-					nid4 = next_nid++;
-					btorf("%d concat %d %d %d\n", nid4, sid, nid3, nid);
+					nid4 = get_node_nid("concat", sid, {nid3, nid});
 				}
 
 				width += upper-lower+1;
@@ -1146,25 +1167,20 @@ struct BtorWorker
 			if (to_width < GetSize(sig))
 			{
 				int sid = get_bv_sid(to_width);
-				int nid2 = next_nid++;
-				btorf("%d slice %d %d %d 0\n", nid2, sid, nid, to_width-1);
-				nid = nid2;
+				nid = get_node_nid("slice", sid, {nid}, {to_width-1, 0});
 			}
 			else
 			{
 				int sid = get_bv_sid(to_width);
-				int nid2 = next_nid++;
-				btorf("%d %s %d %d %d\n", nid2, is_signed ? "sext" : "uext",
-						sid, nid, to_width - GetSize(sig));
-				nid = nid2;
+				nid = get_node_nid(is_signed ? "sext" : "uext", sid, {nid}, {to_width - GetSize(sig)});
 			}
 		}
 
 		return nid;
 	}
 
-	BtorWorker(std::ostream &f, RTLIL::Module *module, bool verbose, bool single_bad, bool cover_mode, bool print_internal_names, string info_filename, string ywmap_filename) :
-			f(f), sigmap(module), module(module), verbose(verbose), single_bad(single_bad), cover_mode(cover_mode), print_internal_names(print_internal_names), info_filename(info_filename)
+	BtorWorker(std::ostream &f, RTLIL::Module *module, bool verbose, bool single_bad, bool cover_mode, bool print_internal_names, bool sharemode, string info_filename, string ywmap_filename) :
+			f(f), sigmap(module), module(module), verbose(verbose), single_bad(single_bad), cover_mode(cover_mode), print_internal_names(print_internal_names), sharemode(sharemode), info_filename(info_filename)
 	{
 		if (!info_filename.empty())
 			infof("name %s\n", log_id(module));
@@ -1274,12 +1290,10 @@ struct BtorWorker
 				int sid = get_bv_sid(1);
 				int nid_a = get_sig_nid(cell->getPort(ID::A));
 				int nid_en = get_sig_nid(cell->getPort(ID::EN));
-				int nid_not_en = next_nid++;
-				int nid_a_or_not_en = next_nid++;
+				int nid_not_en = get_node_nid("not", sid, {nid_en});
+				int nid_a_or_not_en = get_node_nid("or", sid, {nid_a, nid_not_en});
 				int nid = next_nid++;
 
-				btorf("%d not %d %d\n", nid_not_en, sid, nid_en);
-				btorf("%d or %d %d %d\n", nid_a_or_not_en, sid, nid_a, nid_not_en);
 				btorf("%d constraint %d\n", nid, nid_a_or_not_en);
 
 				btorf_pop(log_id(cell));
@@ -1292,11 +1306,8 @@ struct BtorWorker
 				int sid = get_bv_sid(1);
 				int nid_a = get_sig_nid(cell->getPort(ID::A));
 				int nid_en = get_sig_nid(cell->getPort(ID::EN));
-				int nid_not_a = next_nid++;
-				int nid_en_and_not_a = next_nid++;
-
-				btorf("%d not %d %d\n", nid_not_a, sid, nid_a);
-				btorf("%d and %d %d %d\n", nid_en_and_not_a, sid, nid_en, nid_not_a);
+				int nid_not_a = get_node_nid("not", sid, {nid_a});
+				int nid_en_and_not_a = get_node_nid("and", sid, {nid_en, nid_not_a});
 
 				if (single_bad && !cover_mode) {
 					bad_properties.push_back(nid_en_and_not_a);
@@ -1319,9 +1330,7 @@ struct BtorWorker
 				int sid = get_bv_sid(1);
 				int nid_a = get_sig_nid(cell->getPort(ID::A));
 				int nid_en = get_sig_nid(cell->getPort(ID::EN));
-				int nid_en_and_a = next_nid++;
-
-				btorf("%d and %d %d %d\n", nid_en_and_a, sid, nid_en, nid_a);
+				int nid_en_and_a = get_node_nid("and", sid, {nid_en, nid_a});
 
 				if (single_bad) {
 					bad_properties.push_back(nid_en_and_a);
@@ -1405,26 +1414,16 @@ struct BtorWorker
 					int nid2 = next_nid++;
 					btorf("%d read %d %d %d\n", nid2, data_sid, nid_head, wa_nid);
 
-					int nid3 = next_nid++;
-					btorf("%d not %d %d\n", nid3, data_sid, we_nid);
-
-					int nid4 = next_nid++;
-					btorf("%d and %d %d %d\n", nid4, data_sid, nid2, nid3);
-
-					int nid5 = next_nid++;
-					btorf("%d and %d %d %d\n", nid5, data_sid, wd_nid, we_nid);
-
-					int nid6 = next_nid++;
-					btorf("%d or %d %d %d\n", nid6, data_sid, nid5, nid4);
+					int nid3 = get_node_nid("not", data_sid, {we_nid});
+					int nid4 = get_node_nid("and", data_sid, {nid2, nid3});
+					int nid5 = get_node_nid("and", data_sid, {wd_nid, we_nid});
+					int nid6 = get_node_nid("or", data_sid, {nid5, nid4});
 
 					int nid7 = next_nid++;
 					btorf("%d write %d %d %d %d\n", nid7, sid, nid_head, wa_nid, nid6);
 
-					int nid8 = next_nid++;
-					btorf("%d redor %d %d\n", nid8, bool_sid, we_nid);
-
-					int nid9 = next_nid++;
-					btorf("%d ite %d %d %d %d\n", nid9, sid, nid8, nid7, nid_head);
+					int nid8 = get_node_nid("redor", bool_sid, {we_nid});
+					int nid9 = get_node_nid("ite", sid, {nid8, nid7, nid_head});
 
 					nid_head = nid9;
 				}
@@ -1448,10 +1447,7 @@ struct BtorWorker
 			{
 				int nid_a = todo[cursor++];
 				int nid_b = todo[cursor++];
-				int nid = next_nid++;
-
-				bad_properties.push_back(nid);
-				btorf("%d or %d %d %d\n", nid, sid, nid_a, nid_b);
+				bad_properties.push_back(get_node_nid("or", sid, {nid_a, nid_b}));
 			}
 
 			if (!bad_properties.empty()) {
@@ -1543,6 +1539,10 @@ struct BtorBackend : public Backend {
 		log("\n");
 		log("Write a BTOR description of the current design.\n");
 		log("\n");
+		log("Identical nodes are only written once, and nodes with only constant arguments\n");
+		log("are replaced by constants (see -noshare). A filename ending in .gz is written\n");
+		log("compressed.\n");
+		log("\n");
 		log("  -v\n");
 		log("    Add comments and indentation to BTOR output file\n");
 		log("\n");
@@ -1561,10 +1561,14 @@ struct BtorBackend : public Backend {
 		log("  -ywmap <filename>\n");
 		log("    Create a map file for conversion to and from Yosys witness traces\n");
 		log("\n");
+		log("  -noshare\n");
+		log("    Write a new node for every use, without sharing identical nodes or\n");
+		log("    folding constants\n");
+		log("\n");
 	}
 	void execute(std::ostream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design) override
 	{
-		bool verbose = false, single_bad = false, cover_mode = false, print_internal_names = false;
+		bool verbose = false, single_bad = false, cover_mode = false, print_internal_names = false, sharemode = true;
 		string info_filename;
 		string ywmap_filename;
 
@@ -1603,6 +1607,10 @@ struct BtorBackend : public Backend {
 				ywmap_filename = args[++argidx];
 				continue;
 			}
+			if (args[argidx] == "-noshare") {
+				sharemode = false;
+				continue;
+			}
 			break;
 		}
 		extra_args(f, filename, args, argidx);
@@ -1615,7 +1623,7 @@ struct BtorBackend : public Backend {
 		*f << stringf("; BTOR description generated by %s for module %s.\n",
 				yosys_maybe_version(), log_id(topmod));
 
-		BtorWorker(*f, topmod, verbose, single_bad, cover_mode, print_internal_names, info_filename, ywmap_filename);
+		BtorWorker(*f, topmod, verbose, single_bad, cover_mode, print_internal_names, sharemode, info_filename, ywmap_filename);
 
 		*f << stringf("; end of yosys output\n");
 	}
@@ -23,6 +23,8 @@
 #include "kernel/celltypes.h"
 #include "kernel/cellaigs.h"
 #include "kernel/log.h"
+#include "kernel/threading.h"
+#include <charconv>
 #include <string>
 
 USING_YOSYS_NAMESPACE
@@ -35,73 +37,131 @@ struct JsonWriter
 	bool aig_mode;
 	bool compat_int_mode;
 	bool scopeinfo_mode;
+	int threads = 1;
 
 	Design *design;
 	Module *module;
 
 	SigMap sigmap;
 	int sigidcounter;
-	dict<SigBit, string> sigids;
+	dict<SigBit, int> sigids;
+	// for each numbered wire bit, the id of the bit it is mapped to, or
+	// -1 - state when it is mapped to a constant
+	dict<SigBit, int> bitcodes;
 	pool<Aig> aig_models;
 
+	// whether the cell types of the module are known and the directions of
+	// their ports (1 for input, 2 for output), keyed by IdString indices
+	dict<int, bool> type_known;
+	dict<std::pair<int, int>, int> port_dirs;
+
+	// The text is formatted into this buffer, which is written to `f` by
+	// flush() before the cells and netnames and after each module.
+	std::string out;
+
 	JsonWriter(std::ostream &f, bool use_selection, bool aig_mode, bool compat_int_mode, bool scopeinfo_mode) :
 			f(f), use_selection(use_selection), aig_mode(aig_mode),
 			compat_int_mode(compat_int_mode), scopeinfo_mode(scopeinfo_mode) { }
 
-	string get_string(string str)
+	static void put_int(string &out, int64_t value)
+	{
+		char buffer[24];
+		auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+		out.append(buffer, result.ptr);
+	}
+
+	static void put_string(string &out, const string &str)
 	{
-		string newstr = "\"";
+		out += '"';
 		for (char c : str) {
 			if (c == '\\')
-				newstr += "\\\\";
+				out += "\\\\";
 			else if (c == '"')
-				newstr += "\\\"";
+				out += "\\\"";
 			else if (c == '\b')
-				newstr += "\\b";
+				out += "\\b";
 			else if (c == '\f')
-				newstr += "\\f";
+				out += "\\f";
 			else if (c == '\n')
-				newstr += "\\n";
+				out += "\\n";
 			else if (c == '\r')
-				newstr += "\\r";
+				out += "\\r";
 			else if (c == '\t')
-				newstr += "\\t";
+				out += "\\t";
 			else if (c < 0x20)
-				newstr += stringf("\\u%04X", c);
+				out += stringf("\\u%04X", c);
 			else
-				newstr += c;
+				out += c;
 		}
-		return newstr + "\"";
+		out += '"';
 	}
 
-	string get_name(IdString name)
+	static void put_name(string &out, const IdString &name)
 	{
-		return get_string(RTLIL::unescape_id(name));
+		const char *str = name.c_str();
+		if (*str == '\\')
+			str++;
+		put_string(out, str);
 	}
 
-	string get_bits(SigSpec sig)
+	// Assigns the ids of the bits in the order in which they are written,
+	// so that put_bits() only needs to look them up. It must not apply the
+	// SigMap, whose lookups modify it.
+	void number_bits(const SigSpec &sig)
+	{
+		for (auto bit : sig) {
+			if (bit.wire == nullptr || bitcodes.count(bit))
+				continue;
+			SigBit mapped = sigmap(bit);
+			if (mapped.wire == nullptr) {
+				bitcodes[bit] = -1 - mapped.data;
+				continue;
+			}
+			auto it = sigids.find(mapped);
+			if (it == sigids.end())
+				it = sigids.emplace(mapped, sigidcounter++).first;
+			bitcodes[bit] = it->second;
+		}
+	}
+
+	// Records the port directions of the cell, which put_cell() looks up.
+	void note_cell_type(Cell *c)
+	{
+		auto it = type_known.find(c->type.index_);
+		if (it == type_known.end())
+			it = type_known.emplace(c->type.index_, c->known()).first;
+		if (!it->second)
+			return;
+		for (auto &conn : c->connections()) {
+			auto key = std::make_pair(c->type.index_, conn.first.index_);
+			if (port_dirs.count(key) == 0)
+				port_dirs[key] = c->input(conn.first) + 2 * c->output(conn.first);
+		}
+	}
+
+	void put_bits(string &out, const SigSpec &sig) const
 	{
 		bool first = true;
-		string str = "[";
-		for (auto bit : sigmap(sig)) {
-			str += first ? " " : ", ";
+		out += '[';
+		for (auto bit : sig) {
+			out += first ? " " : ", ";
 			first = false;
-			if (sigids.count(bit) == 0) {
-				string &s = sigids[bit];
-				if (bit.wire == nullptr) {
-					if (bit == State::S0) s = "\"0\"";
-					else if (bit == State::S1) s = "\"1\"";
-					else if (bit == State::Sz) s = "\"z\"";
-					else s = "\"x\"";
-				} else
-					s = stringf("%d", sigidcounter++);
-			}
-			str += sigids[bit];
+			int code = bit.wire == nullptr ? -1 - bit.data : bitcodes.at(bit);
+			if (code >= 0)
+				put_int(out, code);
+			else if (code == -1 - State::S0)
+				out += "\"0\"";
+			else if (code == -1 - State::S1)
+				out += "\"1\"";
+			else if (code == -1 - State::Sz)
+				out += "\"z\"";
+			else
+				out += "\"x\"";
 		}
-		return str + " ]";
+		out += " ]";
 	}
 
-	void write_parameter_value(const Const &value)
+	void put_parameter_value(string &out, const Const &value) const
 	{
 		if ((value.flags & RTLIL::ConstFlags::CONST_FLAG_STRING) != 0) {
 			string str = value.decode_string();
@@ -119,34 +179,148 @@ struct JsonWriter
 			}
 			if (state < 2)
 				str += " ";
-			f << get_string(str);
+			put_string(out, str);
 		} else if (compat_int_mode && GetSize(value) <= 32 && value.is_fully_def()) {
 			if ((value.flags & RTLIL::ConstFlags::CONST_FLAG_SIGNED) != 0)
-				f << stringf("%d", value.as_int());
+				put_int(out, value.as_int());
 			else
-				f << stringf("%u", value.as_int());
+				put_int(out, uint32_t(value.as_int()));
 		} else {
-			f << get_string(value.as_string());
+			put_string(out, value.as_string());
 		}
 	}
 
-	void write_parameters(const dict<IdString, Const> &parameters, bool for_module=false)
+	void put_parameters(string &out, const dict<IdString, Const> &parameters, bool for_module=false) const
 	{
 		bool first = true;
 		for (auto &param : parameters) {
-			f << stringf("%s\n", first ? "" : ",");
-			f << stringf("        %s%s: ", for_module ? "" : "    ", get_name(param.first).c_str());
-			write_parameter_value(param.second);
+			out += first ? "\n" : ",\n";
+			out += for_module ? "        " : "            ";
+			put_name(out, param.first);
+			out += ": ";
+			put_parameter_value(out, param.second);
 			first = false;
 		}
 	}
 
+	bool selected_cell(Cell *c) const
+	{
+		if (use_selection && !module->selected(c))
+			return false;
+		if (!scopeinfo_mode && c->type == ID($scopeinfo))
+			return false;
+		return true;
+	}
+
+	// Formats a cell, which must not create IdStrings unless in aig_mode,
+	// where the cells are formatted on a single thread.
+	void put_cell(string &out, Cell *c)
+	{
+		out += "        ";
+		put_name(out, c->name);
+		out += ": {\n";
+		out += c->name[0] == '$' ? "          \"hide_name\": 1,\n" : "          \"hide_name\": 0,\n";
+		out += "          \"type\": ";
+		put_name(out, c->type);
+		out += ",\n";
+		if (aig_mode) {
+			Aig aig(c);
+			if (!aig.name.empty()) {
+				out += "          \"model\": \"";
+				out += aig.name;
+				out += "\",\n";
+				aig_models.insert(aig);
+			}
+		}
+		out += "          \"parameters\": {";
+		put_parameters(out, c->parameters);
+		out += "\n          },\n";
+		out += "          \"attributes\": {";
+		put_parameters(out, c->attributes);
+		out += "\n          },\n";
+		if (type_known.at(c->type.index_)) {
+			out += "          \"port_directions\": {";
+			bool first2 = true;
+			for (auto &conn : c->connections()) {
+				int dirs = port_dirs.at(std::make_pair(c->type.index_, conn.first.index_));
+				const char *direction = "output";
+				if (dirs & 1)
+					direction = (dirs & 2) ? "inout" : "input";
+				out += first2 ? "\n" : ",\n";
+				out += "            ";
+				put_name(out, conn.first);
+				out += ": \"";
+				out += direction;
+				out += '"';
+				first2 = false;
+			}
+			out += "\n          },\n";
+		}
+		out += "          \"connections\": {";
+		bool first2 = true;
+		for (auto &conn : c->connections()) {
+			out += first2 ? "\n" : ",\n";
+			out += "            ";
+			put_name(out, conn.first);
+			out += ": ";
+			put_bits(out, conn.second);
+			first2 = false;
+		}
+		out += "\n          }\n";
+		out += "        }";
+	}
+
+	void put_netname(string &out, Wire *w) const
+	{
+		out += "        ";
+		put_name(out, w->name);
+		out += ": {\n";
+		out += w->name[0] == '$' ? "          \"hide_name\": 1,\n" : "          \"hide_name\": 0,\n";
+		out += "          \"bits\": ";
+		put_bits(out, w);
+		out += ",\n";
+		if (w->start_offset) {
+			out += "          \"offset\": ";
+			put_int(out, w->start_offset);
+			out += ",\n";
+		}
+		if (w->upto)
+			out += "          \"upto\": 1,\n";
+		if (w->is_signed)
+			out += "          \"signed\": 1,\n";
+		out += "          \"attributes\": {";
+		put_parameters(out, w->attributes);
+		out += "\n          }\n";
+		out += "        }";
+	}
+
+	// Formats the items of a cells or netnames section in chunks on up to
+	// `threads` threads and writes them in their original order.
+	template<typename T, typename F>
+	void put_items(const vector<T*> &items, F put_item)
+	{
+		const size_t chunk = 1024;
+		size_t num_chunks = (items.size() + chunk - 1) / chunk;
+		vector<string> texts(num_chunks);
+		parallel_for(aig_mode ? 1 : threads, num_chunks, [&](size_t i) {
+			string &text = texts[i];
+			for (size_t j = i * chunk; j < items.size() && j < (i + 1) * chunk; j++) {
+				text += j == 0 ? "\n" : ",\n";
+				put_item(text, items[j]);
+			}
+		});
+		flush();
+		for (auto &text : texts)
+			f.write(text.data(), text.size());
+	}
+
 	void write_module(Module *module_)
 	{
 		module = module_;
 		log_assert(module->design == design);
 		sigmap.set(module);
 		sigids.clear();
+		bitcodes.clear();
 
 		// reserve 0 and 1 to avoid confusion with "0" and "1"
 		sigidcounter = 2;
@@ -155,134 +329,109 @@ struct JsonWriter
 			log_error("Module %s contains processes, which are not supported by JSON backend (run `proc` first).\n", log_id(module));
 		}
 
-		f << stringf("    %s: {\n", get_name(module->name).c_str());
+		vector<Wire*> ports, wires;
+		vector<Cell*> cells;
+		for (auto &n : module->ports) {
+			Wire *w = module->wire(n);
+			if (use_selection && !module->selected(w))
+				continue;
+			ports.push_back(w);
+			number_bits(w);
+		}
+		for (auto c : module->cells()) {
+			if (!selected_cell(c))
+				continue;
+			cells.push_back(c);
+			note_cell_type(c);
+			for (auto &conn : c->connections())
+				number_bits(conn.second);
+		}
+		for (auto w : module->wires()) {
+			if (use_selection && !module->selected(w))
+				continue;
+			wires.push_back(w);
+			number_bits(w);
+		}
+
+		// The cells and netnames are formatted concurrently, so the tables
+		// they look up must not rehash on the first lookup after growing.
+		bitcodes.count(SigBit());
+		type_known.count(0);
+		port_dirs.count(std::make_pair(0, 0));
+
+		out += "    ";
+		put_name(out, module->name);
+		out += ": {\n";
 
-		f << stringf("      \"attributes\": {");
-		write_parameters(module->attributes, /*for_module=*/true);
-		f << stringf("\n      },\n");
+		out += "      \"attributes\": {";
+		put_parameters(out, module->attributes, /*for_module=*/true);
+		out += "\n      },\n";
 
 		if (module->parameter_default_values.size()) {
-			f << stringf("      \"parameter_default_values\": {");
-			write_parameters(module->parameter_default_values, /*for_module=*/true);
-			f << stringf("\n      },\n");
+			out += "      \"parameter_default_values\": {";
+			put_parameters(out, module->parameter_default_values, /*for_module=*/true);
+			out += "\n      },\n";
 		}
 
-		f << stringf("      \"ports\": {");
+		out += "      \"ports\": {";
 		bool first = true;
-		for (auto n : module->ports) {
-			Wire *w = module->wire(n);
-			if (use_selection && !module->selected(w))
-				continue;
-			f << stringf("%s\n", first ? "" : ",");
-			f << stringf("        %s: {\n", get_name(n).c_str());
-			f << stringf("          \"direction\": \"%s\",\n", w->port_input ? w->port_output ? "inout" : "input" : "output");
+		for (auto w : ports) {
+			out += first ? "\n" : ",\n";
+			out += "        ";
+			put_name(out, w->name);
+			out += ": {\n";
+			out += stringf("          \"direction\": \"%s\",\n", w->port_input ? w->port_output ? "inout" : "input" : "output");
 			if (w->start_offset)
-				f << stringf("          \"offset\": %d,\n", w->start_offset);
+				out += stringf("          \"offset\": %d,\n", w->start_offset);
 			if (w->upto)
-				f << stringf("          \"upto\": 1,\n");
+				out += "          \"upto\": 1,\n";
 			if (w->is_signed)
-				f << stringf("          \"signed\": %d,\n", w->is_signed);
-			f << stringf("          \"bits\": %s\n", get_bits(w).c_str());
-			f << stringf("        }");
+				out += "          \"signed\": 1,\n";
+			out += "          \"bits\": ";
+			put_bits(out, w);
+			out += "\n        }";
 			first = false;
 		}
-		f << stringf("\n      },\n");
+		out += "\n      },\n";
 
-		f << stringf("      \"cells\": {");
-		first = true;
-		for (auto c : module->cells()) {
-			if (use_selection && !module->selected(c))
-				continue;
-			if (!scopeinfo_mode && c->type == ID($scopeinfo))
-				continue;
-			f << stringf("%s\n", first ? "" : ",");
-			f << stringf("        %s: {\n", get_name(c->name).c_str());
-			f << stringf("          \"hide_name\": %s,\n", c->name[0] == '$' ? "1" : "0");
-			f << stringf("          \"type\": %s,\n", get_name(c->type).c_str());
-			if (aig_mode) {
-				Aig aig(c);
-				if (!aig.name.empty()) {
-					f << stringf("          \"model\": \"%s\",\n", aig.name.c_str());
-					aig_models.insert(aig);
-				}
-			}
-			f << stringf("          \"parameters\": {");
-			write_parameters(c->parameters);
-			f << stringf("\n          },\n");
-			f << stringf("          \"attributes\": {");
-			write_parameters(c->attributes);
-			f << stringf("\n          },\n");
-			if (c->known()) {
-				f << stringf("          \"port_directions\": {");
-				bool first2 = true;
-				for (auto &conn : c->connections()) {
-					string direction = "output";
-					if (c->input(conn.first))
-						direction = c->output(conn.first) ? "inout" : "input";
-					f << stringf("%s\n", first2 ? "" : ",");
-					f << stringf("            %s: \"%s\"", get_name(conn.first).c_str(), direction.c_str());
-					first2 = false;
-				}
-				f << stringf("\n          },\n");
-			}
-			f << stringf("          \"connections\": {");
-			bool first2 = true;
-			for (auto &conn : c->connections()) {
-				f << stringf("%s\n", first2 ? "" : ",");
-				f << stringf("            %s: %s", get_name(conn.first).c_str(), get_bits(conn.second).c_str());
-				first2 = false;
-			}
-			f << stringf("\n          }\n");
-			f << stringf("        }");
-			first = false;
-		}
-		f << stringf("\n      },\n");
+		out += "      \"cells\": {";
+		put_items(cells, [this](string &text, Cell *c) { put_cell(text, c); });
+		out += "\n      },\n";
 
 		if (!module->memories.empty()) {
-			f << stringf("      \"memories\": {");
+			out += "      \"memories\": {";
 			first = true;
 			for (auto &it : module->memories) {
 				if (use_selection && !module->selected(it.second))
 					continue;
-				f << stringf("%s\n", first ? "" : ",");
-				f << stringf("        %s: {\n", get_name(it.second->name).c_str());
-				f << stringf("          \"hide_name\": %s,\n", it.second->name[0] == '$' ? "1" : "0");
-				f << stringf("          \"attributes\": {");
-				write_parameters(it.second->attributes);
-				f << stringf("\n          },\n");
-				f << stringf("          \"width\": %d,\n", it.second->width);
-				f << stringf("          \"start_offset\": %d,\n", it.second->start_offset);
-				f << stringf("          \"size\": %d\n", it.second->size);
-				f << stringf("        }");
+				out += first ? "\n" : ",\n";
+				out += "        ";
+				put_name(out, it.second->name);
+				out += ": {\n";
+				out += stringf("          \"hide_name\": %s,\n", it.second->name[0] == '$' ? "1" : "0");
+				out += "          \"attributes\": {";
+				put_parameters(out, it.second->attributes);
+				out += "\n          },\n";
+				out += stringf("          \"width\": %d,\n", it.second->width);
+				out += stringf("          \"start_offset\": %d,\n", it.second->start_offset);
+				out += stringf("          \"size\": %d\n", it.second->size);
+				out += "        }";
 				first = false;
 			}
-			f << stringf("\n      },\n");
+			out += "\n      },\n";
 		}
 
-		f << stringf("      \"netnames\": {");
-		first = true;
-		for (auto w : module->wires()) {
-			if (use_selection && !module->selected(w))
-				continue;
-			f << stringf("%s\n", first ? "" : ",");
-			f << stringf("        %s: {\n", get_name(w->name).c_str());
-			f << stringf("          \"hide_name\": %s,\n", w->name[0] == '$' ? "1" : "0");
-			f << stringf("          \"bits\": %s,\n", get_bits(w).c_str());
-			if (w->start_offset)
-				f << stringf("          \"offset\": %d,\n", w->start_offset);
-			if (w->upto)
-				f << stringf("          \"upto\": 1,\n");
-			if (w->is_signed)
-				f << stringf("          \"signed\": %d,\n", w->is_signed);
-			f << stringf("          \"attributes\": {");
-			write_parameters(w->attributes);
-			f << stringf("\n          }\n");
-			f << stringf("        }");
-			first = false;
-		}
-		f << stringf("\n      }\n");
+		out += "      \"netnames\": {";
+		put_items(wires, [this](string &text, Wire *w) { put_netname(text, w); });
+		out += "\n      }\n";
+
+		out += "    }";
+	}
 
-		f << stringf("    }");
+	void flush()
+	{
+		f.write(out.data(), out.size());
+		out.clear();
 	}
 
 	void write_design(Design *design_)
@@ -290,48 +439,52 @@ struct JsonWriter
 		design = design_;
 		design->sort();
 
-		f << stringf("{\n");
-		f << stringf("  \"creator\": %s,\n", get_string(yosys_maybe_version()).c_str());
-		f << stringf("  \"modules\": {\n");
+		out += "{\n";
+		out += "  \"creator\": ";
+		put_string(out, yosys_maybe_version());
+		out += ",\n";
+		out += "  \"modules\": {\n";
 		vector<Module*> modules = use_selection ? design->selected_modules() : design->modules();
 		bool first_module = true;
 		for (auto mod : modules) {
 			if (!first_module)
-				f << stringf(",\n");
+				out += ",\n";
 			write_module(mod);
+			flush();
 			first_module = false;
 		}
-		f << stringf("\n  }");
+		out += "\n  }";
 		if (!aig_models.empty()) {
-			f << stringf(",\n  \"models\": {\n");
+			out += ",\n  \"models\": {\n";
 			bool first_model = true;
 			for (auto &aig : aig_models) {
 				if (!first_model)
-					f << stringf(",\n");
-				f << stringf("    \"%s\": [\n", aig.name.c_str());
+					out += ",\n";
+				out += stringf("    \"%s\": [\n", aig.name.c_str());
 				int node_idx = 0;
 				for (auto &node : aig.nodes) {
 					if (node_idx != 0)
-						f << stringf(",\n");
-					f << stringf("      /* %3d */ [ ", node_idx);
+						out += ",\n";
+					out += stringf("      /* %3d */ [ ", node_idx);
 					if (node.portbit >= 0)
-						f << stringf("\"%sport\", \"%s\", %d", node.inverter ? "n" : "",
+						out += stringf("\"%sport\", \"%s\", %d", node.inverter ? "n" : "",
 								log_id(node.portname), node.portbit);
 					else if (node.left_parent < 0 && node.right_parent < 0)
-						f << stringf("\"%s\"", node.inverter ? "true" : "false");
+						out += stringf("\"%s\"", node.inverter ? "true" : "false");
 					else
-						f << stringf("\"%s\", %d, %d", node.inverter ? "nand" : "and", node.left_parent, node.right_parent);
+						out += stringf("\"%s\", %d, %d", node.inverter ? "nand" : "and", node.left_parent, node.right_parent);
 					for (auto &op : node.outports)
-						f << stringf(", \"%s\", %d", log_id(op.first), op.second);
-					f << stringf(" ]");
+						out += stringf(", \"%s\", %d", log_id(op.first), op.second);
+					out += " ]";
 					node_idx++;
 				}
-				f << stringf("\n    ]");
+				out += "\n    ]";
 				first_model = false;
 			}
-			f << stringf("\n  }");
+			out += "\n  }";
 		}
-		f << stringf("\n}\n");
+		out += "\n}\n";
+		flush();
 	}
 };
 
@@ -358,6 +511,11 @@ struct JsonBackend : public Backend {
 		log("    -noscopeinfo\n");
 		log("        don't include $scopeinfo cells in the output\n");
 		log("\n");
+		log("    -j <threads>\n");
+		log("        format the cells and netnames of large modules using the given number\n");
+		log("        of threads (0 for one per hardware thread). the output is the same\n");
+		log("        for any number of threads. this has no effect with -aig. default: 1\n");
+		log("\n");
 		log("\n");
 		log("The general syntax of the JSON output created by this command is as follows:\n");
 		log("\n");
@@ -604,6 +762,7 @@ struct JsonBackend : public Backend {
 		bool compat_int_mode = false;
 		bool use_selection = false;
 		bool scopeinfo_mode = true;
+		int threads = 1;
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++)
@@ -624,6 +783,10 @@ struct JsonBackend : public Backend {
 				scopeinfo_mode = false;
 				continue;
 			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				threads = atoi(args[++argidx].c_str());
+				continue;
+			}
 			break;
 		}
 		extra_args(f, filename, args, argidx);
@@ -631,6 +794,7 @@ struct JsonBackend : public Backend {
 		log_header(design, "Executing JSON backend.\n");
 
 		JsonWriter json_writer(*f, use_selection, aig_mode, compat_int_mode, scopeinfo_mode);
+		json_writer.threads = threads;
 		json_writer.write_design(design);
 	}
 } JsonBackend;
@@ -35,7 +35,7 @@ struct Smt2Worker
 	CellTypes ct;
 	SigMap sigmap;
 	RTLIL::Module *module;
-	bool bvmode, memmode, wiresmode, verbose, statebv, statedt, forallmode;
+	bool bvmode, memmode, wiresmode, verbose, statebv, statedt, forallmode, sharemode;
 	dict<IdString, int> &mod_stbv_width;
 	int idcounter = 0, statebv_width = 0;
 
@@ -55,6 +55,11 @@ struct Smt2Worker
 	std::map<int, int> bvsizes;
 	dict<IdString, char*> ids;
 
+	// sort and body of the functions defined for cell outputs, for sharing
+	// structurally identical functions
+	dict<std::string, int> fun_bodies;
+	int shared_funs = 0;
+
 	bool is_smtlib2_module;
 
 	const char *get_id(IdString n)
@@ -116,9 +121,9 @@ struct Smt2Worker
 	}
 
 	Smt2Worker(RTLIL::Module *module, bool bvmode, bool memmode, bool wiresmode, bool verbose, bool statebv, bool statedt, bool forallmode,
-		   dict<IdString, int> &mod_stbv_width, dict<IdString, dict<IdString, pair<bool, bool>>> &mod_clk_cache)
+		   bool sharemode, dict<IdString, int> &mod_stbv_width, dict<IdString, dict<IdString, pair<bool, bool>>> &mod_clk_cache)
 	    : ct(module->design), sigmap(module), module(module), bvmode(bvmode), memmode(memmode), wiresmode(wiresmode), verbose(verbose),
-	      statebv(statebv), statedt(statedt), forallmode(forallmode), mod_stbv_width(mod_stbv_width),
+	      statebv(statebv), statedt(statedt), forallmode(forallmode), sharemode(sharemode), mod_stbv_width(mod_stbv_width),
 	      is_smtlib2_module(module->has_attribute(ID::smtlib2_module))
 	{
 		pool<SigBit> noclock;
@@ -304,7 +309,8 @@ struct Smt2Worker
 		log_assert(bvmode);
 		sigmap.apply(sig);
 
-		log_assert(bvsizes.count(id) == 0);
+		// shared functions are registered for more than one signal
+		log_assert(bvsizes.count(id) == 0 || bvsizes.at(id) == GetSize(sig));
 		bvsizes[id] = GetSize(sig);
 
 		for (int i = 0; i < GetSize(sig); i++) {
@@ -433,6 +439,26 @@ struct Smt2Worker
 		}
 	}
 
+	// Returns the id of a function of the state with the given sort and body.
+	// The function is only defined if no identical function exists yet.
+	int define_fun(const std::string &sort, const std::string &expr, RTLIL::SigSpec sig)
+	{
+		if (sharemode) {
+			auto it = fun_bodies.find(sort + " " + expr);
+			if (it != fun_bodies.end()) {
+				if (verbose) log("%*s-> shared function: %s#%d\n", 2+2*GetSize(recursive_cells), "",
+						get_id(module), it->second);
+				shared_funs++;
+				return it->second;
+			}
+			fun_bodies[sort + " " + expr] = idcounter;
+		}
+
+		decls.push_back(stringf("(define-fun |%s#%d| ((state |%s_s|)) %s %s) ; %s\n",
+				get_id(module), idcounter, get_id(module), sort.c_str(), expr.c_str(), log_signal(sig)));
+		return idcounter++;
+	}
+
 	void export_gate(RTLIL::Cell *cell, std::string expr)
 	{
 		RTLIL::SigBit bit = sigmap(cell->getPort(ID::Y).as_bit());
@@ -450,9 +476,7 @@ struct Smt2Worker
 		if (verbose)
 			log("%*s-> import cell: %s\n", 2+2*GetSize(recursive_cells), "", log_id(cell));
 
-		decls.push_back(stringf("(define-fun |%s#%d| ((state |%s_s|)) Bool %s) ; %s\n",
-				get_id(module), idcounter, get_id(module), processed_expr.c_str(), log_signal(bit)));
-		register_bool(bit, idcounter++);
+		register_bool(bit, define_fun("Bool", processed_expr, bit));
 		recursive_cells.erase(cell);
 	}
 
@@ -500,15 +524,10 @@ struct Smt2Worker
 		if (verbose)
 			log("%*s-> import cell: %s\n", 2+2*GetSize(recursive_cells), "", log_id(cell));
 
-		if (type == 'b') {
-			decls.push_back(stringf("(define-fun |%s#%d| ((state |%s_s|)) Bool %s) ; %s\n",
-					get_id(module), idcounter, get_id(module), processed_expr.c_str(), log_signal(sig_y)));
-			register_boolvec(sig_y, idcounter++);
-		} else {
-			decls.push_back(stringf("(define-fun |%s#%d| ((state |%s_s|)) (_ BitVec %d) %s) ; %s\n",
-					get_id(module), idcounter, get_id(module), GetSize(sig_y), processed_expr.c_str(), log_signal(sig_y)));
-			register_bv(sig_y, idcounter++);
-		}
+		if (type == 'b')
+			register_boolvec(sig_y, define_fun("Bool", processed_expr, sig_y));
+		else
+			register_bv(sig_y, define_fun(stringf("(_ BitVec %d)", GetSize(sig_y)), processed_expr, sig_y));
 
 		recursive_cells.erase(cell);
 	}
@@ -531,9 +550,7 @@ struct Smt2Worker
 		if (verbose)
 			log("%*s-> import cell: %s\n", 2+2*GetSize(recursive_cells), "", log_id(cell));
 
-		decls.push_back(stringf("(define-fun |%s#%d| ((state |%s_s|)) Bool %s) ; %s\n",
-				get_id(module), idcounter, get_id(module), processed_expr.c_str(), log_signal(sig_y)));
-		register_boolvec(sig_y, idcounter++);
+		register_boolvec(sig_y, define_fun("Bool", processed_expr, sig_y));
 		recursive_cells.erase(cell);
 	}
 
@@ -753,9 +770,7 @@ struct Smt2Worker
 					log("%*s-> import cell: %s\n", 2+2*GetSize(recursive_cells), "", log_id(cell));
 
 				RTLIL::SigSpec sig = sigmap(cell->getPort(ID::Y));
-				decls.push_back(stringf("(define-fun |%s#%d| ((state |%s_s|)) (_ BitVec %d) %s) ; %s\n",
-						get_id(module), idcounter, get_id(module), width, processed_expr.c_str(), log_signal(sig)));
-				register_bv(sig, idcounter++);
+				register_bv(sig, define_fun(stringf("(_ BitVec %d)", width), processed_expr, sig));
 				recursive_cells.erase(cell);
 				return;
 			}
@@ -1699,6 +1714,10 @@ struct Smt2Backend : public Backend {
 		log("        create '<mod>_n' functions for all public wires. by default only ports,\n");
 		log("        registers, and wires with the 'keep' attribute are exported.\n");
 		log("\n");
+		log("    -noshare\n");
+		log("        by default cells computing the same function of the same signals share\n");
+		log("        a single '<mod>#<id>' function. this option disables the sharing.\n");
+		log("\n");
 		log("    -tpl <template_file>\n");
 		log("        use the given template file. the line containing only the token '%%%%'\n");
 		log("        is replaced with the regular output of this command.\n");
@@ -1760,7 +1779,7 @@ struct Smt2Backend : public Backend {
 	{
 		std::ifstream template_f;
 		bool bvmode = true, memmode = true, wiresmode = false, verbose = false, statebv = false, statedt = false;
-		bool forallmode = false;
+		bool forallmode = false, sharemode = true;
 		dict<std::string, std::string> solver_options;
 
 		log_header(design, "Executing SMT2 backend.\n");
@@ -1806,6 +1825,10 @@ struct Smt2Backend : public Backend {
 				wiresmode = true;
 				continue;
 			}
+			if (args[argidx] == "-noshare") {
+				sharemode = false;
+				continue;
+			}
 			if (args[argidx] == "-verbose") {
 				verbose = true;
 				continue;
@@ -1904,10 +1927,13 @@ struct Smt2Backend : public Backend {
 
 			log("Creating SMT-LIBv2 representation of module %s.\n", log_id(module));
 
-			Smt2Worker worker(module, bvmode, memmode, wiresmode, verbose, statebv, statedt, forallmode, mod_stbv_width, mod_clk_cache);
+			Smt2Worker worker(module, bvmode, memmode, wiresmode, verbose, statebv, statedt, forallmode, sharemode, mod_stbv_width, mod_clk_cache);
 			worker.run();
 			worker.write(*f);
 
+			if (worker.shared_funs)
+				log("  Shared %d structurally identical functions.\n", worker.shared_funs);
+
 			if (module == topmod)
 				topmod_id = worker.get_id(module);
 		}
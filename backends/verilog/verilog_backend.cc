@@ -29,6 +29,7 @@
 #include "kernel/mem.h"
 #include "kernel/fmt.h"
 #include "backends/verilog/verilog_backend.h"
+#include <charconv>
 #include <string>
 #include <sstream>
 #include <set>
@@ -156,17 +157,37 @@ void reset_auto_counter(RTLIL::Module *module)
 			log("  renaming `%s' to `%s_%0*d_'.\n", it->first.c_str(), auto_prefix.c_str(), auto_name_digits, auto_name_offset + it->second);
 }
 
+std::string auto_id(int number)
+{
+	// same as stringf("%s_%0*d_", ...), which is too slow for large netlists
+	char digits[16];
+	auto result = std::to_chars(digits, digits + sizeof(digits), number);
+	int num_digits = result.ptr - digits;
+	std::string str;
+	str.reserve(auto_prefix.size() + std::max(num_digits, auto_name_digits) + 2);
+	str += auto_prefix;
+	str += '_';
+	if (num_digits < auto_name_digits)
+		str.append(auto_name_digits - num_digits, '0');
+	str.append(digits, result.ptr);
+	str += '_';
+	return str;
+}
+
 std::string next_auto_id()
 {
-	return stringf("%s_%0*d_", auto_prefix.c_str(), auto_name_digits, auto_name_offset + auto_name_counter++);
+	return auto_id(auto_name_offset + auto_name_counter++);
 }
 
-std::string id(RTLIL::IdString internal_id, bool may_rename = true)
+std::string id(const RTLIL::IdString &internal_id, bool may_rename = true)
 {
 	const char *str = internal_id.c_str();
 
-	if (may_rename && auto_name_map.count(internal_id) != 0)
-		return stringf("%s_%0*d_", auto_prefix.c_str(), auto_name_digits, auto_name_offset + auto_name_map[internal_id]);
+	if (may_rename) {
+		auto it = auto_name_map.find(internal_id);
+		if (it != auto_name_map.end())
+			return auto_id(auto_name_offset + it->second);
+	}
 
 	if (*str == '\\')
 		str++;
@@ -224,11 +245,11 @@ void dump_const(std::ostream &f, const RTLIL::Const &data, int width = -1, int o
 					val |= 1 << (i - offset);
 			}
 			if (decimal)
-				f << stringf("%d", val);
+				f << val;
 			else if (set_signed && val < 0)
-				f << stringf("-32'sd%u", -val);
+				f << "-32'sd" << -(uint32_t)val;
 			else
-				f << stringf("32'%sd%u", set_signed ? "s" : "", val);
+				f << (set_signed ? "32'sd" : "32'd") << (uint32_t)val;
 		} else {
 	dump_hex:
 			if (nohex)
@@ -279,26 +300,27 @@ void dump_const(std::ostream &f, const RTLIL::Const &data, int width = -1, int o
 				int val = 8*(bit_3 - '0') + 4*(bit_2 - '0') + 2*(bit_1 - '0') + (bit_0 - '0');
 				hex_digits.push_back(val < 10 ? '0' + val : 'a' + val - 10);
 			}
-			f << stringf("%d'%sh", width, set_signed ? "s" : "");
-			for (int i = GetSize(hex_digits)-1; i >= 0; i--)
-				f << hex_digits[i];
+			f << width << (set_signed ? "'sh" : "'h");
+			f << std::string(hex_digits.rbegin(), hex_digits.rend());
 		}
 		if (0) {
 	dump_bin:
-			f << stringf("%d'%sb", width, set_signed ? "s" : "");
+			f << width << (set_signed ? "'sb" : "'b");
+			std::string bin_digits;
 			if (width == 0)
-				f << stringf("0");
+				bin_digits = "0";
 			for (int i = offset+width-1; i >= offset; i--) {
 				log_assert(i < (int)data.size());
 				switch (data[i]) {
-				case State::S0: f << stringf("0"); break;
-				case State::S1: f << stringf("1"); break;
-				case RTLIL::Sx: f << stringf("x"); break;
-				case RTLIL::Sz: f << stringf("z"); break;
-				case RTLIL::Sa: f << stringf("?"); break;
+				case State::S0: bin_digits += '0'; break;
+				case State::S1: bin_digits += '1'; break;
+				case RTLIL::Sx: bin_digits += 'x'; break;
+				case RTLIL::Sz: bin_digits += 'z'; break;
+				case RTLIL::Sa: bin_digits += '?'; break;
 				case RTLIL::Sm: log_error("Found marker state in final netlist.");
 				}
 			}
+			f << bin_digits;
 		}
 	} else {
 		if ((data.flags & RTLIL::CONST_FLAG_REAL) == 0)
@@ -350,22 +372,23 @@ void dump_sigchunk(std::ostream &f, const RTLIL::SigChunk &chunk, bool no_decima
 	if (chunk.wire == NULL) {
 		dump_const(f, chunk.data, chunk.width, chunk.offset, no_decimal);
 	} else {
+		// this is the most frequently used path of the backend, so it
+		// writes to the stream directly instead of going through stringf()
+		f << id(chunk.wire->name);
 		if (chunk.width == chunk.wire->width && chunk.offset == 0) {
-			f << stringf("%s", id(chunk.wire->name).c_str());
+			// whole wire
 		} else if (chunk.width == 1) {
 			if (chunk.wire->upto)
-				f << stringf("%s[%d]", id(chunk.wire->name).c_str(), (chunk.wire->width - chunk.offset - 1) + chunk.wire->start_offset);
+				f << '[' << (chunk.wire->width - chunk.offset - 1) + chunk.wire->start_offset << ']';
 			else
-				f << stringf("%s[%d]", id(chunk.wire->name).c_str(), chunk.offset + chunk.wire->start_offset);
+				f << '[' << chunk.offset + chunk.wire->start_offset << ']';
 		} else {
 			if (chunk.wire->upto)
-				f << stringf("%s[%d:%d]", id(chunk.wire->name).c_str(),
-						(chunk.wire->width - (chunk.offset + chunk.width - 1) - 1) + chunk.wire->start_offset,
-						(chunk.wire->width - chunk.offset - 1) + chunk.wire->start_offset);
+				f << '[' << (chunk.wire->width - (chunk.offset + chunk.width - 1) - 1) + chunk.wire->start_offset
+						<< ':' << (chunk.wire->width - chunk.offset - 1) + chunk.wire->start_offset << ']';
 			else
-				f << stringf("%s[%d:%d]", id(chunk.wire->name).c_str(),
-						(chunk.offset + chunk.width - 1) + chunk.wire->start_offset,
-						chunk.offset + chunk.wire->start_offset);
+				f << '[' << (chunk.offset + chunk.width - 1) + chunk.wire->start_offset
+						<< ':' << chunk.offset + chunk.wire->start_offset << ']';
 		}
 	}
 }
@@ -380,13 +403,13 @@ void dump_sigspec(std::ostream &f, const RTLIL::SigSpec &sig)
 	if (sig.is_chunk()) {
 		dump_sigchunk(f, sig.as_chunk());
 	} else {
-		f << stringf("{ ");
+		f << "{ ";
 		for (auto it = sig.chunks().rbegin(); it != sig.chunks().rend(); ++it) {
 			if (it != sig.chunks().rbegin())
-				f << stringf(", ");
+				f << ", ";
 			dump_sigchunk(f, *it, true);
 		}
-		f << stringf(" }");
+		f << " }";
 	}
 }
 
@@ -399,15 +422,14 @@ void dump_attributes(std::ostream &f, std::string indent, dict<RTLIL::IdString,
 	for (auto it = attributes.begin(); it != attributes.end(); ++it) {
 		if (it->first == ID::single_bit_vector) continue;
 		if (it->first == ID::init && regattr) continue;
-		f << stringf("%s" "%s %s", indent.c_str(), as_comment ? "/*" : "(*", id(it->first).c_str());
-		f << stringf(" = ");
+		f << indent << (as_comment ? "/* " : "(* ") << id(it->first) << " = ";
 		if (modattr && (it->second == State::S0 || it->second == Const(0)))
-			f << stringf(" 0 ");
+			f << " 0 ";
 		else if (modattr && (it->second == State::S1 || it->second == Const(1)))
-			f << stringf(" 1 ");
+			f << " 1 ";
 		else
 			dump_const(f, it->second, -1, 0, false, as_comment);
-		f << stringf(" %s%s", as_comment ? "*/" : "*)", term.c_str());
+		f << (as_comment ? " */" : " *)") << term;
 	}
 }
 
@@ -1913,26 +1935,27 @@ void dump_cell(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 	}
 
 	dump_attributes(f, indent, cell->attributes);
-	f << stringf("%s" "%s", indent.c_str(), id(cell->type, false).c_str());
+	f << indent << id(cell->type, false);
 
 	if (!defparam && cell->parameters.size() > 0) {
-		f << stringf(" #(");
+		f << " #(";
 		for (auto it = cell->parameters.begin(); it != cell->parameters.end(); ++it) {
 			if (it != cell->parameters.begin())
-				f << stringf(",");
-			f << stringf("\n%s  .%s(", indent.c_str(), id(it->first).c_str());
+				f << ",";
+			f << "\n" << indent << "  ." << id(it->first) << "(";
 			if (it->second.size() > 0)
 				dump_const(f, it->second);
-			f << stringf(")");
+			f << ")";
 		}
-		f << stringf("\n%s" ")", indent.c_str());
+		f << "\n" << indent << ")";
 	}
 
 	std::string cell_name = cellname(cell);
-	if (cell_name != id(cell->name))
-		f << stringf(" %s /* %s */ (", cell_name.c_str(), id(cell->name).c_str());
+	std::string cell_id = id(cell->name);
+	if (cell_name != cell_id)
+		f << " " << cell_name << " /* " << cell_id << " */ (";
 	else
-		f << stringf(" %s (", cell_name.c_str());
+		f << " " << cell_name << " (";
 
 	bool first_arg = true;
 	std::set<RTLIL::IdString> numbered_ports;
@@ -1943,9 +1966,9 @@ void dump_cell(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 			if (it->first != str)
 				continue;
 			if (!first_arg)
-				f << stringf(",");
+				f << ",";
 			first_arg = false;
-			f << stringf("\n%s  ", indent.c_str());
+			f << "\n" << indent << "  ";
 			dump_sigspec(f, it->second);
 			numbered_ports.insert(it->first);
 			goto found_numbered_port;
@@ -1957,14 +1980,14 @@ void dump_cell(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 		if (numbered_ports.count(it->first))
 			continue;
 		if (!first_arg)
-			f << stringf(",");
+			f << ",";
 		first_arg = false;
-		f << stringf("\n%s  .%s(", indent.c_str(), id(it->first).c_str());
+		f << "\n" << indent << "  ." << id(it->first) << "(";
 		if (it->second.size() > 0)
 			dump_sigspec(f, it->second);
-		f << stringf(")");
+		f << ")";
 	}
-	f << stringf("\n%s" ");\n", indent.c_str());
+	f << "\n" << indent << ");\n";
 
 	if (defparam && cell->parameters.size() > 0) {
 		for (auto it = cell->parameters.begin(); it != cell->parameters.end(); ++it) {
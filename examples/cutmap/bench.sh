@@ -0,0 +1,35 @@
+#!/usr/bin/env bash
+# QoR and runtime comparison of cutmap and flowmap on the same AIG.
+# Usage: bash bench.sh [width] [lut size]
+set -e
+
+width=${1:-8}
+lut=${2:-4}
+yosys=${YOSYS:-../../yosys}
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+cat > $tmp/bench.v <<EOT
+module bench #(parameter W = 8) (input [W-1:0] a, b, c, output [2*W-1:0] y, output z);
+assign y = a * b + c;
+assign z = a * b > {c, c};
+endmodule
+EOT
+
+$yosys -q -p "read_verilog $tmp/bench.v; chparam -set W $width bench; synth -top bench -run :fine; techmap; opt -fast; aigmap; opt_clean; write_rtlil $tmp/bench.il"
+
+run() {
+	local name=$1; shift
+	local start=$(date +%s.%N)
+	$yosys -q -l $tmp/$name.log -p "read_rtlil $tmp/bench.il; $*; tee -o $tmp/$name.stat stat"
+	local end=$(date +%s.%N)
+	local luts=$(grep -o '\$lut *[0-9]*' $tmp/$name.stat | grep -o '[0-9]*$')
+	local depth=$(grep -o 'maximum depth \(of \)\?[0-9]*' $tmp/$name.log | grep -o '[0-9]*$' | sort -n | tail -n 1)
+	printf "%-24s %8s LUTs  depth %4s  %8.2f s\n" "$name" "$luts" "$depth" "$(echo "$end - $start" | bc)"
+}
+
+echo "width $width, $lut-LUTs, $(grep -c '\$_AND_' $tmp/bench.il) AND gates"
+run flowmap flowmap -maxlut $lut
+run flowmap-relax flowmap -maxlut $lut -relax -optarea 0
+run cutmap cutmap -maxlut $lut
+run cutmap-j0 cutmap -maxlut $lut -j 0
@@ -0,0 +1,136 @@
+// Microbenchmark for the hashlib containers, using insert, lookup and erase
+// patterns of typical passes. bench.sh compiles it once as is and once with
+// -DYOSYS_ENABLE_HASHLIB_OPEN_ADDRESSING to compare both hash table variants.
+//
+// Usage: bench [size]
+
+// hashlib.h relies on yosys_common.h for these
+#include <array>
+#include <cstring>
+
+#include "kernel/hashlib.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+using namespace hashlib;
+
+uint32_t Hasher::fudge = 0;
+
+struct Checksum {
+	uint64_t value = 1469598103934665603ull;
+	void add(uint64_t x) { value = (value ^ x) * 1099511628211ull; }
+};
+
+template<typename F>
+static void run(const char *name, size_t ops, F fn)
+{
+	auto start = std::chrono::steady_clock::now();
+	Checksum sum;
+	fn(sum);
+	auto stop = std::chrono::steady_clock::now();
+	double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+	// print the checksum too, so that the work is not optimized away
+	printf("%-12s %10zu ops %8.2f ns/op  %016llx\n", name, ops, ns / ops, (unsigned long long)sum.value);
+}
+
+// a wire pointer and bit offset, like a SigBit
+typedef std::pair<uintptr_t, int> bit_t;
+
+int main(int argc, char **argv)
+{
+	size_t n = 1000000;
+	if (argc > 1)
+		n = atol(argv[1]);
+
+	std::mt19937 rng(1);
+	std::vector<bit_t> bits;
+	for (size_t i = 0; bits.size() < n; i++) {
+		uintptr_t wire = 0x10000 + i * 48;
+		int width = 1 + rng() % 32;
+		for (int k = 0; k < width && bits.size() < n; k++)
+			bits.push_back({wire, k});
+	}
+	std::vector<size_t> order(n);
+	for (size_t i = 0; i < n; i++)
+		order[i] = i;
+	std::shuffle(order.begin(), order.end(), rng);
+
+	// SigMap style: map every bit to an index, then look up bits in random order
+	run("sigmap", 2 * n, [&](Checksum &sum) {
+		dict<bit_t, int> db;
+		for (size_t i = 0; i < n; i++)
+			db[bits[i]] = i;
+		for (size_t i : order)
+			sum.add(db.at(bits[i]));
+		for (auto &it : db)
+			sum.add(it.second);
+	});
+
+	// Module::cell() style: names are looked up before insertion, most of them
+	// are new
+	run("names", 3 * n, [&](Checksum &sum) {
+		dict<int, int> db;
+		for (size_t i = 0; i < n; i++) {
+			int name = order[i] * 7;
+			if (!db.count(name))
+				db[name] = i;
+			sum.add(db.count(name + 1));
+		}
+		for (auto &it : db)
+			sum.add(it.first);
+	});
+
+	// opt_clean style: collect used bits, then remove the unused ones
+	run("used_bits", 3 * n, [&](Checksum &sum) {
+		pool<bit_t> used;
+		for (size_t i = 0; i < n; i++)
+			used.insert(bits[i]);
+		for (size_t i : order)
+			if (i % 3 == 0)
+				used.erase(bits[i]);
+		for (size_t i = 0; i < n; i++)
+			sum.add(used.count(bits[i]));
+		for (auto &bit : used)
+			sum.add(bit.first + bit.second);
+	});
+
+	// worklist style: pop from the pool, occasionally pushing new items
+	run("worklist", 2 * n, [&](Checksum &sum) {
+		pool<int> queue;
+		for (size_t i = 0; i < n / 2; i++)
+			queue.insert(order[i]);
+		size_t next = n / 2;
+		while (!queue.empty()) {
+			int item = queue.pop();
+			sum.add(item);
+			if (item % 2 == 0 && next < n)
+				queue.insert(order[next++]);
+		}
+	});
+
+	// IdString/idict style: intern strings, many of which repeat
+	run("intern", n, [&](Checksum &sum) {
+		idict<std::string> db;
+		for (size_t i = 0; i < n; i++)
+			sum.add(db(std::string("\\net_") + std::to_string(order[i] % (n / 4 + 1))));
+		for (auto &it : db)
+			sum.add(it.size());
+	});
+
+	// ModIndex style: a set of ports for each bit
+	run("fanout", 2 * n, [&](Checksum &sum) {
+		dict<bit_t, pool<int>> db;
+		for (size_t i = 0; i < n; i++)
+			db[bits[order[i] % (n / 2 + 1)]].insert(i);
+		for (size_t i = 0; i < n; i += 2)
+			db[bits[i % (n / 2 + 1)]].erase(order[i]);
+		for (auto &it : db)
+			sum.add(it.second.size());
+	});
+
+	return 0;
+}
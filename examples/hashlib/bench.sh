@@ -0,0 +1,16 @@
+#!/usr/bin/env bash
+# Runtime comparison of the chained and the open addressing hashlib tables.
+# Usage: bash bench.sh [size]
+set -e
+
+cxx=${CXX:-c++}
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+$cxx -std=c++17 -O2 -I../.. -o $tmp/bench-chained bench.cc
+$cxx -std=c++17 -O2 -I../.. -DYOSYS_ENABLE_HASHLIB_OPEN_ADDRESSING -o $tmp/bench-open bench.cc
+
+echo "chained:"
+$tmp/bench-chained "$@"
+echo "open addressing:"
+$tmp/bench-open "$@"
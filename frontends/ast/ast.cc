@@ -45,6 +45,90 @@ namespace AST {
 	unsigned long long astnode_count() { return astnodes; }
 }
 
+// Nodes are carved from slabs and freed nodes are kept on a free list for
+// reuse, so that the many short-lived nodes created by simplify() don't go
+// through malloc. The slabs are released at once when the last node is
+// deleted, for example when the design is reset. The pool is never destroyed
+// because nodes may be deleted during static destruction.
+namespace {
+	struct AstNodePool
+	{
+		union Slot {
+			Slot *next;
+			alignas(AstNode) char data[sizeof(AstNode)];
+		};
+
+		static constexpr size_t slab_size = 1024;
+
+		std::vector<std::unique_ptr<Slot[]>> slabs;
+		Slot *free_list = nullptr;
+		size_t slab_used = slab_size;
+		unsigned long long allocations = 0;
+		size_t live = 0;
+
+		void *allocate()
+		{
+			allocations++;
+			live++;
+			if (free_list != nullptr) {
+				Slot *slot = free_list;
+				free_list = slot->next;
+				return slot;
+			}
+			if (slab_used == slab_size) {
+				slabs.emplace_back(new Slot[slab_size]);
+				slab_used = 0;
+			}
+			return &slabs.back()[slab_used++];
+		}
+
+		void release(void *ptr)
+		{
+			Slot *slot = static_cast<Slot*>(ptr);
+			slot->next = free_list;
+			free_list = slot;
+			if (--live == 0) {
+				slabs.clear();
+				free_list = nullptr;
+				slab_used = slab_size;
+			}
+		}
+	};
+
+	AstNodePool &node_pool()
+	{
+		static AstNodePool *pool = new AstNodePool;
+		return *pool;
+	}
+}
+
+void *AstNode::operator new(size_t size)
+{
+	if (size != sizeof(AstNode))
+		return ::operator new(size);
+	return node_pool().allocate();
+}
+
+void AstNode::operator delete(void *ptr, size_t size)
+{
+	if (ptr == nullptr)
+		return;
+	if (size != sizeof(AstNode))
+		::operator delete(ptr);
+	else
+		node_pool().release(ptr);
+}
+
+unsigned long long AST::astnode_allocations()
+{
+	return node_pool().allocations;
+}
+
+size_t AST::astnode_pool_bytes()
+{
+	return node_pool().slabs.size() * AstNodePool::slab_size * sizeof(AstNodePool::Slot);
+}
+
 // instantiate global variables (private API)
 namespace AST_INTERNAL {
 	bool flag_nodisplay, flag_dump_ast1, flag_dump_ast2, flag_no_dump_ptr, flag_dump_vlog1, flag_dump_vlog2, flag_dump_rtlil, flag_nolatches, flag_nomeminit;
@@ -299,6 +383,205 @@ AstNode::~AstNode()
 	delete_children();
 }
 
+// binary (de)serialization of a tree as created by a frontend parser, used by
+// the AST cache of the Verilog frontend. Nodes with an id2ast pointer can't be
+// serialized. The format uses the native byte order and is only meant to be
+// read by the same build of Yosys.
+namespace {
+	struct AstWriter
+	{
+		std::ostream &f;
+		dict<std::string, int> filenames;
+		bool ok = true;
+
+		AstWriter(std::ostream &f) : f(f) { }
+
+		void u32(uint32_t value) { f.write(reinterpret_cast<const char*>(&value), sizeof(value)); }
+		void str(const std::string &value) { u32(value.size()); f.write(value.data(), value.size()); }
+
+		void node(const AstNode *node)
+		{
+			if (node->id2ast != nullptr)
+				ok = false;
+
+			u32(node->type);
+			auto it = filenames.find(node->filename);
+			if (it == filenames.end()) {
+				u32(GetSize(filenames));
+				str(node->filename);
+				filenames.emplace(node->filename, GetSize(filenames));
+			} else {
+				u32(it->second);
+			}
+
+			const bool flags[] = {node->is_input, node->is_output, node->is_reg, node->is_logic, node->is_signed,
+					node->is_string, node->is_wand, node->is_wor, node->range_valid, node->range_swapped,
+					node->was_checked, node->is_unsized, node->is_custom_type, node->is_enum, node->basic_prep,
+					node->lookahead, node->in_lvalue, node->in_param, node->in_lvalue_from_above, node->in_param_from_above};
+			uint32_t mask = 0;
+			int bit = 0;
+			for (bool flag : flags)
+				mask |= uint32_t(flag) << bit++;
+			u32(mask);
+
+			u32(node->port_id);
+			u32(node->range_left);
+			u32(node->range_right);
+			u32(node->integer);
+			u32(node->unpacked_dimensions);
+			f.write(reinterpret_cast<const char*>(&node->realvalue), sizeof(node->realvalue));
+			u32(node->location.first_line);
+			u32(node->location.last_line);
+			u32(node->location.first_column);
+			u32(node->location.last_column);
+			str(node->str);
+
+			u32(node->bits.size());
+			for (auto bit : node->bits)
+				f.put(bit);
+			u32(node->dimensions.size());
+			for (auto &dim : node->dimensions) {
+				u32(dim.range_right);
+				u32(dim.range_width);
+				u32(dim.range_swapped);
+			}
+
+			u32(node->attributes.size());
+			for (auto &it : node->attributes) {
+				str(it.first.str());
+				this->node(it.second);
+			}
+			u32(node->children.size());
+			for (auto child : node->children)
+				this->node(child);
+		}
+	};
+
+	struct AstReader
+	{
+		const std::string &data;
+		size_t pos = 0;
+		std::vector<std::string> filenames;
+		bool ok = true;
+
+		AstReader(const std::string &data) : data(data) { }
+
+		void read(void *dest, size_t size)
+		{
+			if (data.size() - pos < size) {
+				ok = false;
+				return;
+			}
+			memcpy(dest, data.data() + pos, size);
+			pos += size;
+		}
+
+		uint32_t u32()
+		{
+			uint32_t value = 0;
+			read(&value, sizeof(value));
+			return value;
+		}
+
+		void str(std::string &value)
+		{
+			uint32_t size = u32();
+			if (ok && data.size() - pos >= size) {
+				value = data.substr(pos, size);
+				pos += size;
+			} else {
+				ok = false;
+			}
+		}
+
+		AstNode *node()
+		{
+			AstNode *node = new AstNode;
+			node->type = AstNodeType(u32());
+			uint32_t file_id = u32();
+			if (file_id == filenames.size()) {
+				filenames.emplace_back();
+				str(filenames.back());
+			}
+			if (file_id < filenames.size())
+				node->filename = filenames[file_id];
+			else
+				ok = false;
+
+			uint32_t mask = u32();
+			bool *flags[] = {&node->is_input, &node->is_output, &node->is_reg, &node->is_logic, &node->is_signed,
+					&node->is_string, &node->is_wand, &node->is_wor, &node->range_valid, &node->range_swapped,
+					&node->was_checked, &node->is_unsized, &node->is_custom_type, &node->is_enum, &node->basic_prep,
+					&node->lookahead, &node->in_lvalue, &node->in_param, &node->in_lvalue_from_above, &node->in_param_from_above};
+			int bit = 0;
+			for (bool *flag : flags)
+				*flag = (mask >> bit++) & 1;
+
+			node->port_id = u32();
+			node->range_left = u32();
+			node->range_right = u32();
+			node->integer = u32();
+			node->unpacked_dimensions = u32();
+			read(&node->realvalue, sizeof(node->realvalue));
+			node->location.first_line = u32();
+			node->location.last_line = u32();
+			node->location.first_column = u32();
+			node->location.last_column = u32();
+			str(node->str);
+
+			uint32_t count = u32();
+			if (ok && data.size() - pos >= count) {
+				for (uint32_t i = 0; i < count; i++)
+					node->bits.push_back(RTLIL::State(data[pos++]));
+			} else {
+				ok = false;
+			}
+			count = u32();
+			for (uint32_t i = 0; ok && i < count; i++) {
+				AstNode::dimension_t dim;
+				dim.range_right = u32();
+				dim.range_width = u32();
+				dim.range_swapped = u32();
+				node->dimensions.push_back(dim);
+			}
+
+			count = u32();
+			for (uint32_t i = 0; ok && i < count; i++) {
+				std::string name;
+				str(name);
+				if (!ok)
+					break;
+				AstNode *value = this->node();
+				auto &slot = node->attributes[RTLIL::IdString(name)];
+				delete slot;
+				slot = value;
+			}
+			count = u32();
+			for (uint32_t i = 0; ok && i < count; i++)
+				node->children.push_back(this->node());
+			return node;
+		}
+	};
+}
+
+bool AstNode::serialize(std::ostream &f) const
+{
+	AstWriter writer(f);
+	writer.node(this);
+	return writer.ok && f;
+}
+
+AstNode *AstNode::deserialize(const std::string &data)
+{
+	AstReader reader(data);
+	AstNode *node = reader.node();
+	if (!reader.ok || reader.pos != data.size()) {
+		delete node;
+		return nullptr;
+	}
+	return node;
+}
+
 // create a nice text representation of the node
 // (traverse tree by recursion, use 'other' pointer for diffing two AST trees)
 void AstNode::dumpAst(FILE *f, std::string indent) const
@@ -1097,6 +1380,8 @@ static RTLIL::Module *process_module(RTLIL::Design *design, AstNode *ast, bool d
 		log("Generating RTLIL representation for module `%s'.\n", ast->str.c_str());
 	}
 
+	unsigned long long allocations = astnode_allocations();
+
 	AstModule *module = new AstModule;
 	current_module = module;
 
@@ -1304,6 +1589,8 @@ static RTLIL::Module *process_module(RTLIL::Design *design, AstNode *ast, bool d
 		log("--- END OF RTLIL DUMP ---\n");
 	}
 
+	log_debug("Allocated %llu AST nodes for module `%s'.\n", astnode_allocations() - allocations, module->name.c_str());
+
 	design->add(current_module);
 	return current_module;
 }
@@ -240,6 +240,11 @@ namespace AST
 		void delete_children();
 		~AstNode();
 
+		// nodes are allocated from a pool, as elaboration creates and deletes
+		// large numbers of them (see astnode_allocations())
+		static void *operator new(size_t size);
+		static void operator delete(void *ptr, size_t size);
+
 		enum mem2reg_flags
 		{
 			/* status flags */
@@ -297,6 +302,13 @@ namespace AST
 		bool is_recursive_function() const;
 		std::pair<AstNode*, AstNode*> get_tern_choice();
 
+		// binary representation of a tree as created by the parser (used by
+		// the AST cache of read_verilog). serialize() returns false for trees
+		// which can't be serialized, deserialize() returns nullptr for
+		// invalid input.
+		bool serialize(std::ostream &f) const;
+		static AstNode *deserialize(const std::string &data);
+
 		// create a human-readable text representation of the AST (for debugging)
 		void dumpAst(FILE *f, std::string indent) const;
 		void dumpVlog(FILE *f, std::string indent) const;
@@ -412,6 +424,9 @@ namespace AST
 
 	// for stats
 	unsigned long long astnode_count();
+	// number of nodes allocated so far, and the memory held by the node pool
+	unsigned long long astnode_allocations();
+	size_t astnode_pool_bytes();
 
 	// set set_line_num and get_line_num to internal dummy functions (done by simplify() and AstModule::derive
 	// to control the filename and linenum properties of new nodes not generated by a frontend parser)
@@ -19,235 +19,378 @@
 
 #include "kernel/yosys.h"
 
+#if !defined(_WIN32) && !defined(__wasm)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
 YOSYS_NAMESPACE_BEGIN
 
-struct JsonNode
+// The complete text of a JSON file. Plain files are memory mapped, all other
+// streams (stdin, here documents, gzip files) are read into a single buffer.
+struct JsonBuffer
 {
-	char type; // S=String, N=Number, A=Array, D=Dict
-	string data_string;
-	int64_t data_number;
-	vector<JsonNode*> data_array;
-	dict<string, JsonNode*> data_dict;
-	vector<string> data_dict_keys;
+	const char *data = nullptr;
+	size_t size = 0;
+	std::string copy;
+	void *mapping = nullptr;
 
-	JsonNode(std::istream &f)
+	JsonBuffer(std::istream &f, const std::string &filename)
 	{
-		type = 0;
-		data_number = 0;
+#if !defined(_WIN32) && !defined(__wasm)
+		if (dynamic_cast<std::ifstream*>(&f) != nullptr) {
+			int fd = open(filename.c_str(), O_RDONLY);
+			struct stat st;
+			if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+				void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (p != MAP_FAILED) {
+					mapping = p;
+					data = (const char*)p;
+					size = st.st_size;
+				}
+			}
+			if (fd >= 0)
+				close(fd);
+			if (mapping != nullptr)
+				return;
+		}
+#endif
+		f.seekg(0, std::ios::end);
+		if (f.good()) {
+			std::streampos length = f.tellg();
+			f.seekg(0, std::ios::beg);
+			if (length > 0)
+				copy.reserve(length);
+		} else
+			f.clear();
+		copy.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+		data = copy.data();
+		size = copy.size();
+	}
 
-		while (1)
-		{
-			int ch = f.get();
+	~JsonBuffer()
+	{
+#if !defined(_WIN32) && !defined(__wasm)
+		if (mapping != nullptr)
+			munmap(mapping, size);
+#endif
+	}
+};
 
-			if (ch == EOF)
-				log_error("Unexpected EOF in JSON file.\n");
+// A scalar JSON value. Arrays and dicts are only reported by their type, as
+// they are consumed in place by the reader.
+struct JsonScalar
+{
+	char type; // S=String, N=Number, A=Array, D=Dict
+	string data_string;
+	int64_t data_number;
+};
 
-			if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n')
-				continue;
+// The bits of a port, net or cell connection. Bit indices are stored as they
+// are, the constants are stored above the range of int.
+struct JsonBits
+{
+	static constexpr int64_t CONST_BITS = int64_t(1) << 32;
 
-			if (ch == '"')
-			{
-				type = 'S';
+	char type; // 0 if not present
+	vector<int64_t> bits;
+	// first invalid bit, if any
+	int bad_index;
+	JsonScalar bad;
 
-				while (1)
-				{
-					ch = f.get();
-
-					if (ch == EOF)
-						log_error("Unexpected EOF in JSON string.\n");
-
-					if (ch == '"')
-						break;
-
-					if (ch == '\\') {
-						ch = f.get();
-
-						switch (ch) {
-							case EOF: log_error("Unexpected EOF in JSON string.\n"); break;
-							case '"':
-							case '/':
-							case '\\':           break;
-							case 'b': ch = '\b'; break;
-							case 'f': ch = '\f'; break;
-							case 'n': ch = '\n'; break;
-							case 'r': ch = '\r'; break;
-							case 't': ch = '\t'; break;
-							case 'u':
-								int val = 0;
-								for (int i = 0; i < 4; i++) {
-									ch = f.get();
-									val <<= 4;
-									if (ch >= '0' && '9' >= ch) {
-										val += ch - '0';
-									} else if (ch >= 'A' && 'F' >= ch) {
-										val += 10 + ch - 'A';
-									} else if (ch >= 'a' && 'f' >= ch) {
-										val += 10 + ch - 'a';
-									} else
-										log_error("Unexpected non-digit character in \\uXXXX sequence: %c.\n", ch);
-								}
-								if (val < 128)
-									ch = val;
-								else
-									log_error("Unsupported \\uXXXX sequence in JSON string: %04X.\n", val);
-								break;
-						}
-					}
+	void clear()
+	{
+		type = 0;
+		bits.clear();
+		bad_index = -1;
+	}
 
-					data_string += ch;
-				}
+	static bool is_const(int64_t bit) { return bit >= CONST_BITS; }
+	static State to_const(int64_t bit) { return State(bit - CONST_BITS); }
+};
 
-				break;
-			}
+// A pull reader for JSON text that creates no intermediate tree. Like in
+// the rest of the frontend, commas and colons are treated as whitespace.
+struct JsonReader
+{
+	const char *ptr, *end;
+	// target of skipped scalars
+	JsonScalar scratch;
 
-			if (('0' <= ch && ch <= '9') || ch == '-')
-			{
-				bool negative = false;
-				type = 'N';
-				if (ch == '-') {
-					data_number = 0;
-				       	negative = true;
-				} else {
-					data_number = ch - '0';
-				}
+	JsonReader(const JsonBuffer &buffer) : ptr(buffer.data), end(buffer.data + buffer.size) { }
 
-				data_string += ch;
+	static bool is_space(char ch) { return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n'; }
 
-				while (1)
-				{
-					ch = f.get();
+	// Returns the next character which is neither whitespace nor `sep`.
+	char next(char sep = 0)
+	{
+		while (ptr != end && (is_space(*ptr) || (sep != 0 && *ptr == sep)))
+			ptr++;
+		if (ptr == end)
+			log_error("Unexpected EOF in JSON file.\n");
+		return *ptr;
+	}
 
-					if (ch == EOF)
-						break;
+	char peek_type()
+	{
+		char ch = next();
+		if (ch == '"')
+			return 'S';
+		if (('0' <= ch && ch <= '9') || ch == '-')
+			return 'N';
+		if (ch == '[')
+			return 'A';
+		if (ch == '{')
+			return 'D';
+		log_error("Unexpected character in JSON file: '%c'\n", ch);
+	}
 
-					if (ch == '.')
-						goto parse_real;
+	void parse_string(string &s)
+	{
+		s.clear();
+		log_assert(*ptr == '"');
+		ptr++;
 
-					if (ch < '0' || '9' < ch) {
-						f.unget();
-						break;
-					}
+		while (1)
+		{
+			const char *start = ptr;
+			while (ptr != end && *ptr != '"' && *ptr != '\\')
+				ptr++;
+			s.append(start, ptr);
 
-					data_number = data_number*10 + (ch - '0');
-					data_string += ch;
-				}
+			if (ptr == end)
+				log_error("Unexpected EOF in JSON string.\n");
 
-				data_number = negative ? -data_number : data_number;
-				data_string = "";
+			if (*ptr++ == '"')
 				break;
 
-			parse_real:
-				type = 'S';
-				data_number = 0;
-				data_string += ch;
-
-				while (1)
-				{
-					ch = f.get();
-
-					if (ch == EOF)
-						break;
-
-					if (ch < '0' || '9' < ch) {
-						f.unget();
-						break;
+			if (ptr == end)
+				log_error("Unexpected EOF in JSON string.\n");
+
+			char ch = *ptr++;
+			switch (ch) {
+				case '"':
+				case '/':
+				case '\\':           break;
+				case 'b': ch = '\b'; break;
+				case 'f': ch = '\f'; break;
+				case 'n': ch = '\n'; break;
+				case 'r': ch = '\r'; break;
+				case 't': ch = '\t'; break;
+				case 'u':
+					int val = 0;
+					for (int i = 0; i < 4; i++) {
+						int digit = ptr == end ? EOF : *ptr++;
+						val <<= 4;
+						if (digit >= '0' && '9' >= digit) {
+							val += digit - '0';
+						} else if (digit >= 'A' && 'F' >= digit) {
+							val += 10 + digit - 'A';
+						} else if (digit >= 'a' && 'f' >= digit) {
+							val += 10 + digit - 'a';
+						} else
+							log_error("Unexpected non-digit character in \\uXXXX sequence: %c.\n", digit);
 					}
-
-					data_string += ch;
-				}
-
-				break;
+					if (val < 128)
+						ch = val;
+					else
+						log_error("Unsupported \\uXXXX sequence in JSON string: %04X.\n", val);
+					break;
 			}
 
-			if (ch == '[')
-			{
-				type = 'A';
-
-				while (1)
-				{
-					ch = f.get();
+			s += ch;
+		}
+	}
 
-					if (ch == EOF)
-						log_error("Unexpected EOF in JSON file.\n");
+	// Parses an integer, or a real number as a string.
+	void parse_number(JsonScalar &value)
+	{
+		const char *start = ptr;
+		bool negative = *ptr == '-';
+		if (negative)
+			ptr++;
+
+		uint64_t number = 0;
+		while (ptr != end && '0' <= *ptr && *ptr <= '9')
+			number = number*10 + (*ptr++ - '0');
+
+		if (ptr != end && *ptr == '.') {
+			ptr++;
+			while (ptr != end && '0' <= *ptr && *ptr <= '9')
+				ptr++;
+			value.type = 'S';
+			value.data_string.assign(start, ptr);
+			value.data_number = 0;
+			return;
+		}
 
-					if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == ',')
-						continue;
+		value.type = 'N';
+		value.data_string.clear();
+		value.data_number = negative ? -int64_t(number) : int64_t(number);
+	}
 
-					if (ch == ']')
-						break;
+	// Parses a scalar value, or skips an array or dict.
+	void parse_scalar(JsonScalar &value)
+	{
+		value.type = peek_type();
+		if (value.type == 'S') {
+			parse_string(value.data_string);
+			value.data_number = 0;
+		} else if (value.type == 'N') {
+			parse_number(value);
+		} else
+			skip_value();
+	}
 
-					f.unget();
-					data_array.push_back(new JsonNode(f));
-				}
+	// Skips a value by its brackets only, without decoding it.
+	void skip_value()
+	{
+		char type = peek_type();
+		if (type == 'S') {
+			skip_string();
+			return;
+		}
+		if (type == 'N') {
+			parse_number(scratch);
+			return;
+		}
 
-				break;
+		int depth = 0;
+		while (ptr != end) {
+			char ch = *ptr;
+			if (ch == '"') {
+				skip_string();
+				continue;
 			}
+			ptr++;
+			if (ch == '[' || ch == '{')
+				depth++;
+			else if ((ch == ']' || ch == '}') && --depth == 0)
+				return;
+		}
+		log_error("Unexpected EOF in JSON file.\n");
+	}
 
-			if (ch == '{')
-			{
-				type = 'D';
-
-				while (1)
-				{
-					ch = f.get();
-
-					if (ch == EOF)
-						log_error("Unexpected EOF in JSON file.\n");
-
-					if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == ',')
-						continue;
-
-					if (ch == '}')
-						break;
-
-					f.unget();
-					JsonNode key(f);
-
-					while (1)
-					{
-						ch = f.get();
-
-						if (ch == EOF)
-							log_error("Unexpected EOF in JSON file.\n");
+	void skip_string()
+	{
+		ptr++;
+		while (1) {
+			while (ptr != end && *ptr != '"' && *ptr != '\\')
+				ptr++;
+			if (ptr == end)
+				log_error("Unexpected EOF in JSON string.\n");
+			if (*ptr++ == '"')
+				return;
+			if (ptr == end)
+				log_error("Unexpected EOF in JSON string.\n");
+			ptr++;
+		}
+	}
 
-						if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == ':')
-							continue;
+	void begin_array() { log_assert(*ptr == '['); ptr++; }
+	void begin_dict() { log_assert(*ptr == '{'); ptr++; }
 
-						f.unget();
-						break;
-					}
+	// Advances to the next element of an array, returns false at its end.
+	bool next_element()
+	{
+		if (next(',') == ']') {
+			ptr++;
+			return false;
+		}
+		return true;
+	}
 
-					JsonNode *value = new JsonNode(f);
+	// Reads the key of the next entry of a dict, returns false at its end.
+	bool next_key(string &key)
+	{
+		if (next(',') == '}') {
+			ptr++;
+			return false;
+		}
+		if (peek_type() != 'S') {
+			skip_value();
+			log_error("Unexpected non-string key in JSON dict.\n");
+		}
+		parse_string(key);
+		next(':');
+		return true;
+	}
 
-					if (key.type != 'S')
-						log_error("Unexpected non-string key in JSON dict.\n");
+	// Decodes an array of bits, stopping the conversion at the first invalid
+	// bit but still consuming the whole array.
+	void parse_bits(JsonBits &bits)
+	{
+		bits.clear();
+		bits.type = peek_type();
+		if (bits.type != 'A') {
+			skip_value();
+			return;
+		}
 
-					data_dict[key.data_string] = value;
-					data_dict_keys.push_back(key.data_string);
+		begin_array();
+		while (next_element())
+		{
+			if (bits.bad_index >= 0) {
+				skip_value();
+				continue;
+			}
+			JsonScalar &value = bits.bad;
+			parse_scalar(value);
+			if (value.type == 'N') {
+				bits.bits.push_back(int(value.data_number));
+				continue;
+			}
+			if (value.type == 'S' && GetSize(value.data_string) == 1) {
+				switch (value.data_string[0]) {
+					case '0': bits.bits.push_back(JsonBits::CONST_BITS + State::S0); continue;
+					case '1': bits.bits.push_back(JsonBits::CONST_BITS + State::S1); continue;
+					case 'x': bits.bits.push_back(JsonBits::CONST_BITS + State::Sx); continue;
+					case 'z': bits.bits.push_back(JsonBits::CONST_BITS + State::Sz); continue;
 				}
-
-				break;
 			}
-
-			log_error("Unexpected character in JSON file: '%c'\n", ch);
+			bits.bad_index = GetSize(bits.bits);
 		}
 	}
+};
 
-	~JsonNode()
+// The signals of the bit indices of a module. The indices written by
+// write_json and most other tools are dense, so they are kept in a vector
+// which grows with them, and only outliers go to the dict.
+struct JsonSignalBits
+{
+	vector<SigBit> dense;
+	dict<int, SigBit> sparse;
+
+	SigBit *find(int idx)
 	{
-		for (auto it : data_array)
-			delete it;
-		for (auto &it : data_dict)
-			delete it.second;
+		if (idx >= 0 && idx < GetSize(dense) && dense[idx].wire != nullptr)
+			return &dense[idx];
+		if (sparse.empty())
+			return nullptr;
+		auto it = sparse.find(idx);
+		return it == sparse.end() ? nullptr : &it->second;
+	}
+
+	// Must only be called for indices which have no signal yet.
+	void set(int idx, SigBit bit)
+	{
+		if (idx >= 0 && idx < 2 * GetSize(dense) + 1024) {
+			if (idx >= GetSize(dense))
+				dense.resize(std::max(idx + 1, 2 * GetSize(dense)));
+			dense[idx] = bit;
+		} else
+			sparse[idx] = bit;
 	}
 };
 
-Const json_parse_attr_param_value(JsonNode *node)
+Const json_parse_attr_param_value(JsonScalar &node)
 {
 	Const value;
 
-	if (node->type == 'S') {
-		string &s = node->data_string;
+	if (node.type == 'S') {
+		string &s = node.data_string;
 		size_t cursor = s.find_first_not_of("01xz");
 		if (cursor == string::npos) {
 			value = Const::from_string(s);
@@ -257,15 +400,15 @@ Const json_parse_attr_param_value(JsonNode *node)
 			value = Const(s);
 		}
 	} else
-	if (node->type == 'N') {
-		value = Const(node->data_number, 32);
-		if (node->data_number < 0)
+	if (node.type == 'N') {
+		value = Const(node.data_number, 32);
+		if (node.data_number < 0)
 			value.flags |= RTLIL::CONST_FLAG_SIGNED;
 	} else
-	if (node->type == 'A') {
+	if (node.type == 'A') {
 		log_error("JSON attribute or parameter value is an array.\n");
 	} else
-	if (node->type == 'D') {
+	if (node.type == 'D') {
 		log_error("JSON attribute or parameter value is a dict.\n");
 	} else {
 		log_abort();
@@ -274,349 +417,458 @@ Const json_parse_attr_param_value(JsonNode *node)
 	return value;
 }
 
-void json_parse_attr_param(dict<IdString, Const> &results, JsonNode *node)
+void json_parse_attr_param(dict<IdString, Const> &results, JsonReader &reader)
 {
-	if (node->type != 'D')
+	if (reader.peek_type() != 'D')
 		log_error("JSON attributes or parameters node is not a dictionary.\n");
 
-	for (auto it : node->data_dict)
+	string key;
+	JsonScalar value;
+	reader.begin_dict();
+	while (reader.next_key(key))
 	{
-		IdString key = RTLIL::escape_id(it.first.c_str());
-		Const value = json_parse_attr_param_value(it.second);
-		results[key] = value;
+		reader.parse_scalar(value);
+		results[RTLIL::escape_id(key)] = json_parse_attr_param_value(value);
 	}
 }
 
-void json_import(Design *design, string &modname, JsonNode *node)
+void json_check_bits(const JsonBits &bits, const string &what)
 {
-	log("Importing module %s from JSON tree.\n", modname.c_str());
-
-	Module *module = new RTLIL::Module;
-	module->name = RTLIL::escape_id(modname.c_str());
-
-	if (design->module(module->name))
-		log_error("Re-definition of module %s.\n", log_id(module->name));
+	if (bits.bad_index < 0)
+		return;
+	if (bits.bad.type == 'S')
+		log_error("%s has invalid '%s' bit string value on bit %d.\n", what.c_str(), bits.bad.data_string.c_str(), bits.bad_index);
+	log_error("%s has invalid bit value on bit %d.\n", what.c_str(), bits.bad_index);
+}
 
-	design->add(module);
+// Creates the objects of a module while reading its dict. The sections are
+// read in a fixed order (ports, netnames, cells), as the handling of the bit
+// indices depends on it, but write_json puts the cells first. Therefore the
+// module dict is scanned once for the start of its sections before they are
+// read.
+struct JsonImporter
+{
+	JsonReader &reader;
+	Module *module;
+	JsonSignalBits signal_bits;
 
-	if (node->data_dict.count("attributes"))
-		json_parse_attr_param(module->attributes, node->data_dict.at("attributes"));
+	// buffers reused for all entries
+	string key;
+	JsonBits bits;
+	vector<SigBit> sig_bits;
 
-	dict<int, SigBit> signal_bits;
+	JsonImporter(JsonReader &reader, Module *module) : reader(reader), module(module) { }
 
-	if (node->data_dict.count("ports"))
+	void import_ports()
 	{
-		JsonNode *ports_node = node->data_dict.at("ports");
-
-		if (ports_node->type != 'D')
+		if (reader.peek_type() != 'D')
 			log_error("JSON ports node is not a dictionary.\n");
 
-		for (int port_id = 1; port_id <= GetSize(ports_node->data_dict_keys); port_id++)
+		string port_key;
+		JsonScalar direction, upto, is_signed, offset;
+
+		reader.begin_dict();
+		for (int port_id = 1; reader.next_key(port_key); port_id++)
 		{
-			IdString port_name = RTLIL::escape_id(ports_node->data_dict_keys[port_id-1].c_str());
-			JsonNode *port_node = ports_node->data_dict.at(ports_node->data_dict_keys[port_id-1]);
+			IdString port_name = RTLIL::escape_id(port_key);
 
-			if (port_node->type != 'D')
+			if (reader.peek_type() != 'D')
 				log_error("JSON port node '%s' is not a dictionary.\n", log_id(port_name));
 
-			if (port_node->data_dict.count("direction") == 0)
+			direction.type = upto.type = is_signed.type = offset.type = 0;
+			bits.clear();
+
+			reader.begin_dict();
+			while (reader.next_key(key)) {
+				if (key == "direction")
+					reader.parse_scalar(direction);
+				else if (key == "bits")
+					reader.parse_bits(bits);
+				else if (key == "upto")
+					reader.parse_scalar(upto);
+				else if (key == "signed")
+					reader.parse_scalar(is_signed);
+				else if (key == "offset")
+					reader.parse_scalar(offset);
+				else
+					reader.skip_value();
+			}
+
+			if (direction.type == 0)
 				log_error("JSON port node '%s' has no direction attribute.\n", log_id(port_name));
 
-			if (port_node->data_dict.count("bits") == 0)
+			if (bits.type == 0)
 				log_error("JSON port node '%s' has no bits attribute.\n", log_id(port_name));
 
-			JsonNode *port_direction_node = port_node->data_dict.at("direction");
-			JsonNode *port_bits_node = port_node->data_dict.at("bits");
-
-			if (port_direction_node->type != 'S')
+			if (direction.type != 'S')
 				log_error("JSON port node '%s' has non-string direction attribute.\n", log_id(port_name));
 
-			if (port_bits_node->type != 'A')
+			if (bits.type != 'A')
 				log_error("JSON port node '%s' has non-array bits attribute.\n", log_id(port_name));
 
 			Wire *port_wire = module->wire(port_name);
 
 			if (port_wire == nullptr)
-				port_wire = module->addWire(port_name, GetSize(port_bits_node->data_array));
+				port_wire = module->addWire(port_name, GetSize(bits.bits));
 
-			if (port_node->data_dict.count("upto") != 0) {
-				JsonNode *val = port_node->data_dict.at("upto");
-				if (val->type == 'N')
-					port_wire->upto = val->data_number != 0;
-			}
+			if (upto.type == 'N')
+				port_wire->upto = upto.data_number != 0;
 
-			if (port_node->data_dict.count("signed") != 0) {
-				JsonNode *val = port_node->data_dict.at("signed");
-				if (val->type == 'N')
-					port_wire->is_signed = val->data_number != 0;
-			}
+			if (is_signed.type == 'N')
+				port_wire->is_signed = is_signed.data_number != 0;
 
-			if (port_node->data_dict.count("offset") != 0) {
-				JsonNode *val = port_node->data_dict.at("offset");
-				if (val->type == 'N')
-					port_wire->start_offset = val->data_number;
-			}
+			if (offset.type == 'N')
+				port_wire->start_offset = offset.data_number;
 
-			if (port_direction_node->data_string == "input") {
+			if (direction.data_string == "input") {
 				port_wire->port_input = true;
 			} else
-			if (port_direction_node->data_string == "output") {
+			if (direction.data_string == "output") {
 				port_wire->port_output = true;
 			} else
-			if (port_direction_node->data_string == "inout") {
+			if (direction.data_string == "inout") {
 				port_wire->port_input = true;
 				port_wire->port_output = true;
 			} else
-				log_error("JSON port node '%s' has invalid '%s' direction attribute.\n", log_id(port_name), port_direction_node->data_string.c_str());
+				log_error("JSON port node '%s' has invalid '%s' direction attribute.\n", log_id(port_name), direction.data_string.c_str());
 
 			port_wire->port_id = port_id;
 
-			for (int i = 0; i < GetSize(port_bits_node->data_array); i++)
+			json_check_bits(bits, stringf("JSON port node '%s'", log_id(port_name)));
+
+			for (int i = 0; i < GetSize(bits.bits); i++)
 			{
-				JsonNode *bitval_node = port_bits_node->data_array.at(i);
+				int64_t bit = bits.bits[i];
 				SigBit sigbit(port_wire, i);
 
-				if (bitval_node->type == 'S') {
-					if (bitval_node->data_string == "0")
-						module->connect(sigbit, State::S0);
-					else if (bitval_node->data_string == "1")
-						module->connect(sigbit, State::S1);
-					else if (bitval_node->data_string == "x")
-						module->connect(sigbit, State::Sx);
-					else if (bitval_node->data_string == "z")
-						module->connect(sigbit, State::Sz);
-					else
-						log_error("JSON port node '%s' has invalid '%s' bit string value on bit %d.\n",
-								log_id(port_name), bitval_node->data_string.c_str(), i);
+				if (JsonBits::is_const(bit)) {
+					module->connect(sigbit, JsonBits::to_const(bit));
 				} else
-				if (bitval_node->type == 'N') {
-					int bitidx = bitval_node->data_number;
-					if (signal_bits.count(bitidx)) {
-						if (port_wire->port_output) {
-							module->connect(sigbit, signal_bits.at(bitidx));
-						} else {
-							module->connect(signal_bits.at(bitidx), sigbit);
-							signal_bits[bitidx] = sigbit;
-						}
+				if (SigBit *existing = signal_bits.find(bit)) {
+					if (port_wire->port_output) {
+						module->connect(sigbit, *existing);
 					} else {
-						signal_bits[bitidx] = sigbit;
+						module->connect(*existing, sigbit);
+						*existing = sigbit;
 					}
-				} else
-					log_error("JSON port node '%s' has invalid bit value on bit %d.\n", log_id(port_name), i);
+				} else {
+					signal_bits.set(bit, sigbit);
+				}
 			}
 		}
 
 		module->fixup_ports();
 	}
 
-	if (node->data_dict.count("netnames"))
+	void import_netnames()
 	{
-		JsonNode *netnames_node = node->data_dict.at("netnames");
-
-		if (netnames_node->type != 'D')
+		if (reader.peek_type() != 'D')
 			log_error("JSON netnames node is not a dictionary.\n");
 
-		for (auto &net : netnames_node->data_dict)
+		string net_key;
+		JsonScalar upto, offset;
+		dict<IdString, Const> attributes;
+
+		reader.begin_dict();
+		while (reader.next_key(net_key))
 		{
-			IdString net_name = RTLIL::escape_id(net.first.c_str());
-			JsonNode *net_node = net.second;
+			IdString net_name = RTLIL::escape_id(net_key);
 
-			if (net_node->type != 'D')
+			if (reader.peek_type() != 'D')
 				log_error("JSON netname node '%s' is not a dictionary.\n", log_id(net_name));
 
-			if (net_node->data_dict.count("bits") == 0)
-				log_error("JSON netname node '%s' has no bits attribute.\n", log_id(net_name));
+			upto.type = offset.type = 0;
+			bits.clear();
+			attributes.clear();
+
+			reader.begin_dict();
+			while (reader.next_key(key)) {
+				if (key == "bits")
+					reader.parse_bits(bits);
+				else if (key == "upto")
+					reader.parse_scalar(upto);
+				else if (key == "offset")
+					reader.parse_scalar(offset);
+				else if (key == "attributes")
+					json_parse_attr_param(attributes, reader);
+				else
+					reader.skip_value();
+			}
 
-			JsonNode *bits_node = net_node->data_dict.at("bits");
+			if (bits.type == 0)
+				log_error("JSON netname node '%s' has no bits attribute.\n", log_id(net_name));
 
-			if (bits_node->type != 'A')
+			if (bits.type != 'A')
 				log_error("JSON netname node '%s' has non-array bits attribute.\n", log_id(net_name));
 
+			json_check_bits(bits, stringf("JSON netname node '%s'", log_id(net_name)));
+
 			Wire *wire = module->wire(net_name);
 
 			if (wire == nullptr)
-				wire = module->addWire(net_name, GetSize(bits_node->data_array));
+				wire = module->addWire(net_name, GetSize(bits.bits));
 
-			if (net_node->data_dict.count("upto") != 0) {
-				JsonNode *val = net_node->data_dict.at("upto");
-				if (val->type == 'N')
-					wire->upto = val->data_number != 0;
-			}
+			if (upto.type == 'N')
+				wire->upto = upto.data_number != 0;
 
-			if (net_node->data_dict.count("offset") != 0) {
-				JsonNode *val = net_node->data_dict.at("offset");
-				if (val->type == 'N')
-					wire->start_offset = val->data_number;
-			}
+			if (offset.type == 'N')
+				wire->start_offset = offset.data_number;
 
-			for (int i = 0; i < GetSize(bits_node->data_array); i++)
+			for (int i = 0; i < GetSize(bits.bits); i++)
 			{
-				JsonNode *bitval_node = bits_node->data_array.at(i);
+				int64_t bit = bits.bits[i];
 				SigBit sigbit(wire, i);
 
-				if (bitval_node->type == 'S') {
-					if (bitval_node->data_string == "0")
-						module->connect(sigbit, State::S0);
-					else if (bitval_node->data_string == "1")
-						module->connect(sigbit, State::S1);
-					else if (bitval_node->data_string == "x")
-						module->connect(sigbit, State::Sx);
-					else if (bitval_node->data_string == "z")
-						module->connect(sigbit, State::Sz);
-					else
-						log_error("JSON netname node '%s' has invalid '%s' bit string value on bit %d.\n",
-								log_id(net_name), bitval_node->data_string.c_str(), i);
-				} else
-				if (bitval_node->type == 'N') {
-					int bitidx = bitval_node->data_number;
-					if (signal_bits.count(bitidx)) {
-						if (sigbit != signal_bits.at(bitidx))
-							module->connect(sigbit, signal_bits.at(bitidx));
-					} else {
-						signal_bits[bitidx] = sigbit;
-					}
+				if (JsonBits::is_const(bit)) {
+					module->connect(sigbit, JsonBits::to_const(bit));
 				} else
-					log_error("JSON netname node '%s' has invalid bit value on bit %d.\n", log_id(net_name), i);
+				if (SigBit *existing = signal_bits.find(bit)) {
+					if (sigbit != *existing)
+						module->connect(sigbit, *existing);
+				} else {
+					signal_bits.set(bit, sigbit);
+				}
 			}
 
-			if (net_node->data_dict.count("attributes"))
-				json_parse_attr_param(wire->attributes, net_node->data_dict.at("attributes"));
+			for (auto &it : attributes)
+				wire->attributes[it.first] = it.second;
 		}
 	}
 
-	if (node->data_dict.count("cells"))
+	void import_cells()
 	{
-		JsonNode *cells_node = node->data_dict.at("cells");
-
-		if (cells_node->type != 'D')
+		if (reader.peek_type() != 'D')
 			log_error("JSON cells node is not a dictionary.\n");
 
-		for (auto &cell_node_it : cells_node->data_dict)
+		string cell_key;
+		JsonScalar type;
+		char connections_type;
+		vector<std::pair<IdString, JsonBits>> connections;
+		int num_connections;
+		dict<IdString, Const> attributes, parameters;
+
+		reader.begin_dict();
+		while (reader.next_key(cell_key))
 		{
-			IdString cell_name = RTLIL::escape_id(cell_node_it.first.c_str());
-			JsonNode *cell_node = cell_node_it.second;
+			IdString cell_name = RTLIL::escape_id(cell_key);
 
-			if (cell_node->type != 'D')
+			if (reader.peek_type() != 'D')
 				log_error("JSON cells node '%s' is not a dictionary.\n", log_id(cell_name));
 
-			if (cell_node->data_dict.count("type") == 0)
-				log_error("JSON cells node '%s' has no type attribute.\n", log_id(cell_name));
+			type.type = connections_type = 0;
+			num_connections = 0;
+			attributes.clear();
+			parameters.clear();
+
+			reader.begin_dict();
+			while (reader.next_key(key)) {
+				if (key == "type") {
+					reader.parse_scalar(type);
+				} else if (key == "connections") {
+					connections_type = reader.peek_type();
+					if (connections_type != 'D') {
+						reader.skip_value();
+						continue;
+					}
+					num_connections = 0;
+					reader.begin_dict();
+					while (reader.next_key(key)) {
+						if (num_connections == GetSize(connections))
+							connections.emplace_back();
+						auto &conn = connections[num_connections++];
+						conn.first = RTLIL::escape_id(key);
+						reader.parse_bits(conn.second);
+					}
+				} else if (key == "attributes") {
+					json_parse_attr_param(attributes, reader);
+				} else if (key == "parameters") {
+					json_parse_attr_param(parameters, reader);
+				} else
+					reader.skip_value();
+			}
 
-			JsonNode *type_node = cell_node->data_dict.at("type");
+			if (type.type == 0)
+				log_error("JSON cells node '%s' has no type attribute.\n", log_id(cell_name));
 
-			if (type_node->type != 'S')
+			if (type.type != 'S')
 				log_error("JSON cells node '%s' has a non-string type.\n", log_id(cell_name));
 
-			IdString cell_type = RTLIL::escape_id(type_node->data_string.c_str());
+			IdString cell_type = RTLIL::escape_id(type.data_string);
+
+			// later entries replace earlier ones of the same name
+			if (Cell *old_cell = module->cell(cell_name))
+				module->remove(old_cell);
 
 			Cell *cell = module->addCell(cell_name, cell_type);
 
-			if (cell_node->data_dict.count("connections") == 0)
+			if (connections_type == 0)
 				log_error("JSON cells node '%s' has no connections attribute.\n", log_id(cell_name));
 
-			JsonNode *connections_node = cell_node->data_dict.at("connections");
-
-			if (connections_node->type != 'D')
+			if (connections_type != 'D')
 				log_error("JSON cells node '%s' has non-dictionary connections attribute.\n", log_id(cell_name));
 
-			for (auto &conn_it : connections_node->data_dict)
+			for (int i = 0; i < num_connections; i++)
 			{
-				IdString conn_name = RTLIL::escape_id(conn_it.first.c_str());
-				JsonNode *conn_node = conn_it.second;
+				IdString conn_name = connections[i].first;
+				JsonBits &conn_bits = connections[i].second;
 
-				if (conn_node->type != 'A')
+				if (conn_bits.type != 'A')
 					log_error("JSON cells node '%s' connection '%s' is not an array.\n", log_id(cell_name), log_id(conn_name));
 
-				SigSpec sig;
+				json_check_bits(conn_bits, stringf("JSON cells node '%s' connection '%s'", log_id(cell_name), log_id(conn_name)));
 
-				for (int i = 0; i < GetSize(conn_node->data_array); i++)
+				sig_bits.clear();
+				for (int64_t bit : conn_bits.bits)
 				{
-					JsonNode *bitval_node = conn_node->data_array.at(i);
-
-					if (bitval_node->type == 'S') {
-						if (bitval_node->data_string == "0")
-							sig.append(State::S0);
-						else if (bitval_node->data_string == "1")
-							sig.append(State::S1);
-						else if (bitval_node->data_string == "x")
-							sig.append(State::Sx);
-						else if (bitval_node->data_string == "z")
-							sig.append(State::Sz);
-						else
-							log_error("JSON cells node '%s' connection '%s' has invalid '%s' bit string value on bit %d.\n",
-									log_id(cell_name), log_id(conn_name), bitval_node->data_string.c_str(), i);
-					} else
-					if (bitval_node->type == 'N') {
-						int bitidx = bitval_node->data_number;
-						if (signal_bits.count(bitidx) == 0)
-							signal_bits[bitidx] = module->addWire(NEW_ID);
-						sig.append(signal_bits.at(bitidx));
+					if (JsonBits::is_const(bit)) {
+						sig_bits.push_back(JsonBits::to_const(bit));
 					} else
-						log_error("JSON cells node '%s' connection '%s' has invalid bit value on bit %d.\n",
-								log_id(cell_name), log_id(conn_name), i);
-
+					if (SigBit *existing = signal_bits.find(bit)) {
+						sig_bits.push_back(*existing);
+					} else {
+						SigBit sigbit = module->addWire(NEW_ID);
+						signal_bits.set(bit, sigbit);
+						sig_bits.push_back(sigbit);
+					}
 				}
 
-				cell->setPort(conn_name, sig);
+				cell->setPort(conn_name, sig_bits);
 			}
 
-			if (cell_node->data_dict.count("attributes"))
-				json_parse_attr_param(cell->attributes, cell_node->data_dict.at("attributes"));
-
-			if (cell_node->data_dict.count("parameters"))
-				json_parse_attr_param(cell->parameters, cell_node->data_dict.at("parameters"));
+			cell->attributes.swap(attributes);
+			cell->parameters.swap(parameters);
 		}
 	}
 
-	if (node->data_dict.count("memories"))
+	void import_memories()
 	{
-		JsonNode *memories_node = node->data_dict.at("memories");
-
-		if (memories_node->type != 'D')
+		if (reader.peek_type() != 'D')
 			log_error("JSON memories node is not a dictionary.\n");
 
-		for (auto &memory_node_it : memories_node->data_dict)
+		string memory_key;
+		JsonScalar width, size, start_offset;
+
+		reader.begin_dict();
+		while (reader.next_key(memory_key))
 		{
-			IdString memory_name = RTLIL::escape_id(memory_node_it.first.c_str());
-			JsonNode *memory_node = memory_node_it.second;
+			IdString memory_name = RTLIL::escape_id(memory_key);
 
 			RTLIL::Memory *mem = new RTLIL::Memory;
 			mem->name = memory_name;
 
-			if (memory_node->type != 'D')
+			if (reader.peek_type() != 'D')
 				log_error("JSON memory node '%s' is not a dictionary.\n", log_id(memory_name));
 
-			if (memory_node->data_dict.count("width") == 0)
+			width.type = size.type = start_offset.type = 0;
+
+			reader.begin_dict();
+			while (reader.next_key(key)) {
+				if (key == "width")
+					reader.parse_scalar(width);
+				else if (key == "size")
+					reader.parse_scalar(size);
+				else if (key == "start_offset")
+					reader.parse_scalar(start_offset);
+				else if (key == "attributes")
+					json_parse_attr_param(mem->attributes, reader);
+				else
+					reader.skip_value();
+			}
+
+			if (width.type == 0)
 				log_error("JSON memory node '%s' has no width attribute.\n", log_id(memory_name));
-			JsonNode *width_node = memory_node->data_dict.at("width");
-			if (width_node->type != 'N')
+			if (width.type != 'N')
 				log_error("JSON memory node '%s' has a non-number width.\n", log_id(memory_name));
-			mem->width = width_node->data_number;
+			mem->width = width.data_number;
 
-			if (memory_node->data_dict.count("size") == 0)
+			if (size.type == 0)
 				log_error("JSON memory node '%s' has no size attribute.\n", log_id(memory_name));
-			JsonNode *size_node = memory_node->data_dict.at("size");
-			if (size_node->type != 'N')
+			if (size.type != 'N')
 				log_error("JSON memory node '%s' has a non-number size.\n", log_id(memory_name));
-			mem->size = size_node->data_number;
+			mem->size = size.data_number;
 
 			mem->start_offset = 0;
-			if (memory_node->data_dict.count("start_offset") != 0) {
-				JsonNode *val = memory_node->data_dict.at("start_offset");
-				if (val->type == 'N')
-					mem->start_offset = val->data_number;
-			}
-
-			if (memory_node->data_dict.count("attributes"))
-				json_parse_attr_param(mem->attributes, memory_node->data_dict.at("attributes"));
+			if (start_offset.type == 'N')
+				mem->start_offset = start_offset.data_number;
 
+			if (module->memories.count(mem->name))
+				delete module->memories.at(mem->name);
 			module->memories[mem->name] = mem;
 		}
 	}
 
-	// remove duplicates from connections array
-	pool<RTLIL::SigSig> unique_connections(module->connections_.begin(), module->connections_.end());
-	module->connections_ = std::vector<RTLIL::SigSig>(unique_connections.begin(), unique_connections.end());
+	void import()
+	{
+		const char *attributes = nullptr, *ports = nullptr, *netnames = nullptr, *cells = nullptr, *memories = nullptr;
+
+		if (reader.peek_type() != 'D') {
+			reader.skip_value();
+			return;
+		}
+
+		reader.begin_dict();
+		while (reader.next_key(key)) {
+			if (key == "attributes")
+				attributes = reader.ptr;
+			else if (key == "ports")
+				ports = reader.ptr;
+			else if (key == "netnames")
+				netnames = reader.ptr;
+			else if (key == "cells")
+				cells = reader.ptr;
+			else if (key == "memories")
+				memories = reader.ptr;
+			reader.skip_value();
+		}
+		const char *module_end = reader.ptr;
+
+		if (attributes) {
+			reader.ptr = attributes;
+			json_parse_attr_param(module->attributes, reader);
+		}
+
+		if (ports) {
+			reader.ptr = ports;
+			import_ports();
+		}
+
+		if (netnames) {
+			reader.ptr = netnames;
+			import_netnames();
+		}
+
+		if (cells) {
+			reader.ptr = cells;
+			import_cells();
+		}
+
+		if (memories) {
+			reader.ptr = memories;
+			import_memories();
+		}
+
+		reader.ptr = module_end;
+
+		// remove duplicates from connections array
+		pool<RTLIL::SigSig> unique_connections(module->connections_.begin(), module->connections_.end());
+		module->connections_ = std::vector<RTLIL::SigSig>(unique_connections.begin(), unique_connections.end());
+	}
+};
+
+void json_import(Design *design, const string &modname, JsonReader &reader)
+{
+	log("Importing module %s from JSON tree.\n", modname.c_str());
+
+	Module *module = new RTLIL::Module;
+	module->name = RTLIL::escape_id(modname.c_str());
+
+	if (design->module(module->name))
+		log_error("Re-definition of module %s.\n", log_id(module->name));
+
+	design->add(module);
+
+	JsonImporter importer(reader, module);
+	importer.import();
 }
 
 struct JsonFrontend : public Frontend {
@@ -630,6 +882,9 @@ struct JsonFrontend : public Frontend {
 		log("Load modules from a JSON file into the current design See \"help write_json\"\n");
 		log("for a description of the file format.\n");
 		log("\n");
+		log("The design is created while the JSON text is parsed, without building a tree\n");
+		log("of the whole file in memory. Plain files are memory mapped.\n");
+		log("\n");
 	}
 	void execute(std::istream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design) override
 	{
@@ -646,20 +901,27 @@ struct JsonFrontend : public Frontend {
 		}
 		extra_args(f, filename, args, argidx);
 
-		JsonNode root(*f);
+		JsonBuffer buffer(*f, filename);
+		JsonReader reader(buffer);
 
-		if (root.type != 'D')
+		if (reader.peek_type() != 'D')
 			log_error("JSON root node is not a dictionary.\n");
 
-		if (root.data_dict.count("modules") != 0)
+		string key, modname;
+		reader.begin_dict();
+		while (reader.next_key(key))
 		{
-			JsonNode *modules = root.data_dict.at("modules");
+			if (key != "modules") {
+				reader.skip_value();
+				continue;
+			}
 
-			if (modules->type != 'D')
+			if (reader.peek_type() != 'D')
 				log_error("JSON modules node is not a dictionary.\n");
 
-			for (auto &it : modules->data_dict)
-				json_import(design, it.first, it.second);
+			reader.begin_dict();
+			while (reader.next_key(modname))
+				json_import(design, modname, reader);
 		}
 	}
 } JsonFrontend;
@@ -471,6 +471,10 @@ struct LibertyFrontend : public Frontend {
 		log("    -unit_delay\n");
 		log("        import combinational timing arcs under the unit delay model\n");
 		log("\n");
+		log("    -j <threads>\n");
+		log("        parse the cell groups of the liberty file using the given number of\n");
+		log("        threads (0 for one thread per core)\n");
+		log("\n");
 	}
 	void execute(std::istream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design) override
 	{
@@ -484,6 +488,7 @@ struct LibertyFrontend : public Frontend {
 		bool flag_ignore_buses = false;
 		bool flag_unit_delay = false;
 		std::vector<std::string> attributes;
+		LibertyParserOptions parser_options;
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++) {
@@ -530,6 +535,10 @@ struct LibertyFrontend : public Frontend {
 				flag_unit_delay = true;
 				continue;
 			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				parser_options.threads = atoi(args[++argidx].c_str());
+				continue;
+			}
 			break;
 		}
 		extra_args(f, filename, args, argidx);
@@ -539,7 +548,7 @@ struct LibertyFrontend : public Frontend {
 
 		log_header(design, "Executing Liberty frontend: %s\n", filename.c_str());
 
-		LibertyParser parser(*f, filename);
+		LibertyParser parser(*f, filename, parser_options);
 		int cell_count = 0;
 
 		std::map<std::string, std::tuple<int, int, bool>> global_type_map;
@@ -44,41 +44,54 @@
 YOSYS_NAMESPACE_BEGIN
 using namespace VERILOG_FRONTEND;
 
-static std::list<std::string> output_code;
-static std::list<std::string> input_buffer;
-static size_t input_buffer_charp;
+// The pending input is a stack of text segments, each with its own read
+// position. Included files, macro bodies and returned characters are pushed
+// on top of it, so the remaining input is never copied.
+struct input_segment_t
+{
+	std::shared_ptr<const std::string> text;
+	size_t pos;
+};
 
-static void return_char(char ch)
+static std::string output_code;
+static std::vector<input_segment_t> input_stack;
+
+static void insert_input(std::string str)
 {
-	if (input_buffer_charp == 0)
-		input_buffer.push_front(std::string() + ch);
-	else
-		input_buffer.front()[--input_buffer_charp] = ch;
+	if (!str.empty())
+		input_stack.push_back({std::make_shared<const std::string>(std::move(str)), 0});
 }
 
-static void insert_input(std::string str)
+static void return_char(char ch)
 {
-	if (input_buffer_charp != 0) {
-		input_buffer.front() = input_buffer.front().substr(input_buffer_charp);
-		input_buffer_charp = 0;
+	if (!input_stack.empty()) {
+		input_segment_t &top = input_stack.back();
+		if (top.pos > 0 && (*top.text)[top.pos-1] == ch) {
+			top.pos--;
+			return;
+		}
 	}
-	input_buffer.push_front(str);
+	insert_input(std::string(1, ch));
 }
 
-static char next_char()
+// Pops the segments which have been read completely, returns false at the
+// end of the input.
+static bool input_available()
 {
-	if (input_buffer.empty())
-		return 0;
+	while (!input_stack.empty() && input_stack.back().pos == input_stack.back().text->size())
+		input_stack.pop_back();
+	return !input_stack.empty();
+}
 
-	log_assert(input_buffer_charp <= input_buffer.front().size());
-	if (input_buffer_charp == input_buffer.front().size()) {
-		input_buffer_charp = 0;
-		input_buffer.pop_front();
-		return next_char();
+static char next_char()
+{
+	while (input_available()) {
+		input_segment_t &top = input_stack.back();
+		char ch = (*top.text)[top.pos++];
+		if (ch != '\r')
+			return ch;
 	}
-
-	char ch = input_buffer.front()[input_buffer_charp++];
-	return ch == '\r' ? next_char() : ch;
+	return 0;
 }
 
 static std::string skip_spaces()
@@ -108,7 +121,7 @@ static std::string next_token(bool pass_newline = false)
 	token += ch;
 	if (ch == '\n') {
 		if (pass_newline) {
-			output_code.push_back(token);
+			output_code += token;
 			return "";
 		}
 		return token;
@@ -329,7 +342,15 @@ struct define_body_t
 	arg_map_t   args;
 };
 
-define_map_t::define_map_t()
+static uint64_t define_hash(const std::string &name, const define_body_t &body)
+{
+	std::string str = name + '\0' + body.body + (body.has_args ? '\1' : '\0');
+	for (auto &arg : body.args.args)
+		str += arg.name + (arg.has_default ? '\1' + arg.default_value : "") + '\0';
+	return std::hash<std::string>()(str);
+}
+
+define_map_t::define_map_t() : fingerprint(0)
 {
 	add("YOSYS", "1");
 }
@@ -342,21 +363,23 @@ define_map_t::~define_map_t()
 void
 define_map_t::add(const std::string &name, const std::string &txt, const arg_map_t *args)
 {
-	defines[name] = std::unique_ptr<define_body_t>(new define_body_t(txt, args));
+	add(name, define_body_t(txt, args));
 }
 
 void define_map_t::add(const std::string &name, const define_body_t &body)
 {
-	defines[name] = std::unique_ptr<define_body_t>(new define_body_t(body));
+	auto &slot = defines[name];
+	if (slot)
+		fingerprint ^= define_hash(name, *slot);
+	slot = std::unique_ptr<define_body_t>(new define_body_t(body));
+	fingerprint ^= define_hash(name, *slot);
 }
 
 void define_map_t::merge(const define_map_t &map)
 {
-	for (const auto &pr : map.defines) {
-		// These contortions are so that we take a copy of each definition body in
-		// map.defines.
-		defines[pr.first] = std::unique_ptr<define_body_t>(new define_body_t(*pr.second));
-	}
+	// This takes a copy of each definition body in map.defines.
+	for (const auto &pr : map.defines)
+		add(pr.first, *pr.second);
 }
 
 const define_body_t *define_map_t::find(const std::string &name) const
@@ -367,12 +390,17 @@ const define_body_t *define_map_t::find(const std::string &name) const
 
 void define_map_t::erase(const std::string &name)
 {
-	defines.erase(name);
+	auto it = defines.find(name);
+	if (it == defines.end())
+		return;
+	fingerprint ^= define_hash(name, *it->second);
+	defines.erase(it);
 }
 
 void define_map_t::clear()
 {
 	defines.clear();
+	fingerprint = 0;
 }
 
 void define_map_t::log() const
@@ -385,20 +413,201 @@ void define_map_t::log() const
 	}
 }
 
-static void input_file(std::istream &f, std::string filename)
+static std::string read_file(std::istream &f)
 {
-	char buffer[513];
+	std::string text;
+	char buffer[65536];
 	int rc;
 
-	insert_input("");
-	auto it = input_buffer.begin();
+	while ((rc = readsome(f, buffer, sizeof(buffer))) > 0)
+		text.append(buffer, rc);
+	return text;
+}
 
-	input_buffer.insert(it, "`file_push \"" + filename + "\"\n");
-	while ((rc = readsome(f, buffer, sizeof(buffer)-1)) > 0) {
-		buffer[rc] = 0;
-		input_buffer.insert(it, buffer);
+static void input_file(const std::string &text, const std::string &filename)
+{
+	insert_input("`file_push \"" + filename + "\"\n" + text + "\n`file_pop\n");
+}
+
+// Cache of preprocessed include files. An entry holds the output for one
+// include file (from its `file_push to its `file_pop), together with the
+// changes it made to the definitions, so that including the same file again
+// with the same definitions only has to replay these. The key contains
+// everything the result depends on: the file name and contents, the
+// definitions, the include path and the current directory. Files included
+// by the cached file are stored with their contents and checked on each use.
+
+struct include_cache_entry_t
+{
+	std::string output;
+	// the definitions changed by the file: their final value, or nullptr if
+	// they were removed. If `cleared' is set, `undefineall was used first.
+	bool cleared = false;
+	std::vector<std::pair<std::string, std::unique_ptr<define_body_t>>> defines, global_defines;
+	bool resetall = false;
+	// (name, contents hash) of the nested include files
+	std::vector<std::pair<std::string, uint64_t>> nested_files;
+};
+
+// An include file which is being preprocessed, and whose result will be
+// stored in the cache once its `file_pop is reached.
+struct include_recording_t
+{
+	std::string key;
+	std::shared_ptr<const std::string> text;
+	size_t output_start, filename_depth;
+	int ifdef_pass_level;
+	size_t macro_arg_depth;
+	bool cacheable = true;
+	bool cleared = false, resetall = false;
+	std::set<std::string> defines, global_defines;
+	std::vector<std::pair<std::string, uint64_t>> nested_files;
+};
+
+static std::map<std::string, include_cache_entry_t> include_cache;
+static size_t include_cache_size;
+static std::vector<include_recording_t> include_recordings;
+
+// Upper bound for the size of the cached output, the cache is dropped when
+// it is exceeded.
+static const size_t include_cache_limit = 64 << 20;
+
+static uint64_t text_hash(const std::string &text)
+{
+	return std::hash<std::string>()(text);
+}
+
+static void note_define(const std::string &name, bool global)
+{
+	for (auto &rec : include_recordings)
+		(global ? rec.global_defines : rec.defines).insert(name);
+}
+
+static void note_undefineall()
+{
+	for (auto &rec : include_recordings) {
+		rec.cleared = true;
+		rec.defines.clear();
+		rec.global_defines.clear();
+	}
+}
+
+static void note_resetall()
+{
+	for (auto &rec : include_recordings)
+		rec.resetall = true;
+}
+
+static void note_include_file(const std::string &name, uint64_t hash)
+{
+	for (auto &rec : include_recordings)
+		rec.nested_files.push_back({name, hash});
+}
+
+static std::string include_cache_key(const std::string &fixed_fn, const std::string &text,
+		const define_map_t &defines, const std::list<std::string> &include_dirs)
+{
+	char cwd[PATH_MAX];
+	std::string key = fixed_fn + '\0';
+	key += stringf("%llx %zx %llx %d", (unsigned long long)text_hash(text), text.size(),
+			(unsigned long long)defines.fingerprint, sv_mode ? 1 : 0);
+	key += '\0' + std::string(getcwd(cwd, sizeof(cwd)) ? cwd : "");
+	for (auto &incdir : include_dirs)
+		key += '\0' + incdir;
+	return key;
+}
+
+// Returns the cache entry for a key, if the nested include files are
+// unchanged.
+static const include_cache_entry_t *include_cache_lookup(const std::string &key)
+{
+	auto it = include_cache.find(key);
+	if (it == include_cache.end())
+		return nullptr;
+	for (auto &nested : it->second.nested_files) {
+		std::ifstream ff(nested.first);
+		if (ff.fail() || text_hash(read_file(ff)) != nested.second) {
+			include_cache_size -= it->second.output.size();
+			include_cache.erase(it);
+			return nullptr;
+		}
+	}
+	return &it->second;
+}
+
+static void include_cache_replay(const include_cache_entry_t &entry, define_map_t &defines, define_map_t &global_defines_cache)
+{
+	output_code += entry.output;
+	if (entry.cleared) {
+		defines.clear();
+		global_defines_cache.clear();
+		note_undefineall();
+	}
+	for (auto &it : entry.defines) {
+		if (it.second)
+			defines.add(it.first, *it.second);
+		else
+			defines.erase(it.first);
+		note_define(it.first, false);
+	}
+	for (auto &it : entry.global_defines) {
+		if (it.second)
+			global_defines_cache.add(it.first, *it.second);
+		else
+			global_defines_cache.erase(it.first);
+		note_define(it.first, true);
+	}
+	if (entry.resetall) {
+		default_nettype_wire = true;
+		note_resetall();
+	}
+	for (auto &nested : entry.nested_files) {
+		yosys_input_files.insert(nested.first);
+		note_include_file(nested.first, nested.second);
+	}
+}
+
+// Called for each `file_pop, before the file name stack is popped. Stores the
+// recording of the file which ends here, if it is complete: the `file_pop
+// has to come from the end of the included text (rather than, say, from a
+// macro argument) and the conditionals and macro arguments must be balanced.
+static void include_cache_store(size_t filename_depth, int ifdef_pass_level, size_t macro_arg_depth,
+		const define_map_t &defines, const define_map_t &global_defines_cache)
+{
+	while (!include_recordings.empty() && include_recordings.back().filename_depth >= filename_depth)
+	{
+		include_recording_t rec = std::move(include_recordings.back());
+		include_recordings.pop_back();
+
+		if (!rec.cacheable || rec.filename_depth != filename_depth || rec.ifdef_pass_level != ifdef_pass_level ||
+				rec.macro_arg_depth != macro_arg_depth)
+			continue;
+		if (!input_available() || input_stack.back().text != rec.text || input_stack.back().pos + 1 != rec.text->size())
+			continue;
+
+		if (include_cache_size > include_cache_limit) {
+			include_cache.clear();
+			include_cache_size = 0;
+		}
+
+		include_cache_entry_t &entry = include_cache[rec.key];
+		include_cache_size -= entry.output.size();
+		entry.output = output_code.substr(rec.output_start);
+		include_cache_size += entry.output.size();
+		entry.cleared = rec.cleared;
+		entry.defines.clear();
+		for (auto &name : rec.defines) {
+			const define_body_t *body = defines.find(name);
+			entry.defines.emplace_back(name, body ? new define_body_t(*body) : nullptr);
+		}
+		entry.global_defines.clear();
+		for (auto &name : rec.global_defines) {
+			const define_body_t *body = global_defines_cache.find(name);
+			entry.global_defines.emplace_back(name, body ? new define_body_t(*body) : nullptr);
+		}
+		entry.resetall = rec.resetall;
+		entry.nested_files = std::move(rec.nested_files);
 	}
-	input_buffer.insert(it, "\n`file_pop\n");
 }
 
 // Read tokens to get one argument (either a macro argument at a callsite or a default argument in a
@@ -463,6 +672,7 @@ static void restore_macro_arg(define_map_t &defines, macro_arg_stack_t &macro_ar
 	log_assert(!macro_arg_stack.empty());
 	auto &overwritten_arg = macro_arg_stack.top();
 	defines.add(overwritten_arg.first, overwritten_arg.second);
+	note_define(overwritten_arg.first, false);
 	macro_arg_stack.pop();
 }
 
@@ -471,7 +681,7 @@ static bool try_expand_macro(define_map_t &defines, macro_arg_stack_t &macro_arg
 	if (tok == "`\"") {
 		std::string literal("\"");
 		// Expand string literal
-		while (!input_buffer.empty()) {
+		while (input_available()) {
 			std::string ntok = next_token();
 			if (ntok == "`\"") {
 				insert_input(literal+"\"");
@@ -526,6 +736,7 @@ static bool try_expand_macro(define_map_t &defines, macro_arg_stack_t &macro_arg
 				insert_input("`__restore_macro_arg ");
 			}
 			defines.add(pr.first, pr.second);
+			note_define(pr.first, false);
 		}
 	} else {
 		insert_input(tok);
@@ -739,6 +950,8 @@ read_define(const std::string &filename,
 		// printf("define: >>%s<< -> >>%s<<\n", name.c_str(), value.c_str());
 		defines_map.add(name, value, (state == 2) ? &args : nullptr);
 		global_defines_cache.add(name, value, (state == 2) ? &args : nullptr);
+		note_define(name, false);
+		note_define(name, true);
 	} else {
 		log_file_error(filename, 0, "Invalid name for macro definition: >>%s<<.\n", name.c_str());
 	}
@@ -770,12 +983,12 @@ frontend_verilog_preproc(std::istream                 &f,
 	bool ifdef_already_satisfied = false;
 
 	output_code.clear();
-	input_buffer.clear();
-	input_buffer_charp = 0;
+	input_stack.clear();
+	include_recordings.clear();
 
-	input_file(f, filename);
+	input_file(read_file(f), filename);
 
-	while (!input_buffer.empty())
+	while (input_available())
 	{
 		std::string tok = next_token();
 		// printf("token: >>%s<<\n", tok != "\n" ? tok.c_str() : "NEWLINE");
@@ -852,7 +1065,7 @@ frontend_verilog_preproc(std::istream                 &f,
 
 		if (ifdef_fail_level > 0) {
 			if (tok == "\n")
-				output_code.push_back(tok);
+				output_code += tok;
 			continue;
 		}
 
@@ -910,11 +1123,33 @@ frontend_verilog_preproc(std::istream                 &f,
 				}
 			}
 			if (ff.fail()) {
-				output_code.push_back("`file_notfound " + fn);
-			} else {
-				input_file(ff, fixed_fn);
-				yosys_input_files.insert(fixed_fn);
+				output_code += "`file_notfound " + fn;
+				// the file may exist by the time the outer files are included again
+				for (auto &rec : include_recordings)
+					rec.cacheable = false;
+				continue;
+			}
+
+			std::string text = read_file(ff);
+			std::string key = include_cache_key(fixed_fn, text, defines, include_dirs);
+			yosys_input_files.insert(fixed_fn);
+			note_include_file(fixed_fn, text_hash(text));
+
+			if (const include_cache_entry_t *entry = include_cache_lookup(key)) {
+				include_cache_replay(*entry, defines, global_defines_cache);
+				insert_input("\n");
+				continue;
 			}
+
+			input_file(text, fixed_fn);
+			include_recording_t rec;
+			rec.key = std::move(key);
+			rec.text = input_stack.back().text;
+			rec.output_start = output_code.size();
+			rec.filename_depth = filename_stack.size() + 1;
+			rec.ifdef_pass_level = ifdef_pass_level;
+			rec.macro_arg_depth = macro_arg_stack.size();
+			include_recordings.push_back(std::move(rec));
 			continue;
 		}
 
@@ -923,14 +1158,16 @@ frontend_verilog_preproc(std::istream                 &f,
 			std::string fn = next_token(true);
 			if (!fn.empty() && fn.front() == '"' && fn.back() == '"')
 				fn = fn.substr(1, fn.size()-2);
-			output_code.push_back(tok + " \"" + fn + "\"");
+			output_code += tok + " \"" + fn + "\"";
 			filename_stack.push_back(filename);
 			filename = fn;
 			continue;
 		}
 
 		if (tok == "`file_pop") {
-			output_code.push_back(tok);
+			output_code += tok;
+			include_cache_store(filename_stack.size(), ifdef_pass_level, macro_arg_stack.size(),
+					defines, global_defines_cache);
 			filename = filename_stack.back();
 			filename_stack.pop_back();
 			continue;
@@ -948,6 +1185,8 @@ frontend_verilog_preproc(std::istream                 &f,
 			// printf("undef: >>%s<<\n", name.c_str());
 			defines.erase(name);
 			global_defines_cache.erase(name);
+			note_define(name, false);
+			note_define(name, true);
 			continue;
 		}
 
@@ -962,12 +1201,14 @@ frontend_verilog_preproc(std::istream                 &f,
 
 		if (tok == "`resetall") {
 			default_nettype_wire = true;
+			note_resetall();
 			continue;
 		}
 
 		if (tok == "`undefineall" && sv_mode) {
 			defines.clear();
 			global_defines_cache.clear();
+			note_undefineall();
 			continue;
 		}
 
@@ -979,20 +1220,17 @@ frontend_verilog_preproc(std::istream                 &f,
 		if (try_expand_macro(defines, macro_arg_stack, tok))
 			continue;
 
-		output_code.push_back(tok);
+		output_code += tok;
 	}
 
 	if (ifdef_fail_level > 0 || ifdef_pass_level > 0) {
 		log_error("Unterminated preprocessor conditional!\n");
 	}
 
-	std::string output;
-	for (auto &str : output_code)
-		output += str;
-
+	std::string output = std::move(output_code);
 	output_code.clear();
-	input_buffer.clear();
-	input_buffer_charp = 0;
+	input_stack.clear();
+	include_recordings.clear();
 
 	return output;
 }
@@ -61,6 +61,10 @@ struct define_map_t
 	void log() const;
 
 	std::map<std::string, std::unique_ptr<define_body_t>> defines;
+
+	// Order independent hash of all definitions, kept up to date by the
+	// functions above. This is part of the key of the include file cache.
+	uint64_t fingerprint;
 };
 
 
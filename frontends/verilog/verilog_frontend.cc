@@ -52,6 +52,74 @@ static void error_on_dpi_function(AST::AstNode *node)
 		error_on_dpi_function(child);
 }
 
+// The AST cache stores the tree returned by the parser for each input, in a
+// file named after the SHA1 of everything the parser depends on: the code
+// after preprocessing (which contains the included files and the expanded
+// macros), the parser modes and the names of the known user types.
+static std::string ast_cache_file(const std::string &cache_dir, const std::string &filename, const std::string &code)
+{
+	SHA1 hasher;
+	hasher.update(stringf("yosys ast cache %s\n%s\n%zu\n", yosys_version_str, filename.c_str(), code.size()));
+	hasher.update(code);
+	hasher.update(stringf("\n%d%d%d%d%d%d%d%d%d%d\n", sv_mode, formal_mode, noassert_mode, noassume_mode, norestrict_mode,
+			assume_asserts_mode, assert_assumes_mode, lib_mode, specify_mode, default_nettype_wire));
+	std::vector<std::string> type_names;
+	for (auto &types : user_type_stack)
+		for (auto &it : types)
+			type_names.push_back(it.first);
+	for (auto &it : pkg_user_types)
+		type_names.push_back(it.first);
+	std::sort(type_names.begin(), type_names.end());
+	for (auto &name : type_names)
+		hasher.update(name + "\n");
+	return cache_dir + "/" + hasher.final() + ".ast";
+}
+
+// Returns the cached AST, or nullptr if there is no valid cache file. The
+// first byte holds the `default_nettype at the end of the input.
+static AST::AstNode *ast_cache_load(const std::string &cache_file)
+{
+	std::ifstream f(cache_file, std::ios::binary);
+	if (f.fail())
+		return nullptr;
+	std::stringstream buffer;
+	buffer << f.rdbuf();
+	std::string data = buffer.str();
+	if (data.empty() || (data[0] != '0' && data[0] != '1'))
+		return nullptr;
+	AST::AstNode *ast = AST::AstNode::deserialize(data.substr(1));
+	if (ast == nullptr || ast->type != AST::AST_DESIGN) {
+		delete ast;
+		return nullptr;
+	}
+	default_nettype_wire = data[0] == '1';
+	return ast;
+}
+
+static void ast_cache_store(const std::string &cache_dir, const std::string &cache_file, const AST::AstNode *ast)
+{
+	std::stringstream buffer;
+	buffer << (default_nettype_wire ? '1' : '0');
+	if (!ast->serialize(buffer))
+		return;
+
+	// write to a temporary file first, other processes may use the cache
+	// at the same time
+	create_directory(cache_dir);
+	std::string temp_file = stringf("%s.%d.tmp", cache_file.c_str(), getpid());
+	std::ofstream f(temp_file, std::ios::binary);
+	if (f.fail()) {
+		log_warning("Can't write AST cache file `%s'.\n", temp_file.c_str());
+		return;
+	}
+	f << buffer.rdbuf();
+	f.close();
+	if (f.fail() || std::rename(temp_file.c_str(), cache_file.c_str()) != 0) {
+		log_warning("Can't write AST cache file `%s'.\n", cache_file.c_str());
+		remove(temp_file.c_str());
+	}
+}
+
 static void add_package_types(dict<std::string, AST::AstNode *> &user_types, std::vector<AST::AstNode *> &package_list)
 {
 	// prime the parser's user type lookup table with the package qualified names
@@ -169,6 +237,13 @@ struct VerilogFrontend : public Frontend {
 		log("    -nopp\n");
 		log("        do not run the pre-processor\n");
 		log("\n");
+		log("    -astcache <dir>\n");
+		log("        keep the abstract syntax trees returned by the parser in the given\n");
+		log("        directory. When the same code (after preprocessing) is read again\n");
+		log("        with the same options, the tree is loaded from there instead of\n");
+		log("        parsing the code. Warnings from the parser are not repeated in that\n");
+		log("        case. The cache files may be deleted at any time.\n");
+		log("\n");
 		log("    -nodpi\n");
 		log("        disable DPI-C support\n");
 		log("\n");
@@ -266,6 +341,7 @@ struct VerilogFrontend : public Frontend {
 		bool flag_noblackbox = false;
 		bool flag_nowb = false;
 		bool flag_nosynthesis = false;
+		std::string ast_cache_dir;
 		define_map_t defines_map;
 
 		std::list<std::string> include_dirs;
@@ -384,6 +460,10 @@ struct VerilogFrontend : public Frontend {
 				flag_nopp = true;
 				continue;
 			}
+			if (arg == "-astcache" && argidx+1 < args.size()) {
+				ast_cache_dir = args[++argidx];
+				continue;
+			}
 			if (arg == "-nodpi") {
 				flag_nodpi = true;
 				continue;
@@ -493,6 +573,11 @@ struct VerilogFrontend : public Frontend {
 			if (flag_ppdump)
 				log("-- Verilog code after preprocessor --\n%s-- END OF DUMP --\n", code_after_preproc.c_str());
 			lexin = new std::istringstream(code_after_preproc);
+		} else if (!ast_cache_dir.empty()) {
+			std::stringstream buffer;
+			buffer << f->rdbuf();
+			code_after_preproc = buffer.str();
+			lexin = new std::istringstream(code_after_preproc);
 		}
 
 		// make package typedefs available to parser
@@ -511,10 +596,25 @@ struct VerilogFrontend : public Frontend {
 		// add a new empty type map to allow overriding existing global definitions
 		user_type_stack.push_back(UserTypeMap());
 
-		frontend_verilog_yyset_lineno(1);
-		frontend_verilog_yyrestart(NULL);
-		frontend_verilog_yyparse();
-		frontend_verilog_yylex_destroy();
+		std::string ast_cache_filename;
+		AST::AstNode *cached_ast = nullptr;
+		if (!ast_cache_dir.empty()) {
+			ast_cache_filename = ast_cache_file(ast_cache_dir, filename, code_after_preproc);
+			cached_ast = ast_cache_load(ast_cache_filename);
+		}
+
+		if (cached_ast != nullptr) {
+			log("Loaded AST from cache file `%s'.\n", ast_cache_filename.c_str());
+			delete current_ast;
+			current_ast = cached_ast;
+		} else {
+			frontend_verilog_yyset_lineno(1);
+			frontend_verilog_yyrestart(NULL);
+			frontend_verilog_yyparse();
+			frontend_verilog_yylex_destroy();
+			if (!ast_cache_dir.empty())
+				ast_cache_store(ast_cache_dir, ast_cache_filename, current_ast);
+		}
 
 		for (auto &child : current_ast->children) {
 			if (child->type == AST::AST_MODULE)
@@ -530,7 +630,7 @@ struct VerilogFrontend : public Frontend {
 				flag_nomeminit, flag_nomem2reg, flag_mem2reg, flag_noblackbox, lib_mode, flag_nowb, flag_noopt, flag_icells, flag_pwires, flag_nooverwrite, flag_overwrite, flag_defer, default_nettype_wire);
 
 
-		if (!flag_nopp)
+		if (lexin != f)
 			delete lexin;
 
 		// only the previous and new global type maps remain
@@ -0,0 +1,921 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Claire Xenia Wolf <claire@yosyshq.com>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+// [[CITE]] DAG-aware AIG rewriting
+// Alan Mishchenko, Satrajit Chatterjee, Robert Brayton. "DAG-Aware AIG Rewriting: A Fresh Look at Combinational Logic Synthesis."
+// Proceedings of the 43rd Annual Design Automation Conference (DAC '06), pp. 532-535.
+
+// [[CITE]] Irredundant sum of products
+// Shin-ichi Minato. "Fast Generation of Irredundant Sum-Of-Products Forms from Binary Decision Diagrams."
+// Proceedings of the Synthesis and Simulation Meeting and International Interchange (SASIMI '92), pp. 64-73.
+
+#include "kernel/aignet.h"
+
+#include <queue>
+
+YOSYS_NAMESPACE_BEGIN
+
+AigNet::AigNet()
+{
+	nodes.push_back({-1, -1, 0, 0});
+}
+
+int AigNet::add_input()
+{
+	int id = GetSize(nodes);
+	nodes.push_back({-1, -1, 0, 0});
+	inputs.push_back(id);
+	return 2 * id;
+}
+
+int AigNet::add_output(int lit)
+{
+	outputs.push_back(lit);
+	return GetSize(outputs) - 1;
+}
+
+int AigNet::AND(int a, int b)
+{
+	if (a == CFALSE || b == CFALSE || a == NOT(b))
+		return CFALSE;
+	if (a == CTRUE || a == b)
+		return b;
+	if (b == CTRUE)
+		return a;
+
+	if (a > b)
+		std::swap(a, b);
+	auto key = std::make_pair(a, b);
+	auto it = strash.find(key);
+	if (it != strash.end())
+		return 2 * it->second;
+
+	int id = GetSize(nodes);
+	nodes.push_back({a, b, std::max(level(a), level(b)) + 1, 0});
+	strash[key] = id;
+	return 2 * id;
+}
+
+int AigNet::MUX(int a, int b, int s)
+{
+	if (a == b)
+		return a;
+	return OR(AND(a, NOT(s)), AND(b, s));
+}
+
+int AigNet::AND(std::vector<int> lits)
+{
+	std::sort(lits.begin(), lits.end());
+	lits.erase(std::unique(lits.begin(), lits.end()), lits.end());
+	for (int i = 1; i < GetSize(lits); i++)
+		if (lits[i] == NOT(lits[i - 1]))
+			return CFALSE;
+	if (lits.empty())
+		return CTRUE;
+
+	// repeatedly combine the two shallowest literals, with the order of
+	// creation breaking ties
+	typedef std::tuple<int, int, int> entry;
+	std::priority_queue<entry, std::vector<entry>, std::greater<entry>> queue;
+	int seq = 0;
+	for (int lit : lits)
+		queue.push(entry(level(lit), seq++, lit));
+	while (GetSize(queue) > 1) {
+		int a = std::get<2>(queue.top());
+		queue.pop();
+		int b = std::get<2>(queue.top());
+		queue.pop();
+		int lit = AND(a, b);
+		queue.push(entry(level(lit), seq++, lit));
+	}
+	return std::get<2>(queue.top());
+}
+
+int AigNet::num_ands() const
+{
+	int count = 0;
+	for (auto &n : nodes)
+		if (n.fanin0 >= 0)
+			count++;
+	return count;
+}
+
+int AigNet::depth() const
+{
+	int depth = 0;
+	for (int lit : outputs)
+		depth = std::max(depth, level(resolve(lit)));
+	return depth;
+}
+
+void AigNet::replace(int node, int lit)
+{
+	if (GetSize(repl) <= node)
+		repl.resize(node + 1, -1);
+	repl[node] = lit;
+	auto &n = nodes[node];
+	auto it = strash.find(std::make_pair(n.fanin0, n.fanin1));
+	if (it != strash.end() && it->second == node)
+		strash.erase(it);
+}
+
+int AigNet::resolve(int lit) const
+{
+	while (node(lit) < GetSize(repl) && repl[node(lit)] >= 0)
+		lit = repl[node(lit)] ^ (lit & 1);
+	return lit;
+}
+
+void AigNet::truncate(int size)
+{
+	for (int id = size; id < GetSize(nodes); id++)
+		strash.erase(std::make_pair(nodes[id].fanin0, nodes[id].fanin1));
+	nodes.resize(size);
+}
+
+void AigNet::cleanup()
+{
+	AigNet out;
+	std::vector<int> map(nodes.size(), -1);
+	map[0] = CFALSE;
+	for (int id : inputs)
+		map[id] = out.add_input();
+
+	// depth first search without recursion, as AND chains can be long
+	std::vector<int> stack;
+	for (int lit : outputs) {
+		stack.push_back(node(resolve(lit)));
+		while (!stack.empty()) {
+			int id = stack.back();
+			if (map[id] >= 0) {
+				stack.pop_back();
+				continue;
+			}
+			int a = resolve(nodes[id].fanin0), b = resolve(nodes[id].fanin1);
+			if (map[node(a)] < 0) {
+				stack.push_back(node(a));
+				continue;
+			}
+			if (map[node(b)] < 0) {
+				stack.push_back(node(b));
+				continue;
+			}
+			map[id] = out.AND(map[node(a)] ^ (a & 1), map[node(b)] ^ (b & 1));
+			stack.pop_back();
+		}
+	}
+
+	for (int lit : outputs) {
+		lit = resolve(lit);
+		out.add_output(map[node(lit)] ^ (lit & 1));
+	}
+
+	*this = std::move(out);
+	compute_refs();
+}
+
+void AigNet::compute_refs()
+{
+	for (auto &n : nodes)
+		n.refs = 0;
+	for (auto &n : nodes)
+		if (n.fanin0 >= 0) {
+			nodes[node(n.fanin0)].refs++;
+			nodes[node(n.fanin1)].refs++;
+		}
+	for (int lit : outputs)
+		nodes[node(lit)].refs++;
+}
+
+void AigNet::balance()
+{
+	cleanup();
+
+	// an AND node which is used once, and uncomplemented, by another AND
+	// node becomes part of the multi-input AND of that node
+	std::vector<bool> absorbed(nodes.size());
+	for (auto &n : nodes)
+		if (n.fanin0 >= 0)
+			for (int lit : {n.fanin0, n.fanin1})
+				if (!complemented(lit) && is_and(node(lit)) && nodes[node(lit)].refs == 1)
+					absorbed[node(lit)] = true;
+
+	AigNet out;
+	std::vector<int> map(nodes.size(), -1);
+	map[0] = CFALSE;
+	for (int id : inputs)
+		map[id] = out.add_input();
+
+	std::vector<int> stack, leaves;
+	for (int id = 1; id < GetSize(nodes); id++) {
+		if (!is_and(id) || absorbed[id])
+			continue;
+		leaves.clear();
+		stack = {nodes[id].fanin0, nodes[id].fanin1};
+		while (!stack.empty()) {
+			int lit = stack.back();
+			stack.pop_back();
+			if (!complemented(lit) && absorbed[node(lit)]) {
+				stack.push_back(nodes[node(lit)].fanin0);
+				stack.push_back(nodes[node(lit)].fanin1);
+			} else {
+				leaves.push_back(map[node(lit)] ^ (lit & 1));
+			}
+		}
+		map[id] = out.AND(leaves);
+	}
+
+	for (int lit : outputs)
+		out.add_output(map[node(lit)] ^ (lit & 1));
+
+	*this = std::move(out);
+	cleanup();
+}
+
+namespace {
+
+const int MAX_LEAVES = 6;
+const int REWRITE_LEAVES = 4;
+const int REWRITE_CUTS = 8;
+// limit on the visited nodes when collecting the cone of a cut
+const int CONE_LIMIT = 64;
+
+const uint64_t var_masks[MAX_LEAVES] = {
+	0xaaaaaaaaaaaaaaaaull, 0xccccccccccccccccull, 0xf0f0f0f0f0f0f0f0ull,
+	0xff00ff00ff00ff00ull, 0xffff0000ffff0000ull, 0xffffffff00000000ull,
+};
+
+// Truth tables are over 6 variables, functions of fewer variables do not
+// depend on the remaining ones.
+uint64_t cofactor0(uint64_t tt, int var)
+{
+	uint64_t t = tt & ~var_masks[var];
+	return t | (t << (1 << var));
+}
+
+uint64_t cofactor1(uint64_t tt, int var)
+{
+	uint64_t t = tt & var_masks[var];
+	return t | (t >> (1 << var));
+}
+
+bool depends_on(uint64_t tt, int var)
+{
+	return cofactor0(tt, var) != cofactor1(tt, var);
+}
+
+struct Cube
+{
+	uint8_t pos = 0, neg = 0;
+};
+
+// Collects an irredundant sum of products of a function between `lower`
+// and `upper` into `cubes`, and returns the function of the cover.
+uint64_t isop(uint64_t lower, uint64_t upper, int nvars, std::vector<Cube> &cubes)
+{
+	if (lower == 0)
+		return 0;
+	if (upper == ~uint64_t(0)) {
+		cubes.push_back(Cube());
+		return ~uint64_t(0);
+	}
+
+	int var = nvars - 1;
+	while (var >= 0 && !depends_on(lower, var) && !depends_on(upper, var))
+		var--;
+	log_assert(var >= 0);
+
+	uint64_t lower0 = cofactor0(lower, var), lower1 = cofactor1(lower, var);
+	uint64_t upper0 = cofactor0(upper, var), upper1 = cofactor1(upper, var);
+
+	int start = GetSize(cubes);
+	uint64_t cover0 = isop(lower0 & ~upper1, upper0, var, cubes);
+	for (int i = start; i < GetSize(cubes); i++)
+		cubes[i].neg |= 1 << var;
+
+	start = GetSize(cubes);
+	uint64_t cover1 = isop(lower1 & ~upper0, upper1, var, cubes);
+	for (int i = start; i < GetSize(cubes); i++)
+		cubes[i].pos |= 1 << var;
+
+	uint64_t cover2 = isop((lower0 & ~cover0) | (lower1 & ~cover1), upper0 & upper1, var, cubes);
+	return (cover0 & ~var_masks[var]) | (cover1 & var_masks[var]) | cover2;
+}
+
+// A network of multi-input ANDs over the variables of a cut, computed once
+// for each function and instantiated in the AIG for every cut with this
+// function. Literals are encoded like those of the AIG, with nodes 1 to
+// nvars being the variables.
+struct Recipe
+{
+	int nvars = 0, out = AigNet::CFALSE;
+	std::vector<std::vector<int>> ands;
+
+	int var(int idx) const { return 2 * (idx + 1); }
+
+	int AND(std::vector<int> lits)
+	{
+		std::sort(lits.begin(), lits.end());
+		lits.erase(std::unique(lits.begin(), lits.end()), lits.end());
+		if (!lits.empty() && lits[0] == AigNet::CFALSE)
+			return AigNet::CFALSE;
+		if (!lits.empty() && lits[0] == AigNet::CTRUE)
+			lits.erase(lits.begin());
+		for (int i = 1; i < GetSize(lits); i++)
+			if (lits[i] == NOT(lits[i - 1]))
+				return AigNet::CFALSE;
+		if (lits.empty())
+			return AigNet::CTRUE;
+		if (GetSize(lits) == 1)
+			return lits[0];
+		ands.push_back(lits);
+		return 2 * (nvars + GetSize(ands));
+	}
+
+	int AND(int a, int b) { return AND(std::vector<int>{a, b}); }
+	int NOT(int a) { return a ^ 1; }
+	int OR(int a, int b) { return NOT(AND(NOT(a), NOT(b))); }
+	int XOR(int a, int b) { return OR(AND(a, NOT(b)), AND(NOT(a), b)); }
+
+	int MUX(int a, int b, int s)
+	{
+		if (a == b)
+			return a;
+		return OR(AND(a, NOT(s)), AND(b, s));
+	}
+
+	int instantiate(AigNet &aig, const std::vector<int> &leaves) const
+	{
+		std::vector<int> map = {AigNet::CFALSE}, lits;
+		for (int id : leaves)
+			map.push_back(2 * id);
+		for (auto &inputs : ands) {
+			lits.clear();
+			for (int lit : inputs)
+				lits.push_back(map[AigNet::node(lit)] ^ (lit & 1));
+			map.push_back(aig.AND(lits));
+		}
+		return map[AigNet::node(out)] ^ (out & 1);
+	}
+};
+
+// Builds an algebraically factored form of a sum of products, dividing by
+// the most frequent literal first.
+int factor(Recipe &r, const std::vector<Cube> &cubes)
+{
+	if (cubes.empty())
+		return AigNet::CFALSE;
+
+	int best = -1, best_count = 1;
+	for (int i = 0; i < 2 * r.nvars; i++) {
+		int count = 0;
+		for (auto &cube : cubes)
+			count += ((i & 1 ? cube.neg : cube.pos) >> (i >> 1)) & 1;
+		if (count > best_count) {
+			best = i;
+			best_count = count;
+		}
+	}
+
+	if (best < 0) {
+		std::vector<int> terms, lits;
+		for (auto &cube : cubes) {
+			lits.clear();
+			for (int var = 0; var < r.nvars; var++) {
+				if ((cube.pos >> var) & 1)
+					lits.push_back(r.var(var));
+				if ((cube.neg >> var) & 1)
+					lits.push_back(r.NOT(r.var(var)));
+			}
+			terms.push_back(r.NOT(r.AND(lits)));
+		}
+		return r.NOT(r.AND(terms));
+	}
+
+	std::vector<Cube> quotient, remainder;
+	uint8_t bit = 1 << (best >> 1);
+	for (auto cube : cubes) {
+		uint8_t &mask = best & 1 ? cube.neg : cube.pos;
+		if (mask & bit) {
+			mask &= ~bit;
+			quotient.push_back(cube);
+		} else {
+			remainder.push_back(cube);
+		}
+	}
+
+	int term = r.AND(r.var(best >> 1) ^ (best & 1), factor(r, quotient));
+	if (remainder.empty())
+		return term;
+	return r.OR(term, factor(r, remainder));
+}
+
+int synth_sop(Recipe &r, uint64_t tt)
+{
+	std::vector<Cube> cubes;
+	isop(tt, tt, r.nvars, cubes);
+	return factor(r, cubes);
+}
+
+// Builds a function by splitting off single variables as AND, OR and XOR
+// where possible, and by Shannon expansion otherwise.
+int synth_decompose(Recipe &r, uint64_t tt)
+{
+	if (tt == 0)
+		return AigNet::CFALSE;
+	if (tt == ~uint64_t(0))
+		return AigNet::CTRUE;
+
+	int top = -1;
+	for (int var = 0; var < r.nvars; var++) {
+		if (!depends_on(tt, var))
+			continue;
+		uint64_t tt0 = cofactor0(tt, var), tt1 = cofactor1(tt, var);
+		int x = r.var(var);
+		if (tt0 == 0)
+			return r.AND(x, synth_decompose(r, tt1));
+		if (tt1 == 0)
+			return r.AND(r.NOT(x), synth_decompose(r, tt0));
+		if (tt0 == ~uint64_t(0))
+			return r.OR(r.NOT(x), synth_decompose(r, tt1));
+		if (tt1 == ~uint64_t(0))
+			return r.OR(x, synth_decompose(r, tt0));
+		if (tt0 == ~tt1)
+			return r.XOR(x, synth_decompose(r, tt0));
+		top = var;
+	}
+
+	log_assert(top >= 0);
+	return r.MUX(synth_decompose(r, cofactor0(tt, top)), synth_decompose(r, cofactor1(tt, top)), r.var(top));
+}
+
+enum SynthMethod { SYNTH_DECOMPOSE, SYNTH_SOP, SYNTH_SOP_COMPLEMENT };
+
+struct AigResynth
+{
+	AigNet &aig;
+	std::vector<AigNet::Node> &nodes;
+
+	// cuts of the nodes for rewriting, each with sorted leaves
+	std::vector<std::vector<std::vector<int>>> cuts;
+	std::vector<bool> has_cuts;
+
+	// scratch space for the simulation and cost traversals
+	std::vector<uint64_t> values;
+	std::vector<int> stamps;
+	int stamp = 0;
+	std::vector<int> stack;
+
+	dict<std::tuple<uint32_t, uint32_t, int>, Recipe> recipes;
+
+	AigResynth(AigNet &aig) : aig(aig), nodes(aig.nodes)
+	{
+	}
+
+	void new_stamp()
+	{
+		if (GetSize(stamps) < GetSize(nodes)) {
+			stamps.resize(2 * GetSize(nodes), 0);
+			values.resize(2 * GetSize(nodes), 0);
+		}
+		stamp++;
+	}
+
+	int fanin(int id, int idx)
+	{
+		return aig.resolve(idx ? nodes[id].fanin1 : nodes[id].fanin0);
+	}
+
+	static bool is_leaf(const std::vector<int> &leaves, int id)
+	{
+		return std::find(leaves.begin(), leaves.end(), id) != leaves.end();
+	}
+
+	// Dereferences the nodes in the maximum fanout free cone of `root`
+	// bounded by `leaves` (restricted to AND nodes), and returns its size.
+	int deref_mffc(int root, const std::vector<int> &leaves)
+	{
+		int count = 1;
+		stack = {root};
+		while (!stack.empty()) {
+			int id = stack.back();
+			stack.pop_back();
+			for (int idx : {0, 1}) {
+				int f = AigNet::node(fanin(id, idx));
+				if (--nodes[f].refs == 0 && aig.is_and(f) && !is_leaf(leaves, f)) {
+					count++;
+					stack.push_back(f);
+				}
+			}
+		}
+		return count;
+	}
+
+	void ref_mffc(int root, const std::vector<int> &leaves)
+	{
+		stack = {root};
+		while (!stack.empty()) {
+			int id = stack.back();
+			stack.pop_back();
+			for (int idx : {0, 1}) {
+				int f = AigNet::node(fanin(id, idx));
+				if (nodes[f].refs++ == 0 && aig.is_and(f) && !is_leaf(leaves, f))
+					stack.push_back(f);
+			}
+		}
+	}
+
+	// Dereferences all nodes which only `root` used.
+	void kill(int root)
+	{
+		stack = {root};
+		while (!stack.empty()) {
+			int id = stack.back();
+			stack.pop_back();
+			for (int idx : {0, 1}) {
+				int f = AigNet::node(fanin(id, idx));
+				if (--nodes[f].refs == 0 && aig.is_and(f))
+					stack.push_back(f);
+			}
+		}
+	}
+
+	// Computes the function of `root` in terms of `leaves`, failing if the
+	// cone of the node is not bounded by them.
+	bool simulate(int root, const std::vector<int> &leaves, uint64_t &tt)
+	{
+		new_stamp();
+		stamps[0] = stamp;
+		values[0] = 0;
+		for (int i = 0; i < GetSize(leaves); i++) {
+			stamps[leaves[i]] = stamp;
+			values[leaves[i]] = var_masks[i];
+		}
+
+		int budget = 4 * CONE_LIMIT;
+		stack = {root};
+		while (!stack.empty()) {
+			int id = stack.back();
+			if (stamps[id] == stamp) {
+				stack.pop_back();
+				continue;
+			}
+			if (!aig.is_and(id) || --budget < 0)
+				return false;
+			int a = fanin(id, 0), b = fanin(id, 1);
+			if (stamps[AigNet::node(a)] != stamp) {
+				stack.push_back(AigNet::node(a));
+				continue;
+			}
+			if (stamps[AigNet::node(b)] != stamp) {
+				stack.push_back(AigNet::node(b));
+				continue;
+			}
+			uint64_t va = values[AigNet::node(a)], vb = values[AigNet::node(b)];
+			values[id] = (AigNet::complemented(a) ? ~va : va) & (AigNet::complemented(b) ? ~vb : vb);
+			stamps[id] = stamp;
+			stack.pop_back();
+		}
+		tt = values[root];
+		return true;
+	}
+
+	// Returns the number of nodes the structure of `lit` adds to the
+	// network: the ones created after `mark` and the dead ones it reuses.
+	// Returns -1 if the structure contains `root`.
+	int cost(int lit, int mark, int root, const std::vector<int> &leaves)
+	{
+		new_stamp();
+		int count = 0;
+		stack = {AigNet::node(lit)};
+		while (!stack.empty()) {
+			int id = stack.back();
+			stack.pop_back();
+			if (stamps[id] == stamp)
+				continue;
+			stamps[id] = stamp;
+			if (id == root)
+				return -1;
+			if (!aig.is_and(id) || is_leaf(leaves, id))
+				continue;
+			if (id >= mark || nodes[id].refs == 0) {
+				count++;
+				stack.push_back(AigNet::node(fanin(id, 0)));
+				stack.push_back(AigNet::node(fanin(id, 1)));
+			}
+		}
+		return count;
+	}
+
+	// References a node which was unreferenced so far, and recursively the
+	// nodes it revives.
+	void reference(int root, const std::vector<int> &leaves)
+	{
+		stack = {root};
+		while (!stack.empty()) {
+			int id = stack.back();
+			stack.pop_back();
+			for (int idx : {0, 1}) {
+				int f = AigNet::node(fanin(id, idx));
+				if (nodes[f].refs++ == 0 && aig.is_and(f) && !is_leaf(leaves, f))
+					stack.push_back(f);
+			}
+		}
+	}
+
+	int synth(SynthMethod method, uint64_t tt, const std::vector<int> &leaves)
+	{
+		// the halves of the truth table are hashed separately, as they are
+		// equal for functions of fewer than 6 variables
+		auto key = std::make_tuple(uint32_t(tt), uint32_t(tt >> 32), int(method) * (MAX_LEAVES + 1) + GetSize(leaves));
+		if (!recipes.count(key)) {
+			Recipe r;
+			r.nvars = GetSize(leaves);
+			switch (method) {
+			case SYNTH_DECOMPOSE:
+				r.out = synth_decompose(r, tt);
+				break;
+			case SYNTH_SOP:
+				r.out = synth_sop(r, tt);
+				break;
+			case SYNTH_SOP_COMPLEMENT:
+				r.out = r.NOT(synth_sop(r, ~tt));
+				break;
+			}
+			recipes[key] = std::move(r);
+		}
+		return recipes.at(key).instantiate(aig, leaves);
+	}
+
+	struct Candidate {
+		int gain = 0;
+		std::vector<int> leaves;
+		uint64_t tt;
+		SynthMethod method;
+	};
+
+	// Evaluates the given implementations of `root` on a cut and updates
+	// `best` if one of them saves more nodes without increasing the level.
+	void evaluate(int root, const std::vector<int> &leaves, const std::vector<SynthMethod> &methods, Candidate &best)
+	{
+		uint64_t tt;
+		if (!simulate(root, leaves, tt))
+			return;
+
+		int mffc = deref_mffc(root, leaves);
+		if (mffc > best.gain)
+			for (auto method : methods) {
+				int mark = GetSize(nodes);
+				int lit = synth(method, tt, leaves);
+				int added = cost(lit, mark, root, leaves);
+				if (added >= 0 && mffc - added > best.gain && aig.level(lit) <= nodes[root].level) {
+					best.gain = mffc - added;
+					best.leaves = leaves;
+					best.tt = tt;
+					best.method = method;
+				}
+				aig.truncate(mark);
+			}
+		ref_mffc(root, leaves);
+	}
+
+	void apply(int root, const Candidate &best)
+	{
+		deref_mffc(root, best.leaves);
+		int lit = synth(best.method, best.tt, best.leaves);
+		int id = AigNet::node(lit);
+		if (nodes[id].refs == 0 && aig.is_and(id) && !is_leaf(best.leaves, id))
+			reference(id, best.leaves);
+		nodes[id].refs += nodes[root].refs;
+		nodes[root].refs = 0;
+		aig.replace(root, lit);
+		for (int leaf : best.leaves)
+			if (nodes[leaf].refs == 0 && aig.is_and(leaf))
+				kill(leaf);
+	}
+
+	void compute_cuts(int root)
+	{
+		stack = {root};
+		while (!stack.empty()) {
+			int id = stack.back();
+			if (GetSize(has_cuts) < GetSize(nodes)) {
+				has_cuts.resize(2 * GetSize(nodes), false);
+				cuts.resize(2 * GetSize(nodes));
+			}
+			if (has_cuts[id]) {
+				stack.pop_back();
+				continue;
+			}
+			if (!aig.is_and(id)) {
+				has_cuts[id] = true;
+				stack.pop_back();
+				continue;
+			}
+			int a = AigNet::node(fanin(id, 0)), b = AigNet::node(fanin(id, 1));
+			if (!has_cuts[a]) {
+				stack.push_back(a);
+				continue;
+			}
+			if (!has_cuts[b]) {
+				stack.push_back(b);
+				continue;
+			}
+			merge_cuts(id, a, b);
+			has_cuts[id] = true;
+			stack.pop_back();
+		}
+	}
+
+	// The cuts of a node including the trivial one, with the constant node
+	// having a single empty cut.
+	std::vector<std::vector<int>> all_cuts(int id)
+	{
+		std::vector<std::vector<int>> ret;
+		if (id == 0)
+			ret.push_back({});
+		else
+			ret.push_back({id});
+		ret.insert(ret.end(), cuts[id].begin(), cuts[id].end());
+		return ret;
+	}
+
+	static bool dominates(const std::vector<int> &a, const std::vector<int> &b)
+	{
+		return std::includes(b.begin(), b.end(), a.begin(), a.end());
+	}
+
+	void merge_cuts(int id, int a, int b)
+	{
+		std::vector<std::vector<int>> merged;
+		std::vector<int> cut;
+		for (auto &cut_a : all_cuts(a))
+			for (auto &cut_b : all_cuts(b)) {
+				cut.clear();
+				std::set_union(cut_a.begin(), cut_a.end(), cut_b.begin(), cut_b.end(), std::back_inserter(cut));
+				if (GetSize(cut) <= REWRITE_LEAVES)
+					merged.push_back(cut);
+			}
+
+		std::stable_sort(merged.begin(), merged.end(), [](const std::vector<int> &x, const std::vector<int> &y) {
+			return x.size() < y.size();
+		});
+		auto &result = cuts[id];
+		result.clear();
+		for (auto &candidate : merged) {
+			bool dominated = false;
+			for (auto &other : result)
+				if (dominates(other, candidate)) {
+					dominated = true;
+					break;
+				}
+			if (!dominated)
+				result.push_back(candidate);
+			if (GetSize(result) == REWRITE_CUTS)
+				break;
+		}
+	}
+
+	// Grows a cut from the fanins of `root` towards the inputs, expanding
+	// the leaf which adds the fewest new leaves first.
+	std::vector<int> reconvergent_cut(int root)
+	{
+		std::vector<int> leaves, cone = {root};
+		auto add_leaf = [&](int id) {
+			if (id != 0 && !is_leaf(leaves, id) && !is_leaf(cone, id))
+				leaves.push_back(id);
+		};
+		add_leaf(AigNet::node(fanin(root, 0)));
+		add_leaf(AigNet::node(fanin(root, 1)));
+
+		while (GetSize(cone) < CONE_LIMIT) {
+			int best = -1, best_cost = 0;
+			for (int i = 0; i < GetSize(leaves); i++) {
+				int id = leaves[i];
+				if (!aig.is_and(id))
+					continue;
+				int a = AigNet::node(fanin(id, 0)), b = AigNet::node(fanin(id, 1));
+				int cost = -1;
+				if (a != 0 && !is_leaf(leaves, a) && !is_leaf(cone, a))
+					cost++;
+				if (b != 0 && b != a && !is_leaf(leaves, b) && !is_leaf(cone, b))
+					cost++;
+				if (GetSize(leaves) + cost > MAX_LEAVES)
+					continue;
+				if (best < 0 || cost < best_cost || (cost == best_cost && nodes[id].level > nodes[leaves[best]].level)) {
+					best = i;
+					best_cost = cost;
+				}
+			}
+			if (best < 0)
+				break;
+			int id = leaves[best];
+			leaves.erase(leaves.begin() + best);
+			cone.push_back(id);
+			add_leaf(AigNet::node(fanin(id, 0)));
+			add_leaf(AigNet::node(fanin(id, 1)));
+		}
+
+		std::sort(leaves.begin(), leaves.end());
+		return leaves;
+	}
+
+	void rewrite()
+	{
+		const std::vector<SynthMethod> methods = {SYNTH_DECOMPOSE, SYNTH_SOP, SYNTH_SOP_COMPLEMENT};
+		int size = GetSize(nodes);
+		for (int id = 1; id < size; id++) {
+			if (!aig.is_and(id) || nodes[id].refs == 0)
+				continue;
+			compute_cuts(id);
+			Candidate best;
+			for (auto &cut : cuts[id])
+				evaluate(id, cut, methods, best);
+			if (best.gain > 0)
+				apply(id, best);
+		}
+	}
+
+	void refactor()
+	{
+		const std::vector<SynthMethod> methods = {SYNTH_SOP, SYNTH_SOP_COMPLEMENT};
+		int size = GetSize(nodes);
+		for (int id = 1; id < size; id++) {
+			if (!aig.is_and(id) || nodes[id].refs == 0)
+				continue;
+			Candidate best;
+			evaluate(id, reconvergent_cut(id), methods, best);
+			if (best.gain > 0)
+				apply(id, best);
+		}
+	}
+};
+
+} // namespace
+
+void AigNet::rewrite()
+{
+	cleanup();
+	AigResynth worker(*this);
+	worker.rewrite();
+	cleanup();
+}
+
+void AigNet::refactor()
+{
+	cleanup();
+	AigResynth worker(*this);
+	worker.refactor();
+	cleanup();
+}
+
+int aig_bit_literal(RTLIL::Module *module, dict<RTLIL::SigBit, int> &bit_lits, const RTLIL::SigBit &bit,
+		const std::function<std::vector<RTLIL::SigBit>(const RTLIL::SigBit&)> &dependencies,
+		const std::function<int(const RTLIL::SigBit&)> &create_literal)
+{
+	if (auto it = bit_lits.find(bit); it != bit_lits.end())
+		return it->second;
+
+	// depth first search without recursion, as gate chains can be long
+	pool<RTLIL::SigBit> expanded;
+	std::vector<RTLIL::SigBit> stack = {bit};
+	while (!stack.empty()) {
+		RTLIL::SigBit top = stack.back();
+		if (bit_lits.count(top)) {
+			stack.pop_back();
+			continue;
+		}
+		if (expanded.insert(top).second) {
+			for (auto &dep : dependencies(top)) {
+				if (bit_lits.count(dep))
+					continue;
+				// expanded but unfinished bits are on the current path
+				if (expanded.count(dep))
+					log_error("Found combinational loop through %s in module %s.\n", log_signal(dep), log_id(module));
+				stack.push_back(dep);
+			}
+			continue;
+		}
+		bit_lits[top] = create_literal(top);
+		stack.pop_back();
+	}
+	return bit_lits.at(bit);
+}
+
+YOSYS_NAMESPACE_END
@@ -0,0 +1,118 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Claire Xenia Wolf <claire@yosyshq.com>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef AIGNET_H
+#define AIGNET_H
+
+#include "kernel/yosys.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// An in-memory and-inverter graph with structural hashing, together with the
+// classic local optimizations on it (balancing, cut rewriting and
+// refactoring).
+//
+// Literals are 2*node+complement, node 0 is constant false. The node
+// constructors fold constants and reuse existing nodes with the same fanins,
+// the same way as the Index of the aiger2 backend does, so that a network can
+// be built with AND()/NOT() and friends directly. Nodes are created in
+// topological order.
+//
+// The optimization steps keep the inputs and outputs (and their order) but
+// renumber all other nodes; literals obtained before are invalidated.
+struct AigNet
+{
+	struct Node {
+		// fanin literals, -1 for the constant node and inputs
+		int fanin0, fanin1;
+		int level;
+		// number of references by live nodes and outputs, see compute_refs()
+		int refs;
+	};
+
+	static constexpr int CFALSE = 0, CTRUE = 1;
+
+	std::vector<Node> nodes;
+	// nodes of the inputs and literals of the outputs
+	std::vector<int> inputs, outputs;
+
+	AigNet();
+
+	static int node(int lit) { return lit >> 1; }
+	static bool complemented(int lit) { return lit & 1; }
+
+	bool is_and(int node) const { return nodes[node].fanin0 >= 0; }
+	bool is_input(int node) const { return node != 0 && nodes[node].fanin0 < 0; }
+	int level(int lit) const { return nodes[lit >> 1].level; }
+
+	// Returns the literal of the new input, resp. the index of the output.
+	int add_input();
+	int add_output(int lit);
+
+	int AND(int a, int b);
+	int NOT(int a) { return a ^ 1; }
+	int OR(int a, int b) { return NOT(AND(NOT(a), NOT(b))); }
+	int XOR(int a, int b) { return OR(AND(a, NOT(b)), AND(NOT(a), b)); }
+	int MUX(int a, int b, int s);
+	// Conjunction of any number of literals, as a tree of minimal depth.
+	int AND(std::vector<int> lits);
+
+	int num_ands() const;
+	int depth() const;
+
+	// Removes all nodes which are not in the fanin cone of an output and
+	// recomputes the reference counts.
+	void cleanup();
+	void compute_refs();
+
+	// Rebuilds maximal multi-input AND trees for minimal depth.
+	void balance();
+	// Replaces the logic between a node and each of its 4-input cuts by a
+	// smaller implementation, if any.
+	void rewrite();
+	// Like rewrite(), but with a single large cut per node and resynthesis
+	// from the factored sum of products.
+	void refactor();
+
+	// Nodes replaced during the optimizations, which are only removed by
+	// the next cleanup(). resolve() follows the replacements of a literal.
+	std::vector<int> repl;
+	void replace(int node, int lit);
+	int resolve(int lit) const;
+
+	// Removes the nodes created after the network had `size` nodes, which
+	// must not be referenced.
+	void truncate(int size);
+
+private:
+	dict<std::pair<int, int>, int> strash;
+};
+
+// Returns the literal of the sigmapped `bit` from `bit_lits`, after creating the
+// literals of all bits in its fanin cone that don't have one yet, fanins first.
+// `dependencies` returns the sigmapped bits whose literals are needed by
+// `create_literal` for a bit. This is shared by the passes that extract an
+// AIG from the gates of a module; a combinational loop is an error.
+int aig_bit_literal(RTLIL::Module *module, dict<RTLIL::SigBit, int> &bit_lits, const RTLIL::SigBit &bit,
+		const std::function<std::vector<RTLIL::SigBit>(const RTLIL::SigBit&)> &dependencies,
+		const std::function<int(const RTLIL::SigBit&)> &create_literal);
+
+YOSYS_NAMESPACE_END
+
+#endif
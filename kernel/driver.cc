@@ -20,6 +20,7 @@
 #include "kernel/yosys.h"
 #include "kernel/hashlib.h"
 #include "libs/sha1/sha1.h"
+#include "libs/json11/json11.hpp"
 #define CXXOPTS_VECTOR_DELIMITER '\0'
 #include "libs/cxxopts/include/cxxopts.hpp"
 #include <iostream>
@@ -200,6 +201,7 @@ int main(int argc, char **argv)
 	std::string depsfile = "";
 	std::string topmodule = "";
 	std::string perffile = "";
+	std::string tracefile = "";
 	bool scriptfile_tcl = false;
 	bool scriptfile_python = false;
 	bool print_banner = true;
@@ -292,6 +294,8 @@ int main(int argc, char **argv)
 			cxxopts::value<std::vector<std::string>>(), "<feature>")
 		("g,debug", "globally enable debug log messages")
 		("perffile", "write a JSON performance log to <perffile>", cxxopts::value<std::string>(), "<perffile>")
+		("trace-out", "write a Chrome trace event file of all passes to <tracefile>",
+			cxxopts::value<std::string>(), "<tracefile>")
 	;
 
 	options.parse_positional({"infile"});
@@ -436,6 +440,7 @@ int main(int argc, char **argv)
 			log_experimentals_ignored.insert(ignores.begin(), ignores.end());
 		}
 		if (result.count("perffile")) perffile = result["perffile"].as<std::string>();
+		if (result.count("trace-out")) tracefile = result["trace-out"].as<std::string>();
 		if (result.count("infile")) {
 			frontend_files = result["infile"].as<std::vector<std::string>>();
 		}
@@ -515,6 +520,8 @@ int main(int argc, char **argv)
 #endif
 
 	yosys_setup();
+	if (!tracefile.empty())
+		log_trace_open(tracefile);
 #ifdef WITH_PYTHON
 	PyRun_SimpleString(("sys.path.append(\""+proc_self_dirname()+"\")").c_str());
 	PyRun_SimpleString(("sys.path.append(\""+proc_share_dirname()+"plugins\")").c_str());
@@ -696,13 +703,18 @@ int main(int argc, char **argv)
 #endif
 		log("%s\n", yosys_maybe_version());
 
-		int64_t total_ns = 0;
+		int64_t total_ns = 0, total_peak_growth = 0;
 		std::set<tuple<int64_t, int, std::string>> timedat;
+		std::set<tuple<int64_t, std::string>> memdat;
 
 		for (auto &it : pass_register)
 			if (it.second->call_counter) {
 				total_ns += it.second->runtime_ns + 1;
 				timedat.insert(make_tuple(it.second->runtime_ns + 1, it.second->call_counter, it.first));
+				if (it.second->peak_rss_growth > 0) {
+					total_peak_growth += it.second->peak_rss_growth;
+					memdat.insert(make_tuple(it.second->peak_rss_growth, it.first));
+				}
 			}
 
 		if (timing_details)
@@ -727,6 +739,34 @@ int main(int argc, char **argv)
 			}
 			log("%s\n", out_count ? "" : " no commands executed");
 		}
+
+		if (timing_details)
+		{
+			if (!memdat.empty()) {
+				log("Peak memory growth:\n");
+				for (auto it = memdat.rbegin(); it != memdat.rend(); it++) {
+					Pass *pass = pass_register.at(std::get<1>(*it));
+					log("%5d%% %10.2f MB peak %+10.2f MB RSS %+10.2f MB data %+9lld wires %+9lld cells %s\n",
+							int(100*std::get<0>(*it) / total_peak_growth), std::get<0>(*it) / (1024.0 * 1024.0),
+							pass->rss_delta / (1024.0 * 1024.0), pass->data_delta / (1024.0 * 1024.0),
+							(long long)pass->wires_delta, (long long)pass->cells_delta, std::get<1>(*it).c_str());
+				}
+			}
+			int design_wires = 0, design_bits = 0, design_cells = 0;
+			log("Design size:\n");
+			for (auto module : yosys_design->modules()) {
+				int bits = 0;
+				for (auto wire : module->wires())
+					bits += wire->width;
+				log("%9d wires %9d bits %9d cells %s\n", GetSize(module->wires()), bits,
+						GetSize(module->cells()), log_id(module));
+				design_wires += GetSize(module->wires());
+				design_bits += bits;
+				design_cells += GetSize(module->cells());
+			}
+			log("%9d wires %9d bits %9d cells (%d modules)\n", design_wires, design_bits,
+					design_cells, GetSize(yosys_design->modules()));
+		}
 		if(!perffile.empty())
 		{
 			FILE *f = fopen(perffile.c_str(), "wt");
@@ -736,6 +776,7 @@ int main(int argc, char **argv)
 			fprintf(f, "{\n");
 			fprintf(f, "  \"generator\": \"%s\",\n", yosys_maybe_version());
 			fprintf(f, "  \"total_ns\": %" PRIu64 ",\n", total_ns);
+			fprintf(f, "  \"peak_rss_bytes\": %" PRId64 ",\n", MemoryUsage::query().peak_rss);
 			fprintf(f, "  \"passes\": {");
 
 			bool first = true;
@@ -743,8 +784,28 @@ int main(int argc, char **argv)
 				if (!first)
 					fprintf(f, ",");
 				fprintf(f, "\n	\"%s\": {\n", std::get<2>(*it).c_str());
+				Pass *pass = pass_register.at(std::get<2>(*it));
 				fprintf(f, "	  \"runtime_ns\": %" PRIu64 ",\n", std::get<0>(*it));
-				fprintf(f, "	  \"num_calls\": %u\n", std::get<1>(*it));
+				fprintf(f, "	  \"num_calls\": %u,\n", std::get<1>(*it));
+				fprintf(f, "	  \"peak_rss_growth_bytes\": %" PRId64 ",\n", pass->peak_rss_growth);
+				fprintf(f, "	  \"rss_delta_bytes\": %" PRId64 ",\n", pass->rss_delta);
+				fprintf(f, "	  \"data_delta_bytes\": %" PRId64 ",\n", pass->data_delta);
+				fprintf(f, "	  \"wires_delta\": %" PRId64 ",\n", pass->wires_delta);
+				fprintf(f, "	  \"cells_delta\": %" PRId64 "\n", pass->cells_delta);
+				fprintf(f, "	}");
+				first = false;
+			}
+			fprintf(f, "\n  },\n");
+			fprintf(f, "  \"modules\": {");
+			first = true;
+			for (auto module : yosys_design->modules()) {
+				int bits = 0;
+				for (auto wire : module->wires())
+					bits += wire->width;
+				fprintf(f, "%s\n	%s: {\n", first ? "" : ",", json11::Json(module->name.str()).dump().c_str());
+				fprintf(f, "	  \"wires\": %d,\n", GetSize(module->wires()));
+				fprintf(f, "	  \"bits\": %d,\n", bits);
+				fprintf(f, "	  \"cells\": %d\n", GetSize(module->cells()));
 				fprintf(f, "	}");
 				first = false;
 			}
@@ -779,6 +840,7 @@ int main(int argc, char **argv)
 	}
 #endif
 
+	log_trace_close();
 	log_check_expected();
 
 	yosys_atexit();
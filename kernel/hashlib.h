@@ -21,6 +21,12 @@
 #include <type_traits>
 #include <stdint.h>
 
+// SSE2 is used through compiler builtins instead of <emmintrin.h>, as this
+// header is included from within the Yosys namespace (see yosys_common.h).
+#if defined(YOSYS_ENABLE_HASHLIB_OPEN_ADDRESSING) && (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__)
+#  define HASHLIB_SSE2
+#endif
+
 #define YS_HASHING_VERSION 1
 
 namespace hashlib {
@@ -51,6 +57,11 @@ namespace hashlib {
  * We implement associative data structures with separate chaining.
  * Linked lists use integers into the indirection hashtable array
  * instead of pointers.
+ *
+ * When built with YOSYS_ENABLE_HASHLIB_OPEN_ADDRESSING, the indirection
+ * hashtable is replaced by an open addressing table (see open_index below).
+ * The entries vector, and with it the iteration order, is the same in both
+ * variants.
  */
 
 const int hashtable_size_trigger = 2;
@@ -351,6 +362,193 @@ inline unsigned int hashtable_size(unsigned int min_size)
 	throw std::length_error("hash table exceeded maximum size.");
 }
 
+#ifdef YOSYS_ENABLE_HASHLIB_OPEN_ADDRESSING
+// Open addressing index into the entries vector of a dict or pool, in the
+// style of a "Swiss table". Next to each slot there is a control byte which
+// is either empty, deleted (a tombstone) or holds 7 bits of the hash of the
+// entry the slot points to. Lookups compare the control bytes of a group of
+// slots at once (with SSE2 where available) and only touch the entries whose
+// hash bits match. Groups are probed in triangular order, which visits every
+// group of a power of two sized table.
+class open_index
+{
+	static constexpr int8_t EMPTY = -128;
+	static constexpr int8_t DELETED = -2;
+	static constexpr int GROUP = 16;
+
+	// capacity + GROUP - 1 control bytes, the first GROUP - 1 are mirrored
+	// at the end so that a group can be loaded from any slot position
+	std::vector<int8_t> ctrl;
+	std::vector<int> slots;
+	size_t mask = 0;
+	size_t used = 0;
+
+	static uint32_t mix(uint32_t h) {
+		h ^= h >> 16;
+		h *= 0x85ebca6b;
+		h ^= h >> 13;
+		h *= 0xc2b2ae35;
+		h ^= h >> 16;
+		return h;
+	}
+
+#ifdef HASHLIB_SSE2
+	typedef char group_t __attribute__((vector_size(GROUP), __may_alias__, aligned(1)));
+	typedef signed char sgroup_t __attribute__((vector_size(GROUP)));
+
+	sgroup_t load_group(size_t pos) const {
+		return (sgroup_t)*(const group_t*)(ctrl.data() + pos);
+	}
+
+	static uint32_t movemask(sgroup_t bits) {
+		typedef char mask_t __attribute__((vector_size(GROUP)));
+		return __builtin_ia32_pmovmskb128((mask_t)bits);
+	}
+#endif
+
+	static int first_bit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_ctz(mask);
+#else
+		int n = 0;
+		while (!(mask & 1))
+			mask >>= 1, n++;
+		return n;
+#endif
+	}
+
+	uint32_t match(size_t pos, int8_t h2) const {
+#ifdef HASHLIB_SSE2
+		return movemask((sgroup_t)(load_group(pos) == h2));
+#else
+		uint32_t result = 0;
+		for (int i = 0; i < GROUP; i++)
+			if (ctrl[pos + i] == h2)
+				result |= 1u << i;
+		return result;
+#endif
+	}
+
+	// matches empty and deleted slots
+	uint32_t match_free(size_t pos) const {
+#ifdef HASHLIB_SSE2
+		return movemask((sgroup_t)(load_group(pos) < -1));
+#else
+		uint32_t result = 0;
+		for (int i = 0; i < GROUP; i++)
+			if (ctrl[pos + i] < -1)
+				result |= 1u << i;
+		return result;
+#endif
+	}
+
+	void set_ctrl(size_t slot, int8_t value) {
+		ctrl[slot] = value;
+		if (slot < GROUP - 1)
+			ctrl[mask + 1 + slot] = value;
+	}
+
+	// Returns the slot pointing to entry `index`
+	size_t find_slot(uint32_t hash, int index) const {
+		hash = mix(hash);
+		int8_t h2 = hash >> 25;
+		size_t pos = hash & mask;
+		for (size_t step = GROUP;; step += GROUP) {
+			for (uint32_t m = match(pos, h2); m; m &= m - 1) {
+				size_t slot = (pos + first_bit(m)) & mask;
+				if (slots[slot] == index)
+					return slot;
+			}
+			pos = (pos + step) & mask;
+		}
+	}
+
+public:
+	bool empty() const { return slots.empty(); }
+
+	void clear() {
+		ctrl.clear();
+		slots.clear();
+		mask = 0;
+		used = 0;
+	}
+
+	void swap(open_index &other) {
+		ctrl.swap(other.ctrl);
+		slots.swap(other.slots);
+		std::swap(mask, other.mask);
+		std::swap(used, other.used);
+	}
+
+	// Returns whether inserting one more slot requires a rebuild to keep the
+	// load factor (including tombstones) at or below 7/8.
+	bool full() const {
+		return 8 * (used + 1) > 7 * slots.size();
+	}
+
+	// Returns the index of the first entry matching `cmp`, or -1.
+	template<typename Cmp>
+	int find(uint32_t hash, Cmp cmp) const {
+		if (slots.empty())
+			return -1;
+		hash = mix(hash);
+		int8_t h2 = hash >> 25;
+		size_t pos = hash & mask;
+		for (size_t step = GROUP;; step += GROUP) {
+			for (uint32_t m = match(pos, h2); m; m &= m - 1) {
+				int index = slots[(pos + first_bit(m)) & mask];
+				if (cmp(index))
+					return index;
+			}
+			if (match(pos, EMPTY))
+				return -1;
+			pos = (pos + step) & mask;
+		}
+	}
+
+	// Adds entry `index`, the caller must check full() first.
+	void insert(uint32_t hash, int index) {
+		hash = mix(hash);
+		size_t pos = hash & mask;
+		for (size_t step = GROUP;; step += GROUP) {
+			if (uint32_t m = match_free(pos)) {
+				size_t slot = (pos + first_bit(m)) & mask;
+				if (ctrl[slot] == EMPTY)
+					used++;
+				set_ctrl(slot, hash >> 25);
+				slots[slot] = index;
+				return;
+			}
+			pos = (pos + step) & mask;
+		}
+	}
+
+	void erase(uint32_t hash, int index) {
+		set_ctrl(find_slot(hash, index), DELETED);
+	}
+
+	// Makes the slot of entry `old_index` point to `new_index` instead.
+	void move(uint32_t hash, int old_index, int new_index) {
+		slots[find_slot(hash, old_index)] = new_index;
+	}
+
+	// Rebuilds the index for `count` entries with room for at least `min_size`
+	// entries, `hash_of(i)` must return the hash of entry i.
+	template<typename HashOf>
+	void rebuild(size_t count, size_t min_size, HashOf hash_of) {
+		size_t size = GROUP;
+		while (8 * std::max(count + 1, min_size) > 7 * size)
+			size *= 2;
+		ctrl.assign(size + GROUP - 1, EMPTY);
+		slots.assign(size, -1);
+		mask = size - 1;
+		used = 0;
+		for (size_t i = 0; i < count; i++)
+			insert(hash_of(i), i);
+	}
+};
+#endif
+
 template<typename K, typename T, typename OPS = hash_ops<K>> class dict;
 template<typename K, int offset = 0, typename OPS = hash_ops<K>> class idict;
 template<typename K, typename OPS = hash_ops<K>> class pool;
@@ -361,15 +559,25 @@ class dict {
 	struct entry_t
 	{
 		std::pair<K, T> udata;
+#ifdef YOSYS_ENABLE_HASHLIB_OPEN_ADDRESSING
+		entry_t() { }
+		entry_t(const std::pair<K, T> &udata) : udata(udata) { }
+		entry_t(std::pair<K, T> &&udata) : udata(std::move(udata)) { }
+#else
 		int next;
 
 		entry_t() { }
 		entry_t(const std::pair<K, T> &udata, int next) : udata(udata), next(next) { }
 		entry_t(std::pair<K, T> &&udata, int next) : udata(std::move(udata)), next(next) { }
+#endif
 		bool operator<(const entry_t &other) const { return udata.first < other.udata.first; }
 	};
 
+#ifdef YOSYS_ENABLE_HASHLIB_OPEN_ADDRESSING
+	open_index hashtable;
+#else
 	std::vector<int> hashtable;
+#endif
 	std::vector<entry_t> entries;
 	OPS ops;
 
@@ -381,6 +589,78 @@ class dict {
 	}
 #endif
 
+#ifdef YOSYS_ENABLE_HASHLIB_OPEN_ADDRESSING
+	Hasher::hash_t do_hash(const K &key) const
+	{
+		return ops.hash(key).yield();
+	}
+
+	void do_rehash()
+	{
+		if (entries.empty())
+			hashtable.clear();
+		else
+			hashtable.rebuild(entries.size(), entries.capacity(), [&](int i) { return do_hash(entries[i].udata.first); });
+	}
+
+	int do_erase(int index, Hasher::hash_t hash)
+	{
+		do_assert(index < int(entries.size()));
+		if (hashtable.empty() || index < 0)
+			return 0;
+
+		hashtable.erase(hash, index);
+
+		int back_idx = entries.size()-1;
+
+		if (index != back_idx)
+		{
+			hashtable.move(do_hash(entries[back_idx].udata.first), back_idx, index);
+			entries[index] = std::move(entries[back_idx]);
+		}
+
+		entries.pop_back();
+
+		if (entries.empty())
+			hashtable.clear();
+
+		return 1;
+	}
+
+	int do_lookup(const K &key, Hasher::hash_t &hash) const
+	{
+		return hashtable.find(hash, [&](int index) { return ops.cmp(entries[index].udata.first, key); });
+	}
+
+	int do_insert(const K &key, Hasher::hash_t &hash)
+	{
+		entries.emplace_back(std::pair<K, T>(key, T()));
+		do_index_back(hash);
+		return entries.size() - 1;
+	}
+
+	int do_insert(const std::pair<K, T> &value, Hasher::hash_t &hash)
+	{
+		entries.emplace_back(value);
+		do_index_back(hash);
+		return entries.size() - 1;
+	}
+
+	int do_insert(std::pair<K, T> &&rvalue, Hasher::hash_t &hash)
+	{
+		entries.emplace_back(std::forward<std::pair<K, T>>(rvalue));
+		do_index_back(hash);
+		return entries.size() - 1;
+	}
+
+	void do_index_back(Hasher::hash_t hash)
+	{
+		if (hashtable.full())
+			do_rehash();
+		else
+			hashtable.insert(hash, entries.size() - 1);
+	}
+#else
 	Hasher::hash_t do_hash(const K &key) const
 	{
 		Hasher::hash_t hash = 0;
@@ -510,6 +790,7 @@ class dict {
 		}
 		return entries.size() - 1;
 	}
+#endif
 
 public:
 	class const_iterator
@@ -821,14 +1102,24 @@ protected:
 	struct entry_t
 	{
 		K udata;
+#ifdef YOSYS_ENABLE_HASHLIB_OPEN_ADDRESSING
+		entry_t() { }
+		entry_t(const K &udata) : udata(udata) { }
+		entry_t(K &&udata) : udata(std::move(udata)) { }
+#else
 		int next;
 
 		entry_t() { }
 		entry_t(const K &udata, int next) : udata(udata), next(next) { }
 		entry_t(K &&udata, int next) : udata(std::move(udata)), next(next) { }
+#endif
 	};
 
+#ifdef YOSYS_ENABLE_HASHLIB_OPEN_ADDRESSING
+	open_index hashtable;
+#else
 	std::vector<int> hashtable;
+#endif
 	std::vector<entry_t> entries;
 	OPS ops;
 
@@ -840,6 +1131,71 @@ protected:
 	}
 #endif
 
+#ifdef YOSYS_ENABLE_HASHLIB_OPEN_ADDRESSING
+	Hasher::hash_t do_hash(const K &key) const
+	{
+		return ops.hash(key).yield();
+	}
+
+	void do_rehash()
+	{
+		if (entries.empty())
+			hashtable.clear();
+		else
+			hashtable.rebuild(entries.size(), entries.capacity(), [&](int i) { return do_hash(entries[i].udata); });
+	}
+
+	int do_erase(int index, Hasher::hash_t hash)
+	{
+		do_assert(index < int(entries.size()));
+		if (hashtable.empty() || index < 0)
+			return 0;
+
+		hashtable.erase(hash, index);
+
+		int back_idx = entries.size()-1;
+
+		if (index != back_idx)
+		{
+			hashtable.move(do_hash(entries[back_idx].udata), back_idx, index);
+			entries[index] = std::move(entries[back_idx]);
+		}
+
+		entries.pop_back();
+
+		if (entries.empty())
+			hashtable.clear();
+
+		return 1;
+	}
+
+	int do_lookup(const K &key, Hasher::hash_t &hash) const
+	{
+		return hashtable.find(hash, [&](int index) { return ops.cmp(entries[index].udata, key); });
+	}
+
+	int do_insert(const K &value, Hasher::hash_t &hash)
+	{
+		entries.emplace_back(value);
+		do_index_back(hash);
+		return entries.size() - 1;
+	}
+
+	int do_insert(K &&rvalue, Hasher::hash_t &hash)
+	{
+		entries.emplace_back(std::forward<K>(rvalue));
+		do_index_back(hash);
+		return entries.size() - 1;
+	}
+
+	void do_index_back(Hasher::hash_t hash)
+	{
+		if (hashtable.full())
+			do_rehash();
+		else
+			hashtable.insert(hash, entries.size() - 1);
+	}
+#else
 	Hasher::hash_t do_hash(const K &key) const
 	{
 		Hasher::hash_t hash = 0;
@@ -951,6 +1307,7 @@ protected:
 		}
 		return entries.size() - 1;
 	}
+#endif
 
 public:
 	class const_iterator
@@ -20,6 +20,7 @@
 #include "kernel/yosys.h"
 #include "libs/sha1/sha1.h"
 #include "backends/rtlil/rtlil_backend.h"
+#include "libs/json11/json11.hpp"
 
 #if !defined(_WIN32) || defined(__MINGW32__)
 #  include <sys/time.h>
@@ -27,6 +28,7 @@
 
 #if defined(__linux__) || defined(__FreeBSD__)
 #  include <dlfcn.h>
+#  include <unistd.h>
 #endif
 
 #include <stdlib.h>
@@ -35,6 +37,12 @@
 #include <stdarg.h>
 #include <vector>
 #include <list>
+#include <chrono>
+
+#ifdef YOSYS_ENABLE_THREADS
+#  include <atomic>
+#  include <mutex>
+#endif
 
 YOSYS_NAMESPACE_BEGIN
 
@@ -751,6 +759,110 @@ void log_check_expected()
 		}
 }
 
+static FILE *log_trace_file = nullptr;
+static std::chrono::steady_clock::time_point log_trace_start;
+#ifdef YOSYS_ENABLE_THREADS
+static std::mutex log_trace_mutex;
+static std::atomic<int> log_trace_next_tid{1};
+#endif
+
+void log_trace_open(const std::string &filename)
+{
+	log_trace_close();
+	log_trace_file = fopen(filename.c_str(), "wt");
+	if (log_trace_file == nullptr)
+		log_error("Can't open trace file `%s' for writing: %s\n", filename.c_str(), strerror(errno));
+	log_trace_start = std::chrono::steady_clock::now();
+	// the array format, which stays readable if the file isn't closed
+	fprintf(log_trace_file, "[\n");
+	fprintf(log_trace_file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": %s}}",
+			json11::Json(yosys_maybe_version()).dump().c_str());
+}
+
+void log_trace_close()
+{
+	if (log_trace_file == nullptr)
+		return;
+	fprintf(log_trace_file, "\n]\n");
+	fclose(log_trace_file);
+	log_trace_file = nullptr;
+}
+
+bool log_trace_active()
+{
+	return log_trace_file != nullptr;
+}
+
+int64_t log_trace_clock()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - log_trace_start).count();
+}
+
+static void log_trace_event(const std::string &name, const char *category, const char *phase, int64_t ts, int64_t dur, const std::string &args)
+{
+	if (log_trace_file == nullptr)
+		return;
+#ifdef YOSYS_ENABLE_THREADS
+	thread_local int tid = log_trace_next_tid++;
+	std::lock_guard<std::mutex> lock(log_trace_mutex);
+#else
+	int tid = 1;
+#endif
+	fprintf(log_trace_file, ",\n{\"name\": %s, \"cat\": \"%s\", \"ph\": \"%s\", \"ts\": %lld, ",
+			json11::Json(name).dump().c_str(), category, phase, (long long)ts);
+	if (dur >= 0)
+		fprintf(log_trace_file, "\"dur\": %lld, ", (long long)dur);
+	fprintf(log_trace_file, "\"pid\": 1, \"tid\": %d, \"args\": {%s}}", tid, args.c_str());
+}
+
+void log_trace_begin(const std::string &name, const char *category, const std::string &args)
+{
+	if (log_trace_file != nullptr)
+		log_trace_event(name, category, "B", log_trace_clock(), -1, args);
+}
+
+void log_trace_end(const std::string &name, const char *category, const std::string &args)
+{
+	if (log_trace_file != nullptr)
+		log_trace_event(name, category, "E", log_trace_clock(), -1, args);
+}
+
+void log_trace_complete(const std::string &name, const char *category, int64_t begin_us, const std::string &args)
+{
+	if (log_trace_file != nullptr) {
+		int64_t now = log_trace_clock();
+		log_trace_event(name, category, "X", begin_us, now - begin_us, args);
+	}
+}
+
+MemoryUsage MemoryUsage::query()
+{
+	MemoryUsage usage;
+#if defined(__linux__)
+	// sizes in pages: total, resident, shared, text, lib, data
+	if (FILE *f = fopen("/proc/self/statm", "r")) {
+		long long size, resident, shared, text, lib, data;
+		if (fscanf(f, "%lld %lld %lld %lld %lld %lld", &size, &resident, &shared, &text, &lib, &data) == 6) {
+			int64_t page_size = sysconf(_SC_PAGESIZE);
+			usage.rss = resident * page_size;
+			usage.data = data * page_size;
+		}
+		fclose(f);
+	}
+#endif
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__APPLE__)
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru) == 0) {
+#  if defined(__APPLE__)
+		usage.peak_rss = ru.ru_maxrss;
+#  else
+		usage.peak_rss = int64_t(ru.ru_maxrss) * 1024;
+#  endif
+	}
+#endif
+	return usage;
+}
+
 // ---------------------------------------------------
 // This is the magic behind the code coverage counters
 // ---------------------------------------------------
@@ -189,6 +189,21 @@ void log_backtrace(const char *prefix, int levels);
 void log_reset_stack();
 void log_flush();
 
+// Timeline of the executed passes in the Chrome trace event format (see the
+// --trace-out option of the driver). Nested events are written as pairs of
+// begin and end events, `args' is the body of a JSON object (or empty). The
+// functions may be called from any thread and do nothing unless a trace file
+// is open.
+void log_trace_open(const std::string &filename);
+void log_trace_close();
+bool log_trace_active();
+void log_trace_begin(const std::string &name, const char *category, const std::string &args = std::string());
+void log_trace_end(const std::string &name, const char *category, const std::string &args = std::string());
+// for events of other threads, which can't be nested: an event which started
+// at `begin_us' (from log_trace_clock()) and ends now
+void log_trace_complete(const std::string &name, const char *category, int64_t begin_us, const std::string &args = std::string());
+int64_t log_trace_clock();
+
 struct LogExpectedItem
 {
 	LogExpectedItem(const std::regex &pat, int expected) :
@@ -338,6 +353,20 @@ struct PerformanceTimer
 #endif
 };
 
+// snapshot of the memory usage of the process, all values are in bytes and
+// zero where not available. query() is cheap enough to be called for each
+// executed pass.
+struct MemoryUsage
+{
+	// current and peak resident set size
+	int64_t rss = 0, peak_rss = 0;
+	// size of the data segments (heap and anonymous mappings), which grows
+	// with the memory allocated by the process
+	int64_t data = 0;
+
+	static MemoryUsage query();
+};
+
 // simple API for quickly dumping values when debugging
 
 static inline void log_dump_val_worker(short v) { log("%d", v); }
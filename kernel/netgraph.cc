@@ -0,0 +1,194 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Claire Xenia Wolf <claire@yosyshq.com>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/netgraph.h"
+#include "kernel/threading.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+NetGraph::NetGraph(RTLIL::Module *module, int threads) : module(module), sigmap(module)
+{
+	dict<RTLIL::SigBit, int> bit_ids;
+	for (auto wire : module->wires()) {
+		wires.push_back(wire);
+		wire_hashes.push_back(wire->hashidx_);
+		wire_offsets[wire] = GetSize(wire_bit_ids);
+		for (int i = 0; i < wire->width; i++) {
+			SigBit bit = sigmap(SigBit(wire, i));
+			if (bit.wire == nullptr) {
+				wire_bit_ids.push_back(-1);
+				continue;
+			}
+			auto it = bit_ids.find(bit);
+			int id;
+			if (it == bit_ids.end()) {
+				id = GetSize(bits);
+				bit_ids[bit] = id;
+				bits.push_back(bit);
+				bit_flags.push_back(0);
+			} else
+				id = it->second;
+			wire_bit_ids.push_back(id);
+			if (wire->port_input)
+				bit_flags[id] |= FLAG_INPUT;
+			if (wire->port_output)
+				bit_flags[id] |= FLAG_OUTPUT;
+		}
+	}
+	bit_ids.clear();
+
+	cell_port_start.push_back(0);
+	for (auto cell : module->cells()) {
+		cell_ids[cell] = GetSize(cells);
+		cells.push_back(cell);
+		cell_hashes.push_back(cell->hashidx_);
+		cell_types.push_back(cell->type);
+		int size = 0;
+		for (auto &conn : cell->connections())
+			size += GetSize(conn.second);
+		cell_port_start.push_back(cell_port_start.back() + size);
+	}
+
+	// Resolving the connected bits only looks up the (now frozen) wire tables,
+	// so it is done in parallel with each cell writing to its own slice. A
+	// lookup rehashes a dict that has grown since the last lookup, so do one
+	// before.
+	wire_offsets.count(nullptr);
+	std::vector<int> port_bits(cell_port_start.back());
+	parallel_for(threads, cells.size(), [&](size_t i) {
+		int *out = port_bits.data() + cell_port_start[i];
+		for (auto &conn : cells[i]->connections())
+			for (auto &bit : conn.second)
+				*out++ = bit_id(bit);
+	});
+
+	dict<RTLIL::IdString, int> port_ids;
+	cell_ports.reserve(port_bits.size());
+	for (auto cell : cells)
+		for (auto &conn : cell->connections()) {
+			bool input = cell->input(conn.first);
+			bool output = cell->output(conn.first);
+			if (!input && !output)
+				input = output = true;
+			auto it = port_ids.find(conn.first);
+			int port;
+			if (it == port_ids.end()) {
+				port = GetSize(port_names);
+				port_ids[conn.first] = port;
+				port_names.push_back(conn.first);
+			} else
+				port = it->second;
+			for (int offset = 0; offset < GetSize(conn.second); offset++)
+				cell_ports.push_back({port, offset, port_bits[GetSize(cell_ports)], input, output});
+		}
+
+	driver_start.assign(bits.size() + 1, 0);
+	fanout_start.assign(bits.size() + 1, 0);
+	for (auto &port : cell_ports) {
+		if (port.bit < 0)
+			continue;
+		if (port.output)
+			driver_start[port.bit + 1]++;
+		if (port.input)
+			fanout_start[port.bit + 1]++;
+	}
+	for (int i = 0; i < GetSize(bits); i++) {
+		driver_start[i + 1] += driver_start[i];
+		fanout_start[i + 1] += fanout_start[i];
+	}
+
+	driver_ports.resize(driver_start.back());
+	fanout_ports.resize(fanout_start.back());
+	std::vector<int> driver_pos(driver_start.begin(), driver_start.end() - 1);
+	std::vector<int> fanout_pos(fanout_start.begin(), fanout_start.end() - 1);
+	for (int i = 0; i < GetSize(cells); i++)
+		for (int k = cell_port_start[i]; k < cell_port_start[i + 1]; k++) {
+			const CellPortBit &port = cell_ports[k];
+			if (port.bit < 0)
+				continue;
+			if (port.output)
+				driver_ports[driver_pos[port.bit]++] = {i, port.port, port.offset};
+			if (port.input)
+				fanout_ports[fanout_pos[port.bit]++] = {i, port.port, port.offset};
+		}
+
+	// settle the lookup tables, so that the graph can be queried concurrently
+	cell_ids.count(nullptr);
+}
+
+bool NetGraph::up_to_date() const
+{
+	if (GetSize(module->wires_) != GetSize(wires) || GetSize(module->cells_) != GetSize(cells))
+		return false;
+	int i = 0;
+	for (auto wire : module->wires()) {
+		if (wire != wires[i] || wire->hashidx_ != wire_hashes[i])
+			return false;
+		i++;
+	}
+	i = 0;
+	for (auto cell : module->cells()) {
+		if (cell != cells[i] || cell->hashidx_ != cell_hashes[i] || cell->type != cell_types[i])
+			return false;
+		i++;
+	}
+	return true;
+}
+
+int NetGraph::cell_id(RTLIL::Cell *cell) const
+{
+	auto it = cell_ids.find(cell);
+	return it == cell_ids.end() ? -1 : it->second;
+}
+
+int NetGraph::bit_id(RTLIL::SigBit bit) const
+{
+	if (bit.wire == nullptr)
+		return -1;
+	auto it = wire_offsets.find(bit.wire);
+	return it == wire_offsets.end() ? -1 : wire_bit_ids[it->second + bit.offset];
+}
+
+NetGraphIndex::NetGraphIndex(RTLIL::Design *design) : design(design)
+{
+	design->monitors.insert(this);
+}
+
+NetGraphIndex::~NetGraphIndex()
+{
+	design->monitors.erase(this);
+}
+
+NetGraphIndex &NetGraphIndex::get(RTLIL::Design *design)
+{
+	if (design->netgraph_index == nullptr)
+		design->netgraph_index.reset(new NetGraphIndex(design));
+	return *design->netgraph_index;
+}
+
+std::shared_ptr<const NetGraph> NetGraphIndex::graph(RTLIL::Module *module, int threads)
+{
+	log_assert(module->design == design);
+	auto &graph = graphs[module];
+	if (graph == nullptr || !graph->up_to_date())
+		graph = std::make_shared<const NetGraph>(module, threads);
+	return graph;
+}
+
+YOSYS_NAMESPACE_END
@@ -0,0 +1,171 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Claire Xenia Wolf <claire@yosyshq.com>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef NETGRAPH_H
+#define NETGRAPH_H
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// An immutable snapshot of the connectivity of a module. Cells and
+// (sigmapped) wire bits are numbered with dense integer ids and all adjacency
+// information is stored in flat arrays in compressed sparse row form, so that
+// traversals do not need any hashing or allocation.
+//
+// Cell ids follow the iteration order of `module->cells()`, bit ids the order
+// of `module->wires()`. Constant bits have no id. Ports are referred to by
+// their index in `port_names`. The graph does not observe the module; use
+// NetGraphIndex to get a graph which is rebuilt after the module changed.
+struct NetGraph
+{
+	struct PortBit {
+		int cell;
+		int port;
+		int offset;
+	};
+
+	struct CellPortBit {
+		int port;
+		int offset;
+		// -1 for constant bits
+		int bit;
+		bool input, output;
+	};
+
+	template<typename T>
+	struct Range {
+		const T *begin_, *end_;
+		const T *begin() const { return begin_; }
+		const T *end() const { return end_; }
+		int size() const { return end_ - begin_; }
+		bool empty() const { return begin_ == end_; }
+		const T &operator[](int i) const { return begin_[i]; }
+	};
+
+	RTLIL::Module *module;
+	SigMap sigmap;
+
+	std::vector<RTLIL::Cell*> cells;
+	// the sigmapped representative of each bit id
+	std::vector<RTLIL::SigBit> bits;
+	// the names of all ports connected to any cell
+	std::vector<RTLIL::IdString> port_names;
+
+	// Builds the graph, assigning the port bits of the cells to bits on up
+	// to `threads` threads (see thread_count() in kernel/threading.h).
+	NetGraph(RTLIL::Module *module, int threads = 1);
+
+	int num_cells() const { return GetSize(cells); }
+	int num_bits() const { return GetSize(bits); }
+
+	// Returns -1 for cells of other modules and bits without id.
+	int cell_id(RTLIL::Cell *cell) const;
+	int bit_id(RTLIL::SigBit bit) const;
+
+	// Whether the module still has the same cells, of the same types, and
+	// the same wires as when the graph was built. Objects are compared by
+	// pointer and hash index, so the graph's own pointers, which may dangle,
+	// are never followed. Connection changes are not detected.
+	bool up_to_date() const;
+
+	bool is_input(int bit) const { return bit_flags[bit] & FLAG_INPUT; }
+	bool is_output(int bit) const { return bit_flags[bit] & FLAG_OUTPUT; }
+
+	// All port bits of a cell, in the order of `cell->connections()`.
+	Range<CellPortBit> ports(int cell) const {
+		return {cell_ports.data() + cell_port_start[cell], cell_ports.data() + cell_port_start[cell + 1]};
+	}
+
+	// Cell output (resp. input) ports connected to a bit. Ports of unknown
+	// direction are considered both inputs and outputs.
+	Range<PortBit> drivers(int bit) const {
+		return {driver_ports.data() + driver_start[bit], driver_ports.data() + driver_start[bit + 1]};
+	}
+	Range<PortBit> fanout(int bit) const {
+		return {fanout_ports.data() + fanout_start[bit], fanout_ports.data() + fanout_start[bit + 1]};
+	}
+
+private:
+	enum { FLAG_INPUT = 1, FLAG_OUTPUT = 2 };
+
+	// the wires in the order of `module->wires()` and the hash indices and
+	// types of all objects at the time the graph was built
+	std::vector<RTLIL::Wire*> wires;
+	std::vector<Hasher::hash_t> wire_hashes, cell_hashes;
+	std::vector<RTLIL::IdString> cell_types;
+	dict<RTLIL::Cell*, int> cell_ids;
+	// bit ids of all wire bits, indexed by wire_offsets[wire] + offset
+	dict<RTLIL::Wire*, int> wire_offsets;
+	std::vector<int> wire_bit_ids;
+	std::vector<char> bit_flags;
+	std::vector<int> cell_port_start;
+	std::vector<CellPortBit> cell_ports;
+	std::vector<int> driver_start, fanout_start;
+	std::vector<PortBit> driver_ports, fanout_ports;
+};
+
+// Hands out shared NetGraphs of the modules of a design, so that passes which
+// run one after the other can reuse the graph of a module that did not change
+// in between. Each design owns one index (see get()), which is installed as a
+// monitor and drops the graph of a module on any connection change, blackout
+// or deletion of the module. Removing wires (which rewrites connections
+// without notification), adding or removing cells and changing the type of a
+// cell in place are not all reported to monitors, so graph() also checks the
+// graph with NetGraph::up_to_date() before handing it out.
+//
+// A graph which was handed out earlier is not updated. It keeps pointers to
+// the cells and wires of the module as it was built, which dangle once these
+// objects are removed, so it must not be used after changing the module.
+struct NetGraphIndex : public RTLIL::Monitor
+{
+	RTLIL::Design *design;
+
+	NetGraphIndex(RTLIL::Design *design);
+	~NetGraphIndex();
+
+	// The index of the design, created on first use.
+	static NetGraphIndex &get(RTLIL::Design *design);
+
+	// Returns the current graph of the module, building it on up to
+	// `threads` threads if there is none.
+	std::shared_ptr<const NetGraph> graph(RTLIL::Module *module, int threads = 1);
+	void invalidate(RTLIL::Module *module) {
+		if (!graphs.empty())
+			graphs.erase(module);
+	}
+	bool valid(RTLIL::Module *module) const {
+		auto it = graphs.find(module);
+		return it != graphs.end() && it->second->up_to_date();
+	}
+
+	void notify_module_del(RTLIL::Module *module) override { invalidate(module); }
+	void notify_connect(RTLIL::Cell *cell, const RTLIL::IdString&, const RTLIL::SigSpec&, const RTLIL::SigSpec&) override { invalidate(cell->module); }
+	void notify_connect(RTLIL::Module *module, const RTLIL::SigSig&) override { invalidate(module); }
+	void notify_connect(RTLIL::Module *module, const std::vector<RTLIL::SigSig>&) override { invalidate(module); }
+	void notify_blackout(RTLIL::Module *module) override { invalidate(module); }
+
+private:
+	dict<RTLIL::Module*, std::shared_ptr<const NetGraph>> graphs;
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -47,6 +47,11 @@ Pass::Pass(std::string name, std::string short_help) : pass_name(name), short_he
 	first_queued_pass = this;
 	call_counter = 0;
 	runtime_ns = 0;
+	peak_rss_growth = 0;
+	rss_delta = 0;
+	data_delta = 0;
+	wires_delta = 0;
+	cells_delta = 0;
 }
 
 void Pass::run_register()
@@ -91,13 +96,30 @@ Pass::~Pass()
 {
 }
 
+const char *Pass::trace_category()
+{
+	if (dynamic_cast<Frontend*>(this))
+		return "frontend";
+	if (dynamic_cast<Backend*>(this))
+		return "backend";
+	if (dynamic_cast<ScriptPass*>(this))
+		return "script";
+	return "pass";
+}
+
 Pass::pre_post_exec_state_t Pass::pre_execute()
 {
 	pre_post_exec_state_t state;
 	call_counter++;
 	state.begin_ns = PerformanceTimer::query();
+	state.begin_mem = MemoryUsage::query();
+	state.begin_wires = RTLIL::Wire::live_count.load(std::memory_order_relaxed);
+	state.begin_cells = RTLIL::Cell::live_count.load(std::memory_order_relaxed);
 	state.parent_pass = current_pass;
 	current_pass = this;
+	if (log_trace_active())
+		log_trace_begin(pass_name, trace_category(), stringf("\"wires\": %lld, \"cells\": %lld",
+				(long long)state.begin_wires, (long long)state.begin_cells));
 	clear_flags();
 	return state;
 }
@@ -108,10 +130,32 @@ void Pass::post_execute(Pass::pre_post_exec_state_t state)
 	log_suppressed();
 
 	int64_t time_ns = PerformanceTimer::query() - state.begin_ns;
+	MemoryUsage mem = MemoryUsage::query();
+	int64_t peak_growth = mem.peak_rss - state.begin_mem.peak_rss;
+	int64_t rss_change = mem.rss - state.begin_mem.rss;
+	int64_t data_change = mem.data - state.begin_mem.data;
+	int64_t wires_change = RTLIL::Wire::live_count.load(std::memory_order_relaxed) - state.begin_wires;
+	int64_t cells_change = RTLIL::Cell::live_count.load(std::memory_order_relaxed) - state.begin_cells;
+
+	if (log_trace_active())
+		log_trace_end(pass_name, trace_category(), stringf("\"modules\": %d, \"wires_delta\": %lld, \"cells_delta\": %lld",
+				yosys_design ? GetSize(yosys_design->modules()) : 0, (long long)wires_change, (long long)cells_change));
+
 	runtime_ns += time_ns;
+	peak_rss_growth += peak_growth;
+	rss_delta += rss_change;
+	data_delta += data_change;
+	wires_delta += wires_change;
+	cells_delta += cells_change;
 	current_pass = state.parent_pass;
-	if (current_pass)
+	if (current_pass) {
 		current_pass->runtime_ns -= time_ns;
+		current_pass->peak_rss_growth -= peak_growth;
+		current_pass->rss_delta -= rss_change;
+		current_pass->data_delta -= data_change;
+		current_pass->wires_delta -= wires_change;
+		current_pass->cells_delta -= cells_change;
+	}
 }
 
 void Pass::help()
@@ -331,6 +375,14 @@ bool ScriptPass::check_label(std::string label, std::string info)
 			if (label == active_run_to)
 				block_active = false;
 		}
+		if (!traced_label.empty()) {
+			log_trace_end(traced_label, "label");
+			traced_label.clear();
+		}
+		if (block_active && log_trace_active()) {
+			traced_label = pass_name + ": " + label;
+			log_trace_begin(traced_label, "label");
+		}
 		return block_active;
 	}
 }
@@ -368,6 +420,10 @@ void ScriptPass::run_script(RTLIL::Design *design, std::string run_from, std::st
 	active_run_from = run_from;
 	active_run_to = run_to;
 	script();
+	if (!traced_label.empty()) {
+		log_trace_end(traced_label, "label");
+		traced_label.clear();
+	}
 }
 
 void ScriptPass::help_script()
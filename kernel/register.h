@@ -38,6 +38,11 @@ struct Pass
 
 	int call_counter;
 	int64_t runtime_ns;
+	// like runtime_ns, these don't include nested passes: the growth of the
+	// peak RSS, the change of the RSS and of the data segment size, and the
+	// change of the number of wires and cells in existence
+	int64_t peak_rss_growth, rss_delta, data_delta;
+	int64_t wires_delta, cells_delta;
 	bool experimental_flag = false;
 
 	void experimental() {
@@ -47,10 +52,13 @@ struct Pass
 	struct pre_post_exec_state_t {
 		Pass *parent_pass;
 		int64_t begin_ns;
+		MemoryUsage begin_mem;
+		int64_t begin_wires, begin_cells;
 	};
 
 	pre_post_exec_state_t pre_execute();
 	void post_execute(pre_post_exec_state_t state);
+	const char *trace_category();
 
 	void cmd_log_args(const std::vector<std::string> &args);
 	void cmd_error(const std::vector<std::string> &args, size_t argidx, std::string msg);
@@ -80,6 +88,8 @@ struct ScriptPass : Pass
 	bool block_active, help_mode;
 	RTLIL::Design *active_design;
 	std::string active_run_from, active_run_to;
+	// the label of the open trace event, see log_trace_begin()
+	std::string traced_label;
 
 	ScriptPass(std::string name, std::string short_help = "** document me **") : Pass(name, short_help) { }
 
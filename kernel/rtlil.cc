@@ -24,6 +24,7 @@
 #include "kernel/sigtools.h"
 #include "frontends/verilog/verilog_frontend.h"
 #include "frontends/verilog/preproc.h"
+#include "kernel/netgraph.h"
 #include "backends/rtlil/rtlil_backend.h"
 
 #include <string.h>
@@ -3916,11 +3917,14 @@ RTLIL::SigSpec RTLIL::Module::FutureFF(RTLIL::IdString name, const RTLIL::SigSpe
 	return sig;
 }
 
+std::atomic<int64_t> RTLIL::Wire::live_count(0);
+
 RTLIL::Wire::Wire()
 {
 	static unsigned int hashidx_count = 123456789;
 	hashidx_count = mkhash_xorshift(hashidx_count);
 	hashidx_ = hashidx_count;
+	live_count.fetch_add(1, std::memory_order_relaxed);
 
 	module = nullptr;
 	width = 1;
@@ -3938,6 +3942,7 @@ RTLIL::Wire::Wire()
 
 RTLIL::Wire::~Wire()
 {
+	live_count.fetch_sub(1, std::memory_order_relaxed);
 #ifdef WITH_PYTHON
 	RTLIL::Wire::get_all_wires()->erase(hashidx_);
 #endif
@@ -3972,11 +3977,14 @@ RTLIL::Process::Process() : module(nullptr)
 	hashidx_ = hashidx_count;
 }
 
+std::atomic<int64_t> RTLIL::Cell::live_count(0);
+
 RTLIL::Cell::Cell() : module(nullptr)
 {
 	static unsigned int hashidx_count = 123456789;
 	hashidx_count = mkhash_xorshift(hashidx_count);
 	hashidx_ = hashidx_count;
+	live_count.fetch_add(1, std::memory_order_relaxed);
 
 	// log("#memtrace# %p\n", this);
 	memhasher();
@@ -3988,6 +3996,7 @@ RTLIL::Cell::Cell() : module(nullptr)
 
 RTLIL::Cell::~Cell()
 {
+	live_count.fetch_sub(1, std::memory_order_relaxed);
 #ifdef WITH_PYTHON
 	RTLIL::Cell::get_all_cells()->erase(hashidx_);
 #endif
@@ -23,6 +23,8 @@
 #include "kernel/yosys_common.h"
 #include "kernel/yosys.h"
 
+#include <atomic>
+
 YOSYS_NAMESPACE_BEGIN
 
 namespace RTLIL
@@ -1316,6 +1318,9 @@ struct RTLIL::Monitor
 // Forward declaration; defined in preproc.h.
 struct define_map_t;
 
+// Forward declaration; defined in netgraph.h.
+struct NetGraphIndex;
+
 struct RTLIL::Design
 {
 	Hasher::hash_t hashidx_;
@@ -1334,6 +1339,9 @@ struct RTLIL::Design
 	std::vector<AST::AstNode*> verilog_packages, verilog_globals;
 	std::unique_ptr<define_map_t> verilog_defines;
 
+	// created on first use by NetGraphIndex::get()
+	std::unique_ptr<NetGraphIndex> netgraph_index;
+
 	std::vector<RTLIL::Selection> selection_stack;
 	dict<RTLIL::IdString, RTLIL::Selection> selection_vars;
 	std::string selected_active_module;
@@ -1868,6 +1876,9 @@ public:
 	int width, start_offset, port_id;
 	bool port_input, port_output, upto, is_signed;
 
+	// number of wires in existence, for the pass statistics
+	static std::atomic<int64_t> live_count;
+
 	RTLIL::Cell *driverCell() const    { log_assert(driverCell_); return driverCell_; };
 	RTLIL::IdString driverPort() const { log_assert(driverCell_); return driverPort_; };
 
@@ -1928,6 +1939,9 @@ public:
 	dict<RTLIL::IdString, RTLIL::SigSpec> connections_;
 	dict<RTLIL::IdString, RTLIL::Const> parameters;
 
+	// number of cells in existence, for the pass statistics
+	static std::atomic<int64_t> live_count;
+
 	// access cell ports
 	bool hasPort(const RTLIL::IdString &portname) const;
 	void unsetPort(const RTLIL::IdString &portname);
@@ -1387,3 +1387,228 @@ bool SatGen::importCell(RTLIL::Cell *cell, int timestep)
 	// .. and all sequential cells with asynchronous inputs
 	return false;
 }
+
+// Splits a name of the form [undef:]<prefix>@<timestep>:<rest> as used for
+// the literals and the keys of imported_signals.
+static bool split_frame_name(const std::string &name, const std::string &prefix, bool &undef, int &timestep, size_t &rest)
+{
+	size_t pos = 0;
+	undef = name.compare(0, 6, "undef:") == 0;
+	if (undef)
+		pos = 6;
+	if (name.compare(pos, prefix.size(), prefix) != 0)
+		return false;
+	pos += prefix.size();
+	if (pos >= name.size() || name[pos] != '@')
+		return false;
+	size_t colon = name.find(':', pos);
+	if (colon == std::string::npos || colon == pos + 1)
+		return false;
+	timestep = 0;
+	for (size_t i = pos + 1; i < colon; i++) {
+		if (name[i] < '0' || name[i] > '9')
+			return false;
+		timestep = timestep * 10 + (name[i] - '0');
+	}
+	rest = colon + 1;
+	return true;
+}
+
+void SatGen::beginFrame(FrameTemplate &frame, int timestep)
+{
+	log_assert(timestep >= 2 && recording == nullptr && ez->assumeLog == nullptr);
+	log_assert(initstates.count(make_pair(prefix, timestep)) == 0 || !initstates.at(make_pair(prefix, timestep)));
+
+	std::string pf = prefix + stringf("@%d:", timestep);
+	frame = FrameTemplate();
+	frame.prefix = prefix;
+	frame.timestep = timestep;
+	frame.model_undef = model_undef;
+	frame.def_formal = def_formal;
+	frame.ignore_div_by_zero = ignore_div_by_zero;
+	frame.first_literal = ez->numLiterals();
+	frame.asserts_begin = GetSize(asserts_a[pf]);
+	frame.assumes_begin = GetSize(assumes_a[pf]);
+
+	recording = &frame;
+	ez->assumeLog = &frame.assumptions;
+	if (frame_literals_of == &frame)
+		frame_literals_of = nullptr;
+}
+
+void SatGen::endFrame(FrameTemplate &frame)
+{
+	log_assert(recording == &frame);
+	recording = nullptr;
+	ez->assumeLog = nullptr;
+
+	std::string pf = prefix + stringf("@%d:", frame.timestep);
+	frame.asserts_a = asserts_a[pf].extract_end(frame.asserts_begin);
+	frame.asserts_en = asserts_en[pf].extract_end(frame.asserts_begin);
+	frame.assumes_a = assumes_a[pf].extract_end(frame.assumes_begin);
+	frame.assumes_en = assumes_en[pf].extract_end(frame.assumes_begin);
+	frame.has_initstate = initstates.count(make_pair(prefix, frame.timestep)) != 0;
+
+	for (auto &it : frame.recorded_signals) {
+		bool undef;
+		int timestep;
+		size_t rest;
+		if (!split_frame_name(it.first.first, prefix, undef, timestep, rest) || rest != it.first.first.size())
+			continue;
+		frame.signals.push_back({undef, timestep - frame.timestep, it.first.second, it.second});
+	}
+	frame.recorded_signals.clear();
+
+	// compile the expressions into nodes, without recursion as the
+	// expressions can be deep
+	dict<int, int> node_index;
+	dict<std::pair<bool, std::string>, int> name_index;
+	std::vector<int> stack;
+	auto compile = [&](int root) {
+		stack.push_back(root);
+		while (!stack.empty()) {
+			int id = stack.back();
+			if (node_index.count(id)) {
+				stack.pop_back();
+				continue;
+			}
+			FrameTemplate::Node node;
+			node.id = id;
+			node.kind = FrameTemplate::Node::KEEP;
+			if (id > 0) {
+				stack.pop_back();
+				bool undef;
+				int step;
+				size_t rest;
+				if (id == ezSAT::CONST_TRUE || id == ezSAT::CONST_FALSE) {
+					// constants are kept
+				} else if (ez->lookup_literal(id).empty()) {
+					// anonymous literals (e.g. for undefined constants) are
+					// replaced by new ones if they belong to the frame
+					if (id > frame.first_literal)
+						node.kind = FrameTemplate::Node::FRESH;
+				} else if (split_frame_name(ez->lookup_literal(id), frame.prefix, undef, step, rest)) {
+					const std::string &name = ez->lookup_literal(id);
+					auto key = std::make_pair(undef, name.substr(rest));
+					auto it = name_index.find(key);
+					if (it == name_index.end()) {
+						it = name_index.emplace(key, GetSize(frame.names)).first;
+						frame.names.push_back({undef, key.second});
+					}
+					node.kind = FrameTemplate::Node::NAMED;
+					node.name = it->second;
+					node.offset = step - frame.timestep;
+					frame.min_offset = std::min(frame.min_offset, node.offset);
+					frame.max_offset = std::max(frame.max_offset, node.offset);
+				}
+			} else {
+				const std::vector<int> &args = ez->lookup_expression(id, node.op);
+				bool ready = true;
+				for (int arg : args)
+					if (!node_index.count(arg)) {
+						stack.push_back(arg);
+						ready = false;
+					}
+				if (!ready)
+					continue;
+				stack.pop_back();
+				bool keep = true;
+				for (int arg : args) {
+					int index = node_index.at(arg);
+					keep &= frame.nodes[index].kind == FrameTemplate::Node::KEEP;
+					node.args.push_back(index);
+				}
+				if (!keep)
+					node.kind = FrameTemplate::Node::EXPRESSION;
+				else
+					node.args.clear();
+			}
+			node_index[id] = GetSize(frame.nodes);
+			frame.nodes.push_back(std::move(node));
+		}
+		return node_index.at(root);
+	};
+
+	for (auto &signal : frame.signals)
+		frame.signal_nodes.push_back(compile(signal.literal));
+	for (int id : frame.assumptions)
+		frame.assumption_nodes.push_back(compile(id));
+	frame.valid = true;
+}
+
+bool SatGen::instantiateFrame(const FrameTemplate &frame, int timestep)
+{
+	log_assert(frame.valid && recording == nullptr);
+	if (timestep < 2 || model_undef != frame.model_undef || def_formal != frame.def_formal || ignore_div_by_zero != frame.ignore_div_by_zero)
+		return false;
+
+	auto key = make_pair(prefix, timestep);
+	if (frame.has_initstate) {
+		if (initstates.count(key) && initstates.at(key))
+			return false;
+		initstates[key] = false;
+	}
+
+	if (frame_literals_of != &frame) {
+		frame_literals_of = &frame;
+		frame_literals.clear();
+	}
+	// frames are usually instantiated in increasing order, earlier time
+	// steps are not needed anymore
+	frame_literals.erase(frame_literals.begin(), frame_literals.lower_bound(timestep + frame.min_offset));
+
+	std::vector<std::vector<int>*> step_literals;
+	for (int offset = frame.min_offset; offset <= frame.max_offset; offset++) {
+		std::vector<int> &literals = frame_literals[timestep + offset];
+		literals.resize(frame.names.size());
+		step_literals.push_back(&literals);
+	}
+
+	std::vector<int> mapping(frame.nodes.size());
+	std::vector<int> args;
+	for (int i = 0; i < GetSize(frame.nodes); i++) {
+		const FrameTemplate::Node &node = frame.nodes[i];
+		switch (node.kind) {
+		case FrameTemplate::Node::KEEP:
+			mapping[i] = node.id;
+			break;
+		case FrameTemplate::Node::FRESH:
+			mapping[i] = ez->frozen_literal();
+			break;
+		case FrameTemplate::Node::NAMED: {
+			int &literal = (*step_literals[node.offset - frame.min_offset])[node.name];
+			if (literal == 0) {
+				const FrameTemplate::Name &name = frame.names[node.name];
+				literal = ez->frozen_literal((name.undef ? "undef:" : "") + prefix + stringf("@%d:", timestep + node.offset) + name.rest);
+			}
+			mapping[i] = literal;
+			break;
+		}
+		case FrameTemplate::Node::EXPRESSION:
+			args.clear();
+			for (int arg : node.args)
+				args.push_back(mapping[arg]);
+			mapping[i] = ez->expression(node.op, args);
+			break;
+		}
+	}
+
+	dict<std::pair<bool, int>, std::map<RTLIL::SigBit, int>*> signal_maps;
+	for (int i = 0; i < GetSize(frame.signals); i++) {
+		auto &signal = frame.signals[i];
+		auto &signal_map = signal_maps[std::make_pair(signal.undef, signal.offset)];
+		if (signal_map == nullptr)
+			signal_map = &imported_signals[(signal.undef ? "undef:" : "") + prefix + stringf("@%d:", timestep + signal.offset)];
+		(*signal_map)[signal.bit] = mapping[frame.signal_nodes[i]];
+	}
+
+	for (int index : frame.assumption_nodes)
+		ez->assume(mapping[index]);
+
+	std::string pf = prefix + stringf("@%d:", timestep);
+	asserts_a[pf].append(frame.asserts_a);
+	asserts_en[pf].append(frame.asserts_en);
+	assumes_a[pf].append(frame.assumes_a);
+	assumes_en[pf].append(frame.assumes_en);
+	return true;
+}
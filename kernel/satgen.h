@@ -75,6 +75,62 @@ struct SatGen
 	bool model_undef;
 	bool def_formal = false;
 
+	// The constraints created while importing the cells of one time step,
+	// see beginFrame(), endFrame() and instantiateFrame().
+	struct FrameTemplate
+	{
+		bool valid = false;
+		std::string prefix;
+		int timestep = 0;
+		bool model_undef = false, def_formal = false, ignore_div_by_zero = false;
+		// literals with a larger id were created for this frame
+		int first_literal = 0;
+		bool has_initstate = false;
+		std::vector<int> assumptions;
+		RTLIL::SigSpec asserts_a, asserts_en, assumes_a, assumes_en;
+		// the imported signals, with the time step relative to this one
+		struct Signal {
+			bool undef;
+			int offset;
+			RTLIL::SigBit bit;
+			int literal;
+		};
+		std::vector<Signal> signals;
+		// The expressions of the signals and assumptions, compiled by
+		// endFrame() so that instantiating them needs no name lookups. Nodes
+		// come after their arguments. A named literal of a time step refers
+		// to one of `names` (the name without the prefix and time step) and
+		// to the time step relative to this one.
+		struct Node {
+			enum Kind { KEEP, FRESH, NAMED, EXPRESSION };
+			Kind kind;
+			int id;
+			int name, offset;
+			ezSAT::OpId op;
+			// the node indices of the arguments of an expression
+			std::vector<int> args;
+		};
+		struct Name {
+			bool undef;
+			std::string rest;
+		};
+		std::vector<Node> nodes;
+		std::vector<Name> names;
+		// node indices of `signals` and `assumptions`
+		std::vector<int> signal_nodes, assumption_nodes;
+		int min_offset = 0, max_offset = 0;
+		// number of cells imported into the frame, for the caller's statistics
+		int cells = 0;
+		// the imported signals and the assert/assume counts while recording
+		dict<std::pair<std::string, RTLIL::SigBit>, int> recorded_signals;
+		int asserts_begin = 0, assumes_begin = 0;
+	};
+	FrameTemplate *recording = nullptr;
+	// the literals of the absolute time steps used by instantiateFrame(),
+	// indexed by the name index of `frame_literals_of`, 0 if not looked up yet
+	const FrameTemplate *frame_literals_of = nullptr;
+	std::map<int, std::vector<int>> frame_literals;
+
 	SatGen(ezSAT *ez, SigMap *sigmap, std::string prefix = std::string()) :
 			ez(ez), sigmap(sigmap), prefix(prefix), ignore_div_by_zero(false), model_undef(false)
 	{
@@ -106,6 +162,8 @@ struct SatGen
 					(bit.wire->width == 1 ? wire_name : stringf("%s [%d]", wire_name.c_str(), bit.offset));
 				vec.push_back(ez->frozen_literal(name));
 				imported_signals[pf][bit] = vec.back();
+				if (recording != nullptr)
+					recording->recorded_signals[{pf, bit}] = vec.back();
 			}
 		return vec;
 	}
@@ -290,6 +348,23 @@ struct SatGen
 	}
 
 	bool importCell(RTLIL::Cell *cell, int timestep = -1);
+
+	// Importing the same cells for many time steps is expensive, as every
+	// bit of every port is looked up by name. Instead, the cells can be
+	// imported once between beginFrame() and endFrame(), which records the
+	// resulting constraints, and instantiateFrame() then adds the same
+	// constraints for another time step by substituting the literals of that
+	// time step. Each literal of a time step is looked up by name only once,
+	// by the first frame using it; later frames find it in frame_literals.
+	// The template can also be instantiated by another SatGen for the same
+	// module and ezSAT instance, e.g. with another prefix.
+	//
+	// The recorded time step must be at least 2 and must not be an initial
+	// state (cells behave differently there). instantiateFrame() returns false
+	// if the template cannot be used for the given time step.
+	void beginFrame(FrameTemplate &frame, int timestep);
+	void endFrame(FrameTemplate &frame);
+	bool instantiateFrame(const FrameTemplate &frame, int timestep);
 };
 
 YOSYS_NAMESPACE_END
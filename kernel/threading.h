@@ -0,0 +1,119 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Claire Xenia Wolf <claire@yosyshq.com>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef THREADING_H
+#define THREADING_H
+
+#include "kernel/yosys_common.h"
+
+#ifdef YOSYS_ENABLE_THREADS
+#  include <atomic>
+#  include <exception>
+#  include <mutex>
+#  include <thread>
+#endif
+
+YOSYS_NAMESPACE_BEGIN
+
+// Returns the number of worker threads to use for a job consisting of
+// `work_items` independent items when the user requested `requested` threads.
+// A request of 0 (or less) means one thread per available hardware thread.
+// Always returns 1 when yosys is built without thread support.
+inline int thread_count(int requested, size_t work_items = SIZE_MAX)
+{
+#ifdef YOSYS_ENABLE_THREADS
+	int count = requested;
+	if (count <= 0)
+		count = std::max<int>(std::thread::hardware_concurrency(), 1);
+	if (work_items < (size_t)count)
+		count = std::max<size_t>(work_items, 1);
+	return count;
+#else
+	(void)requested;
+	(void)work_items;
+	return 1;
+#endif
+}
+
+// Calls `fn(i)` for every `i` in `[0, n)` using up to `threads` worker threads
+// (see `thread_count()` for the meaning of `threads`). Items are handed out
+// dynamically, in increasing order, to whichever worker is idle.
+//
+// The callback runs concurrently with itself and must therefore neither log,
+// nor modify shared RTLIL objects, nor create or copy IdStrings (copies update
+// the shared reference counts). Shared hashlib containers may be looked up
+// only if they were looked up once since they last grew, as a lookup may
+// rehash them. The usual pattern is to have `fn(i)` write its
+// result into slot `i` of a pre-sized vector and to merge the results on the
+// calling thread afterwards, which also keeps the output independent of the
+// thread count.
+//
+// If a callback throws, the remaining items are skipped and the first
+// exception is rethrown on the calling thread after all workers have joined.
+template<typename F>
+void parallel_for(int threads, size_t n, F &&fn)
+{
+	int num_threads = thread_count(threads, n);
+
+#ifdef YOSYS_ENABLE_THREADS
+	if (num_threads > 1) {
+		std::atomic<size_t> next_item{0};
+		std::atomic<bool> failed{false};
+		std::exception_ptr first_exception;
+		std::mutex exception_mutex;
+
+		auto worker = [&]() {
+			while (!failed.load(std::memory_order_relaxed)) {
+				size_t i = next_item.fetch_add(1, std::memory_order_relaxed);
+				if (i >= n)
+					break;
+				try {
+					fn(i);
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(exception_mutex);
+					if (!first_exception)
+						first_exception = std::current_exception();
+					failed.store(true, std::memory_order_relaxed);
+				}
+			}
+		};
+
+		std::vector<std::thread> workers;
+		workers.reserve(num_threads - 1);
+		for (int t = 1; t < num_threads; t++)
+			workers.emplace_back(worker);
+		worker();
+		for (auto &t : workers)
+			t.join();
+
+		if (first_exception)
+			std::rethrow_exception(first_exception);
+		return;
+	}
+#else
+	(void)num_threads;
+#endif
+
+	for (size_t i = 0; i < n; i++)
+		fn(i);
+}
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -0,0 +1,318 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Claire Xenia Wolf <claire@yosyshq.com>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+// [[CITE]] Forward-backward SCC decomposition with trimming
+// Fleischer, L. K., Hendrickson, B., Pinar, A. (2000), "On Identifying Strongly Connected Components in Parallel", IPDPS Workshops, LNCS 1800, 505-511
+// McLendon III, W., Hendrickson, B., Plimpton, S. J., Rauchwerger, L. (2005), "Finding strongly connected components in distributed graphs", J. Parallel Distrib. Comput. 65 (8), 901-910
+
+#include "kernel/topo_scc.h"
+#include "kernel/threading.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+static void build_adjacency(int num_nodes, std::vector<std::pair<int, int>> const &edges, bool reverse,
+        std::vector<int> &offsets, std::vector<int> &targets)
+{
+    offsets.assign(num_nodes + 1, 0);
+    for (auto const &edge : edges) {
+        log_assert(edge.first >= 0 && edge.first < num_nodes);
+        log_assert(edge.second >= 0 && edge.second < num_nodes);
+        offsets[(reverse ? edge.second : edge.first) + 1]++;
+    }
+    for (int node = 0; node < num_nodes; node++)
+        offsets[node + 1] += offsets[node];
+
+    targets.resize(edges.size());
+    std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+    for (auto const &edge : edges) {
+        if (reverse)
+            targets[fill[edge.second]++] = edge.first;
+        else
+            targets[fill[edge.first]++] = edge.second;
+    }
+
+    // sort the adjacency list of each node and compact the array while
+    // dropping duplicates, writes never overtake the range being read
+    int out = 0;
+    for (int node = 0; node < num_nodes; node++) {
+        int begin = offsets[node], end = offsets[node + 1];
+        std::sort(targets.begin() + begin, targets.begin() + end);
+        offsets[node] = out;
+        for (int i = begin; i < end; i++)
+            if (i == begin || targets[i] != targets[i - 1])
+                targets[out++] = targets[i];
+    }
+    offsets[num_nodes] = out;
+    targets.resize(out);
+    targets.shrink_to_fit();
+}
+
+FrozenIntGraph::FrozenIntGraph(int num_nodes, std::vector<std::pair<int, int>> const &edges)
+{
+    build_adjacency(num_nodes, edges, false, offsets_, targets_);
+    build_adjacency(num_nodes, edges, true, rev_offsets_, rev_targets_);
+    indices_.resize(num_nodes, -1);
+}
+
+namespace {
+
+// The subgraph induced by the nodes of one color, as seen by TopoSortedSccs.
+struct ColoredSubgraph {
+    typedef int node_type;
+
+    struct successor_enumerator {
+        const int *current, *end;
+        const int *color;
+        int own_color;
+
+        bool finished() {
+            while (current != end && color[*current] != own_color)
+                ++current;
+            return current == end;
+        }
+        node_type next() {
+            log_assert(!finished());
+            return *current++;
+        }
+    };
+
+    struct node_enumerator {
+        const int *current, *end;
+        bool finished() const { return current == end; }
+        node_type next() {
+            log_assert(!finished());
+            return *current++;
+        }
+    };
+
+    FrozenIntGraph const &graph;
+    std::vector<int> const &nodes;
+    const int *color;
+    int own_color;
+    int *indices;
+
+    ColoredSubgraph(FrozenIntGraph const &graph, std::vector<int> const &nodes, const int *color, int own_color, int *indices)
+        : graph(graph), nodes(nodes), color(color), own_color(own_color), indices(indices) {}
+
+    node_enumerator enumerate_nodes() const {
+        return {nodes.data(), nodes.data() + nodes.size()};
+    }
+
+    successor_enumerator enumerate_successors(int node) const {
+        auto succ = graph.enumerate_successors(node);
+        return {succ.current, succ.end, color, own_color};
+    }
+
+    int &dfs_index(node_type const &node) {
+        return indices[node];
+    }
+};
+
+struct SccTask {
+    int color;
+    std::vector<int> nodes;
+};
+
+// All per-node state of the decomposition. While the tasks of a round run
+// concurrently, `color` is only read, and all other arrays are only accessed
+// for nodes of the task's own color, so that no two threads ever touch the
+// same element.
+struct SccDecomposition {
+    FrozenIntGraph const &graph;
+    std::vector<int> color;
+    // the smallest node of the node's SCC, once found
+    std::vector<int> rep;
+    std::vector<int> indices;
+    std::vector<int> in_degree, out_degree;
+    std::vector<unsigned char> marks;
+
+    enum { MARK_FORWARD = 1, MARK_BACKWARD = 2, MARK_TRIMMED = 4 };
+
+    SccDecomposition(FrozenIntGraph const &graph) : graph(graph)
+    {
+        int num_nodes = graph.num_nodes();
+        color.resize(num_nodes, 0);
+        rep.resize(num_nodes, -1);
+        indices.resize(num_nodes, -1);
+    }
+
+    bool same_color(int node, int other) const {
+        return color[node] == color[other] && !(marks[other] & MARK_TRIMMED);
+    }
+
+    void run_tarjan(SccTask const &task)
+    {
+        ColoredSubgraph subgraph(graph, task.nodes, color.data(), task.color, indices.data());
+        auto component = [&](int *begin, int *end) {
+            int min_node = *std::min_element(begin, end);
+            for (int *node = begin; node != end; ++node)
+                rep[*node] = min_node;
+        };
+        TopoSortedSccs<ColoredSubgraph, decltype(component)>(subgraph, component).process_all();
+    }
+
+    // Splits a task into up to three subtasks, returning them in `parts`.
+    void split(SccTask const &task, std::array<std::vector<int>, 3> &parts)
+    {
+        // Trim nodes without a predecessor or successor in the task, they
+        // can't be part of a cycle.
+        std::vector<int> queue;
+        for (int node : task.nodes) {
+            in_degree[node] = out_degree[node] = 0;
+            for (auto succ = graph.enumerate_successors(node); !succ.finished();)
+                if (color[succ.next()] == task.color)
+                    out_degree[node]++;
+            for (auto pred = graph.enumerate_predecessors(node); !pred.finished();)
+                if (color[pred.next()] == task.color)
+                    in_degree[node]++;
+            if (in_degree[node] == 0 || out_degree[node] == 0)
+                queue.push_back(node);
+        }
+        while (!queue.empty()) {
+            int node = queue.back();
+            queue.pop_back();
+            if (marks[node] & MARK_TRIMMED)
+                continue;
+            marks[node] |= MARK_TRIMMED;
+            rep[node] = node;
+            for (auto succ = graph.enumerate_successors(node); !succ.finished();) {
+                int next = succ.next();
+                if (same_color(node, next) && --in_degree[next] == 0)
+                    queue.push_back(next);
+            }
+            for (auto pred = graph.enumerate_predecessors(node); !pred.finished();) {
+                int prev = pred.next();
+                if (same_color(node, prev) && --out_degree[prev] == 0)
+                    queue.push_back(prev);
+            }
+        }
+
+        // Circuits tend to be numbered roughly in topological order, where
+        // the first node would only split off its own component. A pivot
+        // from the middle tends to split the remaining nodes evenly instead.
+        std::vector<int> remaining;
+        for (int node : task.nodes)
+            if (!(marks[node] & MARK_TRIMMED))
+                remaining.push_back(node);
+        int pivot = remaining.empty() ? -1 : remaining[remaining.size() / 2];
+
+        if (pivot >= 0) {
+            for (int direction : {MARK_FORWARD, MARK_BACKWARD}) {
+                queue.push_back(pivot);
+                marks[pivot] |= direction;
+                while (!queue.empty()) {
+                    int node = queue.back();
+                    queue.pop_back();
+                    auto next = direction == MARK_FORWARD ? graph.enumerate_successors(node) : graph.enumerate_predecessors(node);
+                    while (!next.finished()) {
+                        int other = next.next();
+                        if (same_color(node, other) && !(marks[other] & direction)) {
+                            marks[other] |= direction;
+                            queue.push_back(other);
+                        }
+                    }
+                }
+            }
+        }
+
+        int min_node = INT_MAX;
+        for (int node : task.nodes)
+            if (marks[node] == (MARK_FORWARD | MARK_BACKWARD))
+                min_node = std::min(min_node, node);
+
+        for (int node : task.nodes) {
+            switch (marks[node]) {
+            case MARK_FORWARD | MARK_BACKWARD:
+                rep[node] = min_node;
+                break;
+            case MARK_FORWARD:
+                parts[0].push_back(node);
+                break;
+            case MARK_BACKWARD:
+                parts[1].push_back(node);
+                break;
+            case 0:
+                parts[2].push_back(node);
+                break;
+            }
+            marks[node] = 0;
+        }
+    }
+};
+
+}
+
+int find_sccs(FrozenIntGraph const &graph, std::vector<int> &component, int threads)
+{
+    int num_nodes = graph.num_nodes();
+    int num_threads = thread_count(threads, num_nodes);
+
+    // Splitting is only worth it when it produces work for several threads,
+    // single threaded Tarjan's algorithm is always faster otherwise.
+    size_t split_threshold = SIZE_MAX;
+    if (num_threads > 1)
+        split_threshold = std::max(num_nodes / (4 * num_threads), 4096);
+
+    SccDecomposition decomp(graph);
+    if (split_threshold < size_t(num_nodes)) {
+        decomp.in_degree.resize(num_nodes);
+        decomp.out_degree.resize(num_nodes);
+        decomp.marks.resize(num_nodes);
+    }
+
+    std::vector<SccTask> tasks(1);
+    tasks[0].color = 0;
+    tasks[0].nodes.resize(num_nodes);
+    for (int node = 0; node < num_nodes; node++)
+        tasks[0].nodes[node] = node;
+    int next_color = 1;
+
+    while (!tasks.empty()) {
+        std::vector<std::array<std::vector<int>, 3>> parts(tasks.size());
+        parallel_for(num_threads, tasks.size(), [&](size_t i) {
+            if (tasks[i].nodes.size() < split_threshold)
+                decomp.run_tarjan(tasks[i]);
+            else
+                decomp.split(tasks[i], parts[i]);
+        });
+
+        std::vector<SccTask> next_tasks;
+        for (auto &task_parts : parts)
+            for (auto &part : task_parts)
+                if (!part.empty())
+                    next_tasks.push_back({next_color++, std::move(part)});
+
+        parallel_for(num_threads, next_tasks.size(), [&](size_t i) {
+            for (int node : next_tasks[i].nodes)
+                decomp.color[node] = next_tasks[i].color;
+        });
+        tasks.swap(next_tasks);
+    }
+
+    int count = 0;
+    component.resize(num_nodes);
+    for (int node = 0; node < num_nodes; node++) {
+        int rep = decomp.rep[node];
+        log_assert(rep >= 0 && rep <= node);
+        component[node] = rep == node ? count++ : component[rep];
+    }
+    return count;
+}
+
+YOSYS_NAMESPACE_END
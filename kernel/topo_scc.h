@@ -193,6 +193,70 @@ public:
     }
 };
 
+// An immutable graph over the nodes [0, num_nodes), with the successors and
+// predecessors of all nodes stored in flat adjacency arrays. Unlike IntGraph
+// it can be traversed from several threads at once (see find_sccs() below),
+// only dfs_index() must not be used concurrently.
+class FrozenIntGraph {
+public:
+    typedef int node_type;
+
+    struct successor_enumerator {
+        const int *current, *end;
+        bool finished() const { return current == end; }
+        node_type next() {
+            log_assert(!finished());
+            return *current++;
+        }
+    };
+
+    struct node_enumerator {
+        int current, end;
+        bool finished() const { return current == end; }
+        node_type next() {
+            log_assert(!finished());
+            node_type result = current;
+            ++current;
+            return result;
+        }
+    };
+
+private:
+    std::vector<int> offsets_, targets_;
+    std::vector<int> rev_offsets_, rev_targets_;
+    std::vector<int> indices_;
+
+public:
+    FrozenIntGraph() : offsets_(1, 0), rev_offsets_(1, 0) {}
+    // Duplicate edges are removed, the successors (and predecessors) of each
+    // node are enumerated in increasing order.
+    FrozenIntGraph(int num_nodes, std::vector<std::pair<int, int>> const &edges);
+
+    int num_nodes() const { return GetSize(offsets_) - 1; }
+    int num_edges() const { return GetSize(targets_); }
+
+    node_enumerator enumerate_nodes() const {
+        return {0, num_nodes()};
+    }
+
+    successor_enumerator enumerate_successors(int node) const {
+        return {targets_.data() + offsets_[node], targets_.data() + offsets_[node + 1]};
+    }
+
+    successor_enumerator enumerate_predecessors(int node) const {
+        return {rev_targets_.data() + rev_offsets_[node], rev_targets_.data() + rev_offsets_[node + 1]};
+    }
+
+    bool has_edge(int src, int dst) const {
+        auto succ = enumerate_successors(src);
+        return std::binary_search(succ.current, succ.end, dst);
+    }
+
+    int &dfs_index(node_type const &node) {
+        return indices_[node];
+    }
+};
+
 template<typename G, typename ComponentCallback>
 class TopoSortedSccs
 {
@@ -352,6 +416,21 @@ public:
     }
 };
 
+// Computes the strongly connected components of a graph, storing the index of
+// the component of each node in `component` and returning the number of
+// components. Components are numbered in the order of their smallest node,
+// independent of the number of threads, but are not topologically sorted.
+// Every node is a component on its own unless it is part of a cycle; use
+// has_edge() to tell apart nodes with a self-loop.
+//
+// With more than one thread (see thread_count() in kernel/threading.h) large
+// subgraphs are first trimmed of nodes without predecessors or successors and
+// then split by a forward-backward search from a pivot node: the nodes
+// reachable in both directions form the pivot's component, and the SCCs of
+// the remaining three parts can be computed independently. Subgraphs which
+// are small enough are handed to TopoSortedSccs, concurrently.
+int find_sccs(FrozenIntGraph const &graph, std::vector<int> &component, int threads = 1);
+
 YOSYS_NAMESPACE_END
 
 #endif
@@ -19,6 +19,7 @@
 
 #include "kernel/yosys.h"
 #include "kernel/celltypes.h"
+#include "libs/json11/json11.hpp"
 
 #ifdef YOSYS_ENABLE_READLINE
 #  include <readline/readline.h>
@@ -156,7 +157,7 @@ void yosys_banner()
 }
 
 #if !defined(YOSYS_DISABLE_SPAWN)
-int run_command(const std::string &command, std::function<void(const std::string&)> process_line)
+static int run_command_untraced(const std::string &command, std::function<void(const std::string&)> process_line)
 {
 	if (!process_line)
 		return system(command.c_str());
@@ -184,6 +185,40 @@ int run_command(const std::string &command, std::function<void(const std::string
 	return WEXITSTATUS(ret);
 #endif
 }
+
+int run_command(const std::string &command, std::function<void(const std::string&)> process_line)
+{
+	if (!log_trace_active())
+		return run_command_untraced(command, process_line);
+
+	int64_t begin_us = log_trace_clock();
+	int ret = run_command_untraced(command, process_line);
+
+	// name the event after the executable, without its path, reading the
+	// first word of the command like the shell would for quotes and escaped
+	// spaces
+	std::string name;
+	char quote = 0;
+	for (size_t i = command.find_first_not_of(" \t"); i < command.size(); i++) {
+		char ch = command[i];
+		if (quote != 0 && ch == quote)
+			quote = 0;
+		else if (quote != 0)
+			name += ch;
+		else if (ch == '"' || ch == '\'')
+			quote = ch;
+		else if (ch == '\\' && i+1 < command.size() && command[i+1] == ' ')
+			name += command[++i];
+		else if (ch == ' ' || ch == '\t')
+			break;
+		else
+			name += ch;
+	}
+	name = name.substr(name.find_last_of("/\\") + 1);
+	log_trace_complete(name, "exec", begin_us, stringf("\"command\": %s, \"status\": %d",
+			json11::Json(command).dump().c_str(), ret));
+	return ret;
+}
 #endif
 
 bool already_setup = false;
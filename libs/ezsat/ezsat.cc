@@ -56,6 +56,9 @@ ezSAT::ezSAT()
 	solverTimeout = 0;
 	solverTimoutStatus = false;
 
+	assumeLog = NULL;
+	assumeContext = 0;
+
 	literal("CONST_TRUE");
 	literal("CONST_FALSE");
 
@@ -409,6 +412,18 @@ void ezSAT::assume(int id)
 	addhash(__LINE__);
 	addhash(id);
 
+	if (assumeLog != NULL)
+		assumeLog->push_back(id);
+
+	if (assumeContext != 0) {
+		int context = assumeContext;
+		std::vector<int> *log = assumeLog;
+		assumeContext = 0, assumeLog = NULL;
+		assume(OR(id, NOT(context)));
+		assumeContext = context, assumeLog = log;
+		return;
+	}
+
 	if (id < 0)
 	{
 		assert(0 < -id && -id <= int(expressions.size()));
@@ -86,6 +86,12 @@ public:
 	unsigned int statehash;
 	void addhash(unsigned int);
 
+	// when set, the ids passed to assume() are also appended to this vector
+	std::vector<int> *assumeLog;
+	// when non-zero, assume() only adds constraints that hold when this
+	// literal is true (which is then assumed when solving)
+	int assumeContext;
+
 	void keep_cnf() { flag_keep_cnf = true; }
 	void non_incremental() { flag_non_incremental = true; }
 
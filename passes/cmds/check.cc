@@ -21,11 +21,549 @@
 #include "kernel/sigtools.h"
 #include "kernel/celledges.h"
 #include "kernel/celltypes.h"
-#include "kernel/utils.h"
+#include "kernel/threading.h"
+#include "kernel/topo_scc.h"
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
+// Port directions and properties of all cell types, keyed by the indices of
+// the IdStrings. The module scans run concurrently and must not copy any
+// IdString (see parallel_for()), which rules out Cell::input() and friends.
+struct CheckTypeInfo
+{
+	enum { PORT_INPUT = 1, PORT_OUTPUT = 2 };
+	enum { TYPE_MODULE = 1, TYPE_EDGES = 2, TYPE_FF = 4, TYPE_TBUF = 8 };
+
+	dict<std::pair<int, int>, int> port_dirs;
+	dict<int, int> type_flags;
+
+	CheckTypeInfo(RTLIL::Design *design)
+	{
+		for (auto &it : yosys_celltypes.cell_types) {
+			int type = it.first.index_;
+			for (auto &port : it.second.inputs)
+				port_dirs[{type, port.index_}] |= PORT_INPUT;
+			for (auto &port : it.second.outputs)
+				port_dirs[{type, port.index_}] |= PORT_OUTPUT;
+			if (it.second.is_evaluable)
+				type_flags[type] |= TYPE_EDGES;
+		}
+		for (auto type : {ID($mem_v2), ID($memrd), ID($memrd_v2)})
+			type_flags[type.index_] |= TYPE_EDGES;
+		for (auto &type : RTLIL::builtin_ff_cell_types())
+			type_flags[type.index_] |= TYPE_EDGES | TYPE_FF;
+		type_flags[ID($_TBUF_).index_] |= TYPE_TBUF;
+
+		for (auto module : design->modules()) {
+			int type = module->name.index_;
+			type_flags[type] |= TYPE_MODULE;
+			if (yosys_celltypes.cell_known(module->name))
+				continue;
+			for (auto &port : module->ports) {
+				Wire *wire = module->wire(port);
+				int dir = (wire->port_input ? PORT_INPUT : 0) | (wire->port_output ? PORT_OUTPUT : 0);
+				if (dir)
+					port_dirs[{type, port.index_}] = dir;
+			}
+		}
+
+		// A lookup rehashes a dict that has grown since the last lookup, so
+		// do one now, before the concurrent lookups.
+		port_dirs.count({0, 0});
+		type_flags.count(0);
+	}
+
+	int port_dir(const RTLIL::Cell *cell, const RTLIL::IdString &port) const
+	{
+		auto it = port_dirs.find({cell->type.index_, port.index_});
+		return it == port_dirs.end() ? 0 : it->second;
+	}
+
+	int flags(const RTLIL::IdString &type) const
+	{
+		auto it = type_flags.find(type.index_);
+		return it == type_flags.end() ? 0 : it->second;
+	}
+};
+
+struct CircuitEdgesDatabase : AbstractCellEdgesDatabase {
+	SigMap &sigmap;
+	bool force_detail;
+
+	// Edges between wire bits, and between wire bits and a helper
+	// node for each cell for which we have done the edges fallback.
+	// Bits are stored as their index, helper nodes as the
+	// complement of the cell's index.
+	idict<SigBit> bits;
+	idict<Cell *> fallback_cells;
+	std::vector<std::pair<int, int>> edges;
+
+	CircuitEdgesDatabase(SigMap &sigmap, bool force_detail)
+		: sigmap(sigmap), force_detail(force_detail) {}
+
+	void add_edge(RTLIL::Cell *cell, RTLIL::IdString from_port, int from_bit,
+				  RTLIL::IdString to_port, int to_bit, int) override {
+		SigSpec from_portsig = cell->getPort(from_port);
+		SigSpec to_portsig = cell->getPort(to_port);
+		log_assert(from_bit >= 0 && from_bit < from_portsig.size());
+		log_assert(to_bit >= 0 && to_bit < to_portsig.size());
+		SigBit from = sigmap(from_portsig[from_bit]);
+		SigBit to = sigmap(to_portsig[to_bit]);
+
+		if (from.wire && to.wire)
+			edges.emplace_back(bits(from), bits(to));
+	}
+
+	bool detail_costly(Cell *cell) {
+		// Only those cell types for which the edge data can expode quadratically
+		// in port widths are those for us to check.
+		if (!cell->type.in(
+				ID($add), ID($sub),
+				ID($shl), ID($shr), ID($sshl), ID($sshr), ID($shift), ID($shiftx)))
+			return false;
+
+		int in_widths = 0, out_widths = 0;
+
+		for (auto &conn : cell->connections()) {
+			if (cell->input(conn.first))
+				in_widths += conn.second.size();
+			if (cell->output(conn.first))
+				out_widths += conn.second.size();
+		}
+
+		const int threshold = 1024;
+
+		// if the multiplication may overflow we will catch it here 
+		if (in_widths + out_widths >= threshold)
+			return true;
+
+		if (in_widths * out_widths >= threshold)
+			return true;
+
+		return false;
+	}
+
+	bool add_edges_from_cell(Cell *cell) {
+		if (force_detail || !detail_costly(cell)) {
+			if (AbstractCellEdgesDatabase::add_edges_from_cell(cell))
+				return true;
+		}
+
+		// We don't have accurate cell edges, do the fallback of all input-output pairs
+		for (auto &conn : cell->connections()) {
+			if (cell->input(conn.first))
+			for (auto bit : sigmap(conn.second))
+			if (bit.wire)
+				edges.emplace_back(bits(bit), ~fallback_cells(cell));
+
+			if (cell->output(conn.first))
+			for (auto bit : sigmap(conn.second))
+			if (bit.wire)
+				edges.emplace_back(~fallback_cells(cell), bits(bit));
+		}
+
+		// Return false to signify the fallback
+		return false;
+	}
+};
+
+struct MatchingEdgePrinter : AbstractCellEdgesDatabase {
+	std::string &message;
+	SigMap &sigmap;
+	SigBit from, to;
+	int nhits;
+	const int HITS_LIMIT = 3;
+
+	MatchingEdgePrinter(std::string &message, SigMap &sigmap, SigBit from, SigBit to)
+		: message(message), sigmap(sigmap), from(from), to(to), nhits(0) {}
+
+	void add_edge(RTLIL::Cell *cell, RTLIL::IdString from_port, int from_bit,
+				  RTLIL::IdString to_port, int to_bit, int) override {
+		SigBit edge_from = sigmap(cell->getPort(from_port))[from_bit];
+		SigBit edge_to = sigmap(cell->getPort(to_port))[to_bit];
+
+		if (edge_from == from && edge_to == to && nhits++ < HITS_LIMIT)
+			message += stringf("      %s[%d] --> %s[%d]\n", log_id(from_port), from_bit,
+							   log_id(to_port), to_bit);
+		if (nhits == HITS_LIMIT)
+			message += "      ...\n";
+	}
+};
+
+// Checks a single module. scan() and find_loops() only record the problems
+// and may run concurrently for different modules, everything that needs
+// IdStrings or logging is left to collect_edges() and report(), which run on
+// the main thread.
+struct CheckWorker
+{
+	const CheckTypeInfo &types;
+	RTLIL::Module *module;
+	bool noinit, initdrv, mapped, allow_tbuf;
+
+	// A driver of a bit, described in a warning only if needed.
+	struct Driver {
+		enum Kind { CASE_ACTION, SYNC_ACTION, CELL_PORT, MODULE_INPUT } kind;
+		int index;
+		RTLIL::Process *process;
+		const RTLIL::SigSig *action;
+		RTLIL::Cell *cell;
+		const RTLIL::IdString *port;
+		RTLIL::Wire *wire;
+	};
+
+	SigMap sigmap;
+	dict<SigBit, vector<Driver>> wire_drivers;
+	dict<SigBit, Cell *> driver_cells;
+	dict<SigBit, int> wire_drivers_count;
+	pool<SigBit> used_wires;
+
+	vector<Cell *> edge_cells;
+	CircuitEdgesDatabase edges_db;
+	pool<Cell *> coarsened_cells;
+
+	// the problems, in the order they are reported
+	vector<Cell *> unmapped_cells;
+	vector<Wire *> unprocessed_init;
+	vector<State> constant_conflicts;
+	vector<SigBit> conflicts, undriven;
+	vector<vector<int>> loops;
+	vector<SigChunk> init_not_ff;
+
+	CheckWorker(const CheckTypeInfo &types, RTLIL::Module *module, bool force_detail)
+		: types(types), module(module), edges_db(sigmap, force_detail) {}
+
+	void add_driver(SigBit bit, RTLIL::Process *process, const SigSig &action, bool sync)
+	{
+		wire_drivers[bit].push_back({sync ? Driver::SYNC_ACTION : Driver::CASE_ACTION, 0, process, &action, nullptr, nullptr, nullptr});
+	}
+
+	void scan()
+	{
+		sigmap.set(module);
+
+		for (auto &proc_it : module->processes)
+		{
+			RTLIL::Process *process = proc_it.second;
+			std::vector<RTLIL::CaseRule*> all_cases = {&process->root_case};
+			for (size_t i = 0; i < all_cases.size(); i++) {
+				for (auto &action : all_cases[i]->actions) {
+					for (auto bit : sigmap(action.first))
+						add_driver(bit, process, action, false);
+
+					for (auto bit : sigmap(action.second))
+						if (bit.wire) used_wires.insert(bit);
+				}
+				for (auto switch_ : all_cases[i]->switches) {
+					for (auto case_ : switch_->cases) {
+						all_cases.push_back(case_);
+						for (auto &compare : case_->compare)
+							for (auto bit : sigmap(compare))
+								if (bit.wire) used_wires.insert(bit);
+					}
+				}
+			}
+			for (auto &sync : process->syncs) {
+				for (auto bit : sigmap(sync->signal))
+					if (bit.wire) used_wires.insert(bit);
+				for (auto &action : sync->actions) {
+					for (auto bit : sigmap(action.first))
+						add_driver(bit, process, action, true);
+					for (auto bit : sigmap(action.second))
+						if (bit.wire) used_wires.insert(bit);
+				}
+				for (auto &memwr : sync->mem_write_actions) {
+					for (auto bit : sigmap(memwr.address))
+						if (bit.wire) used_wires.insert(bit);
+					for (auto bit : sigmap(memwr.data))
+						if (bit.wire) used_wires.insert(bit);
+					for (auto bit : sigmap(memwr.enable))
+						if (bit.wire) used_wires.insert(bit);
+				}
+			}
+		}
+
+		for (auto cell : module->cells())
+		{
+			int flags = types.flags(cell->type);
+
+			if (mapped && cell->type.begins_with("$") && !(flags & CheckTypeInfo::TYPE_MODULE))
+				if (!allow_tbuf || !(flags & CheckTypeInfo::TYPE_TBUF))
+					unmapped_cells.push_back(cell);
+
+			for (auto &conn : cell->connections()) {
+				int dir = types.port_dir(cell, conn.first);
+				bool input = dir & CheckTypeInfo::PORT_INPUT;
+				bool output = dir & CheckTypeInfo::PORT_OUTPUT;
+
+				SigSpec sig = sigmap(conn.second);
+				for (int i = 0; i < sig.size(); i++) {
+					SigBit bit = sig[i];
+
+					if (input && bit.wire)
+						used_wires.insert(bit);
+					if (output && !input && bit.wire)
+						wire_drivers_count[bit]++;
+					if (output && (bit.wire || !input))
+						wire_drivers[bit].push_back({Driver::CELL_PORT, i, nullptr, nullptr, cell, &conn.first, nullptr});
+					if (output)
+						driver_cells[bit] = cell;
+				}
+			}
+
+			if (flags & CheckTypeInfo::TYPE_EDGES)
+				edge_cells.push_back(cell);
+		}
+
+		pool<SigBit> init_bits;
+
+		for (auto wire : module->wires()) {
+			if (wire->port_input) {
+				SigSpec sig = sigmap(wire);
+				for (int i = 0; i < GetSize(sig); i++)
+					if (sig[i].wire || !wire->port_output)
+						wire_drivers[sig[i]].push_back({Driver::MODULE_INPUT, i, nullptr, nullptr, nullptr, nullptr, wire});
+			}
+			if (wire->port_output)
+				for (auto bit : sigmap(wire))
+					if (bit.wire) used_wires.insert(bit);
+			if (wire->port_input && !wire->port_output)
+				for (auto bit : sigmap(wire))
+					if (bit.wire) wire_drivers_count[bit]++;
+			if (wire->attributes.count(ID::init)) {
+				const Const &initval = wire->attributes.at(ID::init);
+				for (int i = 0; i < GetSize(initval) && i < GetSize(wire); i++)
+					if (initval[i] == State::S0 || initval[i] == State::S1)
+						init_bits.insert(sigmap(SigBit(wire, i)));
+				if (noinit)
+					unprocessed_init.push_back(wire);
+			}
+		}
+
+		for (auto state : {State::S0, State::S1, State::Sx})
+			if (wire_drivers.count(state))
+				constant_conflicts.push_back(state);
+
+		for (auto &it : wire_drivers)
+			if (wire_drivers_count[it.first] > 1)
+				conflicts.push_back(it.first);
+
+		for (auto bit : used_wires)
+			if (!wire_drivers.count(bit))
+				undriven.push_back(bit);
+
+		if (initdrv)
+		{
+			for (auto cell : module->cells())
+			{
+				if (!(types.flags(cell->type) & CheckTypeInfo::TYPE_FF))
+					continue;
+
+				for (auto bit : sigmap(cell->getPort(ID::Q)))
+					init_bits.erase(bit);
+			}
+
+			SigSpec init_sig(init_bits);
+			init_sig.sort_and_unify();
+			init_not_ff = init_sig.chunks();
+		}
+	}
+
+	void collect_edges()
+	{
+		for (auto cell : edge_cells)
+			if (!edges_db.add_edges_from_cell(cell))
+				coarsened_cells.insert(cell);
+	}
+
+	void find_loops(int threads)
+	{
+		// The helper nodes of the fallback cells are numbered after the
+		// wire bits, so that the smallest node of any component with more
+		// than one node is a wire bit.
+		int num_bits = GetSize(edges_db.bits);
+		for (auto &edge : edges_db.edges) {
+			if (edge.first < 0)
+				edge.first = num_bits + ~edge.first;
+			if (edge.second < 0)
+				edge.second = num_bits + ~edge.second;
+		}
+		FrozenIntGraph graph(num_bits + GetSize(edges_db.fallback_cells), edges_db.edges);
+		edges_db.edges.clear();
+
+		std::vector<int> component;
+		std::vector<int> component_size(find_sccs(graph, component, threads));
+		for (int node = 0; node < graph.num_nodes(); node++)
+			component_size[component[node]]++;
+
+		std::vector<int> parent(graph.num_nodes(), -1);
+		std::vector<bool> seen_component(GetSize(component_size));
+		for (int root = 0; root < num_bits; root++)
+		{
+			int root_component = component[root];
+			if (seen_component[root_component])
+				continue;
+			seen_component[root_component] = true;
+			if (component_size[root_component] == 1 && !graph.has_edge(root, root))
+				continue;
+
+			// Report one of the shortest loops through the component's
+			// smallest node, found by a breadth-first search within the
+			// component.
+			std::vector<int> visited = {root};
+			int last = -1;
+			for (int i = 0; last < 0; i++) {
+				log_assert(i < GetSize(visited));
+				int node = visited[i];
+				for (auto succ = graph.enumerate_successors(node); !succ.finished();) {
+					int next = succ.next();
+					if (next == root) {
+						last = node;
+						break;
+					}
+					if (component[next] == root_component && parent[next] < 0) {
+						parent[next] = node;
+						visited.push_back(next);
+					}
+				}
+			}
+
+			std::vector<int> loop;
+			for (int node = last; node != root; node = parent[node])
+				loop.push_back(node);
+			loop.push_back(root);
+			std::reverse(loop.begin(), loop.end());
+			for (int node : visited)
+				parent[node] = -1;
+			loops.push_back(std::move(loop));
+		}
+	}
+
+	std::string describe(const Driver &driver)
+	{
+		switch (driver.kind) {
+		case Driver::CASE_ACTION:
+		case Driver::SYNC_ACTION:
+			return stringf("action %s <= %s (%s rule) in process %s",
+					log_signal(driver.action->first), log_signal(driver.action->second),
+					driver.kind == Driver::CASE_ACTION ? "case" : "sync", log_id(driver.process->name));
+		case Driver::CELL_PORT:
+			return stringf("port %s[%d] of cell %s (%s)", log_id(*driver.port), driver.index,
+					log_id(driver.cell), log_id(driver.cell->type));
+		case Driver::MODULE_INPUT:
+			return stringf("module input %s[%d]", log_id(driver.wire), driver.index);
+		}
+		log_abort();
+	}
+
+	void report_loop(const vector<int> &loop, bool &suggest_detail)
+	{
+		string message = stringf("found logic loop in module %s:\n", log_id(module));
+		int num_bits = GetSize(edges_db.bits);
+
+		// `loop` only contains wire bits, or an occasional special helper node for cells for
+		// which we have done the edges fallback. The cell and its ports that led to an edge are
+		// a piece of information we need to recover now. For that we need to have the previous
+		// wire bit of the loop at hand.
+		SigBit prev;
+		for (auto it = loop.rbegin(); it != loop.rend(); it++)
+		if (*it < num_bits) { // skip the fallback helper nodes
+			prev = edges_db.bits[*it];
+			break;
+		}
+		log_assert(prev != SigBit());
+
+		for (int node : loop) {
+			if (node >= num_bits)
+				continue; // helper node for edges fallback, we can ignore it
+
+			SigBit bit = edges_db.bits[node];
+			Wire *wire = bit.wire;
+			log_assert(wire);
+			log_assert(driver_cells.count(bit));
+			Cell *driver = driver_cells.at(bit);
+
+			std::string driver_src;
+			if (driver->has_attribute(ID::src)) {
+				std::string src_attr = driver->get_src_attribute();
+				driver_src = stringf(" source: %s", src_attr.c_str());
+			}
+
+			message += stringf("    cell %s (%s)%s\n", log_id(driver), log_id(driver->type), driver_src.c_str());
+
+			if (!coarsened_cells.count(driver)) {						
+				MatchingEdgePrinter printer(message, sigmap, prev, bit);
+				printer.add_edges_from_cell(driver);
+			} else {
+				message += "      (cell's internal connectivity overapproximated; loop may be a false positive)\n";
+				suggest_detail = true;
+			}
+
+			if (wire->name.isPublic()) {
+				std::string wire_src;
+				if (wire->has_attribute(ID::src)) {
+					std::string src_attr = wire->get_src_attribute();
+					wire_src = stringf(" source: %s", src_attr.c_str());
+				}
+				message += stringf("    wire %s%s\n", log_signal(bit), wire_src.c_str());						
+			}
+
+			prev = bit;
+		}
+		log_warning("%s", message.c_str());
+	}
+
+	int report(bool &suggest_detail)
+	{
+		int counter = 0;
+
+		log("Checking module %s...\n", log_id(module));
+
+		for (auto cell : unmapped_cells) {
+			log_warning("Cell %s.%s is an unmapped internal cell of type %s.\n", log_id(module), log_id(cell), log_id(cell->type));
+			counter++;
+		}
+
+		for (auto wire : unprocessed_init) {
+			log_warning("Wire %s.%s has an unprocessed 'init' attribute.\n", log_id(module), log_id(wire));
+			counter++;
+		}
+
+		for (auto state : constant_conflicts) {
+			string message = stringf("Drivers conflicting with a constant %s driver:\n", log_signal(state));
+			for (auto &driver : wire_drivers.at(state))
+				message += stringf("    %s\n", describe(driver).c_str());
+			log_warning("%s", message.c_str());
+			counter++;
+		}
+
+		for (auto bit : conflicts) {
+			string message = stringf("multiple conflicting drivers for %s.%s:\n", log_id(module), log_signal(bit));
+			for (auto &driver : wire_drivers.at(bit))
+				message += stringf("    %s\n", describe(driver).c_str());
+			log_warning("%s", message.c_str());
+			counter++;
+		}
+
+		for (auto bit : undriven) {
+			log_warning("Wire %s.%s is used but has no driver.\n", log_id(module), log_signal(bit));
+			counter++;
+		}
+
+		for (auto &loop : loops) {
+			report_loop(loop, suggest_detail);
+			counter++;
+		}
+
+		for (auto &chunk : init_not_ff) {
+			log_warning("Wire %s.%s has 'init' attribute and is not driven by an FF cell.\n", log_id(module), log_signal(chunk));
+			counter++;
+		}
+
+		return counter;
+	}
+};
+
 struct CheckPass : public Pass {
 	CheckPass() : Pass("check", "check for obvious problems in the design") { }
 	void help() override
@@ -65,6 +603,12 @@ struct CheckPass : public Pass {
 		log("        falling back to a simpler overapproximating model for those cells for\n");
 		log("        which the detailed model is expected costly.\n");
 		log("\n");
+		log("    -j <threads>\n");
+		log("        check the modules using the given number of threads (0 for one per\n");
+		log("        hardware thread). When only a single module is checked, its search for\n");
+		log("        combinatorial loops uses the threads instead. The output is the same\n");
+		log("        for any number of threads. default: 1\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
@@ -76,6 +620,7 @@ struct CheckPass : public Pass {
 		bool assert_mode = false;
 		bool force_detailed_loop_check = false;
 		bool suggest_detail = false;
+		int threads = 1;
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++) {
@@ -103,331 +648,47 @@ struct CheckPass : public Pass {
 				force_detailed_loop_check = true;
 				continue;
 			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				threads = atoi(args[++argidx].c_str());
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
 
 		log_header(design, "Executing CHECK pass (checking for obvious problems).\n");
 
-		for (auto module : design->selected_whole_modules_warn())
-		{
-			log("Checking module %s...\n", log_id(module));
-
-			SigMap sigmap(module);
-			dict<SigBit, vector<string>> wire_drivers;
-			dict<SigBit, Cell *> driver_cells;
-			dict<SigBit, int> wire_drivers_count;
-			pool<SigBit> used_wires;
-			TopoSort<std::pair<RTLIL::IdString, int>> topo;
-			for (auto &proc_it : module->processes)
-			{
-				std::vector<RTLIL::CaseRule*> all_cases = {&proc_it.second->root_case};
-				for (size_t i = 0; i < all_cases.size(); i++) {
-					for (auto action : all_cases[i]->actions) {
-						for (auto bit : sigmap(action.first))
-							wire_drivers[bit].push_back(
-								stringf("action %s <= %s (case rule) in process %s",
-										log_signal(action.first), log_signal(action.second), log_id(proc_it.first)));
-
-						for (auto bit : sigmap(action.second))
-							if (bit.wire) used_wires.insert(bit);
-					}
-					for (auto switch_ : all_cases[i]->switches) {
-						for (auto case_ : switch_->cases) {
-							all_cases.push_back(case_);
-							for (auto compare : case_->compare)
-								for (auto bit : sigmap(compare))
-									if (bit.wire) used_wires.insert(bit);
-						}
-					}
-				}
-				for (auto &sync : proc_it.second->syncs) {
-					for (auto bit : sigmap(sync->signal))
-						if (bit.wire) used_wires.insert(bit);
-					for (auto action : sync->actions) {
-						for (auto bit : sigmap(action.first))
-							wire_drivers[bit].push_back(
-								stringf("action %s <= %s (sync rule) in process %s",
-										log_signal(action.first), log_signal(action.second), log_id(proc_it.first)));
-						for (auto bit : sigmap(action.second))
-							if (bit.wire) used_wires.insert(bit);
-					}
-					for (auto memwr : sync->mem_write_actions) {
-						for (auto bit : sigmap(memwr.address))
-							if (bit.wire) used_wires.insert(bit);
-						for (auto bit : sigmap(memwr.data))
-							if (bit.wire) used_wires.insert(bit);
-						for (auto bit : sigmap(memwr.enable))
-							if (bit.wire) used_wires.insert(bit);
-					}
-				}
-			}
-
-			struct CircuitEdgesDatabase : AbstractCellEdgesDatabase {
-				TopoSort<std::pair<RTLIL::IdString, int>> &topo;
-				SigMap sigmap;
-				bool force_detail;
-
-				CircuitEdgesDatabase(TopoSort<std::pair<RTLIL::IdString, int>> &topo, SigMap &sigmap, bool force_detail)
-					: topo(topo), sigmap(sigmap), force_detail(force_detail) {}
-
-				void add_edge(RTLIL::Cell *cell, RTLIL::IdString from_port, int from_bit,
-							  RTLIL::IdString to_port, int to_bit, int) override {
-					SigSpec from_portsig = cell->getPort(from_port);
-					SigSpec to_portsig = cell->getPort(to_port);
-					log_assert(from_bit >= 0 && from_bit < from_portsig.size());
-					log_assert(to_bit >= 0 && to_bit < to_portsig.size());
-					SigBit from = sigmap(from_portsig[from_bit]);
-					SigBit to = sigmap(to_portsig[to_bit]);
-
-					if (from.wire && to.wire)
-						topo.edge(std::make_pair(from.wire->name, from.offset), std::make_pair(to.wire->name, to.offset));
-				}
-
-				bool detail_costly(Cell *cell) {
-					// Only those cell types for which the edge data can expode quadratically
-					// in port widths are those for us to check.
-					if (!cell->type.in(
-							ID($add), ID($sub),
-							ID($shl), ID($shr), ID($sshl), ID($sshr), ID($shift), ID($shiftx)))
-						return false;
-
-					int in_widths = 0, out_widths = 0;
-
-					for (auto &conn : cell->connections()) {
-						if (cell->input(conn.first))
-							in_widths += conn.second.size();
-						if (cell->output(conn.first))
-							out_widths += conn.second.size();
-					}
-
-					const int threshold = 1024;
-
-					// if the multiplication may overflow we will catch it here 
-					if (in_widths + out_widths >= threshold)
-						return true;
+		CheckTypeInfo types(design);
+		std::vector<RTLIL::Module*> modules = design->selected_whole_modules_warn();
+		int loop_threads = GetSize(modules) == 1 ? threads : 1;
 
-					if (in_widths * out_widths >= threshold)
-						return true;
+		// The workers of a batch keep their results until they are reported,
+		// the batches bound the memory used for that.
+		int num_threads = thread_count(threads, modules.size());
+		size_t batch_size = num_threads > 1 ? 4 * num_threads : 1;
 
-					return false;
-				}
-
-				bool add_edges_from_cell(Cell *cell) {
-					if (force_detail || !detail_costly(cell)) {
-						if (AbstractCellEdgesDatabase::add_edges_from_cell(cell))
-							return true;
-					}
-
-					// We don't have accurate cell edges, do the fallback of all input-output pairs
-					for (auto &conn : cell->connections()) {
-						if (cell->input(conn.first))
-						for (auto bit : sigmap(conn.second))
-						if (bit.wire)
-							topo.edge(std::make_pair(bit.wire->name, bit.offset),
-									  std::make_pair(cell->name, -1));
-
-						if (cell->output(conn.first))
-						for (auto bit : sigmap(conn.second))
-						if (bit.wire)
-							topo.edge(std::make_pair(cell->name, -1),
-									  std::make_pair(bit.wire->name, bit.offset));
-					}
-
-					// Return false to signify the fallback
-					return false;
-				}
-			};
-
-			CircuitEdgesDatabase edges_db(topo, sigmap, force_detailed_loop_check);
-
-			pool<Cell *> coarsened_cells;
-			for (auto cell : module->cells())
-			{
-				if (mapped && cell->type.begins_with("$") && design->module(cell->type) == nullptr) {
-					if (allow_tbuf && cell->type == ID($_TBUF_)) goto cell_allowed;
-					log_warning("Cell %s.%s is an unmapped internal cell of type %s.\n", log_id(module), log_id(cell), log_id(cell->type));
-					counter++;
-				cell_allowed:;
-				}
-
-				for (auto &conn : cell->connections()) {
-					bool input = cell->input(conn.first);
-					bool output = cell->output(conn.first);
-
-					SigSpec sig = sigmap(conn.second);
-					for (int i = 0; i < sig.size(); i++) {
-						SigBit bit = sig[i];
-
-						if (input && bit.wire)
-							used_wires.insert(bit);
-						if (output && !input && bit.wire)
-							wire_drivers_count[bit]++;
-						if (output && (bit.wire || !input))
-							wire_drivers[bit].push_back(stringf("port %s[%d] of cell %s (%s)", log_id(conn.first), i,
-																log_id(cell), log_id(cell->type)));
-						if (output)
-							driver_cells[bit] = cell;
-					}
-				}
-
-				if (yosys_celltypes.cell_evaluable(cell->type) || cell->type.in(ID($mem_v2), ID($memrd), ID($memrd_v2)) \
-						|| RTLIL::builtin_ff_cell_types().count(cell->type)) {
-					if (!edges_db.add_edges_from_cell(cell))
-						coarsened_cells.insert(cell);
-				}
-			}
-
-			pool<SigBit> init_bits;
-
-			for (auto wire : module->wires()) {
-				if (wire->port_input) {
-					SigSpec sig = sigmap(wire);
-					for (int i = 0; i < GetSize(sig); i++)
-						if (sig[i].wire || !wire->port_output)
-							wire_drivers[sig[i]].push_back(stringf("module input %s[%d]", log_id(wire), i));
-				}
-				if (wire->port_output)
-					for (auto bit : sigmap(wire))
-						if (bit.wire) used_wires.insert(bit);
-				if (wire->port_input && !wire->port_output)
-					for (auto bit : sigmap(wire))
-						if (bit.wire) wire_drivers_count[bit]++;
-				if (wire->attributes.count(ID::init)) {
-					Const initval = wire->attributes.at(ID::init);
-					for (int i = 0; i < GetSize(initval) && i < GetSize(wire); i++)
-						if (initval[i] == State::S0 || initval[i] == State::S1)
-							init_bits.insert(sigmap(SigBit(wire, i)));
-					if (noinit) {
-						log_warning("Wire %s.%s has an unprocessed 'init' attribute.\n", log_id(module), log_id(wire));
-						counter++;
-					}
-				}
-			}
-
-			for (auto state : {State::S0, State::S1, State::Sx})
-				if (wire_drivers.count(state)) {
-					string message = stringf("Drivers conflicting with a constant %s driver:\n", log_signal(state));
-					for (auto str : wire_drivers[state])
-						message += stringf("    %s\n", str.c_str());
-					log_warning("%s", message.c_str());
-					counter++;
-				}
-
-			for (auto it : wire_drivers)
-				if (wire_drivers_count[it.first] > 1) {
-					string message = stringf("multiple conflicting drivers for %s.%s:\n", log_id(module), log_signal(it.first));
-					for (auto str : it.second)
-						message += stringf("    %s\n", str.c_str());
-					log_warning("%s", message.c_str());
-					counter++;
-				}
-
-			for (auto bit : used_wires)
-				if (!wire_drivers.count(bit)) {
-					log_warning("Wire %s.%s is used but has no driver.\n", log_id(module), log_signal(bit));
-					counter++;
-				}
-
-			topo.sort();
-			for (auto &loop : topo.loops) {
-				string message = stringf("found logic loop in module %s:\n", log_id(module));
-
-				// `loop` only contains wire bits, or an occasional special helper node for cells for
-				// which we have done the edges fallback. The cell and its ports that led to an edge are
-				// a piece of information we need to recover now. For that we need to have the previous
-				// wire bit of the loop at hand.
-				SigBit prev;
-				for (auto it = loop.rbegin(); it != loop.rend(); it++)
-				if (it->second != -1) { // skip the fallback helper nodes
-					prev = SigBit(module->wire(it->first), it->second);
-					break;
-				}
-				log_assert(prev != SigBit());
-
-				for (auto &pair : loop) {
-					if (pair.second == -1)
-						continue; // helper node for edges fallback, we can ignore it
-
-					struct MatchingEdgePrinter : AbstractCellEdgesDatabase {
-						std::string &message;
-						SigMap &sigmap;
-						SigBit from, to;
-						int nhits;
-						const int HITS_LIMIT = 3;
-
-						MatchingEdgePrinter(std::string &message, SigMap &sigmap, SigBit from, SigBit to)
-							: message(message), sigmap(sigmap), from(from), to(to), nhits(0) {}
-
-						void add_edge(RTLIL::Cell *cell, RTLIL::IdString from_port, int from_bit,
-									  RTLIL::IdString to_port, int to_bit, int) override {
-							SigBit edge_from = sigmap(cell->getPort(from_port))[from_bit];
-							SigBit edge_to = sigmap(cell->getPort(to_port))[to_bit];
-
-							if (edge_from == from && edge_to == to && nhits++ < HITS_LIMIT)
-								message += stringf("      %s[%d] --> %s[%d]\n", log_id(from_port), from_bit,
-												   log_id(to_port), to_bit);
-							if (nhits == HITS_LIMIT)
-								message += "      ...\n";
-						}
-					};
-
-					Wire *wire = module->wire(pair.first);
-					log_assert(wire);
-					SigBit bit(module->wire(pair.first), pair.second);
-					log_assert(driver_cells.count(bit));
-					Cell *driver = driver_cells.at(bit);
-
-					std::string driver_src;
-					if (driver->has_attribute(ID::src)) {
-						std::string src_attr = driver->get_src_attribute();
-						driver_src = stringf(" source: %s", src_attr.c_str());
-					}
-
-					message += stringf("    cell %s (%s)%s\n", log_id(driver), log_id(driver->type), driver_src.c_str());
-
-					if (!coarsened_cells.count(driver)) {						
-						MatchingEdgePrinter printer(message, sigmap, prev, bit);
-						printer.add_edges_from_cell(driver);
-					} else {
-						message += "      (cell's internal connectivity overapproximated; loop may be a false positive)\n";
-						suggest_detail = true;
-					}
-
-					if (wire->name.isPublic()) {
-						std::string wire_src;
-						if (wire->has_attribute(ID::src)) {
-							std::string src_attr = wire->get_src_attribute();
-							wire_src = stringf(" source: %s", src_attr.c_str());
-						}
-						message += stringf("    wire %s%s\n", log_signal(SigBit(wire, pair.second)), wire_src.c_str());						
-					}
-
-					prev = bit;
-				}
-				log_warning("%s", message.c_str());
-				counter++;
+		for (size_t batch = 0; batch < modules.size(); batch += batch_size)
+		{
+			std::vector<std::unique_ptr<CheckWorker>> workers;
+			for (size_t i = batch; i < modules.size() && i < batch + batch_size; i++) {
+				workers.emplace_back(new CheckWorker(types, modules[i], force_detailed_loop_check));
+				CheckWorker &worker = *workers.back();
+				worker.noinit = noinit;
+				worker.initdrv = initdrv;
+				worker.mapped = mapped;
+				worker.allow_tbuf = allow_tbuf;
 			}
 
-			if (initdrv)
-			{
-				for (auto cell : module->cells())
-				{
-					if (RTLIL::builtin_ff_cell_types().count(cell->type) == 0)
-						continue;
-
-					for (auto bit : sigmap(cell->getPort(ID::Q)))
-						init_bits.erase(bit);
-				}
-
-				SigSpec init_sig(init_bits);
-				init_sig.sort_and_unify();
-
-				for (auto chunk : init_sig.chunks()) {
-					log_warning("Wire %s.%s has 'init' attribute and is not driven by an FF cell.\n", log_id(module), log_signal(chunk));
-					counter++;
-				}
-			}
+			parallel_for(num_threads, workers.size(), [&](size_t i) {
+				workers[i]->scan();
+			});
+			for (auto &worker : workers)
+				worker->collect_edges();
+			parallel_for(num_threads, workers.size(), [&](size_t i) {
+				workers[i]->find_loops(loop_threads);
+			});
+			for (auto &worker : workers)
+				counter += worker->report(suggest_detail);
 		}
 
 		log("Found and reported %d problems.\n", counter);
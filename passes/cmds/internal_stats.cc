@@ -108,6 +108,8 @@ struct InternalStatsPass : public Pass {
 			}
 			auto ast_bytes = AST::astnode_count() * (unsigned long long) sizeof(AST::AstNode);
 			log("   \"memory_ast\": %s,\n", std::to_string(ast_bytes).c_str());
+			log("   \"memory_ast_pool\": %s,\n", std::to_string(AST::astnode_pool_bytes()).c_str());
+			log("   \"ast_nodes_allocated\": %s,\n", std::to_string(AST::astnode_allocations()).c_str());
 		}
 
 		// stats go here
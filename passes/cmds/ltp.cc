@@ -19,26 +19,30 @@
 
 #include "kernel/yosys.h"
 #include "kernel/celltypes.h"
-#include "kernel/sigtools.h"
+#include "kernel/netgraph.h"
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
 struct LtpWorker
 {
-	RTLIL::Design *design;
 	RTLIL::Module *module;
-	SigMap sigmap;
+	const NetGraph &graph;
 
-	dict<SigBit, tuple<int, SigBit, Cell*>> bits;
-	dict<SigBit, dict<SigBit, Cell*>> bit2bits;
-	dict<SigBit, tuple<SigBit, Cell*>> bit2ff;
+	// per bit id: the level, the previous bit and the cell on the path
+	std::vector<int> level, from;
+	std::vector<Cell*> via;
+	std::vector<bool> selected;
+
+	// per bit id: the bits the cells with this input drive, and the cell
+	std::vector<std::vector<std::pair<int, Cell*>>> bit2bits;
+	std::vector<std::pair<int, Cell*>> bit2ff;
 
 	int maxlvl;
-	SigBit maxbit;
-	pool<SigBit> busy;
+	int maxbit;
+	std::vector<bool> busy;
 
-	LtpWorker(RTLIL::Module *module, bool noff) : design(module->design), module(module), sigmap(module)
+	LtpWorker(RTLIL::Module *module, const NetGraph &graph, bool noff) : module(module), graph(graph)
 	{
 		CellTypes ff_celltypes;
 
@@ -47,86 +51,100 @@ struct LtpWorker
 			ff_celltypes.setup_stdcells_mem();
 		}
 
+		int num_bits = graph.num_bits();
+		level.assign(num_bits, -1);
+		from.assign(num_bits, -1);
+		via.assign(num_bits, nullptr);
+		selected.assign(num_bits, false);
+		bit2bits.resize(num_bits);
+		bit2ff.assign(num_bits, {-1, nullptr});
+		busy.assign(num_bits, false);
+
 		for (auto wire : module->selected_wires())
-			for (auto bit : sigmap(wire))
-				bits[bit] = tuple<int, SigBit, Cell*>(-1, State::Sx, nullptr);
+			for (int i = 0; i < wire->width; i++) {
+				int bit = graph.bit_id(SigBit(wire, i));
+				if (bit >= 0)
+					selected[bit] = true;
+			}
 
 		for (auto cell : module->selected_cells())
 		{
-			pool<SigBit> src_bits, dst_bits;
-
-			for (auto &conn : cell->connections())
-				for (auto bit : sigmap(conn.second)) {
-					if (cell->input(conn.first))
-						src_bits.insert(bit);
-					if (cell->output(conn.first))
-						dst_bits.insert(bit);
-				}
+			std::vector<int> src_bits, dst_bits;
+
+			int id = graph.cell_id(cell);
+			for (auto &port : graph.ports(id)) {
+				if (port.bit < 0)
+					continue;
+				// unlike the graph, ports of unknown direction are ignored
+				IdString port_name = graph.port_names[port.port];
+				if (cell->input(port_name))
+					src_bits.push_back(port.bit);
+				if (cell->output(port_name))
+					dst_bits.push_back(port.bit);
+			}
+			std::sort(src_bits.begin(), src_bits.end());
+			src_bits.erase(std::unique(src_bits.begin(), src_bits.end()), src_bits.end());
+			std::sort(dst_bits.begin(), dst_bits.end());
+			dst_bits.erase(std::unique(dst_bits.begin(), dst_bits.end()), dst_bits.end());
 
 			if (noff && ff_celltypes.cell_known(cell->type)) {
-				for (auto s : src_bits)
-					for (auto d : dst_bits) {
-						bit2ff[s] = tuple<SigBit, Cell*>(d, cell);
-						break;
-					}
+				if (!dst_bits.empty())
+					for (auto s : src_bits)
+						bit2ff[s] = {dst_bits.front(), cell};
 				continue;
 			}
 
 			for (auto s : src_bits)
 				for (auto d : dst_bits)
-					bit2bits[s][d] = cell;
+					if (selected[d])
+						bit2bits[s].emplace_back(d, cell);
 		}
 
 		maxlvl = -1;
-		maxbit = State::Sx;
+		maxbit = -1;
 	}
 
-	void runner(SigBit bit, int level, SigBit from, Cell *via)
+	void runner(int bit, int lvl, int from_bit, Cell *via_cell)
 	{
-		auto &bitinfo = bits.at(bit);
-
-		if (get<0>(bitinfo) >= level)
+		if (level[bit] >= lvl)
 			return;
 
-		if (busy.count(bit) > 0) {
-			log_warning("Detected loop at %s in %s\n", log_signal(bit), log_id(module));
+		if (busy[bit]) {
+			log_warning("Detected loop at %s in %s\n", log_signal(graph.bits[bit]), log_id(module));
 			return;
 		}
 
-		busy.insert(bit);
-		get<0>(bitinfo) = level;
-		get<1>(bitinfo) = from;
-		get<2>(bitinfo) = via;
+		busy[bit] = true;
+		level[bit] = lvl;
+		from[bit] = from_bit;
+		via[bit] = via_cell;
 
-		if (level > maxlvl) {
-			maxlvl = level;
+		if (lvl > maxlvl) {
+			maxlvl = lvl;
 			maxbit = bit;
 		}
 
-		if (bit2bits.count(bit)) {
-			for (auto &it : bit2bits.at(bit))
-				runner(it.first, level+1, bit, it.second);
-		}
+		for (auto &it : bit2bits[bit])
+			runner(it.first, lvl+1, bit, it.second);
 
-		busy.erase(bit);
+		busy[bit] = false;
 	}
 
-	void printpath(SigBit bit)
+	void printpath(int bit)
 	{
-		auto &bitinfo = bits.at(bit);
-		if (get<2>(bitinfo)) {
-			printpath(get<1>(bitinfo));
-			log("%5d: %s (via %s)\n", get<0>(bitinfo), log_signal(bit), log_id(get<2>(bitinfo)));
+		if (via[bit]) {
+			printpath(from[bit]);
+			log("%5d: %s (via %s)\n", level[bit], log_signal(graph.bits[bit]), log_id(via[bit]));
 		} else {
-			log("%5d: %s\n", get<0>(bitinfo), log_signal(bit));
+			log("%5d: %s\n", level[bit], log_signal(graph.bits[bit]));
 		}
 	}
 
 	void run()
 	{
-		for (auto &it : bits)
-			if (get<0>(it.second) < 0)
-				runner(it.first, 0, State::Sx, nullptr);
+		for (int bit = 0; bit < graph.num_bits(); bit++)
+			if (selected[bit] && level[bit] < 0)
+				runner(bit, 0, -1, nullptr);
 
 		log("\n");
 		log("Longest topological path in %s (length=%d):\n", log_id(module), maxlvl);
@@ -134,8 +152,8 @@ struct LtpWorker
 		if (maxlvl >= 0)
 			printpath(maxbit);
 
-		if (bit2ff.count(maxbit))
-			log("%5s: %s (via %s)\n", "ff", log_signal(get<0>(bit2ff.at(maxbit))), log_id(get<1>(bit2ff.at(maxbit))));
+		if (maxbit >= 0 && bit2ff[maxbit].second != nullptr)
+			log("%5s: %s (via %s)\n", "ff", log_signal(graph.bits[bit2ff[maxbit].first]), log_id(bit2ff[maxbit].second));
 	}
 };
 
@@ -176,7 +194,8 @@ struct LtpPass : public Pass {
 			if (module->has_processes_warn())
 				continue;
 
-			LtpWorker worker(module, noff);
+			auto graph = NetGraphIndex::get(design).graph(module);
+			LtpWorker worker(module, *graph, noff);
 			worker.run();
 		}
 	}
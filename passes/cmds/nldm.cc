@@ -0,0 +1,750 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Claire Xenia Wolf <claire@yosyshq.com>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "passes/cmds/nldm.h"
+#include <queue>
+
+YOSYS_NAMESPACE_BEGIN
+
+static void locate(const std::vector<double> &index, double x, int &lo, int &hi, double &frac)
+{
+	int n = GetSize(index);
+	if (n < 2) {
+		lo = hi = 0;
+		frac = 0;
+		return;
+	}
+	lo = 0;
+	while (lo < n - 2 && x > index[lo + 1])
+		lo++;
+	hi = lo + 1;
+	double span = index[hi] - index[lo];
+	frac = span == 0 ? 0 : (x - index[lo]) / span;
+}
+
+double NldmTable::lookup(const std::array<double, NUM_VARIABLES> &variables) const
+{
+	if (values.empty())
+		return 0;
+
+	int lo1, hi1, lo2, hi2;
+	double f1, f2;
+	locate(index_1, variables[variable_1], lo1, hi1, f1);
+	locate(index_2, variables[variable_2], lo2, hi2, f2);
+
+	int width = std::max(GetSize(index_2), 1);
+	auto at = [&](int i1, int i2) { return values[i1 * width + i2]; };
+
+	return at(lo1, lo2) * (1 - f1) * (1 - f2) + at(hi1, lo2) * f1 * (1 - f2) +
+			at(lo1, hi2) * (1 - f1) * f2 + at(hi1, hi2) * f1 * f2;
+}
+
+static std::vector<double> parse_numbers(const std::vector<std::string> &args)
+{
+	std::vector<double> numbers;
+	for (auto &arg : args) {
+		const char *p = arg.c_str();
+		while (*p) {
+			if (*p == ',' || *p == ' ' || *p == '\t' || *p == '\\' || *p == '\n' || *p == '\r') {
+				p++;
+				continue;
+			}
+			char *end;
+			double value = strtod(p, &end);
+			if (end == p)
+				log_error("Failed to parse number in liberty table: '%s'.\n", arg.c_str());
+			numbers.push_back(value);
+			p = end;
+		}
+	}
+	return numbers;
+}
+
+static bool parse_variable(const std::string &name, NldmTable::Variable &variable)
+{
+	if (name == "input_net_transition")
+		variable = NldmTable::INPUT_TRANSITION;
+	else if (name == "total_output_net_capacitance")
+		variable = NldmTable::OUTPUT_LOAD;
+	else if (name == "related_pin_transition")
+		variable = NldmTable::RELATED_TRANSITION;
+	else if (name == "constrained_pin_transition")
+		variable = NldmTable::CONSTRAINED_TRANSITION;
+	else
+		return false;
+	return true;
+}
+
+static NldmTable parse_table(const LibertyAst *ast, const dict<std::string, const LibertyAst*> &templates, bool constraint)
+{
+	NldmTable table;
+	if (constraint) {
+		table.variable_1 = NldmTable::RELATED_TRANSITION;
+		table.variable_2 = NldmTable::CONSTRAINED_TRANSITION;
+	}
+
+	if (!ast->args.empty() && templates.count(ast->args[0])) {
+		const LibertyAst *templ = templates.at(ast->args[0]);
+		for (auto child : templ->children) {
+			if (child->id == "variable_1" && !parse_variable(child->value, table.variable_1))
+				log_warning("Unsupported variable '%s' in liberty template '%s'.\n", child->value.c_str(), ast->args[0].c_str());
+			if (child->id == "variable_2" && !parse_variable(child->value, table.variable_2))
+				log_warning("Unsupported variable '%s' in liberty template '%s'.\n", child->value.c_str(), ast->args[0].c_str());
+			if (child->id == "index_1")
+				table.index_1 = parse_numbers(child->args);
+			if (child->id == "index_2")
+				table.index_2 = parse_numbers(child->args);
+		}
+	}
+
+	for (auto child : ast->children) {
+		if (child->id == "index_1")
+			table.index_1 = parse_numbers(child->args);
+		if (child->id == "index_2")
+			table.index_2 = parse_numbers(child->args);
+		if (child->id == "values")
+			table.values = parse_numbers(child->args);
+	}
+
+	size_t expected = std::max<size_t>(table.index_1.size(), 1) * std::max<size_t>(table.index_2.size(), 1);
+	if (!table.values.empty() && table.values.size() != expected) {
+		log_warning("Liberty table '%s' has %d values, expected %d. Ignoring.\n", ast->id.c_str(), GetSize(table.values), int(expected));
+		table.values.clear();
+	}
+	return table;
+}
+
+void NldmLibrary::add(const LibertyAst *library)
+{
+	dict<std::string, const LibertyAst*> templates;
+	double default_input_pin_cap = 0;
+
+	for (auto child : library->children) {
+		if (child->id == "lu_table_template" && !child->args.empty())
+			templates[child->args[0]] = child;
+		if (child->id == "time_unit" && time_unit.empty())
+			time_unit = child->value;
+		if (child->id == "capacitive_load_unit" && capacitive_load_unit.empty() && !child->args.empty())
+			capacitive_load_unit = child->args.size() > 1 ? child->args[0] + child->args[1] : child->args[0];
+		if (child->id == "default_input_pin_cap")
+			default_input_pin_cap = atof(child->value.c_str());
+	}
+
+	for (auto cell_ast : library->children)
+	{
+		if (cell_ast->id != "cell" || cell_ast->args.size() != 1)
+			continue;
+
+		NldmCell &cell = cells[RTLIL::escape_id(cell_ast->args[0])];
+		cell = NldmCell();
+
+		for (auto pin_ast : cell_ast->children)
+		{
+			if (pin_ast->id != "pin")
+				continue;
+
+			const LibertyAst *dir = pin_ast->find("direction");
+			const LibertyAst *cap = pin_ast->find("capacitance");
+			bool input = dir && (dir->value == "input" || dir->value == "inout");
+
+			for (auto &pin_name : pin_ast->args)
+			{
+				IdString pin = RTLIL::escape_id(pin_name);
+				if (cap)
+					cell.capacitance[pin] = atof(cap->value.c_str());
+				else if (input)
+					cell.capacitance[pin] = default_input_pin_cap;
+
+				for (auto timing : pin_ast->children)
+				{
+					if (timing->id != "timing")
+						continue;
+
+					NldmArc arc;
+					arc.pin = pin;
+
+					const LibertyAst *type = timing->find("timing_type");
+					std::string type_str = type ? type->value : "combinational";
+					if (type_str == "combinational" || type_str == "combinational_rise" || type_str == "combinational_fall" ||
+							type_str == "clear" || type_str == "preset" ||
+							type_str == "three_state_enable" || type_str == "three_state_disable")
+						arc.kind = NldmArc::COMBINATIONAL;
+					else if (type_str == "rising_edge")
+						arc.kind = NldmArc::RISING_EDGE;
+					else if (type_str == "falling_edge")
+						arc.kind = NldmArc::FALLING_EDGE;
+					else if (type_str == "setup_rising" || type_str == "recovery_rising")
+						arc.kind = NldmArc::SETUP_RISING;
+					else if (type_str == "setup_falling" || type_str == "recovery_falling")
+						arc.kind = NldmArc::SETUP_FALLING;
+					else
+						continue;
+
+					const LibertyAst *sense = timing->find("timing_sense");
+					if (sense && sense->value == "positive_unate")
+						arc.sense = NldmArc::POSITIVE_UNATE;
+					else if (sense && sense->value == "negative_unate")
+						arc.sense = NldmArc::NEGATIVE_UNATE;
+
+					for (auto table : timing->children) {
+						if (table->id == "cell_rise")
+							arc.cell_rise = parse_table(table, templates, false);
+						else if (table->id == "cell_fall")
+							arc.cell_fall = parse_table(table, templates, false);
+						else if (table->id == "rise_transition")
+							arc.rise_transition = parse_table(table, templates, false);
+						else if (table->id == "fall_transition")
+							arc.fall_transition = parse_table(table, templates, false);
+						else if (table->id == "rise_constraint")
+							arc.rise_constraint = parse_table(table, templates, true);
+						else if (table->id == "fall_constraint")
+							arc.fall_constraint = parse_table(table, templates, true);
+					}
+
+					const LibertyAst *related = timing->find("related_pin");
+					if (related == nullptr)
+						continue;
+					for (auto &related_pin : split_tokens(related->value)) {
+						arc.related_pin = RTLIL::escape_id(related_pin);
+						cell.arcs.push_back(arc);
+					}
+				}
+			}
+		}
+	}
+}
+
+NldmSta::NldmSta(const NldmLibrary &library, RTLIL::Module *module) : library(library), module(module)
+{
+	module->monitors.insert(this);
+}
+
+NldmSta::~NldmSta()
+{
+	module->monitors.erase(this);
+}
+
+int NldmSta::node(SigBit bit)
+{
+	auto it = node_index.find(bit);
+	if (it != node_index.end())
+		return it->second;
+	int n = GetSize(nodes);
+	node_index[bit] = n;
+	nodes.emplace_back();
+	nodes.back().bit = bit;
+	return n;
+}
+
+void NldmSta::add_cell(Cell *cell, pool<int> &dirty)
+{
+	const NldmCell *lib_cell = library.cell(cell->type);
+	if (lib_cell == nullptr) {
+		unknown_cell_types.insert(cell->type);
+		return;
+	}
+
+	auto single_bit = [&](IdString port, SigBit &bit) {
+		if (!cell->hasPort(port))
+			return false;
+		SigSpec sig = sigmap(cell->getPort(port));
+		if (GetSize(sig) != 1 || sig[0].wire == nullptr)
+			return false;
+		bit = sig[0];
+		return true;
+	};
+
+	for (auto &it : lib_cell->capacitance) {
+		SigBit bit;
+		if (!single_bit(it.first, bit))
+			continue;
+		int n = node(bit);
+		nodes[n].load += it.second;
+		cell_loads[cell].push_back({n, it.second});
+		dirty.insert(n);
+	}
+
+	for (auto &arc : lib_cell->arcs)
+	{
+		SigBit from, to;
+		if (!single_bit(arc.related_pin, from) || !single_bit(arc.pin, to))
+			continue;
+
+		if (arc.is_check()) {
+			Check check;
+			check.cell = cell;
+			check.arc = &arc;
+			check.clock = node(from);
+			check.data = node(to);
+			cell_checks[cell].push_back(GetSize(checks));
+			checks.push_back(check);
+			continue;
+		}
+
+		Edge edge;
+		edge.cell = cell;
+		edge.arc = &arc;
+		edge.from = node(from);
+		edge.to = node(to);
+		for (int i = 0; i < 2; i++)
+			for (int j = 0; j < 2; j++)
+				edge.delay[i][j] = NAN;
+		cell_edges[cell].push_back(GetSize(edges));
+		edges.push_back(edge);
+		dirty.insert(edge.to);
+	}
+}
+
+void NldmSta::remove_cell(Cell *cell, pool<int> &dirty)
+{
+	auto it = cell_edges.find(cell);
+	if (it != cell_edges.end()) {
+		for (int e : it->second) {
+			edges[e].alive = false;
+			dirty.insert(edges[e].to);
+		}
+		cell_edges.erase(it);
+	}
+
+	auto jt = cell_checks.find(cell);
+	if (jt != cell_checks.end()) {
+		for (int c : jt->second)
+			checks[c].alive = false;
+		cell_checks.erase(jt);
+	}
+
+	auto kt = cell_loads.find(cell);
+	if (kt != cell_loads.end()) {
+		for (auto &load : kt->second) {
+			nodes[load.first].load -= load.second;
+			dirty.insert(load.first);
+		}
+		cell_loads.erase(kt);
+	}
+}
+
+void NldmSta::rebuild()
+{
+	sigmap.set(module);
+	nodes.clear();
+	node_index.clear();
+	edges.clear();
+	checks.clear();
+	cell_edges.clear();
+	cell_checks.clear();
+	cell_loads.clear();
+	dirty_cells.clear();
+	cell_types.clear();
+	unknown_cell_types.clear();
+
+	for (auto wire : module->wires()) {
+		if (!wire->port_input && !wire->port_output)
+			continue;
+		for (auto bit : sigmap(wire)) {
+			if (bit.wire == nullptr)
+				continue;
+			int n = node(bit);
+			if (wire->port_input)
+				nodes[n].primary_input = true;
+			if (wire->port_output)
+				nodes[n].primary_output = true;
+		}
+	}
+
+	pool<int> dirty;
+	for (auto cell : module->cells()) {
+		cell_types[cell] = cell->type;
+		add_cell(cell, dirty);
+	}
+
+	needs_rebuild = false;
+}
+
+void NldmSta::levelize()
+{
+	for (auto &node : nodes) {
+		node.fanin.clear();
+		node.fanout.clear();
+		node.level = 0;
+	}
+	for (int e = 0; e < GetSize(edges); e++) {
+		if (!edges[e].alive)
+			continue;
+		nodes[edges[e].to].fanin.push_back(e);
+		nodes[edges[e].from].fanout.push_back(e);
+	}
+
+	std::vector<int> indegree(GetSize(nodes));
+	order.clear();
+	for (int n = 0; n < GetSize(nodes); n++) {
+		indegree[n] = GetSize(nodes[n].fanin);
+		if (indegree[n] == 0)
+			order.push_back(n);
+	}
+
+	for (int i = 0; i < GetSize(order); i++) {
+		const Node &node = nodes[order[i]];
+		for (int e : node.fanout) {
+			int to = edges[e].to;
+			nodes[to].level = std::max(nodes[to].level, node.level + 1);
+			if (--indegree[to] == 0)
+				order.push_back(to);
+		}
+	}
+
+	loop_nodes = GetSize(nodes) - GetSize(order);
+	if (loop_nodes > 0) {
+		// Nodes on combinational loops keep an unknown arrival time
+		for (int n = 0; n < GetSize(nodes); n++) {
+			if (indegree[n] == 0)
+				continue;
+			Node &node = nodes[n];
+			for (int t = 0; t < 2; t++) {
+				node.arrival[t] = -INFINITY;
+				node.slew[t] = 0;
+				node.pred_edge[t] = -1;
+			}
+		}
+	}
+}
+
+static bool arc_connects(const NldmArc &arc, int from_transition, int to_transition)
+{
+	switch (arc.kind) {
+	case NldmArc::RISING_EDGE:
+		return from_transition == NldmSta::RISE;
+	case NldmArc::FALLING_EDGE:
+		return from_transition == NldmSta::FALL;
+	default:
+		break;
+	}
+	switch (arc.sense) {
+	case NldmArc::POSITIVE_UNATE:
+		return from_transition == to_transition;
+	case NldmArc::NEGATIVE_UNATE:
+		return from_transition != to_transition;
+	default:
+		return true;
+	}
+}
+
+void NldmSta::compute_node(int n)
+{
+	Node &node = nodes[n];
+	double load = node.load + (node.primary_output ? output_load : 0);
+
+	for (int t = 0; t < 2; t++) {
+		node.arrival[t] = node.primary_input ? 0 : -INFINITY;
+		node.slew[t] = node.primary_input ? input_transition : 0;
+		node.pred_edge[t] = -1;
+		node.pred_transition[t] = -1;
+	}
+
+	for (int e : node.fanin)
+	{
+		Edge &edge = edges[e];
+		const NldmArc &arc = *edge.arc;
+		const Node &from = nodes[edge.from];
+
+		for (int from_t = 0; from_t < 2; from_t++)
+		for (int to_t = 0; to_t < 2; to_t++)
+		{
+			edge.delay[from_t][to_t] = NAN;
+			if (!arc_connects(arc, from_t, to_t))
+				continue;
+
+			const NldmTable &delay_table = to_t == RISE ? arc.cell_rise : arc.cell_fall;
+			if (delay_table.empty())
+				continue;
+
+			std::array<double, NldmTable::NUM_VARIABLES> variables = {from.slew[from_t], load, 0, 0};
+			double delay = delay_table.lookup(variables);
+			edge.delay[from_t][to_t] = delay;
+
+			if (from.arrival[from_t] == -INFINITY)
+				continue;
+
+			const NldmTable &slew_table = to_t == RISE ? arc.rise_transition : arc.fall_transition;
+			double slew = slew_table.empty() ? from.slew[from_t] : slew_table.lookup(variables);
+			node.slew[to_t] = std::max(node.slew[to_t], slew);
+
+			double arrival = from.arrival[from_t] + delay;
+			if (arrival > node.arrival[to_t]) {
+				node.arrival[to_t] = arrival;
+				node.pred_edge[to_t] = e;
+				node.pred_transition[to_t] = from_t;
+			}
+		}
+	}
+}
+
+void NldmSta::propagate_arrival(const pool<int> &dirty, bool all)
+{
+	if (all) {
+		for (int n : order)
+			compute_node(n);
+		return;
+	}
+
+	std::vector<int> position(GetSize(nodes), -1);
+	for (int i = 0; i < GetSize(order); i++)
+		position[order[i]] = i;
+
+	// Visit dirty nodes in topological order, continuing into the fanout only
+	// where arrival or slew actually changed.
+	std::priority_queue<int, std::vector<int>, std::greater<int>> queue;
+	std::vector<bool> queued(GetSize(nodes));
+	for (int n : dirty)
+		if (position[n] >= 0) {
+			queue.push(position[n]);
+			queued[n] = true;
+		}
+
+	while (!queue.empty())
+	{
+		int n = order[queue.top()];
+		queue.pop();
+		queued[n] = false;
+
+		Node &node = nodes[n];
+		double old_arrival[2] = {node.arrival[0], node.arrival[1]};
+		double old_slew[2] = {node.slew[0], node.slew[1]};
+		compute_node(n);
+		if (node.arrival[0] == old_arrival[0] && node.arrival[1] == old_arrival[1] &&
+				node.slew[0] == old_slew[0] && node.slew[1] == old_slew[1])
+			continue;
+
+		for (int e : node.fanout) {
+			int to = edges[e].to;
+			if (!queued[to]) {
+				queue.push(position[to]);
+				queued[to] = true;
+			}
+		}
+	}
+}
+
+void NldmSta::propagate_required()
+{
+	for (auto &node : nodes)
+		node.required[RISE] = node.required[FALL] = INFINITY;
+
+	for (auto &check : checks)
+	{
+		check.required[RISE] = check.required[FALL] = INFINITY;
+		if (!check.alive)
+			continue;
+
+		const Node &clock = nodes[check.clock];
+		Node &data = nodes[check.data];
+		int clock_t = check.arc->kind == NldmArc::SETUP_RISING ? RISE : FALL;
+		double clock_arrival = clock.arrival[clock_t] == -INFINITY ? 0 : clock.arrival[clock_t];
+
+		for (int t = 0; t < 2; t++) {
+			const NldmTable &table = t == RISE ? check.arc->rise_constraint : check.arc->fall_constraint;
+			if (table.empty())
+				continue;
+			std::array<double, NldmTable::NUM_VARIABLES> variables = {0, 0, clock.slew[clock_t], data.slew[t]};
+			check.required[t] = clock_arrival + clock_period - table.lookup(variables);
+			data.required[t] = std::min(data.required[t], check.required[t]);
+		}
+	}
+
+	for (auto &node : nodes)
+		if (node.primary_output)
+			for (int t = 0; t < 2; t++)
+				node.required[t] = std::min(node.required[t], clock_period);
+
+	for (int i = GetSize(order) - 1; i >= 0; i--) {
+		Node &node = nodes[order[i]];
+		for (int e : node.fanout) {
+			const Edge &edge = edges[e];
+			const Node &to = nodes[edge.to];
+			for (int from_t = 0; from_t < 2; from_t++)
+			for (int to_t = 0; to_t < 2; to_t++)
+				if (!std::isnan(edge.delay[from_t][to_t]))
+					node.required[from_t] = std::min(node.required[from_t], to.required[to_t] - edge.delay[from_t][to_t]);
+		}
+	}
+}
+
+void NldmSta::update(bool full)
+{
+	int dead_edges = 0;
+	for (auto &edge : edges)
+		if (!edge.alive)
+			dead_edges++;
+
+	// Adding a cell or changing its type isn't reported to monitors, so the
+	// cells are compared against the ones seen before. Such changes, as well
+	// as cells removed without having had connections, make this a full
+	// update. Dirty cells may have been removed from the module since, so
+	// they are only looked up but never dereferenced unless still alive.
+	pool<Cell*> alive;
+	if (!full && !needs_rebuild) {
+		for (auto cell : module->cells()) {
+			auto it = cell_types.find(cell);
+			if (it == cell_types.end() || it->second != cell->type) {
+				needs_rebuild = true;
+				break;
+			}
+			alive.insert(cell);
+		}
+		for (auto cell : dirty_cells)
+			if (!alive.count(cell))
+				cell_types.erase(cell);
+		if (GetSize(alive) != GetSize(cell_types))
+			needs_rebuild = true;
+	}
+
+	if (full || needs_rebuild || dead_edges > GetSize(edges) / 2) {
+		rebuild();
+		levelize();
+		propagate_arrival({}, true);
+		propagate_required();
+		return;
+	}
+
+	if (dirty_cells.empty())
+		return;
+
+	pool<int> dirty;
+	for (auto cell : dirty_cells) {
+		remove_cell(cell, dirty);
+		if (alive.count(cell))
+			add_cell(cell, dirty);
+	}
+	dirty_cells.clear();
+
+	levelize();
+	propagate_arrival(dirty, false);
+	propagate_required();
+}
+
+std::vector<NldmSta::Path> NldmSta::critical_paths(int count) const
+{
+	std::vector<Path> paths;
+
+	for (auto &check : checks) {
+		if (!check.alive)
+			continue;
+		const Node &data = nodes[check.data];
+		for (int t = 0; t < 2; t++) {
+			if (data.arrival[t] == -INFINITY || check.required[t] == INFINITY)
+				continue;
+			Path path;
+			path.endpoint = data.bit;
+			path.sink = check.cell;
+			path.transition = t;
+			path.arrival = data.arrival[t];
+			path.required = check.required[t];
+			path.slack = path.required - path.arrival;
+			paths.push_back(path);
+		}
+	}
+
+	for (auto &node : nodes) {
+		if (!node.primary_output)
+			continue;
+		for (int t = 0; t < 2; t++) {
+			if (node.arrival[t] == -INFINITY || node.pred_edge[t] < 0)
+				continue;
+			Path path;
+			path.endpoint = node.bit;
+			path.sink = nullptr;
+			path.transition = t;
+			path.arrival = node.arrival[t];
+			path.required = clock_period;
+			path.slack = path.required - path.arrival;
+			paths.push_back(path);
+		}
+	}
+
+	std::stable_sort(paths.begin(), paths.end(), [](const Path &a, const Path &b) { return a.slack < b.slack; });
+
+	// Only keep the worst transition of each endpoint
+	pool<std::pair<Cell*, SigBit>> seen;
+	std::vector<Path> worst;
+	for (auto &path : paths) {
+		if (GetSize(worst) >= count)
+			break;
+		if (seen.insert({path.sink, path.endpoint}).second)
+			worst.push_back(path);
+	}
+	paths.swap(worst);
+
+	for (auto &path : paths) {
+		int n = node_index.at(path.endpoint);
+		int t = path.transition;
+		for (int i = 0; i <= GetSize(nodes); i++) {
+			const Node &node = nodes[n];
+			int e = node.pred_edge[t];
+			PathPoint point;
+			point.bit = node.bit;
+			point.cell = e < 0 ? nullptr : edges[e].cell;
+			point.arc = e < 0 ? nullptr : edges[e].arc;
+			point.transition = t;
+			point.arrival = node.arrival[t];
+			point.slew = node.slew[t];
+			point.load = node.load + (node.primary_output ? output_load : 0);
+			path.points.push_back(point);
+			if (e < 0)
+				break;
+			t = node.pred_transition[t];
+			n = edges[e].from;
+		}
+		std::reverse(path.points.begin(), path.points.end());
+	}
+
+	return paths;
+}
+
+double NldmSta::arrival(SigBit bit, int transition) const
+{
+	auto it = node_index.find(sigmap(bit));
+	return it == node_index.end() ? -INFINITY : nodes[it->second].arrival[transition];
+}
+
+double NldmSta::required(SigBit bit, int transition) const
+{
+	auto it = node_index.find(sigmap(bit));
+	return it == node_index.end() ? INFINITY : nodes[it->second].required[transition];
+}
+
+void NldmSta::notify_connect(RTLIL::Cell *cell, const RTLIL::IdString &, const RTLIL::SigSpec &, const RTLIL::SigSpec &)
+{
+	dirty_cells.insert(cell);
+}
+
+void NldmSta::notify_connect(RTLIL::Module *, const RTLIL::SigSig &)
+{
+	needs_rebuild = true;
+}
+
+void NldmSta::notify_connect(RTLIL::Module *, const std::vector<RTLIL::SigSig> &)
+{
+	needs_rebuild = true;
+}
+
+void NldmSta::notify_blackout(RTLIL::Module *)
+{
+	needs_rebuild = true;
+}
+
+YOSYS_NAMESPACE_END
@@ -0,0 +1,217 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Claire Xenia Wolf <claire@yosyshq.com>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef NLDM_H
+#define NLDM_H
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include "passes/techmap/libparse.h"
+#include <array>
+
+YOSYS_NAMESPACE_BEGIN
+
+// A non-linear delay model (NLDM) lookup table of a liberty file, e.g. a
+// `cell_rise` or `rise_constraint` group.
+struct NldmTable
+{
+	enum Variable {
+		INPUT_TRANSITION,
+		OUTPUT_LOAD,
+		RELATED_TRANSITION,
+		CONSTRAINED_TRANSITION,
+		NUM_VARIABLES
+	};
+
+	Variable variable_1 = INPUT_TRANSITION;
+	Variable variable_2 = OUTPUT_LOAD;
+	std::vector<double> index_1, index_2;
+	// row major, i.e. values[i1 * index_2.size() + i2]
+	std::vector<double> values;
+
+	bool empty() const { return values.empty(); }
+
+	// Bilinear interpolation, extrapolating linearly beyond the table bounds.
+	double lookup(const std::array<double, NUM_VARIABLES> &variables) const;
+};
+
+struct NldmArc
+{
+	enum Sense { POSITIVE_UNATE, NEGATIVE_UNATE, NON_UNATE };
+	enum Kind {
+		COMBINATIONAL,
+		// launching arcs of sequential cells, from the clock pin
+		RISING_EDGE,
+		FALLING_EDGE,
+		// setup checks of sequential cells, related to the clock pin
+		SETUP_RISING,
+		SETUP_FALLING,
+	};
+
+	IdString related_pin, pin;
+	Sense sense = NON_UNATE;
+	Kind kind = COMBINATIONAL;
+	NldmTable cell_rise, cell_fall, rise_transition, fall_transition;
+	NldmTable rise_constraint, fall_constraint;
+
+	bool is_check() const { return kind == SETUP_RISING || kind == SETUP_FALLING; }
+};
+
+struct NldmCell
+{
+	dict<IdString, double> capacitance;
+	std::vector<NldmArc> arcs;
+};
+
+// Timing data of the cells of one or more liberty files. Pin and cell names are
+// stored as escaped IdStrings, so they can be compared against RTLIL directly.
+// Values are kept in the units of the liberty file.
+struct NldmLibrary
+{
+	dict<IdString, NldmCell> cells;
+	std::string time_unit, capacitive_load_unit;
+
+	void add(const LibertyAst *library);
+	const NldmCell *cell(IdString type) const {
+		auto it = cells.find(type);
+		return it == cells.end() ? nullptr : &it->second;
+	}
+};
+
+// Slew and load aware static timing analysis of a single module based on an
+// NldmLibrary. Arrival times are propagated from the primary inputs and from
+// the clock pins of sequential cells, required times from the setup checks of
+// sequential cells and from the primary outputs. Rise and fall transitions are
+// tracked separately. The clock is ideal and arrives at time zero at the
+// primary inputs.
+//
+// The analysis registers itself as a monitor of the module. After changes to
+// cell connections or removed cells, update() only recomputes the delays of
+// the affected arcs and propagates arrival times through the part of the
+// fanout cone where they actually change. Added cells, changed cell types and
+// changes to the module level connections (which affect the SigMap) make the
+// next update() rebuild everything.
+struct NldmSta : RTLIL::Monitor
+{
+	enum { RISE = 0, FALL = 1 };
+
+	struct PathPoint {
+		SigBit bit;
+		Cell *cell; // the cell driving `bit`, nullptr for startpoints
+		const NldmArc *arc;
+		int transition;
+		double arrival, slew, load;
+	};
+
+	struct Path {
+		SigBit endpoint;
+		Cell *sink; // the cell with the setup check, nullptr for primary outputs
+		int transition;
+		double arrival, required, slack;
+		std::vector<PathPoint> points;
+	};
+
+	const NldmLibrary &library;
+	RTLIL::Module *module;
+
+	// All times are relative to the launching clock edge at time zero.
+	double clock_period = 0;
+	// Transition time at the primary inputs and extra load at primary outputs.
+	double input_transition = 0;
+	double output_load = 0;
+
+	NldmSta(const NldmLibrary &library, RTLIL::Module *module);
+	~NldmSta();
+
+	// Brings the timing data up to date with the current netlist.
+	void update(bool full = false);
+
+	// Returns the `count` paths with the worst slack, at most one per endpoint,
+	// after update() has been called.
+	std::vector<Path> critical_paths(int count) const;
+
+	// Returns the latest arrival time at a bit, or -INFINITY if none.
+	double arrival(SigBit bit, int transition) const;
+	double required(SigBit bit, int transition) const;
+
+	pool<IdString> unknown_cell_types;
+	int loop_nodes = 0;
+
+	void notify_connect(RTLIL::Cell *cell, const RTLIL::IdString &port, const RTLIL::SigSpec &old_sig, const RTLIL::SigSpec &sig) override;
+	void notify_connect(RTLIL::Module *module, const RTLIL::SigSig &sigsig) override;
+	void notify_connect(RTLIL::Module *module, const std::vector<RTLIL::SigSig> &sigsig) override;
+	void notify_blackout(RTLIL::Module *module) override;
+
+private:
+	struct Node {
+		SigBit bit;
+		double load = 0;
+		double arrival[2] = {-INFINITY, -INFINITY};
+		double slew[2] = {0, 0};
+		double required[2] = {INFINITY, INFINITY};
+		int pred_edge[2] = {-1, -1};
+		int pred_transition[2] = {-1, -1};
+		bool primary_input = false;
+		bool primary_output = false;
+		int level = 0;
+		std::vector<int> fanin, fanout;
+	};
+
+	struct Edge {
+		Cell *cell;
+		const NldmArc *arc;
+		int from, to;
+		bool alive = true;
+		// delay[from_transition][to_transition], NAN where not applicable
+		double delay[2][2];
+	};
+
+	struct Check {
+		Cell *cell;
+		const NldmArc *arc;
+		int data, clock;
+		bool alive = true;
+		double required[2];
+	};
+
+	SigMap sigmap;
+	std::vector<Node> nodes;
+	dict<SigBit, int> node_index;
+	std::vector<Edge> edges;
+	std::vector<Check> checks;
+	dict<Cell*, std::vector<int>> cell_edges, cell_checks;
+	dict<Cell*, std::vector<std::pair<int, double>>> cell_loads;
+	pool<Cell*> dirty_cells;
+	dict<Cell*, IdString> cell_types;
+	bool needs_rebuild = true;
+	std::vector<int> order;
+
+	int node(SigBit bit);
+	void add_cell(Cell *cell, pool<int> &dirty);
+	void remove_cell(Cell *cell, pool<int> &dirty);
+	void rebuild();
+	void levelize();
+	void compute_node(int n);
+	void propagate_arrival(const pool<int> &dirty, bool all);
+	void propagate_required();
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
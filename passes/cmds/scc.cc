@@ -25,6 +25,7 @@
 #include "kernel/celltypes.h"
 #include "kernel/sigtools.h"
 #include "kernel/log.h"
+#include "kernel/topo_scc.h"
 #include <stdlib.h>
 #include <stdio.h>
 
@@ -38,68 +39,75 @@ struct SccWorker
 	SigMap sigmap;
 	CellTypes ct, specifyCells;
 
-	pool<RTLIL::Cell*> workQueue;
-	dict<RTLIL::Cell*, pool<RTLIL::Cell*>> cellToNextCell;
-	dict<RTLIL::Cell*, RTLIL::SigSpec> cellToPrevSig, cellToNextSig;
+	// the considered cells, numbered in module order, and their cell graph
+	std::vector<RTLIL::Cell*> cells;
+	std::vector<RTLIL::SigSpec> cellToPrevSig, cellToNextSig;
+	FrozenIntGraph graph;
 
-	dict<RTLIL::Cell*, std::pair<int, int>> cellLabels;
-	dict<RTLIL::Cell*, int> cellDepth;
-	pool<RTLIL::Cell*> cellsOnStack;
-	std::vector<RTLIL::Cell*> cellStack;
-	int labelCounter;
+	std::vector<std::vector<int>> sccList;
 
-	dict<RTLIL::Cell*, int> cell2scc;
-	std::vector<pool<RTLIL::Cell*>> sccList;
-
-	void run(RTLIL::Cell *cell, int depth, int maxDepth)
+	// An iterative version of Tarjan's algorithm in which the lowlink of a
+	// cell is only updated from back edges spanning less than `maxDepth`
+	// cells of the DFS tree. This finds components made of short loops, which
+	// do not need to be SCCs of the graph.
+	void findShortLoops(int maxDepth, std::vector<std::vector<int>> &components)
 	{
-		log_assert(workQueue.count(cell) > 0);
-
-		workQueue.erase(cell);
-		cellLabels[cell] = std::pair<int, int>(labelCounter, labelCounter);
-		labelCounter++;
-
-		cellsOnStack.insert(cell);
-		cellStack.push_back(cell);
+		int numCells = graph.num_nodes();
+		std::vector<int> label(numCells, -1), lowlink(numCells), depth(numCells);
+		std::vector<bool> onStack(numCells);
+		std::vector<int> cellStack;
+		std::vector<std::pair<int, FrozenIntGraph::successor_enumerator>> dfsStack;
+		int labelCounter = 0;
+
+		auto enter = [&](int cell, int cellDepth) {
+			label[cell] = lowlink[cell] = labelCounter++;
+			depth[cell] = cellDepth;
+			onStack[cell] = true;
+			cellStack.push_back(cell);
+			dfsStack.emplace_back(cell, graph.enumerate_successors(cell));
+		};
+
+		for (int root = 0; root < numCells; root++)
+		{
+			if (label[root] >= 0)
+				continue;
 
-		if (maxDepth >= 0)
-			cellDepth[cell] = depth;
+			enter(root, 0);
+			while (!dfsStack.empty())
+			{
+				int cell = dfsStack.back().first;
+				auto &successors = dfsStack.back().second;
+
+				if (!successors.finished()) {
+					int nextCell = successors.next();
+					if (label[nextCell] < 0)
+						enter(nextCell, depth[cell] + 1);
+					else if (onStack[nextCell] && depth[nextCell] + maxDepth > depth[cell])
+						lowlink[cell] = min(lowlink[cell], lowlink[nextCell]);
+					continue;
+				}
 
-		for (auto nextCell : cellToNextCell[cell])
-			if (cellLabels.count(nextCell) == 0) {
-				run(nextCell, depth+1, maxDepth);
-				cellLabels[cell].second = min(cellLabels[cell].second, cellLabels[nextCell].second);
-			} else
-			if (cellsOnStack.count(nextCell) > 0 && (maxDepth < 0 || cellDepth[nextCell] + maxDepth > depth)) {
-					cellLabels[cell].second = min(cellLabels[cell].second, cellLabels[nextCell].second);
-			}
+				dfsStack.pop_back();
+				if (!dfsStack.empty()) {
+					int parent = dfsStack.back().first;
+					lowlink[parent] = min(lowlink[parent], lowlink[cell]);
+				}
 
-		if (cellLabels[cell].first == cellLabels[cell].second)
-		{
-			if (cellStack.back() == cell)
-			{
-				cellStack.pop_back();
-				cellsOnStack.erase(cell);
-			}
-			else
-			{
-				log("Found an SCC:");
-				pool<RTLIL::Cell*> scc;
-				while (cellsOnStack.count(cell) > 0) {
-					RTLIL::Cell *c = cellStack.back();
-					cellStack.pop_back();
-					cellsOnStack.erase(c);
-					log(" %s", RTLIL::id2cstr(c->name));
-					cell2scc[c] = sccList.size();
-					scc.insert(c);
+				if (label[cell] == lowlink[cell]) {
+					std::vector<int> component;
+					while (onStack[cell]) {
+						int c = cellStack.back();
+						cellStack.pop_back();
+						onStack[c] = false;
+						component.push_back(c);
+					}
+					components.push_back(std::move(component));
 				}
-				sccList.push_back(scc);
-				log("\n");
 			}
 		}
 	}
 
-	SccWorker(RTLIL::Design *design, RTLIL::Module *module, bool nofeedbackMode, bool allCellTypes, bool specifyMode, int maxDepth) :
+	SccWorker(RTLIL::Design *design, RTLIL::Module *module, bool nofeedbackMode, bool allCellTypes, bool specifyMode, int maxDepth, int threads) :
 			design(design), module(module), sigmap(module)
 	{
 		if (module->processes.size() > 0) {
@@ -127,7 +135,8 @@ struct SccWorker
 		}
 
 		SigPool selectedSignals;
-		SigSet<RTLIL::Cell*> sigToNextCells;
+		idict<RTLIL::SigBit> sigIds;
+		std::vector<std::pair<int, int>> sigToNextCell;
 
 		for (auto &it : module->wires_)
 			if (design->selected(module, it.second))
@@ -143,7 +152,8 @@ struct SccWorker
 			if (!allCellTypes && !ct.cell_known(cell->type) && !specifyCells.cell_known(cell->type))
 				continue;
 
-			workQueue.insert(cell);
+			int cellId = GetSize(cells);
+			cells.push_back(cell);
 
 			RTLIL::SigSpec inputSignals, outputSignals;
 
@@ -191,36 +201,51 @@ struct SccWorker
 			inputSignals.sort_and_unify();
 			outputSignals.sort_and_unify();
 
-			cellToPrevSig[cell] = inputSignals;
-			cellToNextSig[cell] = outputSignals;
-			sigToNextCells.insert(inputSignals, cell);
+			for (auto bit : inputSignals)
+				sigToNextCell.emplace_back(sigIds(bit), cellId);
+			cellToPrevSig.push_back(inputSignals);
+			cellToNextSig.push_back(outputSignals);
 		}
 
-		for (auto cell : workQueue)
-		{
-			sigToNextCells.find(cellToNextSig[cell], cellToNextCell[cell]);
-
-			if (!nofeedbackMode && cellToNextCell[cell].count(cell)) {
-				log("Found an SCC:");
-				pool<RTLIL::Cell*> scc;
-				log(" %s", RTLIL::id2cstr(cell->name));
-				cell2scc[cell] = sccList.size();
-				scc.insert(cell);
-				sccList.push_back(scc);
-				log("\n");
+		std::sort(sigToNextCell.begin(), sigToNextCell.end());
+
+		std::vector<std::pair<int, int>> edges;
+		for (int cellId = 0; cellId < GetSize(cells); cellId++)
+			for (auto bit : cellToNextSig[cellId]) {
+				int sigId = sigIds.at(bit, -1);
+				if (sigId < 0)
+					continue;
+				auto it = std::lower_bound(sigToNextCell.begin(), sigToNextCell.end(), std::make_pair(sigId, 0));
+				for (; it != sigToNextCell.end() && it->first == sigId; ++it)
+					edges.emplace_back(cellId, it->second);
 			}
-		}
+		graph = FrozenIntGraph(GetSize(cells), edges);
 
-		labelCounter = 0;
-		cellLabels.clear();
+		std::vector<std::vector<int>> components;
+		if (maxDepth >= 0) {
+			findShortLoops(maxDepth, components);
+		} else {
+			std::vector<int> component;
+			components.resize(find_sccs(graph, component, threads));
+			for (int cellId = 0; cellId < GetSize(cells); cellId++)
+				components[component[cellId]].push_back(cellId);
+		}
 
-		while (!workQueue.empty())
-		{
-			RTLIL::Cell *cell = *workQueue.begin();
-			log_assert(cellStack.size() == 0);
-			cellDepth.clear();
+		// Single cells only count as an SCC when they feed back into
+		// themselves.
+		for (auto &component : components) {
+			if (GetSize(component) == 1 && (nofeedbackMode || !graph.has_edge(component[0], component[0])))
+				continue;
+			std::sort(component.begin(), component.end());
+			sccList.push_back(std::move(component));
+		}
+		std::sort(sccList.begin(), sccList.end());
 
-			run(cell, 0, maxDepth);
+		for (auto &scc : sccList) {
+			log("Found an SCC:");
+			for (int cellId : scc)
+				log(" %s", RTLIL::id2cstr(cells[cellId]->name));
+			log("\n");
 		}
 
 		log("Found %d SCCs in module %s.\n", int(sccList.size()), RTLIL::id2cstr(module->name));
@@ -230,13 +255,12 @@ struct SccWorker
 	{
 		for (int i = 0; i < int(sccList.size()); i++)
 		{
-			pool<RTLIL::Cell*> &cells = sccList[i];
 			RTLIL::SigSpec prevsig, nextsig, sig;
 
-			for (auto cell : cells) {
-				sel.selected_members[module->name].insert(cell->name);
-				prevsig.append(cellToPrevSig[cell]);
-				nextsig.append(cellToNextSig[cell]);
+			for (int cellId : sccList[i]) {
+				sel.selected_members[module->name].insert(cells[cellId]->name);
+				prevsig.append(cellToPrevSig[cellId]);
+				nextsig.append(cellToNextSig[cellId]);
 			}
 
 			prevsig.sort_and_unify();
@@ -291,6 +315,12 @@ struct SccPass : public Pass {
 		log("    -specify\n");
 		log("        examine specify rules to detect logic loops in whitebox/blackbox cells\n");
 		log("\n");
+		log("    -j <threads>\n");
+		log("        split the cell graphs of large modules into parts that are searched\n");
+		log("        for SCCs using the given number of threads (0 for one per hardware\n");
+		log("        thread). The result is the same for any number of threads. This has\n");
+		log("        no effect with -max_depth. default: 1\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
@@ -301,6 +331,7 @@ struct SccPass : public Pass {
 		bool specifyMode = false;
 		int maxDepth = -1;
 		int expect = -1;
+		int threads = 1;
 
 		log_header(design, "Executing SCC pass (detecting logic loops).\n");
 
@@ -335,6 +366,10 @@ struct SccPass : public Pass {
 				specifyMode = true;
 				continue;
 			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				threads = atoi(args[++argidx].c_str());
+				continue;
+			}
 			break;
 		}
 		int origSelectPos = design->selection_stack.size() - 1;
@@ -345,7 +380,7 @@ struct SccPass : public Pass {
 
 		for (auto mod : design->selected_modules())
 		{
-			SccWorker worker(design, mod, nofeedbackMode, allCellTypes, specifyMode, maxDepth);
+			SccWorker worker(design, mod, nofeedbackMode, allCellTypes, specifyMode, maxDepth, threads);
 
 			if (!setAttr.empty())
 			{
@@ -362,8 +397,8 @@ struct SccPass : public Pass {
 
 						Const attr_value(attr_valstr);
 
-						for (auto cell : cells)
-							cell->attributes[attr_name] = attr_value;
+						for (int cellId : cells)
+							worker.cells[cellId]->attributes[attr_name] = attr_value;
 					}
 
 					scc_counter++;
@@ -21,6 +21,8 @@
 #include "kernel/yosys.h"
 #include "kernel/sigtools.h"
 #include "kernel/timinginfo.h"
+#include "kernel/gzip.h"
+#include "passes/cmds/nldm.h"
 #include <deque>
 
 USING_YOSYS_NAMESPACE
@@ -273,6 +275,53 @@ struct StaWorker
 	}
 };
 
+static void report_nldm(const NldmLibrary &library, Module *module, double period, double input_transition, double output_load, int num_paths)
+{
+	NldmSta sta(library, module);
+	sta.clock_period = period;
+	sta.input_transition = input_transition;
+	sta.output_load = output_load;
+	sta.update();
+
+	for (auto type : sta.unknown_cell_types)
+		log_warning("Cell type '%s' not found in liberty files! Ignoring.\n", log_id(type));
+	if (sta.loop_nodes > 0)
+		log_warning("Module '%s' contains combinational loops, ignoring %d nets on or behind loops.\n", log_id(module), sta.loop_nodes);
+
+	std::vector<NldmSta::Path> paths = sta.critical_paths(num_paths);
+	if (paths.empty()) {
+		log("No timing paths found.\n");
+		return;
+	}
+
+	const char *transition_str[2] = {"rise", "fall"};
+	for (int i = 0; i < GetSize(paths); i++)
+	{
+		auto &path = paths[i];
+		log("\nPath %d in '%s' with slack %.4f%s:\n", i+1, log_id(module), path.slack, library.time_unit.empty() ? "" : stringf(" (times in %s)", library.time_unit.c_str()).c_str());
+		log("  %10s %10s %10s %10s  %s\n", "arrival", "delay", "slew", "load", "point");
+
+		double prev_arrival = 0;
+		for (auto &point : path.points) {
+			std::string desc;
+			if (point.cell)
+				desc = stringf("%s (%s.%s->%s)", log_id(point.cell), log_id(point.cell->type), log_id(point.arc->related_pin), log_id(point.arc->pin));
+			else
+				desc = "<primary input>";
+			log("  %10.4f %10.4f %10.4f %10.4f  %s %s %s\n", point.arrival, point.arrival - prev_arrival, point.slew, point.load,
+					log_signal(point.bit), transition_str[point.transition], desc.c_str());
+			prev_arrival = point.arrival;
+		}
+
+		if (path.sink)
+			log("  %10.4f  data required time at %s (%s)\n", path.required, log_id(path.sink), log_id(path.sink->type));
+		else
+			log("  %10.4f  data required time at %s (<primary output>)\n", path.required, log_signal(path.endpoint));
+		log("  %10.4f  data arrival time\n", path.arrival);
+		log("  %10.4f  slack%s\n", path.slack, path.slack < 0 ? " (VIOLATED)" : "");
+	}
+}
+
 struct StaPass : public Pass {
 	StaPass() : Pass("sta", "perform static timing analysis") { }
 	void help() override
@@ -284,28 +333,84 @@ struct StaPass : public Pass {
 		log("This command performs static timing analysis on the design. (Only considers\n");
 		log("paths within a single module, so the design must be flattened.)\n");
 		log("\n");
+		log("Without -liberty, integer delays are taken from the specify blocks of the\n");
+		log("black- and white-box cell modules (see 'abc9').\n");
+		log("\n");
+		log("    -liberty <file>\n");
+		log("        use the NLDM delay, transition and constraint tables and the pin\n");
+		log("        capacitances of the given liberty file(s) instead. Arrival times are\n");
+		log("        load and slew aware and tracked separately for rising and falling\n");
+		log("        transitions. This option can be used multiple times.\n");
+		log("\n");
+		log("    -period <time>\n");
+		log("        clock period used for the required times at setup checks and primary\n");
+		log("        outputs, in the time unit of the liberty file. (default: 0)\n");
+		log("\n");
+		log("    -input_transition <time>\n");
+		log("        transition time at the primary inputs. (default: 0)\n");
+		log("\n");
+		log("    -output_load <cap>\n");
+		log("        additional load at the primary outputs, in the capacitive load unit\n");
+		log("        of the liberty file. (default: 0)\n");
+		log("\n");
+		log("    -paths <n>\n");
+		log("        report the <n> paths with the worst slack. (default: 1)\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
 		log_header(design, "Executing STA pass (static timing analysis).\n");
 
-		/*
+		std::vector<std::string> liberty_files;
+		double period = 0, input_transition = 0, output_load = 0;
+		int num_paths = 1;
+
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++) {
-			if (args[argidx] == "-TODO") {
+			if (args[argidx] == "-liberty" && argidx+1 < args.size()) {
+				liberty_files.push_back(args[++argidx]);
+				continue;
+			}
+			if (args[argidx] == "-period" && argidx+1 < args.size()) {
+				period = atof(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-input_transition" && argidx+1 < args.size()) {
+				input_transition = atof(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-output_load" && argidx+1 < args.size()) {
+				output_load = atof(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-paths" && argidx+1 < args.size()) {
+				num_paths = atoi(args[++argidx].c_str());
 				continue;
 			}
 			break;
 		}
-		*/
-
-		extra_args(args, 1, design);
+		extra_args(args, argidx, design);
+
+		NldmLibrary library;
+		for (auto path : liberty_files) {
+			std::istream* f = uncompressed(path);
+			if (f->fail())
+				log_cmd_error("Can't open liberty file `%s': %s\n", path.c_str(), strerror(errno));
+			LibertyParser p(*f, path);
+			library.add(p.ast);
+			delete f;
+		}
 
 		for (Module *module : design->selected_modules())
 		{
 			if (module->has_processes_warn())
 				continue;
 
+			if (!liberty_files.empty()) {
+				report_nldm(library, module, period, input_transition, output_load, num_paths);
+				continue;
+			}
+
 			StaWorker worker(module);
 			worker.run();
 		}
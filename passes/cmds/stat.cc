@@ -281,6 +281,20 @@ struct statdata_t
 		}
 	}
 
+	json11::Json::object json_record() const
+	{
+		json11::Json::object record;
+	#define X(_name) record[#_name] = double(_name);
+		STAT_NUMERIC_MEMBERS
+	#undef X
+		json11::Json::object cells_by_type;
+		for (auto &it : num_cells_by_type)
+			if (it.second)
+				cells_by_type[log_id(it.first)] = double(it.second);
+		record["num_cells_by_type"] = cells_by_type;
+		return record;
+	}
+
 	void log_data_json(const char *mod_name, bool first_module)
 	{
 		if (!first_module)
@@ -346,13 +360,115 @@ statdata_t hierarchy_worker(std::map<RTLIL::IdString, statdata_t> &mod_stat, RTL
 	return mod_data;
 }
 
+// Keeps the statistics of wholly selected modules between stat calls. Cell
+// types and wires can be changed in place without notifying monitors, so an
+// entry is only reused while a fingerprint of everything statdata_t counts
+// still matches. The fingerprint only mixes integers, which is much cheaper
+// than counting the cells by type name. It does not depend on the identity
+// of the objects: modules with the same fingerprint have the same statistics.
+struct StatCache
+{
+	struct entry_t {
+		uint64_t fingerprint;
+		statdata_t data;
+	};
+
+	// the design the entries were taken in
+	Hasher::hash_t design_hashidx = 0;
+	dict<Module*, entry_t> entries;
+
+	static uint64_t mix(uint64_t state, uint64_t value)
+	{
+		// the finalizer of splitmix64
+		uint64_t z = state ^ (value + 0x9e3779b97f4a7c15ULL + (state << 6) + (state >> 2));
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	static uint64_t options_key(bool width_mode, const dict<IdString, cell_area_t> &cell_area)
+	{
+		uint64_t sum = mix(0, width_mode);
+		for (auto &it : cell_area) {
+			uint64_t area_bits;
+			memcpy(&area_bits, &it.second.area, sizeof(area_bits));
+			sum += mix(mix(mix(1, it.first.index_), area_bits), it.second.is_sequential);
+		}
+		return sum;
+	}
+
+	// Objects are combined by addition, so that the result does not depend on
+	// their order. Port widths only matter for -width.
+	static uint64_t fingerprint(Module *module, bool width_mode, uint64_t options)
+	{
+		uint64_t sum = mix(options, GetSize(module->processes));
+
+		for (auto &it : module->wires_) {
+			Wire *wire = it.second;
+			int flags = wire->port_input + 2 * wire->port_output + 4 * wire->name.isPublic();
+			sum += mix(mix(2, wire->width), flags);
+		}
+
+		for (auto &it : module->memories)
+			sum += mix(mix(3, it.second->width), it.second->size);
+
+		for (auto &it : module->cells_) {
+			Cell *cell = it.second;
+			uint64_t h = mix(4, cell->type.index_);
+			if (width_mode)
+				for (auto &conn : cell->connections())
+					h = mix(mix(h, conn.first.index_), GetSize(conn.second));
+			sum += h;
+		}
+
+		return sum;
+	}
+
+	void start(Design *design)
+	{
+		if (design->hashidx_ != design_hashidx) {
+			entries.clear();
+			design_hashidx = design->hashidx_;
+		}
+	}
+};
+
+StatCache stat_cache;
+
+// The cell areas extracted from the ASTs held by LibertyAstCache, so that
+// cached liberty files are neither opened nor walked again.
+struct LibertyAreaTable {
+	std::weak_ptr<const LibertyAst> ast;
+	dict<IdString, cell_area_t> cell_area;
+};
+
+dict<std::string, LibertyAreaTable> liberty_area_tables;
+
 void read_liberty_cellarea(dict<IdString, cell_area_t> &cell_area, string liberty_file)
 {
-	std::istream* f = uncompressed(liberty_file.c_str());
 	yosys_input_files.insert(liberty_file);
-	LibertyParser libparser(*f, liberty_file);
+
+	auto &cache = LibertyAstCache::instance;
+	auto cached_it = cache.cached.find(liberty_file);
+	auto table_it = liberty_area_tables.find(liberty_file);
+	if (cached_it != cache.cached.end() && table_it != liberty_area_tables.end() &&
+			table_it->second.ast.lock() == cached_it->second) {
+		if (cache.verbose)
+			log("Using cached cell areas for liberty file `%s'\n", liberty_file.c_str());
+		for (auto &it : table_it->second.cell_area)
+			cell_area[it.first] = it.second;
+		return;
+	}
+
+	LibertyParserOptions options;
+	options.cells_only = true;
+	options.cell_attributes = {"area", "ff"};
+
+	std::istream* f = uncompressed(liberty_file.c_str());
+	LibertyParser libparser(*f, liberty_file, options);
 	delete f;
 
+	LibertyAreaTable table;
 	for (auto cell : libparser.ast->children)
 	{
 		if (cell->id != "cell" || cell->args.size() != 1)
@@ -361,7 +477,17 @@ void read_liberty_cellarea(dict<IdString, cell_area_t> &cell_area, string libert
 		const LibertyAst *ar = cell->find("area");
 		bool is_flip_flop = cell->find("ff") != nullptr;
 		if (ar != nullptr && !ar->value.empty())
-			cell_area["\\" + cell->args[0]] = {/*area=*/atof(ar->value.c_str()), is_flip_flop};
+			table.cell_area["\\" + cell->args[0]] = {/*area=*/atof(ar->value.c_str()), is_flip_flop};
+	}
+
+	for (auto &it : table.cell_area)
+		cell_area[it.first] = it.second;
+
+	if (cache.cached.count(liberty_file)) {
+		table.ast = libparser.shared_ast;
+		liberty_area_tables[liberty_file] = std::move(table);
+	} else {
+		liberty_area_tables.erase(liberty_file);
 	}
 }
 
@@ -396,6 +522,18 @@ struct StatPass : public Pass {
 		log("        output the statistics in a machine-readable JSON format.\n");
 		log("        this is output to the console; use \"tee\" to output to a file.\n");
 		log("\n");
+		log("    -timeseries <file>\n");
+		log("        append the statistics as one line of JSON to the given file, together\n");
+		log("        with the checkpoint name and the CPU time used so far. this can be\n");
+		log("        used to track the statistics over the course of a script.\n");
+		log("\n");
+		log("    -checkpoint <name>\n");
+		log("        the checkpoint name used for -timeseries.\n");
+		log("\n");
+		log("The statistics of fully selected modules are kept between calls and are only\n");
+		log("recomputed for modules that changed since. Cell areas read from liberty files\n");
+		log("are kept as long as the files are cached (see 'help libcache').\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
@@ -403,7 +541,7 @@ struct StatPass : public Pass {
 		RTLIL::Module *top_mod = nullptr;
 		std::map<RTLIL::IdString, statdata_t> mod_stat;
 		dict<IdString, cell_area_t> cell_area;
-		string techname;
+		string techname, timeseries_file, checkpoint;
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++)
@@ -432,6 +570,15 @@ struct StatPass : public Pass {
 				json_mode = true;
 				continue;
 			}
+			if (args[argidx] == "-timeseries" && argidx+1 < args.size()) {
+				timeseries_file = args[++argidx];
+				rewrite_filename(timeseries_file);
+				continue;
+			}
+			if (args[argidx] == "-checkpoint" && argidx+1 < args.size()) {
+				checkpoint = args[++argidx];
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -451,6 +598,10 @@ struct StatPass : public Pass {
 			log("   \"modules\": {\n");
 		}
 
+		stat_cache.start(design);
+		uint64_t options = StatCache::options_key(width_mode, cell_area);
+		dict<Module*, StatCache::entry_t> cache_entries;
+
 		bool first_module = true;
 		for (auto mod : design->selected_modules())
 		{
@@ -458,7 +609,20 @@ struct StatPass : public Pass {
 				if (mod->get_bool_attribute(ID::top))
 					top_mod = mod;
 
-			statdata_t data(design, mod, width_mode, cell_area, techname);
+			statdata_t data;
+			if (mod->is_selected_whole()) {
+				uint64_t fingerprint = StatCache::fingerprint(mod, width_mode, options);
+				auto it = stat_cache.entries.find(mod);
+				if (it != stat_cache.entries.end() && it->second.fingerprint == fingerprint) {
+					if (!json_mode)
+						log_debug("Using cached statistics for module %s.\n", log_id(mod));
+					data = it->second.data;
+					data.tech = techname;
+				} else
+					data = statdata_t(design, mod, width_mode, cell_area, techname);
+				cache_entries[mod] = {fingerprint, data};
+			} else
+				data = statdata_t(design, mod, width_mode, cell_area, techname);
 			mod_stat[mod->name] = data;
 
 			if (json_mode) {
@@ -472,11 +636,19 @@ struct StatPass : public Pass {
 			}
 		}
 
+		// only keep the modules of this call, so that deleted ones are dropped
+		stat_cache.entries.swap(cache_entries);
+
 		if (json_mode) {
 			log("\n");
 			log(top_mod == nullptr ? "   }\n" : "   },\n");
 		}
 
+		statdata_t design_data;
+		if (top_mod == nullptr)
+			for (auto &it : mod_stat)
+				design_data = design_data + it.second;
+
 		if (top_mod != nullptr)
 		{
 			if (!json_mode && GetSize(mod_stat) > 1) {
@@ -487,6 +659,7 @@ struct StatPass : public Pass {
 			}
 
 			statdata_t data = hierarchy_worker(mod_stat, top_mod->name, 0, /*quiet=*/json_mode);
+			design_data = data;
 
 			if (json_mode)
 				data.log_data_json("design", true);
@@ -513,6 +686,26 @@ struct StatPass : public Pass {
 			log("}\n");
 		}
 
+		if (!timeseries_file.empty())
+		{
+			json11::Json::object modules;
+			for (auto &it : mod_stat)
+				modules[log_id(it.first)] = it.second.json_record();
+
+			json11::Json::object record;
+			record["checkpoint"] = checkpoint;
+			record["cpu_time"] = PerformanceTimer::query() * 1e-9;
+			record["top"] = top_mod != nullptr ? json11::Json(log_id(top_mod)) : json11::Json();
+			record["design"] = design_data.json_record();
+			record["modules"] = modules;
+
+			FILE *f = fopen(timeseries_file.c_str(), "a");
+			if (f == nullptr)
+				log_cmd_error("Can't open file `%s' for writing: %s\n", timeseries_file.c_str(), strerror(errno));
+			fprintf(f, "%s\n", json11::Json(record).dump().c_str());
+			fclose(f);
+		}
+
 		log("\n");
 	}
 } StatPass;
@@ -20,15 +20,14 @@
 #include "kernel/sigtools.h"
 #include "kernel/register.h"
 #include "kernel/cellaigs.h"
-#include "kernel/utils.h"
 #include "kernel/ff.h"
 #include "kernel/mem.h"
+#include "kernel/threading.h"
 
 #include <assert.h>
 #include <limits>
 
 USING_YOSYS_NAMESPACE
-template<> struct Yosys::hashlib::hash_ops<AigNode *> : Yosys::hashlib::hash_ptr_ops {};
 
 PRIVATE_NAMESPACE_BEGIN
 
@@ -48,6 +47,7 @@ struct EstimateSta {
 	std::vector<std::pair<Cell *, SigBit>> samplers;
 	bool all_paths = false;
 	bool select = false;
+	int threads = 1;
 
 	void add_seq(Cell *cell, SigSpec launch, SigSpec sample)
 	{
@@ -151,95 +151,184 @@ struct EstimateSta {
 			}
 		}
 
-		// now we toposort the combinational logic
-
-		// each toposort node is either a SigBit or a pair of Cell * / AigNode *
-		TopoSort<std::tuple<SigBit, Cell *, AigNode *>> topo;
-
-		auto desc_aig = [&](Cell *cell, AigNode &node) {
-			return std::make_tuple(RTLIL::S0, cell, &node);
-		};
-		auto desc_sig = [&](SigBit bit) {
-			return std::make_tuple(sigmap(bit), (Cell *) NULL, (AigNode *) NULL);
+		// now we freeze the combinational logic into a graph in compressed sparse
+		// row form. nodes [0, num_aig) are the AIG nodes of all cells, followed by
+		// one node per (sigmapped) bit which is connected to any of them
+		std::vector<int> aig_base(combinational.size() + 1);
+		std::vector<Aig *> aig_of(combinational.size());
+		std::vector<int> factors(combinational.size());
+		for (int i = 0; i < GetSize(combinational); i++) {
+			Cell *cell = combinational[i];
+			aig_of[i] = cell_aigs.at(cell);
+			aig_base[i + 1] = aig_base[i] + GetSize(aig_of[i]->nodes);
+			factors[i] = cell_type_factor(cell->type);
+		}
+		int num_aig = aig_base.back();
+
+		dict<SigBit, int> bit_nodes;
+		std::vector<SigBit> node_bits;
+		auto bit_node = [&](SigBit bit) {
+			bit = sigmap(bit);
+			auto it = bit_nodes.find(bit);
+			if (it != bit_nodes.end())
+				return it->second;
+			int n = num_aig + GetSize(node_bits);
+			bit_nodes[bit] = n;
+			node_bits.push_back(bit);
+			return n;
 		};
 
-		// collect edges of the AIG graph
-		for (auto cell : combinational) {
-			assert(cell_aigs.count(cell));
-			Aig &aig = *cell_aigs.at(cell);
-			for (auto &node : aig.nodes) {
+		// collect edges of the AIG graph as (to, from) pairs
+		std::vector<std::pair<int, int>> edges;
+		std::vector<int> node_cell(num_aig);
+		for (int i = 0; i < GetSize(combinational); i++) {
+			Cell *cell = combinational[i];
+			Aig &aig = *aig_of[i];
+			int base = aig_base[i];
+			for (int j = 0; j < GetSize(aig.nodes); j++) {
+				auto &node = aig.nodes[j];
+				node_cell[base + j] = i;
 				if (!node.portname.empty()) {
-					topo.edge(
-						desc_sig(cell->getPort(node.portname)[node.portbit]),
-						desc_aig(cell, node)
-					);
+					edges.emplace_back(base + j, bit_node(cell->getPort(node.portname)[node.portbit]));
 				} else if (node.left_parent < 0 && node.right_parent < 0) {
 					// constant, nothing to do
 				} else {
-					topo.edge(
-						desc_aig(cell, aig.nodes[node.left_parent]),
-						desc_aig(cell, node)
-					);
-					topo.edge(
-						desc_aig(cell, aig.nodes[node.right_parent]),
-						desc_aig(cell, node)
-					);
+					edges.emplace_back(base + j, base + node.left_parent);
+					edges.emplace_back(base + j, base + node.right_parent);
 				}
 
-				for (auto &oport : node.outports) {
-					topo.edge(
-						desc_aig(cell, node),
-						desc_sig(cell->getPort(oport.first)[oport.second])
-					);
+				for (auto &oport : node.outports)
+					edges.emplace_back(bit_node(cell->getPort(oport.first)[oport.second]), base + j);
+			}
+		}
+
+		int num_nodes = num_aig + GetSize(node_bits);
+		std::vector<int> fanin_start(num_nodes + 1), fanout_start(num_nodes + 1);
+		for (auto &edge : edges) {
+			fanin_start[edge.first + 1]++;
+			fanout_start[edge.second + 1]++;
+		}
+		for (int n = 0; n < num_nodes; n++) {
+			fanin_start[n + 1] += fanin_start[n];
+			fanout_start[n + 1] += fanout_start[n];
+		}
+		std::vector<int> fanin(edges.size()), fanout(edges.size());
+		{
+			std::vector<int> fanin_pos(fanin_start.begin(), fanin_start.end() - 1);
+			std::vector<int> fanout_pos(fanout_start.begin(), fanout_start.end() - 1);
+			for (auto &edge : edges) {
+				fanin[fanin_pos[edge.first]++] = edge.second;
+				fanout[fanout_pos[edge.second]++] = edge.first;
+			}
+		}
+		edges.clear();
+		edges.shrink_to_fit();
+
+		// levelize the graph, the nodes of one level only depend on lower levels
+		std::vector<int> order, node_level(num_nodes);
+		{
+			std::vector<int> pending(num_nodes);
+			order.reserve(num_nodes);
+			for (int n = 0; n < num_nodes; n++) {
+				pending[n] = fanin_start[n + 1] - fanin_start[n];
+				if (pending[n] == 0)
+					order.push_back(n);
+			}
+			for (int i = 0; i < GetSize(order); i++) {
+				int n = order[i];
+				for (int k = fanout_start[n]; k < fanout_start[n + 1]; k++) {
+					int succ = fanout[k];
+					node_level[succ] = std::max(node_level[succ], node_level[n] + 1);
+					if (--pending[succ] == 0)
+						order.push_back(succ);
 				}
 			}
 		}
 
-		if (!topo.sort())
+		if (GetSize(order) != num_nodes)
 			log_error("Module '%s' contains combinational loops", log_id(m));
-		
+
+		int num_levels = 0;
+		for (int n = 0; n < num_nodes; n++)
+			num_levels = std::max(num_levels, node_level[n] + 1);
+		std::vector<int> level_start(num_levels + 1), sorted(num_nodes);
+		for (int n = 0; n < num_nodes; n++)
+			level_start[node_level[n] + 1]++;
+		for (int l = 0; l < num_levels; l++)
+			level_start[l + 1] += level_start[l];
+		{
+			std::vector<int> level_pos(level_start.begin(), level_start.end() - 1);
+			for (int n : order)
+				sorted[level_pos[node_level[n]]++] = n;
+		}
+		order.clear();
+		order.shrink_to_fit();
+
 		// now we determine how long it takes for signals to stabilize
-		
-		// `levels` records the time after a clock edge after which a signal is stable
-		dict<std::tuple<SigBit, Cell *, AigNode *>, arrivalint> levels;
 
-		for (auto node : topo.sorted)
-			levels[node] = INF_PAST;
+		// `levels` records the time after a clock edge after which a signal is stable
+		std::vector<arrivalint> levels(num_nodes, INF_PAST);
 
 		// launch points are at 0 by definition
+		std::vector<char> launched(num_nodes);
 		for (auto pair : launchers)
-			levels[desc_sig(pair.second)] = 0;
-
-		for (auto node : topo.sorted) {
-			AigNode *aig_node = std::get<2>(node);
-			if (aig_node) {
-				Cell *cell = std::get<1>(node);
-				Aig &aig = *cell_aigs.at(cell);
-				if (!aig_node->portname.empty()) {
-					// for a cell port, copy `levels` value from port bit
-					SigBit bit = cell->getPort(aig_node->portname)[aig_node->portbit];
-					levels[node] = levels[desc_sig(bit)];
-				} else if (aig_node->left_parent < 0 && aig_node->right_parent < 0) {
-					// constant, nothing to do
-				} else {
-					// for each AIG node, find maximum of parents and add a cell-specific delay
-					int left = levels[desc_aig(cell, aig.nodes[aig_node->left_parent])];
-					int right = levels[desc_aig(cell, aig.nodes[aig_node->right_parent])];
-					levels[node] = (std::max(left, right) + cell_type_factor(cell->type));
-				}
+			if (bit_nodes.count(pair.second))
+				launched[bit_nodes.at(pair.second)] = true;
 
-				// copy `levels` value to any output ports
-				for (auto &oport : aig_node->outports) {
-					levels[desc_sig(cell->getPort(oport.first)[oport.second])] = levels[node];
-				}
+		auto aig_node = [&](int n) -> AigNode & {
+			return aig_of[node_cell[n]]->nodes[n - aig_base[node_cell[n]]];
+		};
+
+		auto compute = [&](int n) -> arrivalint {
+			if (n >= num_aig) {
+				// a bit takes the value of its driver, if it has one
+				if (fanin_start[n] == fanin_start[n + 1])
+					return launched[n] ? 0 : INF_PAST;
+				arrivalint value = INF_PAST;
+				for (int k = fanin_start[n]; k < fanin_start[n + 1]; k++)
+					value = std::max(value, levels[fanin[k]]);
+				return value;
+			}
+			AigNode &node = aig_node(n);
+			if (!node.portname.empty()) {
+				// for a cell port, copy `levels` value from port bit
+				return levels[fanin[fanin_start[n]]];
+			} else if (node.left_parent < 0 && node.right_parent < 0) {
+				// constant, nothing to do
+				return INF_PAST;
+			} else {
+				// for each AIG node, find maximum of parents and add a cell-specific delay
+				int base = aig_base[node_cell[n]];
+				int left = levels[base + node.left_parent];
+				int right = levels[base + node.right_parent];
+				return std::max(left, right) + factors[node_cell[n]];
 			}
+		};
+
+		// the nodes of a level are computed in parallel, in chunks large enough
+		// to amortize the scheduling overhead
+		const int chunk_size = 4096;
+		for (int l = 0; l < num_levels; l++) {
+			int begin = level_start[l], end = level_start[l + 1];
+			int num_chunks = (end - begin + chunk_size - 1) / chunk_size;
+			parallel_for(num_chunks > 1 ? threads : 1, num_chunks, [&](size_t chunk) {
+				int chunk_end = std::min<int>(end, begin + (chunk + 1) * chunk_size);
+				for (int i = begin + chunk * chunk_size; i < chunk_end; i++)
+					levels[sorted[i]] = compute(sorted[i]);
+			});
 		}
 
+		// bits which are not part of the graph are considered stable at 0
+		auto bit_level = [&](SigBit bit) -> arrivalint {
+			auto it = bit_nodes.find(bit);
+			return it == bit_nodes.end() ? 0 : levels[it->second];
+		};
+
 		// now find the length of the critical path (slowest path in the design)
 		arrivalint crit = INF_PAST;
 		for (auto pair : samplers)
-			if (levels[desc_sig(pair.second)] > crit)
-				crit = levels[desc_sig(pair.second)];
+			if (bit_level(pair.second) > crit)
+				crit = bit_level(pair.second);
 
 		if (crit < 0) {
 			log("No paths found\n");
@@ -248,57 +337,54 @@ struct EstimateSta {
 
 		log("Critical path is %ld nodes long:\n\n", crit);
 
-		// we use dict instead of pool because dict gives us
-		// some compile-time errors related to hashing
-		dict<std::tuple<SigBit, Cell *, AigNode *>, bool> critical;
+		std::vector<char> critical(num_nodes);
 
 		// actually find one critical path, or all such paths if requested
 		for (auto pair : samplers) {
-			if (levels[desc_sig(pair.second)] == crit) {
-				critical[desc_sig(pair.second)] = true;
+			if (bit_level(pair.second) == crit) {
+				if (bit_nodes.count(pair.second))
+					critical[bit_nodes.at(pair.second)] = true;
 				if (!all_paths)
 					break;
 			}
 		}
 
-		// walk backwards through toposorted nodes and set critical flag on nodes in critical path
-		for (auto it = topo.sorted.rbegin(); it != topo.sorted.rend(); it++) {
-			auto node = *it;
-			AigNode *aig_node = std::get<2>(node);
-			if (aig_node) {
-				Cell *cell = std::get<1>(node);
-				Aig &aig = *cell_aigs.at(cell);
-
-				for (auto &oport : aig_node->outports) {
-					if (critical.count(desc_sig(cell->getPort(oport.first)[oport.second])))
-						critical[node] = true;
-				}
-
-				if (!aig_node->portname.empty()) {
-					SigBit bit = cell->getPort(aig_node->portname)[aig_node->portbit];
-					if (critical.count(node))
-						critical[desc_sig(bit)] = true;
-				} else if (aig_node->left_parent < 0 && aig_node->right_parent < 0) {
-					// constant, nothing to do
-				} else {
-					// figure out which parent is on the critical path
-					auto left = desc_aig(cell, aig.nodes[aig_node->left_parent]);
-					auto right = desc_aig(cell, aig.nodes[aig_node->right_parent]);
-					int crit_input_lvl = levels[node] - cell_type_factor(cell->type);
-					if (critical.count(node)) {
-						bool left_critical = (levels[left] == crit_input_lvl);
-						bool right_critical = (levels[right] == crit_input_lvl);
-						if (all_paths) {
-							if (left_critical)
-								critical[left] = true;
-							if (right_critical)
-								critical[right] = true;
-						} else {
-							if (left_critical)
-								critical[left] = true;
-							else if (right_critical)
-								critical[right] = true;
-						}
+		// walk backwards through levelized nodes and set critical flag on nodes in critical path
+		for (int i = num_nodes - 1; i >= 0; i--) {
+			int n = sorted[i];
+			if (n >= num_aig)
+				continue;
+			AigNode &node = aig_node(n);
+
+			// the fanout bits of an AIG node are its output ports
+			for (int k = fanout_start[n]; k < fanout_start[n + 1]; k++)
+				if (fanout[k] >= num_aig && critical[fanout[k]])
+					critical[n] = true;
+
+			if (!node.portname.empty()) {
+				if (critical[n])
+					critical[fanin[fanin_start[n]]] = true;
+			} else if (node.left_parent < 0 && node.right_parent < 0) {
+				// constant, nothing to do
+			} else {
+				// figure out which parent is on the critical path
+				int base = aig_base[node_cell[n]];
+				int left = base + node.left_parent;
+				int right = base + node.right_parent;
+				int crit_input_lvl = levels[n] - factors[node_cell[n]];
+				if (critical[n]) {
+					bool left_critical = (levels[left] == crit_input_lvl);
+					bool right_critical = (levels[right] == crit_input_lvl);
+					if (all_paths) {
+						if (left_critical)
+							critical[left] = true;
+						if (right_critical)
+							critical[right] = true;
+					} else {
+						if (left_critical)
+							critical[left] = true;
+						else if (right_critical)
+							critical[right] = true;
 					}
 				}
 			}
@@ -309,12 +395,11 @@ struct EstimateSta {
 		pool<IdString> to_select;
 
 		pool<Cell *> printed;
-		for (auto node : topo.sorted) {
-			if (!critical.count(node))
+		for (int n : sorted) {
+			if (!critical[n])
 				continue;
-			AigNode *aig_node = std::get<2>(node);
-			if (aig_node) {
-				Cell *cell = std::get<1>(node);
+			if (n < num_aig) {
+				Cell *cell = combinational[node_cell[n]];
 				if (!printed.count(cell)) {
 					to_select.insert(cell->name);
 					std::string cell_src;
@@ -326,14 +411,14 @@ struct EstimateSta {
 					printed.insert(cell);
 				}
 			} else {
-				SigBit bit = std::get<0>(node);
+				SigBit bit = node_bits[n - num_aig];
 				bits_to_select.add(bit);
 				std::string wire_src;
 				if (bit.wire && bit.wire->has_attribute(ID::src)) {
 					std::string src_attr = bit.wire->get_src_attribute();
 					wire_src = stringf(" source: %s", src_attr.c_str());
 				}
-				log("    wire %s%s (level %ld)\n", log_signal(bit), wire_src.c_str(), levels[node]);
+				log("    wire %s%s (level %ld)\n", log_signal(bit), wire_src.c_str(), levels[n]);
 			}
 		}
 
@@ -369,6 +454,10 @@ struct TimeestPass : Pass {
 		log("    -select\n");
 		log("        Select the nodes of a critical path\n");
 		log("\n");
+		log("    -j <threads>\n");
+		log("        Propagate arrival times using the given number of threads (0 for one\n");
+		log("        thread per core). The result does not depend on the thread count.\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *d) override
 	{
@@ -377,6 +466,7 @@ struct TimeestPass : Pass {
 		std::string clk;
 		bool all_paths = false;
 		bool select = false;
+		int threads = 1;
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++) {
 			if (args[argidx] == "-all_paths") {
@@ -387,6 +477,10 @@ struct TimeestPass : Pass {
 				select = true;
 				continue;
 			}
+			if (args[argidx] == "-j" && argidx + 1 < args.size()) {
+				threads = atoi(args[++argidx].c_str());
+				continue;
+			}
 			if (args[argidx] == "-clk" && argidx + 1 < args.size()) {
 				clk = args[++argidx];
 				continue;
@@ -410,6 +504,7 @@ struct TimeestPass : Pass {
 			EstimateSta sta(m, SigBit(m->wire(RTLIL::escape_id(clk)), 0));
 			sta.all_paths = all_paths;
 			sta.select = select;
+			sta.threads = threads;
 			sta.run();
 		}
 	}
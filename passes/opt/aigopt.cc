@@ -0,0 +1,268 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Claire Xenia Wolf <claire@yosyshq.com>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include "kernel/aignet.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct AigoptWorker
+{
+	RTLIL::Module *module;
+	SigMap sigmap;
+	AigNet aig;
+
+	dict<RTLIL::SigBit, RTLIL::Cell*> and_drivers, not_drivers;
+	pool<RTLIL::Cell*> gates;
+	dict<RTLIL::SigBit, int> bit_lits;
+	// bits of the inputs and outputs of the AIG
+	std::vector<RTLIL::SigBit> ci_bits, co_bits;
+
+	int and_count = 0, not_count = 0, new_and_count = 0, new_not_count = 0;
+
+	AigoptWorker(RTLIL::Module *module) : module(module), sigmap(module)
+	{
+	}
+
+	// Returns the bits that need a literal before the literal of `bit` (which
+	// must be sigmapped) can be created.
+	std::vector<RTLIL::SigBit> dependencies(const RTLIL::SigBit &bit)
+	{
+		std::vector<RTLIL::SigBit> deps;
+		if (auto it = and_drivers.find(bit); it != and_drivers.end()) {
+			deps.push_back(sigmap(it->second->getPort(ID::A)));
+			deps.push_back(sigmap(it->second->getPort(ID::B)));
+		} else if (auto it = not_drivers.find(bit); it != not_drivers.end()) {
+			deps.push_back(sigmap(it->second->getPort(ID::A)));
+		}
+		return deps;
+	}
+
+	// Creates the literal of a sigmapped bit whose dependencies all have a
+	// literal already.
+	int create_literal(const RTLIL::SigBit &bit)
+	{
+		if (bit == State::S0)
+			return AigNet::CFALSE;
+		if (bit == State::S1)
+			return AigNet::CTRUE;
+
+		if (auto it = and_drivers.find(bit); it != and_drivers.end())
+			return aig.AND(bit_lits.at(sigmap(it->second->getPort(ID::A))),
+					bit_lits.at(sigmap(it->second->getPort(ID::B))));
+
+		if (auto it = not_drivers.find(bit); it != not_drivers.end())
+			return aig.NOT(bit_lits.at(sigmap(it->second->getPort(ID::A))));
+
+		// an input of the AIG, which may be an undefined constant
+		ci_bits.push_back(bit);
+		return aig.add_input();
+	}
+
+	int literal(RTLIL::SigBit bit)
+	{
+		return aig_bit_literal(module, bit_lits, sigmap(bit),
+				[this](const RTLIL::SigBit &bit) { return dependencies(bit); },
+				[this](const RTLIL::SigBit &bit) { return create_literal(bit); });
+	}
+
+	void build_aig()
+	{
+		pool<RTLIL::SigBit> co_pool;
+		for (auto cell : module->cells()) {
+			if (module->selected(cell) && cell->type.in(ID($_AND_), ID($_NOT_)) && !cell->has_keep_attr()) {
+				gates.insert(cell);
+				auto &drivers = cell->type == ID($_AND_) ? and_drivers : not_drivers;
+				drivers[sigmap(cell->getPort(ID::Y))] = cell;
+				if (cell->type == ID($_AND_))
+					and_count++;
+				else
+					not_count++;
+				continue;
+			}
+			for (auto &conn : cell->connections())
+				if (cell->input(conn.first) || !cell->output(conn.first))
+					for (auto bit : sigmap(conn.second))
+						co_pool.insert(bit);
+		}
+
+		for (auto wire : module->wires())
+			if (wire->port_output || wire->get_bool_attribute(ID::keep))
+				for (auto bit : sigmap(wire))
+					co_pool.insert(bit);
+
+		for (auto &bit : co_pool)
+			if (and_drivers.count(bit) || not_drivers.count(bit)) {
+				co_bits.push_back(bit);
+				aig.add_output(literal(bit));
+			}
+	}
+
+	void write_gates()
+	{
+		for (auto cell : gates)
+			module->remove(cell);
+
+		// the signal of the positive and negative phase of each node
+		std::vector<RTLIL::SigBit> pos_bits(aig.nodes.size()), neg_bits(aig.nodes.size());
+		pos_bits[0] = State::S0;
+		neg_bits[0] = State::S1;
+		for (int i = 0; i < GetSize(ci_bits); i++)
+			pos_bits[aig.inputs[i]] = ci_bits[i];
+
+		// outputs are driven directly by the gates where possible
+		for (int i = 0; i < GetSize(co_bits); i++) {
+			int lit = aig.outputs[i], id = AigNet::node(lit);
+			if (AigNet::complemented(lit) ? id == 0 : !aig.is_and(id))
+				continue;
+			auto &bits = AigNet::complemented(lit) ? neg_bits : pos_bits;
+			if (bits[id] == RTLIL::SigBit())
+				bits[id] = co_bits[i];
+		}
+
+		for (int id = 1; id < GetSize(aig.nodes); id++)
+			if (aig.is_and(id) && pos_bits[id] == RTLIL::SigBit())
+				pos_bits[id] = module->addWire(NEW_ID);
+
+		auto bit_of = [&](int lit) {
+			int id = AigNet::node(lit);
+			if (!AigNet::complemented(lit))
+				return pos_bits[id];
+			if (neg_bits[id] == RTLIL::SigBit())
+				neg_bits[id] = module->addWire(NEW_ID);
+			return neg_bits[id];
+		};
+
+		for (int i = 0; i < GetSize(co_bits); i++) {
+			RTLIL::SigBit bit = bit_of(aig.outputs[i]);
+			if (bit != co_bits[i])
+				module->connect(co_bits[i], bit);
+		}
+
+		for (int id = 1; id < GetSize(aig.nodes); id++)
+			if (aig.is_and(id)) {
+				module->addAndGate(NEW_ID, bit_of(aig.nodes[id].fanin0), bit_of(aig.nodes[id].fanin1), pos_bits[id]);
+				new_and_count++;
+			}
+
+		for (int id = 1; id < GetSize(aig.nodes); id++)
+			if (neg_bits[id] != RTLIL::SigBit()) {
+				module->addNotGate(NEW_ID, pos_bits[id], neg_bits[id]);
+				new_not_count++;
+			}
+	}
+
+	void run(const std::vector<std::string> &script)
+	{
+		build_aig();
+		if (gates.empty())
+			return;
+
+		aig.cleanup();
+		log("Module %s: extracted %d AND gates and %d inverters, %d ANDs and %d levels after hashing.\n",
+				log_id(module), and_count, not_count, aig.num_ands(), aig.depth());
+		log_push();
+		for (auto &step : script) {
+			if (step == "balance")
+				aig.balance();
+			else if (step == "rewrite")
+				aig.rewrite();
+			else if (step == "refactor")
+				aig.refactor();
+			else
+				log_abort();
+			log("After %s: %d ANDs, %d levels.\n", step.c_str(), aig.num_ands(), aig.depth());
+		}
+		log_pop();
+
+		write_gates();
+	}
+};
+
+struct AigoptPass : public Pass {
+	AigoptPass() : Pass("aigopt", "optimize AIGs without ABC") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    aigopt [options] [selection]\n");
+		log("\n");
+		log("This pass optimizes the logic of $_AND_ and $_NOT_ cells (as created by\n");
+		log("`aigmap`) in place. The cells are converted to a structurally hashed AIG, on\n");
+		log("which a sequence of the following steps is run:\n");
+		log("\n");
+		log("    balance\n");
+		log("        rebuild multi-input ANDs as trees of minimal depth\n");
+		log("\n");
+		log("    rewrite\n");
+		log("        replace the logic between each node and its 4-input cuts with a\n");
+		log("        smaller implementation, without increasing the depth\n");
+		log("\n");
+		log("    refactor\n");
+		log("        replace the logic between each node and a cut of up to 6 inputs with\n");
+		log("        a factored form of its function, without increasing the depth\n");
+		log("\n");
+		log("All other cells and the outputs of the selected gates used outside of the\n");
+		log("optimized logic are kept.\n");
+		log("\n");
+		log("    -script <steps>\n");
+		log("        comma separated list of steps to run.\n");
+		log("        default: balance,rewrite,refactor,balance,rewrite\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) override
+	{
+		std::vector<std::string> script = {"balance", "rewrite", "refactor", "balance", "rewrite"};
+
+		log_header(design, "Executing AIGOPT pass (optimize AIGs without ABC).\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-script" && argidx+1 < args.size()) {
+				script = split_tokens(args[++argidx], ",");
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		for (auto &step : script)
+			if (step != "balance" && step != "rewrite" && step != "refactor")
+				log_cmd_error("Unknown step `%s'.\n", step.c_str());
+
+		int and_count = 0, not_count = 0, new_and_count = 0, new_not_count = 0;
+		for (auto module : design->selected_modules()) {
+			if (module->has_processes_warn())
+				continue;
+			AigoptWorker worker(module);
+			worker.run(script);
+			and_count += worker.and_count;
+			not_count += worker.not_count;
+			new_and_count += worker.new_and_count;
+			new_not_count += worker.new_not_count;
+		}
+
+		log("Optimized %d AND gates and %d inverters to %d AND gates and %d inverters.\n",
+				and_count, not_count, new_and_count, new_not_count);
+	}
+} AigoptPass;
+
+PRIVATE_NAMESPACE_END
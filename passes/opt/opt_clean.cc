@@ -104,6 +104,151 @@ keep_cache_t keep_cache;
 CellTypes ct_reg, ct_all;
 int count_rm_cells, count_rm_wires;
 
+int count_nontrivial_wire_attrs(RTLIL::Wire *w);
+
+// Remembers the fingerprints the modules had after they were last cleaned, so
+// that modules which did not change since can be skipped. Cell types,
+// parameters, attributes and connections_ can be modified without notifying
+// monitors, so the fingerprint is all there is to go by. The numbers of
+// objects are compared first, so that the fingerprint of a module is usually
+// only taken once per run, after cleaning it.
+struct CleanTracker
+{
+	struct State {
+		int wires, cells, connections;
+		uint64_t fingerprint;
+	};
+
+	// the design the fingerprints were taken in
+	Hasher::hash_t design_hashidx = 0;
+	dict<Module*, State> clean_modules;
+
+	// the port directions of the module types, as seen by ct_all
+	dict<IdString, uint64_t> interfaces;
+
+	void start(Design *design)
+	{
+		if (design->hashidx_ != design_hashidx) {
+			clean_modules.clear();
+			design_hashidx = design->hashidx_;
+		}
+		interfaces.clear();
+	}
+
+	static uint64_t mix(uint64_t state, uint64_t value)
+	{
+		// the finalizer of splitmix64
+		uint64_t z = state ^ (value + 0x9e3779b97f4a7c15ULL + (state << 6) + (state >> 2));
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	static uint64_t mix(uint64_t state, const Const &value)
+	{
+		state = mix(state, value.size());
+		for (auto bit : value)
+			state = mix(state, bit);
+		return state;
+	}
+
+	static uint64_t mix(uint64_t state, const SigSpec &sig)
+	{
+		for (auto &chunk : sig.chunks()) {
+			if (chunk.wire != nullptr) {
+				state = mix(state, chunk.wire->name.index_);
+				state = mix(state, ((uint64_t)chunk.offset << 32) | (uint32_t)chunk.width);
+			} else {
+				state = mix(state, chunk.width);
+				for (auto bit : chunk.data)
+					state = mix(state, bit);
+			}
+		}
+		return state;
+	}
+
+	uint64_t interface(Module *module)
+	{
+		auto it = interfaces.find(module->name);
+		if (it != interfaces.end())
+			return it->second;
+		uint64_t h = 0;
+		for (auto port : module->ports) {
+			Wire *wire = module->wire(port);
+			h = mix(h, port.index_);
+			h = mix(h, wire->port_input + 2 * wire->port_output);
+		}
+		return interfaces[module->name] = h;
+	}
+
+	// Hashes everything rmunused_module() looks at. Objects are combined by
+	// addition, so that the result does not depend on their order.
+	uint64_t fingerprint(Module *module, bool purge_mode)
+	{
+		uint64_t sum = mix(GetSize(module->processes), purge_mode);
+
+		for (auto &it : module->wires_) {
+			Wire *wire = it.second;
+			uint64_t h = mix(1, wire->name.index_);
+			h = mix(h, wire->width);
+			h = mix(h, wire->start_offset);
+			h = mix(h, wire->port_id);
+			h = mix(h, wire->port_input + 2 * wire->port_output + 4 * wire->upto + 8 * wire->is_signed);
+			h = mix(h, wire->get_bool_attribute(ID::keep));
+			// compare_signals() prefers wires with more attributes
+			h = mix(h, count_nontrivial_wire_attrs(wire));
+			for (auto attr : {ID::init, ID::unused_bits}) {
+				auto attr_it = wire->attributes.find(attr);
+				if (attr_it != wire->attributes.end())
+					h = mix(mix(h, attr.index_), attr_it->second);
+			}
+			sum += h;
+		}
+
+		for (auto &it : module->cells_) {
+			Cell *cell = it.second;
+			uint64_t h = mix(2, cell->name.index_);
+			h = mix(h, cell->type.index_);
+			h = mix(h, keep_cache.query(cell) + 2 * cell->get_bool_attribute(ID(clk2fflogic)));
+			for (auto &param : cell->parameters)
+				h = mix(mix(h, param.first.index_), param.second);
+			for (auto &conn : cell->connections())
+				h = mix(mix(h, conn.first.index_), conn.second);
+			if (Module *tpl = module->design->module(cell->type))
+				h = mix(h, interface(tpl));
+			sum += h;
+		}
+
+		for (auto &conn : module->connections())
+			sum += mix(mix(3, conn.first), conn.second);
+
+		for (auto &it : module->memories)
+			sum += mix(4, it.first.index_);
+
+		return sum;
+	}
+
+	bool unchanged(Module *module, bool purge_mode)
+	{
+		auto it = clean_modules.find(module);
+		if (it == clean_modules.end())
+			return false;
+		const State &state = it->second;
+		if (GetSize(module->wires_) != state.wires || GetSize(module->cells_) != state.cells ||
+				GetSize(module->connections_) != state.connections)
+			return false;
+		return fingerprint(module, purge_mode) == state.fingerprint;
+	}
+
+	void mark_clean(Module *module, bool purge_mode)
+	{
+		clean_modules[module] = {GetSize(module->wires_), GetSize(module->cells_),
+				GetSize(module->connections_), fingerprint(module, purge_mode)};
+	}
+};
+
+CleanTracker clean_tracker;
+
 void rmunused_module_cells(Module *module, bool verbose)
 {
 	SigMap sigmap(module);
@@ -639,6 +784,7 @@ struct OptCleanPass : public Pass {
 		log("after the passes that do the actual work.\n");
 		log("\n");
 		log("This pass only operates on completely selected modules without processes.\n");
+		log("Modules which have not changed since they were last cleaned are skipped.\n");
 		log("\n");
 		log("    -purge\n");
 		log("        also remove internal nets if they have a public name\n");
@@ -672,10 +818,18 @@ struct OptCleanPass : public Pass {
 		count_rm_cells = 0;
 		count_rm_wires = 0;
 
+		clean_tracker.start(design);
+
+		std::vector<RTLIL::Module*> cleaned_modules;
 		for (auto module : design->selected_whole_modules_warn()) {
 			if (module->has_processes_warn())
 				continue;
+			if (clean_tracker.unchanged(module, purge_mode)) {
+				log_debug("Module %s is unchanged since it was last cleaned.\n", log_id(module));
+				continue;
+			}
 			rmunused_module(module, purge_mode, true, true);
+			cleaned_modules.push_back(module);
 		}
 
 		if (count_rm_cells > 0 || count_rm_wires > 0)
@@ -685,6 +839,9 @@ struct OptCleanPass : public Pass {
 		design->sort();
 		design->check();
 
+		for (auto module : cleaned_modules)
+			clean_tracker.mark_clean(module, purge_mode);
+
 		keep_cache.reset();
 		ct_reg.clear();
 		ct_all.clear();
@@ -734,10 +891,16 @@ struct CleanPass : public Pass {
 		count_rm_cells = 0;
 		count_rm_wires = 0;
 
+		clean_tracker.start(design);
+
+		std::vector<RTLIL::Module*> cleaned_modules;
 		for (auto module : design->selected_unboxed_whole_modules()) {
 			if (module->has_processes())
 				continue;
+			if (clean_tracker.unchanged(module, purge_mode))
+				continue;
 			rmunused_module(module, purge_mode, ys_debug(), true);
+			cleaned_modules.push_back(module);
 		}
 
 		log_suppressed();
@@ -748,6 +911,9 @@ struct CleanPass : public Pass {
 		design->sort();
 		design->check();
 
+		for (auto module : cleaned_modules)
+			clean_tracker.mark_clean(module, purge_mode);
+
 		keep_cache.reset();
 		ct_reg.clear();
 		ct_all.clear();
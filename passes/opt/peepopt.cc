@@ -99,16 +99,18 @@ struct PeepoptPass : public Pass {
 
 		for (auto module : design->selected_modules())
 		{
+			// the indices are kept up to date across the iterations instead
+			// of being rebuilt for the whole module after each change
+			peepopt_pm pm(module);
+			pm.track_changes();
+			pm.setup(module->selected_cells());
+
 			did_something = true;
 
 			while (did_something)
 			{
 				did_something = false;
 
-				peepopt_pm pm(module);
-
-				pm.setup(module->selected_cells());
-
 				if (formalclk) {
 					pm.run_formal_clockgateff();
 				} else {
@@ -118,6 +120,9 @@ struct PeepoptPass : public Pass {
 					pm.run_muldiv();
 					pm.run_muldiv_c();
 				}
+
+				if (did_something)
+					pm.update();
 			}
 		}
 	}
@@ -359,7 +359,7 @@ with open(outfile, "w") as f:
         print("YOSYS_NAMESPACE_BEGIN", file=f)
         print("", file=f)
 
-    print("struct {}_pm {{".format(prefix), file=f)
+    print("struct {}_pm : public RTLIL::Monitor {{".format(prefix), file=f)
     print("  Module *module;", file=f)
     print("  SigMap sigmap;", file=f)
     print("  std::function<void()> on_accept;", file=f)
@@ -394,12 +394,19 @@ with open(outfile, "w") as f:
             print("  typedef std::tuple<{}> index_{}_key_type;".format(", ".join(index_types), index), file=f)
             print("  typedef std::tuple<{}> index_{}_value_type;".format(", ".join(value_types), index), file=f)
             print("  dict<index_{}_key_type, vector<index_{}_value_type>> index_{};".format(index, index, index), file=f)
+            print("  dict<Cell*, vector<index_{}_key_type>> index_{}_keys;".format(index, index), file=f)
     print("  dict<SigBit, pool<Cell*>> sigusers;", file=f)
     print("  pool<Cell*> blacklist_cells;", file=f)
     print("  pool<Cell*> autoremove_cells;", file=f)
     print("  dict<Cell*,int> rollback_cache;", file=f)
     print("  int rollback;", file=f)
     print("", file=f)
+    print("  // changes since setup() or the last update(), see track_changes()", file=f)
+    print("  bool tracking;", file=f)
+    print("  bool needs_reload;", file=f)
+    print("  dict<Cell*, pool<SigBit>> changed_cells;", file=f)
+    print("  vector<SigSig> new_connections;", file=f)
+    print("", file=f)
 
     for current_pattern in sorted(patterns.keys()):
         print("  struct state_{}_t {{".format(current_pattern), file=f)
@@ -483,13 +490,15 @@ with open(outfile, "w") as f:
     print("", file=f)
 
     print("  {}_pm(Module *module, const vector<Cell*> &cells) :".format(prefix), file=f)
-    print("      module(module), sigmap(module), setup_done(false), generate_mode(false), rngseed(12345678) {", file=f)
+    print("      module(module), sigmap(module), setup_done(false), generate_mode(false), rngseed(12345678),", file=f)
+    print("      tracking(false), needs_reload(false) {", file=f)
     print("    setup(cells);", file=f)
     print("  }", file=f)
     print("", file=f)
 
     print("  {}_pm(Module *module) :".format(prefix), file=f)
-    print("      module(module), sigmap(module), setup_done(false), generate_mode(false), rngseed(12345678) {", file=f)
+    print("      module(module), sigmap(module), setup_done(false), generate_mode(false), rngseed(12345678),", file=f)
+    print("      tracking(false), needs_reload(false) {", file=f)
     print("  }", file=f)
     print("", file=f)
 
@@ -508,7 +517,12 @@ with open(outfile, "w") as f:
     print("    for (auto cell : module->cells())", file=f)
     print("      for (auto &conn : cell->connections())", file=f)
     print("        add_siguser(conn.second, cell);", file=f)
-    print("    for (auto cell : cells) {", file=f)
+    print("    for (auto cell : cells)", file=f)
+    print("      index_cell(cell);", file=f)
+    print("  }", file=f)
+    print("", file=f)
+
+    print("  void index_cell(Cell *cell) {", file=f)
 
     for index in range(len(blocks)):
         block = blocks[index]
@@ -541,15 +555,150 @@ with open(outfile, "w") as f:
             for field, entry in enumerate(block["index"]):
                 print("        std::get<{}>(key) = {};".format(field, entry[1]), file=f)
             print("        index_{}[key].push_back(value);".format(index), file=f)
+            print("        if (tracking)", file=f)
+            print("          index_{}_keys[cell].push_back(key);".format(index), file=f)
             for i in range(loopcnt):
                 print("        }", file=f)
             print("      } while (0);", file=f)
 
+    print("  }", file=f)
+    print("", file=f)
+
+    print("  void unindex_cell(Cell *cell) {", file=f)
+    for index in range(len(blocks)):
+        block = blocks[index]
+        if block["type"] == "match":
+            print("    if (auto it = index_{}_keys.find(cell); it != index_{}_keys.end()) {{".format(index, index), file=f)
+            print("      for (auto &key : it->second) {", file=f)
+            print("        auto ptr = index_{}.find(key);".format(index), file=f)
+            print("        if (ptr == index_{}.end()) continue;".format(index), file=f)
+            print("        auto &values = ptr->second;", file=f)
+            print("        values.erase(std::remove_if(values.begin(), values.end(),", file=f)
+            print("            [&](const index_{}_value_type &value) {{ return std::get<0>(value) == cell; }}), values.end());".format(index), file=f)
+            print("        if (values.empty())", file=f)
+            print("          index_{}.erase(ptr);".format(index), file=f)
+            print("      }", file=f)
+            print("      index_{}_keys.erase(it);".format(index), file=f)
+            print("    }", file=f)
+    print("  }", file=f)
+    print("", file=f)
+
+    print("  void track_changes() {", file=f)
+    print("    log_assert(!setup_done);", file=f)
+    print("    tracking = true;", file=f)
+    print("    module->monitors.insert(this);", file=f)
+    print("  }", file=f)
+    print("", file=f)
+
+    print("  void notify_connect(Cell *cell, const IdString &, const SigSpec &old_sig, const SigSpec &sig) override {", file=f)
+    print("    if (needs_reload || cell->module != module) return;", file=f)
+    print("    auto &bits = changed_cells[cell];", file=f)
+    print("    for (auto bit : old_sig)", file=f)
+    print("      if (bit.wire != nullptr) bits.insert(bit);", file=f)
+    print("    for (auto bit : sig)", file=f)
+    print("      if (bit.wire != nullptr) bits.insert(bit);", file=f)
+    print("  }", file=f)
+    print("", file=f)
+    print("  void notify_connect(Module *, const SigSig &conn) override {", file=f)
+    print("    if (!needs_reload) new_connections.push_back(conn);", file=f)
+    print("  }", file=f)
+    print("", file=f)
+    print("  void notify_connect(Module *, const vector<SigSig> &) override { needs_reload = true; }", file=f)
+    print("  void notify_blackout(Module *) override { needs_reload = true; }", file=f)
+    print("", file=f)
+
+    print("  void update() {", file=f)
+    print("    log_assert(tracking && setup_done);", file=f)
+    print("    for (auto cell : autoremove_cells)", file=f)
+    print("      module->remove(cell);", file=f)
+    print("    autoremove_cells.clear();", file=f)
+    print("    blacklist_cells.clear();", file=f)
+    print("", file=f)
+    print("    if (needs_reload) {", file=f)
+    print("      sigmap.set(module);", file=f)
+    print("      sigusers.clear();", file=f)
+    for index in range(len(blocks)):
+        if blocks[index]["type"] == "match":
+            print("      index_{}.clear();".format(index), file=f)
+            print("      index_{}_keys.clear();".format(index), file=f)
+    print("      for (auto port : module->ports)", file=f)
+    print("        add_siguser(module->wire(port), nullptr);", file=f)
+    print("      for (auto cell : module->cells())", file=f)
+    print("        for (auto &conn : cell->connections())", file=f)
+    print("          add_siguser(conn.second, cell);", file=f)
+    print("      for (auto cell : module->selected_cells())", file=f)
+    print("        index_cell(cell);", file=f)
+    print("      changed_cells.clear();", file=f)
+    print("      new_connections.clear();", file=f)
+    print("      needs_reload = false;", file=f)
+    print("      return;", file=f)
+    print("    }", file=f)
+    print("", file=f)
+    print("    // the cells whose index entries may depend on the changes", file=f)
+    print("    pool<Cell*> dirty;", file=f)
+    print("    auto add_users = [&](SigBit bit) {", file=f)
+    print("      auto it = sigusers.find(bit);", file=f)
+    print("      if (it != sigusers.end())", file=f)
+    print("        for (auto user : it->second)", file=f)
+    print("          if (user != nullptr) dirty.insert(user);", file=f)
+    print("    };", file=f)
+    print("", file=f)
+    print("    for (auto &conn : new_connections)", file=f)
+    print("      for (int i = 0; i < GetSize(conn.first); i++) {", file=f)
+    print("        SigBit lhs = sigmap(conn.first[i]), rhs = sigmap(conn.second[i]);", file=f)
+    print("        if (lhs == rhs) continue;", file=f)
+    print("        pool<Cell*> users;", file=f)
+    print("        for (auto bit : {lhs, rhs}) {", file=f)
+    print("          auto it = sigusers.find(bit);", file=f)
+    print("          if (it == sigusers.end()) continue;", file=f)
+    print("          users.insert(it->second.begin(), it->second.end());", file=f)
+    print("          sigusers.erase(it);", file=f)
+    print("        }", file=f)
+    print("        sigmap.add(lhs, rhs);", file=f)
+    print("        SigBit bit = sigmap(lhs);", file=f)
+    print("        for (auto user : users)", file=f)
+    print("          if (user != nullptr) dirty.insert(user);", file=f)
+    print("        if (bit.wire != nullptr && !users.empty())", file=f)
+    print("          sigusers[bit].insert(users.begin(), users.end());", file=f)
+    print("      }", file=f)
+    print("    new_connections.clear();", file=f)
+    print("", file=f)
+    print("    // cells may have been deleted, only the ones still in the module are dereferenced", file=f)
+    print("    pool<Cell*> live;", file=f)
+    print("    for (auto cell : module->cells())", file=f)
+    print("      if (changed_cells.count(cell))", file=f)
+    print("        live.insert(cell);", file=f)
+    print("    for (auto &it : changed_cells) {", file=f)
+    print("      for (auto raw_bit : it.second) {", file=f)
+    print("        SigBit bit = sigmap(raw_bit);", file=f)
+    print("        if (bit.wire == nullptr) continue;", file=f)
+    print("        add_users(bit);", file=f)
+    print("        auto users = sigusers.find(bit);", file=f)
+    print("        if (users != sigusers.end())", file=f)
+    print("          users->second.erase(it.first);", file=f)
+    print("      }", file=f)
+    print("      dirty.insert(it.first);", file=f)
+    print("    }", file=f)
+    print("    for (auto cell : live)", file=f)
+    print("      for (auto &conn : cell->connections())", file=f)
+    print("        for (auto bit : sigmap(conn.second))", file=f)
+    print("          if (bit.wire != nullptr) {", file=f)
+    print("            add_users(bit);", file=f)
+    print("            sigusers[bit].insert(cell);", file=f)
+    print("          }", file=f)
+    print("", file=f)
+    print("    for (auto cell : dirty) {", file=f)
+    print("      unindex_cell(cell);", file=f)
+    print("      if ((live.count(cell) || !changed_cells.count(cell)) && module->design->selected(module, cell))", file=f)
+    print("        index_cell(cell);", file=f)
     print("    }", file=f)
+    print("    changed_cells.clear();", file=f)
     print("  }", file=f)
     print("", file=f)
 
     print("  ~{}_pm() {{".format(prefix), file=f)
+    print("    if (tracking)", file=f)
+    print("      module->monitors.erase(this);", file=f)
     print("    for (auto cell : autoremove_cells)", file=f)
     print("      module->remove(cell);", file=f)
     print("  }", file=f)
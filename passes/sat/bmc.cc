@@ -0,0 +1,572 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Claire Xenia Wolf <claire@yosyshq.com>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/functional.h"
+#include "kernel/satgen.h"
+#include "kernel/threading.h"
+#include "kernel/json.h"
+#include "kernel/yw.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+using Functional::Fn;
+
+// A copy of the functional IR of a module which does not refer to any
+// IdStrings, so that several threads can unroll it at the same time.
+struct BmcProgram
+{
+	struct Op {
+		Fn fn;
+		// width of signals, resp. data and address width of memories
+		int width = 0, addr_width = 0;
+		bool is_memory = false;
+		std::vector<int> args;
+		int offset = 0;
+		int index = -1;
+		RTLIL::Const value;
+	};
+
+	struct Input {
+		int width;
+		bool is_const;
+	};
+
+	struct State {
+		int width, addr_width;
+		bool is_memory;
+		// a single value for signals, one value per word for memories
+		std::vector<RTLIL::Const> init;
+		int next;
+	};
+
+	struct Property {
+		IdString name;
+		int node;
+	};
+
+	std::vector<Op> ops;
+	std::vector<Input> inputs;
+	std::vector<State> states;
+	std::vector<Property> asserts;
+	std::vector<int> assumes;
+};
+
+struct BmcBuilder : public Functional::DefaultVisitor<void>
+{
+	BmcProgram::Op &op;
+	const dict<std::pair<IdString, IdString>, int> &input_index, &state_index;
+
+	BmcBuilder(BmcProgram::Op &op, const dict<std::pair<IdString, IdString>, int> &input_index,
+			const dict<std::pair<IdString, IdString>, int> &state_index) :
+			op(op), input_index(input_index), state_index(state_index) { }
+
+	void default_handler(Functional::Node) override { }
+	void slice(Functional::Node, Functional::Node, int offset, int) override { op.offset = offset; }
+	void constant(Functional::Node, RTLIL::Const const &value) override { op.value = value; }
+	void input(Functional::Node, IdString name, IdString kind) override { op.index = input_index.at({name, kind}); }
+	void state(Functional::Node, IdString name, IdString kind) override { op.index = state_index.at({name, kind}); }
+};
+
+struct BmcResult
+{
+	// the first step in which the assertion fails, or -1
+	int fail_step = -1;
+	// the counterexample: values of the (non-memory) initial state and of the
+	// inputs in each step
+	std::vector<RTLIL::Const> init_values;
+	std::vector<std::vector<RTLIL::Const>> input_values;
+};
+
+// Unrolls the program for a single assertion. Each worker owns its solver
+// and only touches the shared (read-only) program.
+struct BmcWorker
+{
+	typedef std::vector<std::vector<int>> Value;
+
+	const BmcProgram &prog;
+	int assert_idx;
+	ezSatPtr ez;
+
+	// literals of the initial state and of the inputs in every step, which
+	// make up the counterexample
+	std::vector<std::vector<int>> init_lits;
+	std::vector<std::vector<std::vector<int>>> input_lits;
+
+	BmcResult &result;
+
+	BmcWorker(const BmcProgram &prog, int assert_idx, BmcResult &result) :
+			prog(prog), assert_idx(assert_idx), result(result) { }
+
+	std::vector<int> import_const(const RTLIL::Const &value, bool undef_free)
+	{
+		std::vector<int> bits;
+		for (auto bit : value)
+			if (bit == State::S1)
+				bits.push_back(ez->CONST_TRUE);
+			else if (bit != State::S0 && undef_free)
+				bits.push_back(ez->frozen_literal());
+			else
+				bits.push_back(ez->CONST_FALSE);
+		return bits;
+	}
+
+	std::vector<int> multiply(const std::vector<int> &a, const std::vector<int> &b)
+	{
+		std::vector<int> y(a.size(), ez->CONST_FALSE);
+		for (int i = 0; i < GetSize(a); i++) {
+			std::vector<int> shifted_a(a.size(), ez->CONST_FALSE);
+			for (int j = i; j < GetSize(a); j++)
+				shifted_a[j] = a[j-i];
+			y = ez->vec_ite(b[i], ez->vec_add(y, shifted_a), y);
+		}
+		return y;
+	}
+
+	// restoring division; like the C++ simulation library of the functional
+	// backend, division and modulo by zero give zero
+	std::vector<int> divide(const std::vector<int> &a, const std::vector<int> &b, bool modulo)
+	{
+		// the partial remainder has an extra bit, as it can exceed the
+		// width of b before the subtraction
+		std::vector<int> q(a.size(), ez->CONST_FALSE), r(a.size() + 1, ez->CONST_FALSE);
+		std::vector<int> b_ext = ez->vec_cast(b, GetSize(r), false);
+		for (int i = GetSize(a) - 1; i >= 0; i--) {
+			r.pop_back();
+			r.insert(r.begin(), a[i]);
+			q[i] = ez->vec_ge_unsigned(r, b_ext);
+			r = ez->vec_ite(q[i], ez->vec_sub(r, b_ext), r);
+		}
+		r.pop_back();
+		std::vector<int> zero(a.size(), ez->CONST_FALSE);
+		return ez->vec_ite(ez->vec_reduce_or(b), modulo ? r : q, zero);
+	}
+
+	std::vector<int> read_word(const Value &mem, const std::vector<int> &addr)
+	{
+		std::vector<int> data = mem[0];
+		for (int i = 1; i < GetSize(mem); i++)
+			data = ez->vec_ite(ez->vec_eq(addr, ez->vec_const_unsigned(i, GetSize(addr))), mem[i], data);
+		return data;
+	}
+
+	Value evaluate(const BmcProgram::Op &op, const std::vector<Value> &values, const std::vector<Value> &state)
+	{
+		auto arg = [&](int i) -> const std::vector<int> & { return values[op.args[i]][0]; };
+
+		switch (op.fn) {
+		case Fn::buf: return values[op.args[0]];
+		case Fn::slice: return {std::vector<int>(arg(0).begin() + op.offset, arg(0).begin() + op.offset + op.width)};
+		case Fn::zero_extend: return {ez->vec_cast(arg(0), op.width, false)};
+		case Fn::sign_extend: return {ez->vec_cast(arg(0), op.width, true)};
+		case Fn::concat: {
+			std::vector<int> bits = arg(0);
+			bits.insert(bits.end(), arg(1).begin(), arg(1).end());
+			return {bits};
+		}
+		case Fn::add: return {ez->vec_add(arg(0), arg(1))};
+		case Fn::sub: return {ez->vec_sub(arg(0), arg(1))};
+		case Fn::mul: return {multiply(arg(0), arg(1))};
+		case Fn::unsigned_div: return {divide(arg(0), arg(1), false)};
+		case Fn::unsigned_mod: return {divide(arg(0), arg(1), true)};
+		case Fn::bitwise_and: return {ez->vec_and(arg(0), arg(1))};
+		case Fn::bitwise_or: return {ez->vec_or(arg(0), arg(1))};
+		case Fn::bitwise_xor: return {ez->vec_xor(arg(0), arg(1))};
+		case Fn::bitwise_not: return {ez->vec_not(arg(0))};
+		case Fn::unary_minus: return {ez->vec_neg(arg(0))};
+		case Fn::reduce_and: return {std::vector<int>{ez->vec_reduce_and(arg(0))}};
+		case Fn::reduce_or: return {std::vector<int>{ez->vec_reduce_or(arg(0))}};
+		case Fn::reduce_xor: return {std::vector<int>{ez->expression(ezSAT::OpXor, arg(0))}};
+		case Fn::equal: return {std::vector<int>{ez->vec_eq(arg(0), arg(1))}};
+		case Fn::not_equal: return {std::vector<int>{ez->vec_ne(arg(0), arg(1))}};
+		case Fn::signed_greater_than: return {std::vector<int>{ez->vec_gt_signed(arg(0), arg(1))}};
+		case Fn::signed_greater_equal: return {std::vector<int>{ez->vec_ge_signed(arg(0), arg(1))}};
+		case Fn::unsigned_greater_than: return {std::vector<int>{ez->vec_gt_unsigned(arg(0), arg(1))}};
+		case Fn::unsigned_greater_equal: return {std::vector<int>{ez->vec_ge_unsigned(arg(0), arg(1))}};
+		case Fn::logical_shift_left: return {ez->vec_shift_left(arg(0), arg(1), false, ez->CONST_FALSE, ez->CONST_FALSE)};
+		case Fn::logical_shift_right: return {ez->vec_shift_right(arg(0), arg(1), false, ez->CONST_FALSE, ez->CONST_FALSE)};
+		case Fn::arithmetic_shift_right: return {ez->vec_shift_right(arg(0), arg(1), false, arg(0).back(), arg(0).back())};
+		case Fn::mux: {
+			const Value &a = values[op.args[0]], &b = values[op.args[1]];
+			int s = arg(2)[0];
+			Value result;
+			for (int i = 0; i < GetSize(a); i++)
+				result.push_back(ez->vec_ite(s, b[i], a[i]));
+			return result;
+		}
+		case Fn::constant: return {import_const(op.value, false)};
+		case Fn::input: return {input_lits.back()[op.index]};
+		case Fn::state: return state[op.index];
+		case Fn::memory_read: return {read_word(values[op.args[0]], arg(1))};
+		case Fn::memory_write: {
+			Value mem = values[op.args[0]];
+			const std::vector<int> &addr = arg(1), &data = arg(2);
+			for (int i = 0; i < GetSize(mem); i++)
+				mem[i] = ez->vec_ite(ez->vec_eq(addr, ez->vec_const_unsigned(i, GetSize(addr))), data, mem[i]);
+			return mem;
+		}
+		case Fn::invalid: break;
+		}
+		log_abort();
+	}
+
+	void run(int depth)
+	{
+		std::vector<Value> state;
+		for (auto &s : prog.states) {
+			Value value;
+			for (auto &word : s.init)
+				value.push_back(import_const(word, true));
+			if (!s.is_memory)
+				init_lits.push_back(value[0]);
+			state.push_back(std::move(value));
+		}
+
+		std::vector<std::vector<int>> const_inputs(prog.inputs.size());
+		for (int step = 0; step < depth; step++)
+		{
+			input_lits.emplace_back();
+			for (int i = 0; i < GetSize(prog.inputs); i++) {
+				auto &input = prog.inputs[i];
+				if (input.is_const && step > 0) {
+					input_lits.back().push_back(const_inputs[i]);
+					continue;
+				}
+				std::vector<int> bits;
+				for (int j = 0; j < input.width; j++)
+					bits.push_back(ez->frozen_literal());
+				if (input.is_const)
+					const_inputs[i] = bits;
+				input_lits.back().push_back(bits);
+			}
+
+			std::vector<Value> values;
+			values.reserve(prog.ops.size());
+			for (auto &op : prog.ops)
+				values.push_back(evaluate(op, values, state));
+
+			for (int node : prog.assumes)
+				ez->assume(values[node][0][0]);
+
+			std::vector<int> model_expr;
+			std::vector<bool> model_values;
+			for (auto &bits : init_lits)
+				model_expr.insert(model_expr.end(), bits.begin(), bits.end());
+			for (auto &step_bits : input_lits)
+				for (auto &bits : step_bits)
+					model_expr.insert(model_expr.end(), bits.begin(), bits.end());
+
+			int assert_lit = values[prog.asserts[assert_idx].node][0][0];
+			if (ez->solve(model_expr, model_values, ez->NOT(assert_lit))) {
+				result.fail_step = step;
+				extract_model(model_values);
+				return;
+			}
+			ez->assume(assert_lit);
+
+			std::vector<Value> next_state;
+			for (auto &s : prog.states)
+				next_state.push_back(values[s.next]);
+			state.swap(next_state);
+		}
+	}
+
+	void extract_model(const std::vector<bool> &model_values)
+	{
+		int pos = 0;
+		auto extract = [&](const std::vector<int> &bits) {
+			RTLIL::Const value(State::S0, GetSize(bits));
+			for (int i = 0; i < GetSize(bits); i++)
+				value.bits()[i] = model_values[pos++] ? State::S1 : State::S0;
+			return value;
+		};
+		for (auto &bits : init_lits)
+			result.init_values.push_back(extract(bits));
+		for (auto &step : input_lits) {
+			result.input_values.emplace_back();
+			for (auto &bits : step)
+				result.input_values.back().push_back(extract(bits));
+		}
+	}
+};
+
+// Converts a module to a BmcProgram and writes the counterexamples in the
+// Yosys witness format, both on the main thread.
+struct BmcModule
+{
+	struct WitnessSignal {
+		std::vector<std::string> path;
+		int offset, width;
+		// which value of the BmcResult the signal is part of and where
+		bool is_state;
+		int index, value_offset;
+		bool init_only;
+	};
+
+	RTLIL::Module *module;
+	BmcProgram prog;
+	std::vector<WitnessSignal> witness_signals;
+
+	BmcModule(RTLIL::Module *module) : module(module) { }
+
+	void add_witness_chunks(const RTLIL::SigSpec &sig, bool is_state, int index, bool init_only)
+	{
+		int value_offset = 0;
+		for (auto &chunk : sig.chunks()) {
+			if (chunk.is_wire())
+				witness_signals.push_back({witness_path(chunk.wire), chunk.offset, chunk.width, is_state, index, value_offset, init_only});
+			value_offset += chunk.width;
+		}
+	}
+
+	void build()
+	{
+		Functional::IR ir = Functional::IR::from_module(module);
+		dict<std::pair<IdString, IdString>, int> input_index, state_index;
+
+		for (auto input : ir.all_inputs()) {
+			if (input->kind.in(ID($allconst), ID($allseq)))
+				log_error("Module %s contains an %s cell, which is not supported by the bmc pass.\n",
+						log_id(module), log_id(input->kind));
+			int index = GetSize(prog.inputs);
+			input_index[{input->name, input->kind}] = index;
+			prog.inputs.push_back({input->sort.width(), input->kind == ID($anyconst)});
+			if (input->kind == ID($input))
+				add_witness_chunks(module->wire(input->name), false, index, false);
+			else
+				add_witness_chunks(module->cell(input->name)->getPort(ID::Y), false, index, input->kind == ID($anyconst));
+		}
+
+		int init_index = 0;
+		for (auto state : ir.all_states()) {
+			state_index[{state->name, state->kind}] = GetSize(prog.states);
+			BmcProgram::State s;
+			s.is_memory = state->sort.is_memory();
+			if (s.is_memory) {
+				s.width = state->sort.data_width();
+				s.addr_width = state->sort.addr_width();
+				if (s.addr_width > 16)
+					log_error("Memory %s in module %s has more than 2^16 words, which is not supported by the bmc pass.\n",
+							log_id(state->name), log_id(module));
+				auto &contents = state->initial_value_memory();
+				for (int i = 0; i < (1 << s.addr_width); i++)
+					s.init.push_back(contents[i]);
+			} else {
+				s.width = state->sort.width();
+				s.addr_width = 0;
+				s.init.push_back(state->initial_value_signal());
+				// the initial value of flip-flops is part of the witness,
+				// other states (like $initstate) have a fixed initial value
+				RTLIL::Cell *cell = module->cell(state->name);
+				if (cell != nullptr && RTLIL::builtin_ff_cell_types().count(cell->type))
+					add_witness_chunks(cell->getPort(ID::Q), true, init_index, true);
+				init_index++;
+			}
+			s.next = state->next_value().id();
+			prog.states.push_back(std::move(s));
+		}
+
+		for (auto node : ir) {
+			log_assert(node.id() == GetSize(prog.ops));
+			BmcProgram::Op op;
+			op.fn = node.fn();
+			if (node.sort().is_memory()) {
+				op.is_memory = true;
+				op.width = node.sort().data_width();
+				op.addr_width = node.sort().addr_width();
+			} else
+				op.width = node.width();
+			for (int i = 0; i < int(node.arg_count()); i++)
+				op.args.push_back(node.arg(i).id());
+			node.visit(BmcBuilder(op, input_index, state_index));
+			prog.ops.push_back(std::move(op));
+		}
+
+		for (auto output : ir.all_outputs()) {
+			if (output->kind == ID($assert))
+				prog.asserts.push_back({output->name, output->value().id()});
+			else if (output->kind == ID($assume))
+				prog.assumes.push_back(output->value().id());
+		}
+		std::sort(prog.asserts.begin(), prog.asserts.end(), [](const BmcProgram::Property &a, const BmcProgram::Property &b) {
+			return a.name.str() < b.name.str();
+		});
+	}
+
+	void write_witness(const std::string &filename, const BmcResult &result)
+	{
+		PrettyJson json;
+		if (!json.write_to_file(filename))
+			log_error("Can't open file `%s' for writing: %s\n", filename.c_str(), strerror(errno));
+
+		json.begin_object();
+		json.entry("format", "Yosys Witness Trace");
+		json.entry("generator", yosys_maybe_version());
+		json.name("clocks");
+		json.begin_array();
+		json.end_array();
+		json.name("signals");
+		json.begin_array();
+		for (auto &signal : witness_signals) {
+			json.begin_object();
+			json.entry("path", signal.path);
+			json.entry("offset", signal.offset);
+			json.entry("width", signal.width);
+			json.entry("init_only", signal.init_only);
+			json.end_object();
+		}
+		json.end_array();
+		json.name("steps");
+		json.begin_array();
+		for (int step = 0; step <= result.fail_step; step++) {
+			// the bits of the first signal are at the end of the string
+			std::string bits;
+			for (auto &signal : witness_signals) {
+				if (signal.init_only && step > 0) {
+					bits.append(signal.width, '?');
+					continue;
+				}
+				const RTLIL::Const &value = signal.is_state ? result.init_values[signal.index] : result.input_values[step][signal.index];
+				for (int i = 0; i < signal.width; i++)
+					bits.push_back(value[signal.value_offset + i] == State::S1 ? '1' : '0');
+			}
+			std::reverse(bits.begin(), bits.end());
+			json.begin_object();
+			json.entry("bits", bits);
+			json.end_object();
+		}
+		json.end_array();
+		json.end_object();
+	}
+};
+
+struct BmcPass : public Pass {
+	BmcPass() : Pass("bmc", "bounded model checking on the functional IR") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    bmc [options] [selection]\n");
+		log("\n");
+		log("This pass checks the $assert cells of the selected modules for the given number\n");
+		log("of time steps, starting from the initial state. The modules are converted to\n");
+		log("the functional IR (see `write_functional_cxx`), so all flip-flops must use the\n");
+		log("global clock (use `clk2fflogic` or `formalff -clk2ff` otherwise) and the\n");
+		log("design must be flattened.\n");
+		log("\n");
+		log("Every assertion is checked by its own incremental SAT solver, which is given\n");
+		log("the assumptions of all steps up to the current one and the assertion itself in\n");
+		log("all earlier steps. Undefined initial values are unconstrained, other undefined\n");
+		log("values are zero. $cover, $live and $fair cells are ignored.\n");
+		log("\n");
+		log("    -seq <N>\n");
+		log("        number of time steps to check. default: 20\n");
+		log("\n");
+		log("    -j <threads>\n");
+		log("        check the assertions using the given number of threads (0 for one\n");
+		log("        per hardware thread). The result is the same for any number of\n");
+		log("        threads. default: 1\n");
+		log("\n");
+		log("    -yw <prefix>\n");
+		log("        write a counterexample for each failing assertion to the Yosys witness\n");
+		log("        file <prefix><N>.yw, with N counting the failing assertions from 1.\n");
+		log("        The files can be replayed with `sim -r`. The initial contents of\n");
+		log("        memories are not part of the witness.\n");
+		log("\n");
+		log("    -assert\n");
+		log("        produce an error if any assertion fails.\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) override
+	{
+		int seq_len = 20, threads = 1;
+		std::string yw_prefix;
+		bool assert_mode = false;
+
+		log_header(design, "Executing BMC pass (bounded model checking on the functional IR).\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-seq" && argidx+1 < args.size()) {
+				seq_len = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				threads = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-yw" && argidx+1 < args.size()) {
+				yw_prefix = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-assert") {
+				assert_mode = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		if (seq_len < 1)
+			log_cmd_error("The number of time steps must be at least 1.\n");
+
+		int num_failed = 0;
+		for (auto module : design->selected_whole_modules_warn())
+		{
+			if (module->has_processes_warn())
+				continue;
+
+			BmcModule bmc(module);
+			bmc.build();
+			if (bmc.prog.asserts.empty())
+				continue;
+
+			log("Checking %d assertions in module %s for %d steps.\n", GetSize(bmc.prog.asserts), log_id(module), seq_len);
+
+			std::vector<BmcResult> results(bmc.prog.asserts.size());
+			parallel_for(threads, results.size(), [&](size_t i) {
+				BmcWorker worker(bmc.prog, i, results[i]);
+				worker.run(seq_len);
+			});
+
+			log_push();
+			for (int i = 0; i < GetSize(results); i++) {
+				IdString name = bmc.prog.asserts[i].name;
+				if (results[i].fail_step < 0) {
+					log("Assertion %s holds for %d steps.\n", log_id(name), seq_len);
+					continue;
+				}
+				num_failed++;
+				log("Assertion %s failed in step %d.\n", log_id(name), results[i].fail_step);
+				if (!yw_prefix.empty()) {
+					std::string filename = stringf("%s%d.yw", yw_prefix.c_str(), num_failed);
+					log("Writing counterexample to `%s'.\n", filename.c_str());
+					bmc.write_witness(filename, results[i]);
+				}
+			}
+			log_pop();
+		}
+
+		if (num_failed > 0 && assert_mode)
+			log_error("Found %d failing assertion%s.\n", num_failed, num_failed > 1 ? "s" : "");
+	}
+} BmcPass;
+
+PRIVATE_NAMESPACE_END
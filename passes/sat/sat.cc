@@ -44,9 +44,20 @@ struct SatHelper
 	SigMap sigmap;
 	CellTypes ct;
 
-	ezSatPtr ez;
+	// the solver, which is owned by this instance unless it is shared with
+	// another SatHelper for the same module
+	std::unique_ptr<ezSAT> own_ez;
+	ezSAT *ez;
 	SatGen satgen;
 
+	// with a shared solver, the constraints of each problem are only active
+	// when its context literal is assumed
+	int context;
+
+	// the cells imported for one time step, which are instantiated for all
+	// later time steps (also of the other problem with a shared solver)
+	std::shared_ptr<SatGen::FrameTemplate> frame_template;
+
 	// additional constraints
 	std::vector<std::pair<std::string, std::string>> sets, prove, prove_x, sets_init;
 	std::map<int, std::vector<std::pair<std::string, std::string>>> sets_at;
@@ -65,9 +76,20 @@ struct SatHelper
 	int max_timestep, timeout;
 	bool gotTimeout;
 
-	SatHelper(RTLIL::Design *design, RTLIL::Module *module, bool enable_undef, bool set_def_formal) :
-		design(design), module(module), sigmap(module), ct(design), satgen(ez.get(), &sigmap)
+	SatHelper(RTLIL::Design *design, RTLIL::Module *module, bool enable_undef, bool set_def_formal,
+			SatHelper *share_with = nullptr, std::string prefix = std::string()) :
+		design(design), module(module), sigmap(module), ct(design),
+		own_ez(share_with ? nullptr : yosys_satsolver->create()), ez(share_with ? share_with->ez : own_ez.get()),
+		satgen(ez, &sigmap, prefix), context(0)
 	{
+		if (share_with) {
+			log_assert(share_with->max_timestep < 0 && share_with->module == module && share_with->satgen.prefix != prefix);
+			if (share_with->context == 0)
+				share_with->context = ez->frozen_literal();
+			context = ez->frozen_literal();
+			frame_template = share_with->frame_template;
+		} else
+			frame_template = std::make_shared<SatGen::FrameTemplate>();
 		this->enable_undef = enable_undef;
 		satgen.model_undef = enable_undef;
 		satgen.def_formal = set_def_formal;
@@ -80,6 +102,14 @@ struct SatHelper
 		gotTimeout = false;
 	}
 
+	void assume(int id)
+	{
+		if (context)
+			ez->assume(id, context);
+		else
+			ez->assume(id);
+	}
+
 	void check_undef_enabled(const RTLIL::SigSpec &sig)
 	{
 		if (enable_undef)
@@ -162,7 +192,7 @@ struct SatHelper
 
 		log("Final constraint equation: %s = %s\n", log_signal(big_lhs), log_signal(big_rhs));
 		check_undef_enabled(big_lhs), check_undef_enabled(big_rhs);
-		ez->assume(satgen.signals_eq(big_lhs, big_rhs, timestep));
+		assume(satgen.signals_eq(big_lhs, big_rhs, timestep));
 
 		// 0 = sets_def
 		// 1 = sets_any_undef
@@ -222,35 +252,53 @@ struct SatHelper
 			log("Import %s constraint for this timestep: %s\n", t == 0 ? "def" : t == 1 ? "any_undef" : "all_undef", log_signal(sig));
 			std::vector<int> undef_sig = satgen.importUndefSigSpec(sig, timestep);
 			if (t == 0)
-				ez->assume(ez->NOT(ez->expression(ezSAT::OpOr, undef_sig)));
+				assume(ez->NOT(ez->expression(ezSAT::OpOr, undef_sig)));
 			if (t == 1)
-				ez->assume(ez->expression(ezSAT::OpOr, undef_sig));
+				assume(ez->expression(ezSAT::OpOr, undef_sig));
 			if (t == 2)
-				ez->assume(ez->expression(ezSAT::OpAnd, undef_sig));
+				assume(ez->expression(ezSAT::OpAnd, undef_sig));
 		}
 
-		int import_cell_counter = 0;
-		for (auto cell : module->cells())
-			if (design->selected(module, cell)) {
-				// log("Import cell: %s\n", RTLIL::id2cstr(cell->name));
-				if (satgen.importCell(cell, timestep)) {
-					for (auto &p : cell->connections())
-						if (ct.cell_output(cell->type, p.first))
-							show_drivers.insert(sigmap(p.second), cell);
-					import_cell_counter++;
-				} else if (ignore_unknown_cells)
-					log_warning("Failed to import cell %s (type %s) to SAT database.\n", RTLIL::id2cstr(cell->name), RTLIL::id2cstr(cell->type));
-				else
-					log_error("Failed to import cell %s (type %s) to SAT database.\n", RTLIL::id2cstr(cell->name), RTLIL::id2cstr(cell->type));
+		// all time steps after the first one (and after the initial state)
+		// import the cells the same way
+		bool use_template = timestep >= 2 && !initstate;
+		ez->assumeContext = context;
+		if (use_template && frame_template->valid && satgen.instantiateFrame(*frame_template, timestep)) {
+			log("Instantiated %d cells from the template of time step %d.\n", frame_template->cells, frame_template->timestep);
+		} else {
+			bool record = use_template && !frame_template->valid;
+			if (record)
+				satgen.beginFrame(*frame_template, timestep);
+
+			int import_cell_counter = 0;
+			for (auto cell : module->cells())
+				if (design->selected(module, cell)) {
+					// log("Import cell: %s\n", RTLIL::id2cstr(cell->name));
+					if (satgen.importCell(cell, timestep)) {
+						for (auto &p : cell->connections())
+							if (ct.cell_output(cell->type, p.first))
+								show_drivers.insert(sigmap(p.second), cell);
+						import_cell_counter++;
+					} else if (ignore_unknown_cells)
+						log_warning("Failed to import cell %s (type %s) to SAT database.\n", RTLIL::id2cstr(cell->name), RTLIL::id2cstr(cell->type));
+					else
+						log_error("Failed to import cell %s (type %s) to SAT database.\n", RTLIL::id2cstr(cell->name), RTLIL::id2cstr(cell->type));
+			}
+			log("Imported %d cells to SAT database.\n", import_cell_counter);
+
+			if (record) {
+				satgen.endFrame(*frame_template);
+				frame_template->cells = import_cell_counter;
+			}
 		}
-		log("Imported %d cells to SAT database.\n", import_cell_counter);
+		ez->assumeContext = 0;
 
 		if (set_assumes) {
 			RTLIL::SigSpec assumes_a, assumes_en;
 			satgen.getAssumes(assumes_a, assumes_en, timestep);
 			for (int i = 0; i < GetSize(assumes_a); i++)
 				log("Import constraint from assume cell: %s when %s.\n", log_signal(assumes_a[i]), log_signal(assumes_en[i]));
-			ez->assume(satgen.importAssumes(timestep));
+			assume(satgen.importAssumes(timestep));
 		}
 
 		if (initstate)
@@ -324,7 +372,7 @@ struct SatHelper
 			if (set_init_def) {
 				RTLIL::SigSpec rem = satgen.initial_state.export_all();
 				std::vector<int> undef_rem = satgen.importUndefSigSpec(rem, 1);
-				ez->assume(ez->NOT(ez->expression(ezSAT::OpOr, undef_rem)));
+				assume(ez->NOT(ez->expression(ezSAT::OpOr, undef_rem)));
 			}
 
 			if (set_init_undef) {
@@ -349,7 +397,7 @@ struct SatHelper
 
 			log("Final init constraint equation: %s = %s\n", log_signal(big_lhs), log_signal(big_rhs));
 			check_undef_enabled(big_lhs), check_undef_enabled(big_rhs);
-			ez->assume(satgen.signals_eq(big_lhs, big_rhs, timestep));
+			assume(satgen.signals_eq(big_lhs, big_rhs, timestep));
 		}
 	}
 
@@ -438,12 +486,14 @@ struct SatHelper
 	{
 		RTLIL::SigSpec state_signals = satgen.initial_state.export_all();
 		for (int i = timestep_from; i < timestep_to; i++)
-			ez->assume(ez->NOT(satgen.signals_eq(state_signals, state_signals, i, timestep_to)));
+			assume(ez->NOT(satgen.signals_eq(state_signals, state_signals, i, timestep_to)));
 	}
 
-	bool solve(const std::vector<int> &assumptions)
+	bool solve(std::vector<int> assumptions)
 	{
 		log_assert(gotTimeout == false);
+		if (context)
+			assumptions.push_back(context);
 		ez->setSolverTimeout(timeout);
 		bool success = ez->solve(modelExpressions, modelValues, assumptions);
 		if (ez->getSolverTimoutStatus())
@@ -453,12 +503,11 @@ struct SatHelper
 
 	bool solve(int a = 0, int b = 0, int c = 0, int d = 0, int e = 0, int f = 0)
 	{
-		log_assert(gotTimeout == false);
-		ez->setSolverTimeout(timeout);
-		bool success = ez->solve(modelExpressions, modelValues, a, b, c, d, e, f);
-		if (ez->getSolverTimoutStatus())
-			gotTimeout = true;
-		return success;
+		std::vector<int> assumptions;
+		for (int id : {a, b, c, d, e, f})
+			if (id != 0)
+				assumptions.push_back(id);
+		return solve(assumptions);
 	}
 
 	struct ModelBlockInfo {
@@ -858,7 +907,7 @@ struct SatHelper
 		} else
 			for (size_t i = 0; i < modelExpressions.size(); i++)
 				clause.push_back(modelValues.at(i) ? ez->NOT(modelExpressions.at(i)) : modelExpressions.at(i));
-		ez->assume(ez->expression(ezSAT::OpOr, clause));
+		assume(ez->expression(ezSAT::OpOr, clause));
 	}
 };
 
@@ -1396,8 +1445,12 @@ struct SatPass : public Pass {
 			if (loopcount > 0 || max_undef)
 				log_cmd_error("The options -max, -all, and -max_undef are not supported for temporal induction proofs!\n");
 
+			// the base case and the induction step share one solver and the
+			// unrolled time steps, unless the CNF of the induction step is dumped
+			bool share_solver = cnf_file_name.empty();
 			SatHelper basecase(design, module, enable_undef, set_def_formal);
-			SatHelper inductstep(design, module, enable_undef, set_def_formal);
+			SatHelper inductstep(design, module, enable_undef, set_def_formal,
+					share_solver ? &basecase : nullptr, share_solver ? "induct:" : "");
 
 			basecase.sets = sets;
 			basecase.set_assumes = set_assumes;
@@ -1440,12 +1493,12 @@ struct SatPass : public Pass {
 
 			if (!tempinduct_baseonly) {
 				inductstep.setup(1);
-				inductstep.ez->assume(inductstep.setup_proof(1));
+				inductstep.assume(inductstep.setup_proof(1));
 			}
 
 			if (tempinduct_def) {
 				std::vector<int> undef_state = inductstep.satgen.importUndefSigSpec(inductstep.satgen.initial_state.export_all(), 1);
-				inductstep.ez->assume(inductstep.ez->NOT(inductstep.ez->expression(ezSAT::OpOr, undef_state)));
+				inductstep.assume(inductstep.ez->NOT(inductstep.ez->expression(ezSAT::OpOr, undef_state)));
 			}
 
 			for (int inductlen = 1; inductlen <= maxsteps || maxsteps == 0; inductlen++)
@@ -1492,7 +1545,7 @@ struct SatPass : public Pass {
 						log("\n[base case %d] Problem size so far: %d variables and %d clauses.\n",
 								inductlen, basecase.ez->numCnfVariables(), basecase.ez->numCnfClauses());
 					}
-					basecase.ez->assume(property);
+					basecase.assume(property);
 				}
 
 				// phase 2: proving induction step
@@ -1519,7 +1572,7 @@ struct SatPass : public Pass {
 									inductlen, stepsize);
 						log("\n[induction step %d] Problem size so far: %d variables and %d clauses.\n",
 								inductlen, inductstep.ez->numCnfVariables(), inductstep.ez->numCnfClauses());
-						inductstep.ez->assume(property);
+						inductstep.assume(property);
 					}
 					else
 					{
@@ -1550,7 +1603,7 @@ struct SatPass : public Pass {
 						}
 
 						log("Induction step failed. Incrementing induction length.\n");
-						inductstep.ez->assume(property);
+						inductstep.assume(property);
 						inductstep.print_model();
 					}
 				}
@@ -1613,7 +1666,7 @@ struct SatPass : public Pass {
 			if (seq_len == 0) {
 				sathelper.setup();
 				if (sathelper.prove.size() || sathelper.prove_x.size() || sathelper.prove_asserts)
-					sathelper.ez->assume(sathelper.ez->NOT(sathelper.setup_proof()));
+					sathelper.assume(sathelper.ez->NOT(sathelper.setup_proof()));
 			} else {
 				std::vector<int> prove_bits;
 				for (int timestep = 1; timestep <= seq_len; timestep++) {
@@ -1623,7 +1676,7 @@ struct SatPass : public Pass {
 							prove_bits.push_back(sathelper.setup_proof(timestep));
 				}
 				if (sathelper.prove.size() || sathelper.prove_x.size() || sathelper.prove_asserts)
-					sathelper.ez->assume(sathelper.ez->NOT(sathelper.ez->expression(ezSAT::OpAnd, prove_bits)));
+					sathelper.assume(sathelper.ez->NOT(sathelper.ez->expression(ezSAT::OpAnd, prove_bits)));
 			}
 			sathelper.generate_model();
 
@@ -171,6 +171,12 @@ struct Abc9Pass : public ScriptPass
 		log("    -box <file>\n");
 		log("        pass this file with box library to ABC.\n");
 		log("\n");
+		log("    -j <jobs>\n");
+		log("        map up to this many modules concurrently (0 for one per hardware\n");
+		log("        thread). all modules are exported before ABC is run on them, and the\n");
+		log("        results are reintegrated in the same order as without this option,\n");
+		log("        so that the resulting netlist is identical. default: 1\n");
+		log("\n");
 		log("Note that this is a logic optimization pass within Yosys that is calling ABC\n");
 		log("internally. This is not going to \"run ABC on your design\". It will instead run\n");
 		log("ABC on logic snippets extracted from your design. You will not get any useful\n");
@@ -188,6 +194,7 @@ struct Abc9Pass : public ScriptPass
 	bool dff_mode, cleanup;
 	bool lut_mode;
 	int maxlut;
+	int jobs;
 	std::string box_file;
 
 	void clear_flags() override
@@ -198,6 +205,7 @@ struct Abc9Pass : public ScriptPass
 		cleanup = true;
 		lut_mode = false;
 		maxlut = 0;
+		jobs = 1;
 		box_file = "";
 	}
 
@@ -250,6 +258,10 @@ struct Abc9Pass : public ScriptPass
 				maxlut = atoi(args[++argidx].c_str());
 				continue;
 			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				jobs = atoi(args[++argidx].c_str());
+				continue;
+			}
 			if (arg == "-run" && argidx+1 < args.size()) {
 				size_t pos = args[argidx+1].find(':');
 				if (pos == std::string::npos)
@@ -279,6 +291,98 @@ struct Abc9Pass : public ScriptPass
 		log_pop();
 	}
 
+	// Like the per-module loop in script(), but all modules are exported
+	// before a single abc9_exe call maps them concurrently. The lut and box
+	// libraries are the same for every module and are only written once.
+	void map_concurrently(const std::vector<RTLIL::Module*> &modules)
+	{
+		std::string tempdir_name;
+		if (cleanup)
+			tempdir_name = get_base_tmpdir() + "/";
+		else
+			tempdir_name = "_tmp_";
+		tempdir_name += proc_program_prefix() + "yosys-abc-XXXXXX";
+		tempdir_name = make_temp_dir(tempdir_name);
+
+		std::vector<RTLIL::Module*> exported;
+		std::vector<std::string> module_dirs;
+		std::vector<bool> has_outputs;
+		for (auto mod : modules) {
+			if (mod->processes.size() > 0) {
+				log("Skipping module %s as it contains processes.\n", log_id(mod));
+				continue;
+			}
+
+			log_push();
+			active_design->select(mod);
+
+			if (exported.empty()) {
+				if (!lut_mode)
+					run_nocheck(stringf("abc9_ops -write_lut %s/input.lut", tempdir_name.c_str()));
+				if (box_file.empty())
+					run_nocheck(stringf("abc9_ops -write_box %s/input.box", tempdir_name.c_str()));
+			}
+
+			std::string module_dir = stringf("%s/%d", tempdir_name.c_str(), GetSize(exported));
+			if (!create_directory(module_dir))
+				log_error("Failed to create directory %s.\n", module_dir.c_str());
+			run_nocheck(stringf("write_xaiger -map %s/input.sym %s %s/input.xaig", module_dir.c_str(), dff_mode ? "-dff" : "", module_dir.c_str()));
+
+			int num_outputs = active_design->scratchpad_get_int("write_xaiger.num_outputs");
+
+			log("Extracted %d AND gates and %d wires from module `%s' to a netlist network with %d inputs and %d outputs.\n",
+					active_design->scratchpad_get_int("write_xaiger.num_ands"),
+					active_design->scratchpad_get_int("write_xaiger.num_wires"),
+					log_id(mod),
+					active_design->scratchpad_get_int("write_xaiger.num_inputs"),
+					num_outputs);
+			if (!num_outputs)
+				log("Don't call ABC as there is nothing to map.\n");
+
+			exported.push_back(mod);
+			module_dirs.push_back(module_dir);
+			has_outputs.push_back(num_outputs != 0);
+			active_design->selection().selected_modules.clear();
+			log_pop();
+		}
+
+		std::string abc9_exe_cmd = stringf("%s -j %d", exe_cmd.str().c_str(), jobs);
+		if (!lut_mode)
+			abc9_exe_cmd += stringf(" -lut %s/input.lut", tempdir_name.c_str());
+		if (box_file.empty())
+			abc9_exe_cmd += stringf(" -box %s/input.box", tempdir_name.c_str());
+		else
+			abc9_exe_cmd += stringf(" -box %s", box_file.c_str());
+		bool any_outputs = false;
+		for (int i = 0; i < GetSize(exported); i++)
+			if (has_outputs[i]) {
+				abc9_exe_cmd += stringf(" -cwd %s", module_dirs[i].c_str());
+				any_outputs = true;
+			}
+		if (any_outputs)
+			run_nocheck(abc9_exe_cmd);
+
+		// Reintegrate in module order so that the netlist (including the
+		// names of new objects) is the same as when mapping one at a time.
+		for (int i = 0; i < GetSize(exported); i++) {
+			auto mod = exported[i];
+			log_push();
+			active_design->select(mod);
+			if (has_outputs[i]) {
+				run_nocheck(stringf("read_aiger -xaiger -wideports -module_name %s$abc9 -map %s/input.sym %s/output.aig", log_id(mod), module_dirs[i].c_str(), module_dirs[i].c_str()));
+				run_nocheck(stringf("abc9_ops -reintegrate %s", dff_mode ? "-dff" : ""));
+			}
+			mod->check();
+			active_design->selection().selected_modules.clear();
+			log_pop();
+		}
+
+		if (cleanup) {
+			log("Removing temp directory.\n");
+			remove_directory(tempdir_name);
+		}
+	}
+
 	void script() override
 	{
 		if (check_label("check")) {
@@ -392,6 +496,12 @@ struct Abc9Pass : public ScriptPass
 				run("    read_aiger -xaiger -wideports -module_name <module-name>$abc9 -map <abc-temp-dir>/input.sym <abc-temp-dir>/output.aig");
 				run("    abc9_ops -reintegrate [-dff]");
 			}
+			else if (jobs != 1) {
+				auto selected_modules = active_design->selected_modules();
+				active_design->push_empty_selection();
+				map_concurrently(selected_modules);
+				active_design->pop_selection();
+			}
 			else {
 				auto selected_modules = active_design->selected_modules();
 				active_design->push_empty_selection();
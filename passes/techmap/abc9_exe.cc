@@ -24,6 +24,7 @@
 
 #include "kernel/register.h"
 #include "kernel/log.h"
+#include "kernel/threading.h"
 
 #ifndef _WIN32
 #  include <unistd.h>
@@ -164,9 +165,11 @@ struct abc9_output_filter
 	}
 };
 
-void abc9_module(RTLIL::Design *design, std::string script_file, std::string exe_file,
+// Writes the ABC script for the netlist in `tempdir_name` and returns the
+// command line which runs it.
+std::string abc9_prepare(RTLIL::Design *design, std::string script_file, std::string exe_file,
 		vector<int> lut_costs, bool dff_mode, std::string delay_target, std::string /*lutin_shared*/, bool fast_mode,
-		bool show_tempdir, std::string box_file, std::string lut_file,
+		std::string box_file, std::string lut_file,
 		std::vector<std::string> liberty_files, std::string wire_delay, std::string tempdir_name,
 		std::string constr_file, std::vector<std::string> dont_use_cells, std::vector<std::string> genlib_files)
 {
@@ -263,12 +266,8 @@ void abc9_module(RTLIL::Design *design, std::string script_file, std::string exe
 	fprintf(f, "%s\n", abc9_script.c_str());
 	fclose(f);
 
-	std::string buffer;
-
-	log_header(design, "Executing ABC9.\n");
-
 	if (!lut_costs.empty()) {
-		buffer = stringf("%s/lutdefs.txt", tempdir_name.c_str());
+		std::string buffer = stringf("%s/lutdefs.txt", tempdir_name.c_str());
 		f = fopen(buffer.c_str(), "wt");
 		if (f == NULL)
 			log_error("Opening %s for writing failed: %s\n", buffer.c_str(), strerror(errno));
@@ -277,10 +276,26 @@ void abc9_module(RTLIL::Design *design, std::string script_file, std::string exe
 		fclose(f);
 	}
 
-	buffer = stringf("\"%s\" -s -f %s/abc.script 2>&1", exe_file.c_str(), tempdir_name.c_str());
+	return stringf("\"%s\" -s -f %s/abc.script 2>&1", exe_file.c_str(), tempdir_name.c_str());
+}
+
+void abc9_check_result(const std::string &buffer, const std::string &tempdir_name, int ret)
+{
+	if (ret != 0) {
+		if (check_file_exists(stringf("%s/output.aig", tempdir_name.c_str())))
+			log_warning("ABC: execution of command \"%s\" failed: return code %d.\n", buffer.c_str(), ret);
+		else
+			log_error("ABC: execution of command \"%s\" failed: return code %d.\n", buffer.c_str(), ret);
+	}
+}
+
+void abc9_run(RTLIL::Design *design, const std::string &buffer, std::string exe_file, std::string tempdir_name, bool show_tempdir)
+{
+	log_header(design, "Executing ABC9.\n");
 	log("Running ABC command: %s\n", replace_tempdir(buffer, tempdir_name, show_tempdir).c_str());
 
 #ifndef YOSYS_LINK_ABC
+	(void)exe_file;
 	abc9_output_filter filt(tempdir_name, show_tempdir);
 	int ret = run_command(buffer, std::bind(&abc9_output_filter::next_line, filt, std::placeholders::_1));
 #else
@@ -327,13 +342,33 @@ void abc9_module(RTLIL::Design *design, std::string script_file, std::string exe
 		filt.next_line(line + "\n");
 	temp_stdouterr_r.close();
 #endif
-	if (ret != 0) {
-		if (check_file_exists(stringf("%s/output.aig", tempdir_name.c_str())))
-			log_warning("ABC: execution of command \"%s\" failed: return code %d.\n", buffer.c_str(), ret);
-		else
-			log_error("ABC: execution of command \"%s\" failed: return code %d.\n", buffer.c_str(), ret);
+	abc9_check_result(buffer, tempdir_name, ret);
+}
+
+#ifndef YOSYS_LINK_ABC
+// Runs ABC for all netlists in `tempdir_names`, using up to `jobs` concurrent
+// ABC processes. The output of each process is collected and logged (in the
+// order of `tempdir_names`) after all of them have finished.
+void abc9_run_parallel(RTLIL::Design *design, const std::vector<std::string> &buffers, const std::vector<std::string> &tempdir_names, bool show_tempdir, int jobs)
+{
+	int threads = thread_count(jobs, tempdir_names.size());
+	log("Running %d ABC processes on %d threads.\n", GetSize(tempdir_names), threads);
+
+	std::vector<std::string> outputs(tempdir_names.size());
+	std::vector<int> rets(tempdir_names.size());
+	parallel_for(threads, tempdir_names.size(), [&](size_t i) {
+		rets[i] = run_command(buffers[i], [&](const std::string &line) { outputs[i] += line; });
+	});
+
+	for (int i = 0; i < GetSize(tempdir_names); i++) {
+		log_header(design, "Executing ABC9.\n");
+		log("Running ABC command: %s\n", replace_tempdir(buffers[i], tempdir_names[i], show_tempdir).c_str());
+		abc9_output_filter filt(tempdir_names[i], show_tempdir);
+		filt.next_line(outputs[i]);
+		abc9_check_result(buffers[i], tempdir_names[i], rets[i]);
 	}
 }
+#endif
 
 struct Abc9ExePass : public Pass {
 	Abc9ExePass() : Pass("abc9_exe", "use ABC9 for technology mapping") { }
@@ -432,7 +467,13 @@ struct Abc9ExePass : public Pass {
 		log("    -cwd <dir>\n");
 		log("        use this as the current working directory, inside which the 'input.xaig'\n");
 		log("        file is expected. temporary files will be created in this directory, and\n");
-		log("        the mapped result will be written to 'output.aig'.\n");
+		log("        the mapped result will be written to 'output.aig'. this option can be\n");
+		log("        used multiple times to map several netlists with the same options.\n");
+		log("\n");
+		log("    -j <jobs>\n");
+		log("        when mapping several netlists, run up to this many ABC processes\n");
+		log("        concurrently (0 for one per hardware thread). the ABC output of each\n");
+		log("        netlist is logged after all processes have finished. default: 1\n");
 		log("\n");
 		log("Note that this is a logic optimization pass within Yosys that is calling ABC\n");
 		log("internally. This is not going to \"run ABC on your design\". It will instead run\n");
@@ -452,7 +493,8 @@ struct Abc9ExePass : public Pass {
 		std::string script_file, clk_str, box_file, lut_file, constr_file;
 		std::vector<std::string> liberty_files, genlib_files, dont_use_cells;
 		std::string delay_target, lutin_shared = "-S 1", wire_delay;
-		std::string tempdir_name;
+		std::vector<std::string> tempdir_names;
+		int jobs = 1;
 		bool fast_mode = false, dff_mode = false;
 		bool show_tempdir = false;
 		vector<int> lut_costs;
@@ -535,7 +577,11 @@ struct Abc9ExePass : public Pass {
 				continue;
 			}
 			if (arg == "-cwd" && argidx+1 < args.size()) {
-				tempdir_name = args[++argidx];
+				tempdir_names.push_back(args[++argidx]);
+				continue;
+			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				jobs = atoi(args[++argidx].c_str());
 				continue;
 			}
 			if (arg == "-liberty" && argidx+1 < args.size()) {
@@ -613,16 +659,31 @@ struct Abc9ExePass : public Pass {
 		if (!box_file.empty() && !is_absolute_path(box_file) && box_file[0] != '+')
 			box_file = std::string(pwd) + "/" + box_file;
 
-		if (tempdir_name.empty())
+		if (tempdir_names.empty())
 			log_cmd_error("abc9_exe '-cwd' option is mandatory.\n");
 
 		if (!genlib_files.empty() && !dont_use_cells.empty())
 			log_cmd_error("abc9_exe '-genlib' is incompatible with '-dont_use'.\n");
 
-		abc9_module(design, script_file, exe_file, lut_costs, dff_mode,
-				delay_target, lutin_shared, fast_mode, show_tempdir,
-				box_file, lut_file, liberty_files, wire_delay, tempdir_name,
-				constr_file, dont_use_cells, genlib_files);
+		std::vector<std::string> buffers;
+		for (auto &tempdir_name : tempdir_names)
+			buffers.push_back(abc9_prepare(design, script_file, exe_file, lut_costs, dff_mode,
+					delay_target, lutin_shared, fast_mode,
+					box_file, lut_file, liberty_files, wire_delay, tempdir_name,
+					constr_file, dont_use_cells, genlib_files));
+
+#ifndef YOSYS_LINK_ABC
+		if (thread_count(jobs, tempdir_names.size()) > 1) {
+			abc9_run_parallel(design, buffers, tempdir_names, show_tempdir, jobs);
+			return;
+		}
+#else
+		// the linked-in ABC is not reentrant
+		if (jobs != 1 && GetSize(tempdir_names) > 1)
+			log("ABC is linked into yosys, ignoring -j option.\n");
+#endif
+		for (int i = 0; i < GetSize(tempdir_names); i++)
+			abc9_run(design, buffers[i], exe_file, tempdir_names[i], show_tempdir);
 	}
 } Abc9ExePass;
 
@@ -0,0 +1,835 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Claire Xenia Wolf <claire@yosyshq.com>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+// [[CITE]] Priority cuts
+// Alan Mishchenko, Sungmin Cho, Satrajit Chatterjee, Robert Brayton. "Combinational and Sequential Mapping with Priority Cuts."
+// Proceedings of the 2007 IEEE/ACM International Conference on Computer-Aided Design (ICCAD '07), pp. 354-361.
+
+// [[CITE]] Area flow and exact area
+// Valavan Manohararajah, Stephen D. Brown, Zvonko G. Vranesic. "Heuristics for Area Minimization in LUT-Based FPGA Technology Mapping."
+// IEEE Transactions on Computer-Aided Design of Integrated Circuits and Systems, 25(11), pp. 2331-2340, 2006.
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include "kernel/timinginfo.h"
+#include "kernel/aignet.h"
+#include "kernel/threading.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+static const int MAX_LUT = 6;
+static const int DELAY_INF = INT_MAX / 4;
+
+struct Cut
+{
+	int size = 0;
+	int leaves[MAX_LUT];
+	uint64_t sign = 0;
+	int delay = 0;
+	// area flow, or exact area during exact area recovery
+	float area = 0;
+
+	// Returns whether the leaves of this cut are a subset of those of `other`.
+	bool dominates(const Cut &other) const
+	{
+		if (size > other.size || (sign & other.sign) != sign)
+			return false;
+		int j = 0;
+		for (int i = 0; i < size; i++) {
+			while (j < other.size && other.leaves[j] < leaves[i])
+				j++;
+			if (j == other.size || other.leaves[j] != leaves[i])
+				return false;
+		}
+		return true;
+	}
+};
+
+struct CutmapWorker
+{
+	enum NodeType : char { NODE_CONST, NODE_CI, NODE_BOX, NODE_AND };
+
+	RTLIL::Module *module;
+	SigMap sigmap;
+	TimingInfo &timing;
+	int lut_size, max_cuts, lut_delay, threads;
+
+	// The AIG. Nodes are numbered in topological order, node 0 is constant
+	// false. Literals are 2*node+complement.
+	std::vector<NodeType> types;
+	std::vector<int> fanin0, fanin1;
+	std::vector<int> levels;
+	// nodes sorted by level, with the nodes of level i starting at level_start[i]
+	std::vector<int> level_order, level_start;
+	// the bit driven by the positive phase of each node
+	std::vector<RTLIL::SigBit> node_bits;
+	std::vector<RTLIL::Cell*> node_cells;
+	// timing arcs (source literal, delay) of box outputs, and their fixed
+	// arrival times (e.g. clock-to-q delay)
+	dict<int, std::vector<std::pair<int, int>>> box_arcs;
+	std::vector<int> fixed_arrival;
+	// estimated number of fanouts in the AIG, for area flow
+	std::vector<int> fanouts;
+
+	// combinational outputs: sigmapped bits which are used outside of the
+	// mapped gates, their literals and setup times
+	std::vector<RTLIL::SigBit> co_bits;
+	std::vector<int> co_lits;
+	std::vector<int> co_setup;
+
+	// cut sets, with up to max_cuts cuts (excluding the trivial cut) per node
+	std::vector<Cut> cuts;
+	std::vector<int> num_cuts;
+	std::vector<Cut> best;
+	std::vector<int> arrival, required, refs;
+	std::vector<float> flow;
+	int depth_target;
+
+	dict<RTLIL::SigBit, RTLIL::Cell*> and_drivers, not_drivers;
+	dict<RTLIL::SigBit, std::pair<RTLIL::Cell*, TimingInfo::NameBit>> box_drivers;
+	dict<RTLIL::SigBit, int> bit_lits;
+	pool<RTLIL::Cell*> gates;
+
+	int and_count = 0, not_count = 0, lut_count = 0, depth = 0;
+
+	CutmapWorker(RTLIL::Module *module, TimingInfo &timing, int lut_size, int max_cuts, int lut_delay, int threads) :
+			module(module), sigmap(module), timing(timing), lut_size(lut_size), max_cuts(max_cuts), lut_delay(lut_delay), threads(threads)
+	{
+	}
+
+	const TimingInfo::ModuleTiming *cell_timing(RTLIL::Cell *cell)
+	{
+		RTLIL::Module *inst_module = module->design->module(cell->type);
+		if (inst_module == nullptr || !inst_module->get_blackbox_attribute())
+			return nullptr;
+		if (!timing.data.count(cell->type))
+			timing.setup_module(inst_module);
+		return &timing.data.at(cell->type);
+	}
+
+	int add_node(NodeType type, RTLIL::SigBit bit, int level)
+	{
+		types.push_back(type);
+		fanin0.push_back(0);
+		fanin1.push_back(0);
+		levels.push_back(level);
+		node_bits.push_back(bit);
+		node_cells.push_back(nullptr);
+		fixed_arrival.push_back(0);
+		fanouts.push_back(0);
+		return GetSize(types) - 1;
+	}
+
+	// Returns the bits that need a literal before the literal of `bit` (which
+	// must be sigmapped) can be created.
+	std::vector<RTLIL::SigBit> dependencies(const RTLIL::SigBit &bit)
+	{
+		std::vector<RTLIL::SigBit> deps;
+		if (auto it = and_drivers.find(bit); it != and_drivers.end()) {
+			deps.push_back(sigmap(it->second->getPort(ID::A)));
+			deps.push_back(sigmap(it->second->getPort(ID::B)));
+		} else if (auto it = not_drivers.find(bit); it != not_drivers.end()) {
+			deps.push_back(sigmap(it->second->getPort(ID::A)));
+		} else if (auto it = box_drivers.find(bit); it != box_drivers.end()) {
+			auto &t = timing.data.at(it->second.first->type);
+			for (auto &arc : t.comb) {
+				TimingInfo::NameBit src_name = arc.first.first;
+				if (arc.first.second == it->second.second)
+					if (auto src = src_name.get_connection(it->second.first))
+						deps.push_back(sigmap(*src));
+			}
+		}
+		return deps;
+	}
+
+	// Creates the literal of a sigmapped bit whose dependencies all have a
+	// literal already.
+	int create_literal(const RTLIL::SigBit &bit)
+	{
+		if (bit.wire == nullptr)
+			return bit == State::S1 ? 1 : 0;
+
+		if (auto it = and_drivers.find(bit); it != and_drivers.end()) {
+			int a = bit_lits.at(sigmap(it->second->getPort(ID::A)));
+			int b = bit_lits.at(sigmap(it->second->getPort(ID::B)));
+			int node = add_node(NODE_AND, it->second->getPort(ID::Y), std::max(levels[a >> 1], levels[b >> 1]) + 1);
+			fanin0[node] = a;
+			fanin1[node] = b;
+			fanouts[a >> 1]++;
+			fanouts[b >> 1]++;
+			node_cells[node] = it->second;
+			return 2 * node;
+		}
+
+		if (auto it = not_drivers.find(bit); it != not_drivers.end())
+			return bit_lits.at(sigmap(it->second->getPort(ID::A))) ^ 1;
+
+		if (auto it = box_drivers.find(bit); it != box_drivers.end()) {
+			RTLIL::Cell *cell = it->second.first;
+			auto &t = timing.data.at(cell->type);
+			std::vector<std::pair<int, int>> arcs;
+			int level = 0;
+			for (auto &arc : t.comb) {
+				TimingInfo::NameBit src_name = arc.first.first;
+				if (arc.first.second == it->second.second)
+					if (auto src = src_name.get_connection(cell)) {
+						int lit = bit_lits.at(sigmap(*src));
+						arcs.push_back({lit, arc.second});
+						level = std::max(level, levels[lit >> 1] + 1);
+					}
+			}
+			int node = add_node(NODE_BOX, bit, level);
+			auto arr = t.arrival.find(it->second.second);
+			if (arr != t.arrival.end())
+				fixed_arrival[node] = arr->second.first;
+			for (auto &arc : arcs)
+				fanouts[arc.first >> 1]++;
+			if (!arcs.empty())
+				box_arcs[node] = std::move(arcs);
+			return 2 * node;
+		}
+
+		return 2 * add_node(NODE_CI, bit, 0);
+	}
+
+	int literal(RTLIL::SigBit bit)
+	{
+		return aig_bit_literal(module, bit_lits, sigmap(bit),
+				[this](const RTLIL::SigBit &bit) { return dependencies(bit); },
+				[this](const RTLIL::SigBit &bit) { return create_literal(bit); });
+	}
+
+	void build_aig()
+	{
+		add_node(NODE_CONST, State::S0, 0);
+
+		pool<RTLIL::SigBit> co_pool;
+		dict<RTLIL::SigBit, int> setup;
+		for (auto cell : module->cells()) {
+			if (module->selected(cell) && cell->type.in(ID($_AND_), ID($_NOT_))) {
+				gates.insert(cell);
+				auto &drivers = cell->type == ID($_AND_) ? and_drivers : not_drivers;
+				drivers[sigmap(cell->getPort(ID::Y))] = cell;
+				if (cell->type == ID($_AND_))
+					and_count++;
+				else
+					not_count++;
+				continue;
+			}
+			auto t = cell_timing(cell);
+			for (auto &conn : cell->connections()) {
+				bool input = cell->input(conn.first), output = cell->output(conn.first);
+				if (!input && !output)
+					input = output = true;
+				for (int i = 0; i < GetSize(conn.second); i++) {
+					RTLIL::SigBit bit = sigmap(conn.second[i]);
+					if (bit.wire == nullptr)
+						continue;
+					TimingInfo::NameBit name_bit(conn.first, i);
+					if (input) {
+						co_pool.insert(bit);
+						if (t != nullptr)
+							if (auto it = t->required.find(name_bit); it != t->required.end())
+								setup[bit] = std::max(setup[bit], it->second.first);
+					}
+					if (output && t != nullptr)
+						box_drivers[bit] = {cell, name_bit};
+				}
+			}
+		}
+
+		for (auto wire : module->wires())
+			if (wire->port_output || wire->get_bool_attribute(ID::keep))
+				for (auto bit : sigmap(wire))
+					if (bit.wire != nullptr)
+						co_pool.insert(bit);
+
+		for (auto &bit : co_pool) {
+			co_bits.push_back(bit);
+			int lit = literal(bit);
+			co_lits.push_back(lit);
+			co_setup.push_back(setup.count(bit) ? setup.at(bit) : 0);
+			fanouts[lit >> 1]++;
+		}
+	}
+
+	Cut trivial_cut(int node)
+	{
+		Cut cut;
+		cut.size = 1;
+		cut.leaves[0] = node;
+		cut.sign = uint64_t(1) << (node & 63);
+		cut.delay = arrival[node];
+		cut.area = flow[node];
+		return cut;
+	}
+
+	// Updates the delay and area flow of a cut from its leaves.
+	void evaluate(Cut &cut)
+	{
+		cut.delay = 0;
+		cut.area = 1;
+		for (int i = 0; i < cut.size; i++) {
+			cut.delay = std::max(cut.delay, arrival[cut.leaves[i]]);
+			cut.area += flow[cut.leaves[i]];
+		}
+		cut.delay += lut_delay;
+	}
+
+	static bool merge(const Cut &a, const Cut &b, Cut &result, int lut_size)
+	{
+		int i = 0, j = 0, k = 0;
+		while (i < a.size || j < b.size) {
+			if (k == lut_size)
+				return false;
+			if (j == b.size || (i < a.size && a.leaves[i] < b.leaves[j]))
+				result.leaves[k++] = a.leaves[i++];
+			else if (i == a.size || b.leaves[j] < a.leaves[i])
+				result.leaves[k++] = b.leaves[j++];
+			else
+				result.leaves[k++] = a.leaves[i++], j++;
+		}
+		result.size = k;
+		result.sign = a.sign | b.sign;
+		return true;
+	}
+
+	// Cut ordering: by delay in the first pass, by area flow (among the cuts
+	// meeting the required time) in the area recovery passes.
+	bool better(const Cut &a, const Cut &b, bool area_mode, int req) const
+	{
+		if (area_mode) {
+			bool a_late = a.delay > req, b_late = b.delay > req;
+			if (a_late != b_late)
+				return !a_late;
+			if (a.area != b.area)
+				return a.area < b.area;
+			if (a.delay != b.delay)
+				return a.delay < b.delay;
+		} else {
+			if (a.delay != b.delay)
+				return a.delay < b.delay;
+			if (a.size != b.size)
+				return a.size < b.size;
+			if (a.area != b.area)
+				return a.area < b.area;
+		}
+		return a.size < b.size;
+	}
+
+	// Adds `cut` to the sorted priority list of `node`, keeping at most
+	// max_cuts cuts which are not dominated by other cuts of the list.
+	void insert_cut(Cut *list, int &count, const Cut &cut, bool area_mode, int req)
+	{
+		for (int i = 0; i < count; i++)
+			if (list[i].dominates(cut))
+				return;
+		int n = 0;
+		for (int i = 0; i < count; i++)
+			if (!cut.dominates(list[i]))
+				list[n++] = list[i];
+		count = n;
+
+		int pos = count;
+		while (pos > 0 && better(cut, list[pos - 1], area_mode, req))
+			pos--;
+		if (pos == max_cuts)
+			return;
+		if (count == max_cuts)
+			count--;
+		for (int i = count; i > pos; i--)
+			list[i] = list[i - 1];
+		list[pos] = cut;
+		count++;
+	}
+
+	void compute_box(int node)
+	{
+		int arr = fixed_arrival[node];
+		auto it = box_arcs.find(node);
+		if (it != box_arcs.end())
+			for (auto &arc : it->second)
+				arr = std::max(arr, arrival[arc.first >> 1] + arc.second);
+		arrival[node] = arr;
+		flow[node] = 0;
+	}
+
+	void compute_cuts(int node, bool area_mode)
+	{
+		Cut *list = cuts.data() + size_t(node) * max_cuts;
+		int count = 0;
+		int req = required[node];
+
+		if (area_mode) {
+			// keep the previous best cut available, which guarantees that
+			// the required time can be met
+			evaluate(best[node]);
+			insert_cut(list, count, best[node], area_mode, req);
+		}
+
+		int a = fanin0[node] >> 1, b = fanin1[node] >> 1;
+		Cut *list_a = cuts.data() + size_t(a) * max_cuts;
+		Cut *list_b = cuts.data() + size_t(b) * max_cuts;
+		int count_a = types[a] == NODE_AND ? num_cuts[a] : 0;
+		int count_b = types[b] == NODE_AND ? num_cuts[b] : 0;
+		Cut trivial_a = trivial_cut(a), trivial_b = trivial_cut(b);
+
+		for (int i = -1; i < count_a; i++) {
+			const Cut &cut_a = i < 0 ? trivial_a : list_a[i];
+			for (int j = -1; j < count_b; j++) {
+				const Cut &cut_b = j < 0 ? trivial_b : list_b[j];
+				Cut cut;
+				if (!merge(cut_a, cut_b, cut, lut_size))
+					continue;
+				evaluate(cut);
+				insert_cut(list, count, cut, area_mode, req);
+			}
+		}
+
+		log_assert(count > 0);
+		num_cuts[node] = count;
+		best[node] = list[0];
+		arrival[node] = list[0].delay;
+		flow[node] = list[0].area / std::max(fanouts[node], 1);
+	}
+
+	// Sorts the nodes by level into `level_order`.
+	void sort_levels()
+	{
+		level_start.assign(1, 0);
+		for (int node = 0; node < GetSize(types); node++)
+			if (GetSize(level_start) <= levels[node] + 1)
+				level_start.resize(levels[node] + 2, 0);
+		for (int node = 0; node < GetSize(types); node++)
+			level_start[levels[node] + 1]++;
+		for (int i = 1; i < GetSize(level_start); i++)
+			level_start[i] += level_start[i - 1];
+		level_order.resize(types.size());
+		std::vector<int> pos(level_start.begin(), level_start.end() - 1);
+		for (int node = 0; node < GetSize(types); node++)
+			level_order[pos[levels[node]]++] = node;
+	}
+
+	// One mapping pass over all nodes, in parallel for the nodes of a level
+	// with at least two chunks of nodes. Returns the number of such levels.
+	int map_pass(bool area_mode)
+	{
+		const int chunk = 256;
+		int parallel_levels = 0;
+		// compute_box() looks up box_arcs from the worker threads, which must
+		// not be the first lookup since it grew, as that would rehash it
+		box_arcs.count(0);
+		for (int level = 0; level + 1 < GetSize(level_start); level++) {
+			int start = level_start[level], count = level_start[level + 1] - start;
+			bool parallel = count >= 2 * chunk && thread_count(threads) > 1;
+			parallel_levels += parallel;
+			parallel_for(parallel ? threads : 1, (count + chunk - 1) / chunk, [&](size_t c) {
+				int end = std::min<int>(start + (c + 1) * chunk, start + count);
+				for (int i = start + c * chunk; i < end; i++) {
+					int node = level_order[i];
+					switch (types[node]) {
+					case NODE_AND:
+						compute_cuts(node, area_mode);
+						break;
+					case NODE_BOX:
+						compute_box(node);
+						break;
+					default:
+						arrival[node] = fixed_arrival[node];
+						flow[node] = 0;
+					}
+				}
+			});
+		}
+		return parallel_levels;
+	}
+
+	// Computes the references and required times of the current mapping.
+	// Returns the depth of the mapping.
+	int compute_required()
+	{
+		int n = GetSize(types);
+		refs.assign(n, 0);
+		required.assign(n, DELAY_INF);
+
+		int max_arrival = 0;
+		for (int i = 0; i < GetSize(co_lits); i++)
+			max_arrival = std::max(max_arrival, arrival[co_lits[i] >> 1] + co_setup[i]);
+		if (depth_target < max_arrival)
+			depth_target = max_arrival;
+
+		for (int i = 0; i < GetSize(co_lits); i++) {
+			int node = co_lits[i] >> 1;
+			refs[node]++;
+			required[node] = std::min(required[node], depth_target - co_setup[i]);
+		}
+		for (int node = n - 1; node > 0; node--) {
+			if (refs[node] == 0)
+				continue;
+			if (types[node] == NODE_AND) {
+				auto &cut = best[node];
+				for (int i = 0; i < cut.size; i++) {
+					refs[cut.leaves[i]]++;
+					required[cut.leaves[i]] = std::min(required[cut.leaves[i]], required[node] - lut_delay);
+				}
+			} else if (types[node] == NODE_BOX) {
+				auto it = box_arcs.find(node);
+				if (it != box_arcs.end())
+					for (auto &arc : it->second)
+						required[arc.first >> 1] = std::min(required[arc.first >> 1], required[node] - arc.second);
+			}
+		}
+		return max_arrival;
+	}
+
+	int count_luts()
+	{
+		int count = 0;
+		for (int node = 0; node < GetSize(types); node++)
+			if (types[node] == NODE_AND && refs[node] > 0)
+				count++;
+		return count;
+	}
+
+	// Reference (or dereference) the cone of a cut, returns the number of
+	// LUTs which got referenced (or dereferenced).
+	int cut_ref(const Cut &cut, int delta, std::vector<int> &stack)
+	{
+		int area = 1;
+		for (int i = 0; i < cut.size; i++)
+			stack.push_back(cut.leaves[i]);
+		while (!stack.empty()) {
+			int node = stack.back();
+			stack.pop_back();
+			if (types[node] != NODE_AND)
+				continue;
+			int old_refs = refs[node];
+			refs[node] += delta;
+			if ((delta > 0 && old_refs == 0) || (delta < 0 && refs[node] == 0)) {
+				area++;
+				for (int i = 0; i < best[node].size; i++)
+					stack.push_back(best[node].leaves[i]);
+			}
+		}
+		return area;
+	}
+
+	void exact_area_pass()
+	{
+		std::vector<int> stack;
+		for (int node = 1; node < GetSize(types); node++) {
+			if (types[node] == NODE_BOX)
+				compute_box(node);
+			if (types[node] != NODE_AND)
+				continue;
+			if (refs[node] == 0) {
+				evaluate(best[node]);
+				arrival[node] = best[node].delay;
+				continue;
+			}
+
+			cut_ref(best[node], -1, stack);
+			Cut *list = cuts.data() + size_t(node) * max_cuts;
+			Cut chosen = best[node];
+			evaluate(chosen);
+			chosen.area = cut_ref(chosen, 1, stack);
+			cut_ref(chosen, -1, stack);
+			for (int i = 0; i < num_cuts[node]; i++) {
+				Cut cut = list[i];
+				evaluate(cut);
+				if (cut.delay > required[node])
+					continue;
+				cut.area = cut_ref(cut, 1, stack);
+				cut_ref(cut, -1, stack);
+				if (cut.area < chosen.area || (cut.area == chosen.area && cut.delay < chosen.delay))
+					chosen = cut;
+			}
+			best[node] = chosen;
+			arrival[node] = chosen.delay;
+			cut_ref(chosen, 1, stack);
+		}
+	}
+
+	// Simulates the cone of the best cut of `root`.
+	RTLIL::Const truth_table(int root)
+	{
+		static const uint64_t var_masks[MAX_LUT] = {
+			0xAAAAAAAAAAAAAAAAull, 0xCCCCCCCCCCCCCCCCull, 0xF0F0F0F0F0F0F0F0ull,
+			0xFF00FF00FF00FF00ull, 0xFFFF0000FFFF0000ull, 0xFFFFFFFF00000000ull,
+		};
+		auto &cut = best[root];
+		dict<int, uint64_t> values;
+		for (int i = 0; i < cut.size; i++)
+			values[cut.leaves[i]] = var_masks[i];
+
+		std::vector<int> cone, stack = {root};
+		pool<int> visited;
+		while (!stack.empty()) {
+			int node = stack.back();
+			stack.pop_back();
+			if (values.count(node) || !visited.insert(node).second)
+				continue;
+			log_assert(types[node] == NODE_AND);
+			cone.push_back(node);
+			stack.push_back(fanin0[node] >> 1);
+			stack.push_back(fanin1[node] >> 1);
+		}
+		std::sort(cone.begin(), cone.end());
+		for (int node : cone) {
+			uint64_t a = values.at(fanin0[node] >> 1), b = values.at(fanin1[node] >> 1);
+			if (fanin0[node] & 1)
+				a = ~a;
+			if (fanin1[node] & 1)
+				b = ~b;
+			values[node] = a & b;
+		}
+
+		uint64_t value = values.at(root);
+		RTLIL::Const table(State::S0, 1 << cut.size);
+		for (int i = 0; i < (1 << cut.size); i++)
+			if ((value >> i) & 1)
+				table.bits()[i] = State::S1;
+		return table;
+	}
+
+	void write_luts()
+	{
+		int n = GetSize(types);
+		std::vector<bool> need_pos(n), need_neg(n);
+		for (int node = 0; node < n; node++)
+			if (types[node] == NODE_AND && refs[node] > 0)
+				for (int i = 0; i < best[node].size; i++)
+					need_pos[best[node].leaves[i]] = true;
+		dict<int, RTLIL::SigBit> neg_bits;
+		for (int i = 0; i < GetSize(co_lits); i++) {
+			int node = co_lits[i] >> 1;
+			if (co_lits[i] & 1) {
+				need_neg[node] = true;
+				if (!neg_bits.count(node) && not_drivers.count(co_bits[i]))
+					neg_bits[node] = co_bits[i];
+			} else
+				need_pos[node] = true;
+		}
+
+		auto leaf_bit = [&](int node) -> RTLIL::SigBit {
+			return node == 0 ? RTLIL::SigBit(State::S0) : node_bits[node];
+		};
+
+		for (int node = 1; node < n; node++) {
+			if (types[node] == NODE_AND && (need_pos[node] || need_neg[node])) {
+				RTLIL::SigSpec lut_a;
+				for (int i = 0; i < best[node].size; i++)
+					lut_a.append(leaf_bit(best[node].leaves[i]));
+				RTLIL::Const table = truth_table(node);
+				if (need_pos[node]) {
+					RTLIL::Cell *lut = module->addLut(NEW_ID, lut_a, node_bits[node], table);
+					lut->add_strpool_attribute(ID::src, node_cells[node]->get_strpool_attribute(ID::src));
+					lut_count++;
+				}
+				if (need_neg[node]) {
+					for (auto &bit : table.bits())
+						bit = bit == State::S1 ? State::S0 : State::S1;
+					if (!neg_bits.count(node))
+						neg_bits[node] = module->addWire(NEW_ID);
+					RTLIL::Cell *lut = module->addLut(NEW_ID, lut_a, neg_bits.at(node), table);
+					lut->add_strpool_attribute(ID::src, node_cells[node]->get_strpool_attribute(ID::src));
+					lut_count++;
+				}
+			} else if (need_neg[node]) {
+				if (!neg_bits.count(node))
+					neg_bits[node] = module->addWire(NEW_ID);
+				module->addLut(NEW_ID, node_bits[node], neg_bits.at(node), RTLIL::Const::from_string("01"));
+				lut_count++;
+			}
+		}
+
+		for (int i = 0; i < GetSize(co_lits); i++) {
+			int node = co_lits[i] >> 1;
+			RTLIL::SigBit driver;
+			if (co_lits[i] & 1)
+				driver = node == 0 ? RTLIL::SigBit(State::S1) : neg_bits.at(node);
+			else
+				driver = leaf_bit(node);
+			if (sigmap(driver) != co_bits[i])
+				module->connect(co_bits[i], driver);
+		}
+
+		for (auto cell : gates)
+			module->remove(cell);
+	}
+
+	void run(int target, int flow_rounds, int exact_rounds)
+	{
+		log("Mapping module %s.\n", log_id(module));
+		log_push();
+		build_aig();
+
+		int n = GetSize(types);
+		cuts.resize(size_t(n) * max_cuts);
+		num_cuts.assign(n, 0);
+		best.resize(n);
+		arrival.assign(n, 0);
+		flow.assign(n, 0);
+		required.assign(n, DELAY_INF);
+		depth_target = 0;
+		sort_levels();
+
+		log("Extracted %d AND gates and %d inverters from %d outputs.\n", and_count, not_count, GetSize(co_bits));
+
+		int parallel_levels = map_pass(false);
+		if (parallel_levels > 0)
+			log_debug("Enumerated the cuts of %d levels on multiple threads.\n", parallel_levels);
+		depth = compute_required();
+		if (target > 0) {
+			if (target < depth)
+				log_warning("Module %s: delay target %d cannot be met, using %d instead.\n", log_id(module), target, depth);
+			else
+				depth_target = target;
+			depth = compute_required();
+		}
+		log("Delay oriented mapping: %d LUTs, depth %d.\n", count_luts(), depth);
+
+		for (int round = 0; round < flow_rounds; round++) {
+			map_pass(true);
+			depth = compute_required();
+			log("Area flow recovery: %d LUTs, depth %d.\n", count_luts(), depth);
+		}
+
+		for (int round = 0; round < exact_rounds; round++) {
+			exact_area_pass();
+			depth = compute_required();
+			log("Exact area recovery: %d LUTs, depth %d.\n", count_luts(), depth);
+		}
+
+		write_luts();
+		log("Mapped to %d LUTs.\n", lut_count);
+		log_pop();
+	}
+};
+
+struct CutmapPass : public Pass {
+	CutmapPass() : Pass("cutmap", "map AIGs to LUTs using priority cuts") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    cutmap [options] [selection]\n");
+		log("\n");
+		log("This pass maps $_AND_ and $_NOT_ cells (as created by `aigmap`) to $lut cells\n");
+		log("using priority cut enumeration. A delay optimal mapping (with respect to the\n");
+		log("enumerated cuts) is computed first, which is then improved with area flow and\n");
+		log("exact area recovery while keeping the depth.\n");
+		log("\n");
+		log("All other cells are kept. Their inputs are the outputs of the mapped logic and\n");
+		log("their outputs are primary inputs. For instances of blackbox or whitebox modules\n");
+		log("with specify blocks (see also `abc9`), the combinational delays, arrival times\n");
+		log("and setup times are taken into account. These are given in the same units as\n");
+		log("the LUT delay (see -lutdelay).\n");
+		log("\n");
+		log("    -maxlut <k>\n");
+		log("        map to LUTs with at most k inputs (between 2 and %d). default: 4\n", MAX_LUT);
+		log("\n");
+		log("    -cuts <n>\n");
+		log("        number of priority cuts kept for each node. default: 8\n");
+		log("\n");
+		log("    -lutdelay <delay>\n");
+		log("        delay of a LUT. default: 1\n");
+		log("\n");
+		log("    -D <delay>\n");
+		log("        target delay of the mapped logic. by default the minimum delay found\n");
+		log("        in the first pass is used. a larger target allows more area recovery.\n");
+		log("\n");
+		log("    -flow <n>\n");
+		log("        number of area flow recovery passes. default: 1\n");
+		log("\n");
+		log("    -exact <n>\n");
+		log("        number of exact area recovery passes. default: 2\n");
+		log("\n");
+		log("    -j <threads>\n");
+		log("        number of threads used for cut enumeration (0 for one per hardware\n");
+		log("        thread). the result does not depend on this option. default: 1\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) override
+	{
+		int lut_size = 4, max_cuts = 8, lut_delay = 1, target = 0;
+		int flow_rounds = 1, exact_rounds = 2, threads = 1;
+
+		log_header(design, "Executing CUTMAP pass (map AIGs to LUTs using priority cuts).\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-maxlut" && argidx+1 < args.size()) {
+				lut_size = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-cuts" && argidx+1 < args.size()) {
+				max_cuts = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-lutdelay" && argidx+1 < args.size()) {
+				lut_delay = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-D" && argidx+1 < args.size()) {
+				target = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-flow" && argidx+1 < args.size()) {
+				flow_rounds = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-exact" && argidx+1 < args.size()) {
+				exact_rounds = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				threads = atoi(args[++argidx].c_str());
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		if (lut_size < 2 || lut_size > MAX_LUT)
+			log_cmd_error("LUT size must be between 2 and %d.\n", MAX_LUT);
+		if (max_cuts < 1)
+			log_cmd_error("Number of cuts must be at least 1.\n");
+		if (lut_delay < 1)
+			log_cmd_error("LUT delay must be at least 1.\n");
+
+		TimingInfo timing;
+		int and_count = 0, not_count = 0, lut_count = 0, depth = 0;
+		for (auto module : design->selected_modules()) {
+			if (module->has_processes_warn())
+				continue;
+			CutmapWorker worker(module, timing, lut_size, max_cuts, lut_delay, threads);
+			worker.run(target, flow_rounds, exact_rounds);
+			and_count += worker.and_count;
+			not_count += worker.not_count;
+			lut_count += worker.lut_count;
+			depth = std::max(depth, worker.depth);
+		}
+
+		log("Mapped %d AND gates and %d inverters to %d LUTs with a maximum depth of %d.\n", and_count, not_count, lut_count, depth);
+	}
+} CutmapPass;
+
+PRIVATE_NAMESPACE_END
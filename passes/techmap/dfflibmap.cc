@@ -565,7 +565,7 @@ struct DfflibmapPass : public Pass {
 	void help() override
 	{
 		log("\n");
-		log("    dfflibmap [-prepare] [-map-only] [-info] [-dont_use <cell_name>] -liberty <file> [selection]\n");
+		log("    dfflibmap [-prepare] [-map-only] [-info] [-dont_use <cell_name>] [-j <threads>] -liberty <file> [selection]\n");
 		log("\n");
 		log("Map internal flip-flop cells to the flip-flop cells in the technology\n");
 		log("library specified in the given liberty files.\n");
@@ -591,6 +591,10 @@ struct DfflibmapPass : public Pass {
 		log("This argument can be called multiple times with different cell names. This\n");
 		log("argument also supports simple glob patterns in the cell name.\n");
 		log("\n");
+		log("When called with -j, the liberty files are parsed using the given number of\n");
+		log("threads (0 for one thread per core). Only the flip-flop cells of the liberty\n");
+		log("files are kept in memory in either case.\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
@@ -604,6 +608,12 @@ struct DfflibmapPass : public Pass {
 		std::vector<std::string> liberty_files;
 		std::vector<std::string> dont_use_cells;
 
+		LibertyParserOptions parser_options;
+		parser_options.cells_only = true;
+		parser_options.cell_filter = [](const LibertyAst *cell) { return cell->find("ff") != nullptr; };
+		parser_options.cell_attributes = {"area", "dont_use", "ff", "clocked_on", "next_state", "clear", "preset",
+				"clear_preset_var1", "clear_preset_var2", "pin", "direction", "function"};
+
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++)
 		{
@@ -630,6 +640,10 @@ struct DfflibmapPass : public Pass {
 				dont_use_cells.push_back(args[++argidx]);
 				continue;
 			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				parser_options.threads = atoi(args[++argidx].c_str());
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -650,7 +664,7 @@ struct DfflibmapPass : public Pass {
 		LibertyMergedCells merged;
 		for (auto path : liberty_files) {
 			std::istream* f = uncompressed(path);
-			LibertyParser p(*f, path);
+			LibertyParser p(*f, path, parser_options);
 			merged.merge(p);
 			delete f;
 		}
@@ -20,6 +20,7 @@
 #include "kernel/yosys.h"
 #include "kernel/utils.h"
 #include "kernel/sigtools.h"
+#include "kernel/threading.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -40,12 +41,6 @@ IdString concat_name(RTLIL::Cell *cell, IdString object_name, const std::string
 	}
 }
 
-template<class T>
-IdString map_name(RTLIL::Cell *cell, T *object, const std::string &separator = ".")
-{
-	return cell->module->uniquify(concat_name(cell, object->name, separator));
-}
-
 void map_sigspec(const dict<RTLIL::Wire*, RTLIL::Wire*> &map, RTLIL::SigSpec &sig, RTLIL::Module *into = nullptr)
 {
 	vector<SigChunk> chunks = sig;
@@ -55,15 +50,158 @@ void map_sigspec(const dict<RTLIL::Wire*, RTLIL::Wire*> &map, RTLIL::SigSpec &si
 	sig = chunks;
 }
 
+// A template module prepared for being instantiated many times. The signals of
+// the template are stored with the index of each wire in `wires`, so that an
+// instance only has to substitute its own wires, and the parts of the
+// hierarchical names which do not depend on the instance are concatenated
+// once.
+struct FlattenStamp
+{
+	struct Name {
+		bool is_public;
+		// separator and object name, without the leading '\' resp. "$flatten"
+		std::string suffix;
+	};
+
+	struct Sig {
+		std::vector<RTLIL::SigChunk> chunks;
+		// the index of the wire of each chunk, or -1 for constant chunks
+		std::vector<int> wires;
+	};
+
+	struct CellInfo {
+		RTLIL::Cell *cell;
+		// in the order of the connections of the cell
+		std::vector<Sig> ports;
+		// index of the memory given by the MEMID parameter, -1 if there is
+		// none, -2 for memory cells which refer to a memory of an instance
+		int memory;
+	};
+
+	RTLIL::Module *tpl;
+	std::vector<RTLIL::Memory*> memories;
+	std::vector<RTLIL::Wire*> wires;
+	std::vector<RTLIL::Process*> processes;
+	std::vector<CellInfo> cells;
+	std::vector<std::pair<Sig, Sig>> connections;
+
+	// the names of the objects in the order of the vectors above
+	std::vector<Name> names;
+
+	dict<RTLIL::Wire*, int> wire_index;
+	dict<IdString, IdString> positional_ports;
+	pool<SigBit> driven;
+
+	FlattenStamp(RTLIL::Module *tpl, const std::string &separator) : tpl(tpl)
+	{
+		auto add_name = [&](IdString object_name) {
+			if (object_name[0] == '\\')
+				names.push_back({true, separator + (object_name.c_str() + 1)});
+			else {
+				const char *str = object_name.c_str();
+				if (strncmp(str, "$flatten", 8) == 0)
+					str += 8;
+				names.push_back({false, separator + str});
+			}
+		};
+
+		dict<IdString, int> memory_index;
+		for (auto &it : tpl->memories) {
+			memory_index[it.first] = GetSize(memories);
+			memories.push_back(it.second);
+			add_name(it.second->name);
+		}
+
+		for (auto wire : tpl->wires()) {
+			wire_index[wire] = GetSize(wires);
+			wires.push_back(wire);
+			add_name(wire->name);
+			if (wire->port_id > 0)
+				positional_ports.emplace(stringf("$%d", wire->port_id), wire->name);
+		}
+
+		for (auto &it : tpl->processes) {
+			processes.push_back(it.second);
+			add_name(it.second->name);
+		}
+
+		for (auto cell : tpl->cells()) {
+			CellInfo info;
+			info.cell = cell;
+			for (auto &conn : cell->connections()) {
+				info.ports.push_back(compile(conn.second));
+				if (cell->output(conn.first))
+					for (auto bit : conn.second)
+						driven.insert(bit);
+			}
+			if (cell->has_memid())
+				info.memory = memory_index.at(cell->getParam(ID::MEMID).decode_string());
+			else if (cell->is_mem_cell())
+				info.memory = -2;
+			else
+				info.memory = -1;
+			cells.push_back(std::move(info));
+			add_name(cell->name);
+		}
+
+		for (auto &conn : tpl->connections()) {
+			connections.emplace_back(compile(conn.first), compile(conn.second));
+			for (auto bit : conn.first)
+				driven.insert(bit);
+		}
+	}
+
+	Sig compile(const RTLIL::SigSpec &sig) const
+	{
+		Sig result;
+		result.chunks = sig.chunks();
+		for (auto &chunk : result.chunks)
+			result.wires.push_back(chunk.wire ? wire_index.at(chunk.wire) : -1);
+		return result;
+	}
+
+	static RTLIL::SigSpec instantiate(const Sig &sig, const std::vector<RTLIL::Wire*> &new_wires)
+	{
+		std::vector<RTLIL::SigChunk> chunks = sig.chunks;
+		for (int i = 0; i < GetSize(chunks); i++)
+			if (sig.wires[i] >= 0)
+				chunks[i].wire = new_wires[sig.wires[i]];
+		return chunks;
+	}
+
+	// Returns the hierarchical names of all objects for an instance named
+	// `cell_name`. Only uses strings, so it can be called from worker threads.
+	std::vector<std::string> instance_names(const std::string &cell_name) const
+	{
+		std::vector<std::string> result;
+		result.reserve(names.size());
+		for (auto &name : names) {
+			std::string &str = result.emplace_back();
+			str.reserve(8 + cell_name.size() + name.suffix.size());
+			if (!name.is_public)
+				str += "$flatten";
+			str += cell_name;
+			str += name.suffix;
+		}
+		return result;
+	}
+};
+
 struct FlattenWorker
 {
 	bool ignore_wb = false;
 	bool create_scopeinfo = true;
 	bool create_scopename = false;
 	std::string separator = ".";
+	int threads = 1;
+
+	dict<RTLIL::Module*, std::unique_ptr<FlattenStamp>> stamps;
+
+	// the number of names generated at once on multiple threads
+	static constexpr int name_batch_size = 65536;
 
 	template<class T>
-	void map_attributes(RTLIL::Cell *cell, T *object, IdString orig_object_name)
+	void map_attributes(RTLIL::Cell *cell, const std::string &cell_hdlname, T *object, IdString orig_object_name)
 	{
 		if (!create_scopeinfo && object->has_attribute(ID::src))
 			object->add_strpool_attribute(ID::src, cell->get_strpool_attribute(ID::src));
@@ -72,15 +210,7 @@ struct FlattenWorker
 		// If the '-scopename' option is used, also preserve the containing scope of private objects if their scope is fully public.
 		if (cell->name[0] == '\\') {
 			if (object->has_attribute(ID::hdlname) || orig_object_name[0] == '\\') {
-				std::string new_hdlname;
-
-				if (cell->has_attribute(ID::hdlname)) {
-					new_hdlname = cell->get_string_attribute(ID(hdlname));
-				} else {
-					log_assert(!cell->name.empty());
-					new_hdlname = cell->name.c_str() + 1;
-				}
-				new_hdlname += ' ';
+				std::string new_hdlname = cell_hdlname + ' ';
 
 				if (object->has_attribute(ID::hdlname)) {
 					new_hdlname += object->get_string_attribute(ID(hdlname));
@@ -90,15 +220,7 @@ struct FlattenWorker
 				}
 				object->set_string_attribute(ID(hdlname), new_hdlname);
 			} else if (object->has_attribute(ID(scopename))) {
-				std::string new_scopename;
-
-				if (cell->has_attribute(ID::hdlname)) {
-					new_scopename = cell->get_string_attribute(ID(hdlname));
-				} else {
-					log_assert(!cell->name.empty());
-					new_scopename = cell->name.c_str() + 1;
-				}
-				new_scopename += ' ';
+				std::string new_scopename = cell_hdlname + ' ';
 				new_scopename += object->get_string_attribute(ID(scopename));
 				object->set_string_attribute(ID(scopename), new_scopename);
 			} else if (create_scopename) {
@@ -108,27 +230,90 @@ struct FlattenWorker
 		}
 	}
 
-	void flatten_cell(RTLIL::Design *design, RTLIL::Module *module, RTLIL::Cell *cell, RTLIL::Module *tpl, SigMap &sigmap, std::vector<RTLIL::Cell*> &new_cells, const std::string &separator)
+	// Returns the module which replaces `cell` when flattening, or nullptr if
+	// the cell is kept.
+	RTLIL::Module *flattened_template(RTLIL::Design *design, RTLIL::Cell *cell)
+	{
+		RTLIL::Module *tpl = design->module(cell->type);
+		if (tpl == nullptr || tpl->get_blackbox_attribute(ignore_wb))
+			return nullptr;
+		if (cell->get_bool_attribute(ID::keep_hierarchy) || tpl->get_bool_attribute(ID::keep_hierarchy))
+			return nullptr;
+		return tpl;
+	}
+
+	const FlattenStamp &get_stamp(RTLIL::Module *tpl)
+	{
+		auto &stamp = stamps[tpl];
+		if (stamp == nullptr)
+			stamp = std::make_unique<FlattenStamp>(tpl, separator);
+		return *stamp;
+	}
+
+	// Generates the hierarchical names for `cell` and the instances after it
+	// on the worklist (which are flattened next), using the worker threads.
+	// The batch ends before it exceeds name_batch_size names, but always
+	// contains `cell`.
+	void prepare_names(RTLIL::Design *design, const std::vector<RTLIL::Cell*> &worklist, RTLIL::Cell *cell,
+			dict<RTLIL::Cell*, std::vector<std::string>> &instance_names)
+	{
+		std::vector<std::pair<std::string, const FlattenStamp*>> batch;
+		batch.emplace_back(cell->name.str(), &get_stamp(design->module(cell->type)));
+		std::vector<RTLIL::Cell*> cells = {cell};
+		int num_names = GetSize(batch.back().second->names);
+		for (int i = GetSize(worklist) - 1; i >= 0; i--) {
+			RTLIL::Module *tpl = flattened_template(design, worklist[i]);
+			if (tpl == nullptr || instance_names.count(worklist[i]))
+				continue;
+			const FlattenStamp *stamp = &get_stamp(tpl);
+			num_names += GetSize(stamp->names);
+			if (num_names > name_batch_size)
+				break;
+			batch.emplace_back(worklist[i]->name.str(), stamp);
+			cells.push_back(worklist[i]);
+		}
+
+		std::vector<std::vector<std::string>> results(batch.size());
+		parallel_for(threads, batch.size(), [&](size_t i) {
+			results[i] = batch[i].second->instance_names(batch[i].first);
+		});
+
+		for (int i = 0; i < GetSize(cells); i++)
+			instance_names[cells[i]] = std::move(results[i]);
+	}
+
+	void flatten_cell(RTLIL::Design *design, RTLIL::Module *module, RTLIL::Cell *cell, const FlattenStamp &stamp, const std::vector<std::string> &names, SigMap &sigmap, std::vector<RTLIL::Cell*> &new_cells)
 	{
+		RTLIL::Module *tpl = stamp.tpl;
+		auto name_it = names.begin();
+
+		std::string cell_hdlname;
+		if (cell->name[0] == '\\') {
+			if (cell->has_attribute(ID::hdlname)) {
+				cell_hdlname = cell->get_string_attribute(ID(hdlname));
+			} else {
+				log_assert(!cell->name.empty());
+				cell_hdlname = cell->name.c_str() + 1;
+			}
+		}
+
 		// Copy the contents of the flattened cell
 
-		dict<IdString, IdString> memory_map;
-		for (auto &tpl_memory_it : tpl->memories) {
-			RTLIL::Memory *new_memory = module->addMemory(map_name(cell, tpl_memory_it.second, separator), tpl_memory_it.second);
-			map_attributes(cell, new_memory, tpl_memory_it.second->name);
-			memory_map[tpl_memory_it.first] = new_memory->name;
+		std::vector<RTLIL::Memory*> new_memories;
+		for (auto tpl_memory : stamp.memories) {
+			RTLIL::Memory *new_memory = module->addMemory(module->uniquify(*name_it++), tpl_memory);
+			map_attributes(cell, cell_hdlname, new_memory, tpl_memory->name);
+			new_memories.push_back(new_memory);
 			design->select(module, new_memory);
 		}
 
-		dict<RTLIL::Wire*, RTLIL::Wire*> wire_map;
-		dict<IdString, IdString> positional_ports;
-		for (auto tpl_wire : tpl->wires()) {
-			if (tpl_wire->port_id > 0)
-				positional_ports.emplace(stringf("$%d", tpl_wire->port_id), tpl_wire->name);
-
+		std::vector<RTLIL::Wire*> new_wires;
+		new_wires.reserve(stamp.wires.size());
+		for (auto tpl_wire : stamp.wires) {
+			IdString name = *name_it++;
 			RTLIL::Wire *new_wire = nullptr;
 			if (tpl_wire->name[0] == '\\') {
-				RTLIL::Wire *hier_wire = module->wire(concat_name(cell, tpl_wire->name, separator));
+				RTLIL::Wire *hier_wire = module->wire(name);
 				if (hier_wire != nullptr && hier_wire->get_bool_attribute(ID::hierconn)) {
 					hier_wire->attributes.erase(ID::hierconn);
 					if (GetSize(hier_wire) < GetSize(tpl_wire)) {
@@ -140,67 +325,71 @@ struct FlattenWorker
 				}
 			}
 			if (new_wire == nullptr) {
-				new_wire = module->addWire(map_name(cell, tpl_wire, separator), tpl_wire);
+				new_wire = module->addWire(module->uniquify(name), tpl_wire);
 				new_wire->port_input = new_wire->port_output = false;
 				new_wire->port_id = false;
 			}
 
-			map_attributes(cell, new_wire, tpl_wire->name);
-			wire_map[tpl_wire] = new_wire;
+			map_attributes(cell, cell_hdlname, new_wire, tpl_wire->name);
+			new_wires.push_back(new_wire);
 			design->select(module, new_wire);
 		}
 
-		for (auto &tpl_proc_it : tpl->processes) {
-			RTLIL::Process *new_proc = module->addProcess(map_name(cell, tpl_proc_it.second, separator), tpl_proc_it.second);
-			map_attributes(cell, new_proc, tpl_proc_it.second->name);
-			for (auto new_proc_sync : new_proc->syncs)
-				for (auto &memwr_action : new_proc_sync->mem_write_actions)
-					memwr_action.memid = memory_map.at(memwr_action.memid).str();
-			auto rewriter = [&](RTLIL::SigSpec &sig) { map_sigspec(wire_map, sig); };
-			new_proc->rewrite_sigspecs(rewriter);
-			design->select(module, new_proc);
+		if (!stamp.processes.empty()) {
+			dict<IdString, IdString> memory_map;
+			for (int i = 0; i < GetSize(stamp.memories); i++)
+				memory_map[stamp.memories[i]->name] = new_memories[i]->name;
+			dict<RTLIL::Wire*, RTLIL::Wire*> wire_map;
+			for (int i = 0; i < GetSize(stamp.wires); i++)
+				wire_map[stamp.wires[i]] = new_wires[i];
+
+			for (auto tpl_proc : stamp.processes) {
+				RTLIL::Process *new_proc = module->addProcess(module->uniquify(*name_it++), tpl_proc);
+				map_attributes(cell, cell_hdlname, new_proc, tpl_proc->name);
+				for (auto new_proc_sync : new_proc->syncs)
+					for (auto &memwr_action : new_proc_sync->mem_write_actions)
+						memwr_action.memid = memory_map.at(memwr_action.memid).str();
+				auto rewriter = [&](RTLIL::SigSpec &sig) { map_sigspec(wire_map, sig); };
+				new_proc->rewrite_sigspecs(rewriter);
+				design->select(module, new_proc);
+			}
 		}
 
-		for (auto tpl_cell : tpl->cells()) {
-			RTLIL::Cell *new_cell = module->addCell(map_name(cell, tpl_cell, separator), tpl_cell);
-			map_attributes(cell, new_cell, tpl_cell->name);
-			if (new_cell->has_memid()) {
-				IdString memid = new_cell->getParam(ID::MEMID).decode_string();
-				new_cell->setParam(ID::MEMID, Const(memory_map.at(memid).str()));
-			} else if (new_cell->is_mem_cell()) {
+		for (auto &info : stamp.cells) {
+			RTLIL::Cell *new_cell = module->addCell(module->uniquify(*name_it++), info.cell);
+			map_attributes(cell, cell_hdlname, new_cell, info.cell->name);
+			if (info.memory >= 0) {
+				new_cell->setParam(ID::MEMID, Const(new_memories[info.memory]->name.str()));
+			} else if (info.memory == -2) {
 				IdString memid = new_cell->getParam(ID::MEMID).decode_string();
 				new_cell->setParam(ID::MEMID, Const(concat_name(cell, memid, separator).str()));
 			}
-			auto rewriter = [&](RTLIL::SigSpec &sig) { map_sigspec(wire_map, sig); };
-			new_cell->rewrite_sigspecs(rewriter);
+			auto port_it = info.ports.begin();
+			for (auto &conn : new_cell->connections_)
+				conn.second = FlattenStamp::instantiate(*port_it++, new_wires);
 			design->select(module, new_cell);
 			new_cells.push_back(new_cell);
 		}
 
-		for (auto &tpl_conn_it : tpl->connections()) {
-			RTLIL::SigSig new_conn = tpl_conn_it;
-			map_sigspec(wire_map, new_conn.first);
-			map_sigspec(wire_map, new_conn.second);
-			module->connect(new_conn);
-		}
+		for (auto &tpl_conn : stamp.connections)
+			module->connect(FlattenStamp::instantiate(tpl_conn.first, new_wires),
+					FlattenStamp::instantiate(tpl_conn.second, new_wires));
 
 		// Attach port connections of the flattened cell
 
-		pool<SigBit> tpl_driven;
-		for (auto tpl_cell : tpl->cells())
-			for (auto &tpl_conn : tpl_cell->connections())
-				if (tpl_cell->output(tpl_conn.first))
-					for (auto bit : tpl_conn.second)
-						tpl_driven.insert(bit);
-		for (auto &tpl_conn : tpl->connections())
-			for (auto bit : tpl_conn.first)
-				tpl_driven.insert(bit);
+		auto map_port_sig = [&](RTLIL::SigSpec &sig) {
+			vector<SigChunk> chunks = sig;
+			for (auto &chunk : chunks)
+				if (chunk.wire != nullptr && chunk.wire->module == tpl)
+					chunk.wire = new_wires[stamp.wire_index.at(chunk.wire)];
+			sig = chunks;
+		};
 
 		for (auto &port_it : cell->connections())
 		{
 			IdString port_name = port_it.first;
-			if (positional_ports.count(port_name) > 0)
-				port_name = positional_ports.at(port_name);
+			if (stamp.positional_ports.count(port_name) > 0)
+				port_name = stamp.positional_ports.at(port_name);
 			if (tpl->wire(port_name) == nullptr || tpl->wire(port_name)->port_id == 0) {
 				if (port_name.begins_with("$"))
 					log_error("Can't map port `%s' of cell `%s' to template `%s'!\n",
@@ -225,7 +414,7 @@ struct FlattenWorker
 			} else {
 				SigSpec sig_tpl = tpl_wire, sig_mod = port_it.second;
 				for (int i = 0; i < GetSize(sig_tpl) && i < GetSize(sig_mod); i++) {
-					if (tpl_driven.count(sig_tpl[i])) {
+					if (stamp.driven.count(sig_tpl[i])) {
 						new_conn.first.append(sig_mod[i]);
 						new_conn.second.append(sig_tpl[i]);
 					} else {
@@ -234,8 +423,8 @@ struct FlattenWorker
 					}
 				}
 			}
-			map_sigspec(wire_map, new_conn.first, module);
-			map_sigspec(wire_map, new_conn.second, module);
+			map_port_sig(new_conn.first);
+			map_port_sig(new_conn.second);
 
 			if (new_conn.second.size() > new_conn.first.size())
 				new_conn.second.remove(new_conn.first.size(), new_conn.second.size() - new_conn.first.size());
@@ -280,13 +469,27 @@ struct FlattenWorker
 			module->rename(scopeinfo, cell_name);
 	}
 
-	void flatten_module(RTLIL::Design *design, RTLIL::Module *module, pool<RTLIL::Module*> &used_modules, const std::string &separator)
+	void flatten_module(RTLIL::Design *design, RTLIL::Module *module, pool<RTLIL::Module*> &used_modules)
 	{
 		if (!design->selected(module) || module->get_blackbox_attribute(ignore_wb))
 			return;
 
+		// the module changes now, stamps are made from its final contents
+		stamps.erase(module);
+
 		SigMap sigmap(module);
 		std::vector<RTLIL::Cell*> worklist = module->selected_cells();
+
+		size_t added_wires = 0, added_cells = 0;
+		for (auto cell : worklist)
+			if (RTLIL::Module *tpl = flattened_template(design, cell)) {
+				added_wires += GetSize(tpl->wires_);
+				added_cells += GetSize(tpl->cells_) + 1;
+			}
+		module->wires_.reserve(module->wires_.size() + added_wires);
+		module->cells_.reserve(module->cells_.size() + added_cells);
+
+		dict<RTLIL::Cell*, std::vector<std::string>> instance_names;
 		while (!worklist.empty())
 		{
 			RTLIL::Cell *cell = worklist.back();
@@ -306,10 +509,19 @@ struct FlattenWorker
 			}
 
 			log_debug("Flattening %s.%s (%s).\n", log_id(module), log_id(cell), log_id(cell->type));
+			std::vector<std::string> names;
+			if (thread_count(threads) == 1)
+				names = get_stamp(tpl).instance_names(cell->name.str());
+			else {
+				if (!instance_names.count(cell))
+					prepare_names(design, worklist, cell, instance_names);
+				names = std::move(instance_names.at(cell));
+				instance_names.erase(cell);
+			}
 			// If a design is fully selected and has a top module defined, topological sorting ensures that all cells
 			// added during flattening are black boxes, and flattening is finished in one pass. However, when flattening
 			// individual modules, this isn't the case, and the newly added cells might have to be flattened further.
-			flatten_cell(design, module, cell, tpl, sigmap, worklist, separator);
+			flatten_cell(design, module, cell, get_stamp(tpl), names, sigmap, worklist);
 		}
 	}
 };
@@ -353,6 +565,11 @@ struct FlattenPass : public Pass {
 		log("        Don't remove unused submodules, leave a flattened version of each\n");
 		log("        submodule in the design.\n");
 		log("\n");
+		log("    -j <threads>\n");
+		log("        Generate the hierarchical names of the flattened objects using the\n");
+		log("        given number of threads (0 for one per hardware thread). The result\n");
+		log("        is the same for any number of threads. default: 1\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
@@ -388,6 +605,10 @@ struct FlattenPass : public Pass {
 				cleanup = false;
 				continue;
 			}
+			if (args[argidx] == "-j" && argidx + 1 < args.size()) {
+				worker.threads = atoi(args[++argidx].c_str());
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -422,7 +643,7 @@ struct FlattenPass : public Pass {
 			log_error("Cannot flatten a design containing recursive instantiations.\n");
 
 		for (auto module : topo_modules.sorted)
-			worker.flatten_module(design, module, used_modules, worker.separator);
+			worker.flatten_module(design, module, used_modules);
 
 		if (cleanup && top != nullptr)
 			for (auto module : design->modules().to_vector())
@@ -18,6 +18,7 @@
  */
 
 #include "libparse.h"
+#include "kernel/threading.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -46,11 +47,15 @@ std::shared_ptr<const LibertyAst> LibertyAstCache::cached_ast(const std::string
 	return it->second;
 }
 
-void LibertyAstCache::parsed_ast(const std::string &fname, const std::shared_ptr<const LibertyAst> &ast)
+bool LibertyAstCache::cache_enabled(const std::string &fname) const
 {
 	auto it = cache_path.find(fname);
-	bool should_cache = it == cache_path.end() ? cache_by_default : it->second;
-	if (!should_cache)
+	return it == cache_path.end() ? cache_by_default : it->second;
+}
+
+void LibertyAstCache::parsed_ast(const std::string &fname, const std::shared_ptr<const LibertyAst> &ast)
+{
+	if (!cache_enabled(fname))
 		return;
 	if (verbose)
 		log("Caching data for liberty file `%s'\n", fname.c_str());
@@ -659,15 +664,203 @@ LibertyAst *LibertyParser::parse(bool top_level)
 	return ast;
 }
 
+namespace {
+
+// Makes a range of memory readable through an std::istream without copying it.
+struct LibertyMemoryBuf : std::streambuf
+{
+	LibertyMemoryBuf(const char *begin, const char *end) {
+		setg(const_cast<char *>(begin), const_cast<char *>(begin), const_cast<char *>(end));
+	}
+};
+
+// Keeps only the statements with ids in `keep` below `ast`.
+void prune_liberty_ast(LibertyAst *ast, const std::set<std::string> &keep)
+{
+	size_t kept = 0;
+	for (auto child : ast->children) {
+		if (keep.count(child->id)) {
+			prune_liberty_ast(child, keep);
+			ast->children[kept++] = child;
+		} else {
+			delete child;
+		}
+	}
+	ast->children.resize(kept);
+}
+
+// Applies the filter options to a statement of the top level group. Returns
+// false if the statement should be dropped.
+bool filter_liberty_statement(LibertyAst *ast, const LibertyParserOptions &options)
+{
+	if (ast->id != "cell")
+		return !options.cells_only;
+	if (options.cell_filter && !options.cell_filter(ast))
+		return false;
+	if (!options.cell_attributes.empty())
+		prune_liberty_ast(ast, options.cell_attributes);
+	return true;
+}
+
+}
+
+// Liberty files are mostly one large top level group containing many
+// independent cell groups. This reads the whole file, pre-scans it for the
+// closing braces of the statements of that top level group, and parses runs of
+// those statements as separate chunks, on multiple threads if requested. The
+// statements are then merged in file order, giving the same AST as parse().
+LibertyAst *LibertyParser::parse_chunked(std::istream &s, const LibertyParserOptions &options)
+{
+	std::vector<char> data;
+	while (true) {
+		const size_t block_size = 1 << 20;
+		size_t old_size = data.size();
+		data.resize(old_size + block_size);
+		size_t read_size = s.rdbuf()->sgetn(data.data() + old_size, block_size);
+		data.resize(old_size + read_size);
+		if (read_size < block_size)
+			break;
+	}
+
+	// Skip comments and strings the same way the lexer does, so that only
+	// structural braces are counted.
+	size_t size = data.size();
+	size_t header_end = 0, body_end = 0;
+	std::vector<std::pair<size_t, int>> boundaries;
+	int depth = 0, scan_line = 1;
+	for (size_t i = 0; i < size; i++) {
+		char c = data[i];
+		if (c == '\n') {
+			scan_line++;
+		} else if (c == '"') {
+			for (i++; i < size && data[i] != '"'; i++)
+				scan_line += data[i] == '\n';
+		} else if (c == '/' && i + 1 < size && data[i + 1] == '*') {
+			char last_c = 0;
+			for (i++; i < size && (last_c != '*' || data[i] != '/'); i++) {
+				scan_line += data[i] == '\n';
+				last_c = data[i];
+			}
+		} else if (c == '/' && i + 1 < size && data[i + 1] == '/') {
+			while (i + 1 < size && data[i + 1] != '\n')
+				i++;
+		} else if (c == '{') {
+			if (depth++ == 0 && header_end == 0)
+				header_end = i + 1;
+		} else if (c == '}') {
+			if (--depth == 1)
+				boundaries.emplace_back(i + 1, scan_line);
+			if (depth == 0) {
+				body_end = i;
+				break;
+			}
+		}
+	}
+
+	// Anything unusual, including syntax errors, is left to the sequential
+	// parser so that it is handled and reported exactly as before.
+	if (header_end == 0 || body_end == 0) {
+		LibertyMemoryBuf buf(data.data(), data.data() + size);
+		std::istream is(&buf);
+		LibertyParser parser(is, 1, false);
+		LibertyAst *ast = parser.parse(true);
+		if (ast && ast->id == "library") {
+			size_t kept = 0;
+			for (auto child : ast->children) {
+				if (filter_liberty_statement(child, options))
+					ast->children[kept++] = child;
+				else
+					delete child;
+			}
+			ast->children.resize(kept);
+		}
+		return ast;
+	}
+
+	// The header is parsed as an empty group.
+	std::string header(data.data(), header_end);
+	header += "}";
+	LibertyMemoryBuf header_buf(header.data(), header.data() + header.size());
+	std::istream header_stream(&header_buf);
+	LibertyParser header_parser(header_stream, 1, false);
+	LibertyAst *ast = header_parser.parse(true);
+
+	struct Chunk {
+		size_t begin, end;
+		int line;
+		std::vector<LibertyAst*> statements;
+		bool failed = false;
+		ParseError error;
+	};
+
+	int num_threads = thread_count(options.threads);
+	size_t target_size = std::max<size_t>((body_end - header_end) / (num_threads * 8), 1 << 16);
+
+	std::vector<Chunk> chunks;
+	size_t chunk_begin = header_end;
+	int chunk_line = 0;
+	for (size_t i = 0; i < header_end; i++)
+		chunk_line += data[i] == '\n';
+	chunk_line += 1;
+	for (auto &it : boundaries) {
+		if (it.first - chunk_begin < target_size)
+			continue;
+		chunks.push_back({chunk_begin, it.first, chunk_line, {}, false, {}});
+		chunk_begin = it.first;
+		chunk_line = it.second;
+	}
+	chunks.push_back({chunk_begin, body_end, chunk_line, {}, false, {}});
+
+	parallel_for(num_threads, chunks.size(), [&](size_t idx) {
+		Chunk &chunk = chunks[idx];
+		LibertyMemoryBuf buf(data.data() + chunk.begin, data.data() + chunk.end);
+		std::istream is(&buf);
+		LibertyParser parser(is, chunk.line, true);
+		try {
+			while (LibertyAst *child = parser.parse(true)) {
+				if (filter_liberty_statement(child, options))
+					chunk.statements.push_back(child);
+				else
+					delete child;
+			}
+		} catch (const ParseError &e) {
+			chunk.failed = true;
+			chunk.error = e;
+		}
+	});
+
+	for (auto &chunk : chunks) {
+		if (!chunk.failed)
+			continue;
+		for (auto &c : chunks)
+			for (auto child : c.statements)
+				delete child;
+		delete ast;
+		line = chunk.error.line;
+		if (chunk.error.msg.empty())
+			error();
+		error(chunk.error.msg);
+	}
+
+	for (auto &chunk : chunks)
+		ast->children.insert(ast->children.end(), chunk.statements.begin(), chunk.statements.end());
+
+	return ast;
+}
+
 #ifndef FILTERLIB
 
 void LibertyParser::error() const
 {
+	if (defer_errors)
+		throw ParseError{line, ""};
 	log_error("Syntax error in liberty file on line %d.\n", line);
 }
 
 void LibertyParser::error(const std::string &str) const
 {
+	if (defer_errors)
+		throw ParseError{line, str};
 	std::stringstream ss;
 	ss << "Syntax error in liberty file on line " << line << ".\n";
 	ss << "  " << str << "\n";
@@ -678,12 +871,16 @@ void LibertyParser::error(const std::string &str) const
 
 void LibertyParser::error() const
 {
+	if (defer_errors)
+		throw ParseError{line, ""};
 	fprintf(stderr, "Syntax error in liberty file on line %d.\n", line);
 	exit(1);
 }
 
 void LibertyParser::error(const std::string &str) const
 {
+	if (defer_errors)
+		throw ParseError{line, str};
 	std::stringstream ss;
 	ss << "Syntax error in liberty file on line " << line << ".\n";
 	ss << "  " << str << "\n";
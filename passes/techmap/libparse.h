@@ -151,12 +151,38 @@ namespace Yosys
 		bool verbose = false;
 		dict<std::string, bool> cache_path;
 
+		bool cache_enabled(const std::string &fname) const;
 		std::shared_ptr<const LibertyAst> cached_ast(const std::string &fname);
 		void parsed_ast(const std::string &fname, const std::shared_ptr<const LibertyAst> &ast);
 		static LibertyAstCache instance;
 	};
 #endif
 
+	// Options for LibertyParser. The default options parse the whole file
+	// sequentially and keep everything.
+	struct LibertyParserOptions
+	{
+		// Number of threads used to parse the statements of the top level
+		// group. 1 disables threading and 0 uses all hardware threads.
+		int threads = 1;
+
+		// When set, only cell groups for which this returns true are kept. This
+		// is called concurrently from the parser threads and must not log or
+		// access any other shared state.
+		std::function<bool(const LibertyAst *cell)> cell_filter;
+
+		// When not empty, only statements with one of these ids are kept below
+		// cell groups, at any depth.
+		std::set<std::string> cell_attributes;
+
+		// Drop all statements of the top level group that aren't cell groups.
+		bool cells_only = false;
+
+		bool filtering() const {
+			return cell_filter || !cell_attributes.empty() || cells_only;
+		}
+	};
+
 	class LibertyMergedCells;
 	class LibertyParser
 	{
@@ -165,6 +191,16 @@ namespace Yosys
 		LibertyInputStream f;
 		int line;
 
+		// When set, syntax errors throw a ParseError instead of being reported
+		// right away. Used for the chunks parsed by worker threads.
+		bool defer_errors = false;
+		struct ParseError {
+			int line;
+			std::string msg;
+		};
+
+		LibertyParser(std::istream &f, int line, bool defer_errors) : f(f), line(line), defer_errors(defer_errors) {}
+
 		/* lexer return values:
 		   'v': identifier, string, array range [...] -> str holds the token string
 		   'n': newline
@@ -175,6 +211,7 @@ namespace Yosys
 		void report_unexpected_token(int tok);
 		void parse_vector_range(int tok);
 		LibertyAst *parse(bool top_level);
+		LibertyAst *parse_chunked(std::istream &s, const LibertyParserOptions &options);
 		void error() const;
 		void error(const std::string &str) const;
 
@@ -195,11 +232,37 @@ namespace Yosys
 			}
 		}
 
+		// Parses the file with the given options, see LibertyParserOptions.
+		LibertyParser(std::istream &f, const LibertyParserOptions &options) : f(f), line(1) {
+			shared_ast.reset(parse_chunked(f, options));
+			ast = shared_ast.get();
+			if (!ast) {
+#ifdef FILTERLIB
+				fprintf(stderr, "No entries found in liberty file.\n");
+				exit(1);
+#else
+				log_error("No entries found in liberty file.\n");
+#endif
+			}
+		}
+
 #ifndef FILTERLIB
-		LibertyParser(std::istream &f, const std::string &fname) : f(f), line(1) {
+		LibertyParser(std::istream &f, const std::string &fname) : LibertyParser(f, fname, LibertyParserOptions()) {}
+
+		// The filter options are ignored for files that are to be cached, and a
+		// cached AST is used as is. Callers must thus be prepared to see
+		// unfiltered data.
+		LibertyParser(std::istream &f, const std::string &fname, const LibertyParserOptions &options) : f(f), line(1) {
 			shared_ast = LibertyAstCache::instance.cached_ast(fname);
 			if (!shared_ast) {
-				shared_ast.reset(parse(true));
+				LibertyParserOptions parse_options = options;
+				if (LibertyAstCache::instance.cache_enabled(fname)) {
+					parse_options.cell_filter = nullptr;
+					parse_options.cell_attributes.clear();
+					parse_options.cells_only = false;
+				}
+				bool chunked = parse_options.threads != 1 || parse_options.filtering();
+				shared_ast.reset(chunked ? parse_chunked(f, parse_options) : parse(true));
 				LibertyAstCache::instance.parsed_ast(fname, shared_ast);
 			}
 			ast = shared_ast.get();
@@ -0,0 +1,127 @@
+// Prints a checksum of the iteration order of the hashlib containers after
+// each of a few access patterns of typical passes. It is compiled once as is
+// and once with -DYOSYS_ENABLE_HASHLIB_OPEN_ADDRESSING, and both variants must
+// print the same.
+
+// hashlib.h relies on yosys_common.h for these
+#include <array>
+#include <cstring>
+
+#include "kernel/hashlib.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+
+using namespace hashlib;
+
+uint32_t Hasher::fudge = 0;
+
+struct Checksum {
+	uint64_t value = 1469598103934665603ull;
+	void add(uint64_t x) { value = (value ^ x) * 1099511628211ull; }
+};
+
+template<typename F>
+static void run(const char *name, F fn)
+{
+	Checksum sum;
+	fn(sum);
+	printf("%-12s %016llx\n", name, (unsigned long long)sum.value);
+}
+
+// a wire pointer and bit offset, like a SigBit
+typedef std::pair<uintptr_t, int> bit_t;
+
+int main()
+{
+	size_t n = 20000;
+
+	std::mt19937 rng(1);
+	std::vector<bit_t> bits;
+	for (size_t i = 0; bits.size() < n; i++) {
+		uintptr_t wire = 0x10000 + i * 48;
+		int width = 1 + rng() % 32;
+		for (int k = 0; k < width && bits.size() < n; k++)
+			bits.push_back({wire, k});
+	}
+	std::vector<size_t> order(n);
+	for (size_t i = 0; i < n; i++)
+		order[i] = i;
+	std::shuffle(order.begin(), order.end(), rng);
+
+	// SigMap style: map every bit to an index, then look up bits in random order
+	run("sigmap", [&](Checksum &sum) {
+		dict<bit_t, int> db;
+		for (size_t i = 0; i < n; i++)
+			db[bits[i]] = i;
+		for (size_t i : order)
+			sum.add(db.at(bits[i]));
+		for (auto &it : db)
+			sum.add(it.second);
+	});
+
+	// Module::cell() style: names are looked up before insertion, most of them
+	// are new
+	run("names", [&](Checksum &sum) {
+		dict<int, int> db;
+		for (size_t i = 0; i < n; i++) {
+			int name = order[i] * 7;
+			if (!db.count(name))
+				db[name] = i;
+			sum.add(db.count(name + 1));
+		}
+		for (auto &it : db)
+			sum.add(it.first);
+	});
+
+	// opt_clean style: collect used bits, then remove the unused ones
+	run("used_bits", [&](Checksum &sum) {
+		pool<bit_t> used;
+		for (size_t i = 0; i < n; i++)
+			used.insert(bits[i]);
+		for (size_t i : order)
+			if (i % 3 == 0)
+				used.erase(bits[i]);
+		for (size_t i = 0; i < n; i++)
+			sum.add(used.count(bits[i]));
+		for (auto &bit : used)
+			sum.add(bit.first + bit.second);
+	});
+
+	// worklist style: pop from the pool, occasionally pushing new items
+	run("worklist", [&](Checksum &sum) {
+		pool<int> queue;
+		for (size_t i = 0; i < n / 2; i++)
+			queue.insert(order[i]);
+		size_t next = n / 2;
+		while (!queue.empty()) {
+			int item = queue.pop();
+			sum.add(item);
+			if (item % 2 == 0 && next < n)
+				queue.insert(order[next++]);
+		}
+	});
+
+	// IdString/idict style: intern strings, many of which repeat
+	run("intern", [&](Checksum &sum) {
+		idict<std::string> db;
+		for (size_t i = 0; i < n; i++)
+			sum.add(db(std::string("\\net_") + std::to_string(order[i] % (n / 4 + 1))));
+		for (auto &it : db)
+			sum.add(it.size());
+	});
+
+	// ModIndex style: a set of ports for each bit
+	run("fanout", [&](Checksum &sum) {
+		dict<bit_t, pool<int>> db;
+		for (size_t i = 0; i < n; i++)
+			db[bits[order[i] % (n / 2 + 1)]].insert(i);
+		for (size_t i = 0; i < n; i += 2)
+			db[bits[i % (n / 2 + 1)]].erase(order[i]);
+		for (auto &it : db)
+			sum.add(it.second.size());
+	});
+
+	return 0;
+}
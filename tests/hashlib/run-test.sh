@@ -0,0 +1,10 @@
+#!/bin/bash
+
+set -ex
+
+# Both hash table variants must produce the same iteration order.
+${CXX:-c++} -std=c++17 -O1 -I../.. -o hashlib-order-chained order.cc
+${CXX:-c++} -std=c++17 -O1 -I../.. -DYOSYS_ENABLE_HASHLIB_OPEN_ADDRESSING -o hashlib-order-open order.cc
+./hashlib-order-chained > hashlib-order-chained.out
+./hashlib-order-open > hashlib-order-open.out
+diff hashlib-order-chained.out hashlib-order-open.out
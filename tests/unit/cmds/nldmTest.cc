@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include "passes/cmds/nldm.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+namespace RTLIL {
+
+	static const char *nldm_test_lib = R"(
+library (test) {
+  time_unit : "1ns" ;
+  capacitive_load_unit (1, pf) ;
+  lu_table_template (tbl) {
+    variable_1 : input_net_transition ;
+    variable_2 : total_output_net_capacitance ;
+    index_1 ("0.1, 1") ;
+    index_2 ("0.01, 0.1") ;
+  }
+  cell (INV) {
+    pin (A) { direction : input ; capacitance : 0.01 ; }
+    pin (Y) {
+      direction : output ;
+      function : "!A" ;
+      timing () {
+        related_pin : "A" ;
+        timing_sense : negative_unate ;
+        cell_rise (tbl) { values ("0.1, 0.3", "0.2, 0.5") ; }
+        cell_fall (tbl) { values ("0.1, 0.2", "0.2, 0.4") ; }
+        rise_transition (tbl) { values ("0.05, 0.2", "0.1, 0.3") ; }
+        fall_transition (tbl) { values ("0.05, 0.15", "0.1, 0.25") ; }
+      }
+    }
+  }
+  cell (BUF) {
+    pin (A) { direction : input ; capacitance : 0.02 ; }
+    pin (Y) {
+      direction : output ;
+      function : "A" ;
+      timing () {
+        related_pin : "A" ;
+        timing_sense : positive_unate ;
+        cell_rise (tbl) { values ("0.2, 0.4", "0.3, 0.7") ; }
+        cell_fall (tbl) { values ("0.2, 0.3", "0.3, 0.6") ; }
+        rise_transition (tbl) { values ("0.04, 0.1", "0.08, 0.2") ; }
+        fall_transition (tbl) { values ("0.04, 0.1", "0.08, 0.2") ; }
+      }
+    }
+  }
+}
+)";
+
+	class CmdsNldmTest : public testing::Test {
+	protected:
+		NldmLibrary library;
+		Design design;
+		Module *module;
+
+		CmdsNldmTest() {
+			if (log_files.empty()) log_files.emplace_back(stdout);
+			// for the ID:: constants
+			yosys_setup();
+			std::istringstream f(nldm_test_lib);
+			LibertyParser parser(f);
+			library.add(parser.ast);
+			module = design.addModule(ID(top));
+		}
+
+		Cell *addGate(IdString type, IdString name, SigBit a, SigBit y) {
+			Cell *cell = module->addCell(name, type);
+			cell->setPort(ID::A, a);
+			cell->setPort(ID::Y, y);
+			return cell;
+		}
+
+		// Compares the incrementally updated analysis against a fresh one.
+		void checkFresh(NldmSta &sta) {
+			sta.update();
+			NldmSta fresh(library, module);
+			fresh.clock_period = sta.clock_period;
+			fresh.input_transition = sta.input_transition;
+			fresh.update();
+			for (auto wire : module->wires())
+				for (auto bit : SigSpec(wire))
+					for (int t : {NldmSta::RISE, NldmSta::FALL}) {
+						EXPECT_DOUBLE_EQ(sta.arrival(bit, t), fresh.arrival(bit, t)) << log_signal(bit);
+						EXPECT_DOUBLE_EQ(sta.required(bit, t), fresh.required(bit, t)) << log_signal(bit);
+					}
+			auto paths = sta.critical_paths(1), fresh_paths = fresh.critical_paths(1);
+			ASSERT_EQ(paths.size(), fresh_paths.size());
+			if (!paths.empty()) {
+				EXPECT_EQ(paths[0].endpoint, fresh_paths[0].endpoint);
+				EXPECT_DOUBLE_EQ(paths[0].slack, fresh_paths[0].slack);
+			}
+		}
+	};
+
+	TEST_F(CmdsNldmTest, UpdateMatchesFreshAnalysis)
+	{
+		Wire *a = module->addWire(ID(a));
+		Wire *y = module->addWire(ID(y));
+		Wire *n1 = module->addWire(ID(n1));
+		Wire *n2 = module->addWire(ID(n2));
+		a->port_input = true;
+		y->port_output = true;
+		module->fixup_ports();
+
+		addGate(ID(INV), ID(u1), a, n1);
+		Cell *u2 = addGate(ID(INV), ID(u2), n1, n2);
+		Cell *u3 = addGate(ID(BUF), ID(u3), n2, y);
+
+		NldmSta sta(library, module);
+		sta.clock_period = 1;
+		sta.input_transition = 0.2;
+		checkFresh(sta);
+		EXPECT_GT(sta.arrival(y, NldmSta::RISE), 0);
+
+		// reconnection
+		u3->setPort(ID::A, n1);
+		checkFresh(sta);
+
+		// type change, which isn't reported to monitors
+		u2->type = ID(BUF);
+		checkFresh(sta);
+
+		// added cell loading n1
+		Wire *n3 = module->addWire(ID(n3));
+		addGate(ID(BUF), ID(u4), n1, n3);
+		checkFresh(sta);
+
+		// removed cells
+		module->remove(u2);
+		checkFresh(sta);
+		module->remove(u3);
+		checkFresh(sta);
+		EXPECT_EQ(sta.arrival(y, NldmSta::RISE), -INFINITY);
+
+		// a cell without connections
+		module->addCell(ID(u5), ID(INV));
+		checkFresh(sta);
+	}
+}
+
+YOSYS_NAMESPACE_END
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include "kernel/aignet.h"
+
+#include <random>
+
+YOSYS_NAMESPACE_BEGIN
+
+namespace {
+
+	// Simulates the outputs of a clean network for 64 input patterns.
+	std::vector<uint64_t> simulate(const AigNet &aig, const std::vector<uint64_t> &patterns)
+	{
+		std::vector<uint64_t> values(aig.nodes.size());
+		for (int i = 0; i < GetSize(aig.inputs); i++)
+			values[aig.inputs[i]] = patterns[i];
+		auto value = [&](int lit) { return AigNet::complemented(lit) ? ~values[AigNet::node(lit)] : values[AigNet::node(lit)]; };
+		for (int id = 1; id < GetSize(aig.nodes); id++)
+			if (aig.is_and(id))
+				values[id] = value(aig.nodes[id].fanin0) & value(aig.nodes[id].fanin1);
+		std::vector<uint64_t> ret;
+		for (int lit : aig.outputs)
+			ret.push_back(value(lit));
+		return ret;
+	}
+
+	class KernelAigNetTest : public testing::Test {};
+
+	TEST_F(KernelAigNetTest, Hashing)
+	{
+		AigNet aig;
+		int a = aig.add_input(), b = aig.add_input();
+		EXPECT_EQ(aig.AND(a, b), aig.AND(b, a));
+		EXPECT_EQ(aig.AND(a, aig.NOT(a)), AigNet::CFALSE);
+		EXPECT_EQ(aig.AND(a, AigNet::CTRUE), a);
+		EXPECT_EQ(aig.OR(a, AigNet::CTRUE), AigNet::CTRUE);
+		EXPECT_EQ(aig.num_ands(), 1);
+	}
+
+	TEST_F(KernelAigNetTest, Balance)
+	{
+		AigNet aig;
+		int lit = AigNet::CTRUE;
+		for (int i = 0; i < 16; i++)
+			lit = aig.AND(lit, aig.add_input());
+		aig.add_output(lit);
+		EXPECT_EQ(aig.depth(), 15);
+		aig.balance();
+		EXPECT_EQ(aig.depth(), 4);
+		EXPECT_EQ(aig.num_ands(), 15);
+	}
+
+	TEST_F(KernelAigNetTest, Redundancy)
+	{
+		AigNet aig;
+		int a = aig.add_input(), b = aig.add_input();
+		aig.add_output(aig.OR(aig.AND(a, b), aig.AND(a, aig.NOT(b))));
+		aig.rewrite();
+		EXPECT_EQ(aig.num_ands(), 0);
+		EXPECT_EQ(aig.outputs[0], a);
+	}
+
+	TEST_F(KernelAigNetTest, RandomNetworks)
+	{
+		std::mt19937 rng(1);
+		for (int round = 0; round < 50; round++) {
+			AigNet aig;
+			std::vector<int> lits;
+			int num_inputs = 4 + rng() % 8;
+			for (int i = 0; i < num_inputs; i++)
+				lits.push_back(aig.add_input());
+			for (int i = 0; i < 200; i++) {
+				int a = lits[rng() % lits.size()] ^ (rng() & 1);
+				int b = lits[rng() % lits.size()] ^ (rng() & 1);
+				int s = lits[rng() % lits.size()];
+				switch (rng() % 3) {
+				case 0: lits.push_back(aig.AND(a, b)); break;
+				case 1: lits.push_back(aig.XOR(a, b)); break;
+				case 2: lits.push_back(aig.MUX(a, b, s)); break;
+				}
+			}
+			for (int i = 0; i < 8; i++)
+				aig.add_output(lits[lits.size() - 1 - rng() % 32] ^ (rng() & 1));
+			aig.cleanup();
+
+			std::vector<uint64_t> patterns;
+			for (int i = 0; i < num_inputs; i++)
+				patterns.push_back((uint64_t(rng()) << 32) | rng());
+			auto expected = simulate(aig, patterns);
+			int ands = aig.num_ands();
+
+			for (int step = 0; step < 3; step++) {
+				int depth = aig.depth();
+				if (step == 0)
+					aig.balance();
+				else if (step == 1)
+					aig.rewrite();
+				else
+					aig.refactor();
+				EXPECT_EQ(simulate(aig, patterns), expected);
+				if (step > 0)
+					EXPECT_LE(aig.depth(), depth);
+			}
+			EXPECT_LE(aig.num_ands(), ands);
+		}
+	}
+}
+
+YOSYS_NAMESPACE_END
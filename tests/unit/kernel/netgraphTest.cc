@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include "kernel/netgraph.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+namespace RTLIL {
+
+	class KernelNetGraphTest : public testing::Test {
+	protected:
+		KernelNetGraphTest() {
+			if (log_files.empty()) log_files.emplace_back(stdout);
+			// for the ID:: constants and the port directions of internal cells
+			yosys_setup();
+		}
+	};
+
+	TEST_F(KernelNetGraphTest, Connectivity)
+	{
+		Design design;
+		Module *module = design.addModule(ID(top));
+		Wire *a = module->addWire(ID(a));
+		Wire *b = module->addWire(ID(b));
+		Wire *y = module->addWire(ID(y), 2);
+		Wire *n = module->addWire(ID(n));
+		a->port_input = true;
+		b->port_input = true;
+		y->port_output = true;
+		module->fixup_ports();
+
+		Cell *and_cell = module->addAndGate(ID(and), a, b, n);
+		Cell *not_cell = module->addNotGate(ID(not), n, SigBit(y, 0));
+		module->connect(SigBit(y, 1), n);
+
+		for (int threads : {1, 4}) {
+			NetGraph graph(module, threads);
+			EXPECT_EQ(graph.num_cells(), 2);
+			// y[1] is an alias of n
+			EXPECT_EQ(graph.num_bits(), 4);
+			EXPECT_EQ(graph.bit_id(SigBit(y, 1)), graph.bit_id(n));
+			EXPECT_EQ(graph.bit_id(State::S0), -1);
+			EXPECT_TRUE(graph.is_input(graph.bit_id(a)));
+			EXPECT_TRUE(graph.is_output(graph.bit_id(n)));
+			EXPECT_FALSE(graph.is_output(graph.bit_id(a)));
+
+			int bit_n = graph.bit_id(n);
+			ASSERT_EQ(graph.drivers(bit_n).size(), 1);
+			EXPECT_EQ(graph.cells[graph.drivers(bit_n)[0].cell], and_cell);
+			EXPECT_EQ(graph.port_names[graph.drivers(bit_n)[0].port], ID::Y);
+			ASSERT_EQ(graph.fanout(bit_n).size(), 1);
+			EXPECT_EQ(graph.cells[graph.fanout(bit_n)[0].cell], not_cell);
+			EXPECT_EQ(graph.port_names[graph.fanout(bit_n)[0].port], ID::A);
+
+			int cell = graph.cell_id(and_cell);
+			ASSERT_EQ(graph.ports(cell).size(), 3);
+			for (auto &port : graph.ports(cell)) {
+				EXPECT_EQ(port.input, graph.port_names[port.port] != ID::Y);
+				EXPECT_EQ(port.output, graph.port_names[port.port] == ID::Y);
+			}
+		}
+	}
+
+	TEST_F(KernelNetGraphTest, Invalidation)
+	{
+		Design design;
+		Module *module = design.addModule(ID(top));
+		Wire *a = module->addWire(ID(a));
+		Wire *y = module->addWire(ID(y));
+		Cell *cell = module->addNotGate(ID(not), a, y);
+
+		Module *other = design.addModule(ID(other));
+
+		NetGraphIndex &index = NetGraphIndex::get(&design);
+		EXPECT_EQ(&NetGraphIndex::get(&design), &index);
+		auto graph = index.graph(module);
+		auto other_graph = index.graph(other);
+		EXPECT_EQ(index.graph(module), graph);
+		EXPECT_EQ(graph->fanout(graph->bit_id(a)).size(), 1);
+
+		cell->setPort(ID::A, y);
+		EXPECT_FALSE(index.valid(module));
+		EXPECT_TRUE(index.valid(other));
+
+		auto new_graph = index.graph(module);
+		EXPECT_NE(new_graph, graph);
+		EXPECT_EQ(new_graph->fanout(new_graph->bit_id(a)).size(), 0);
+		// the old snapshot is left untouched
+		EXPECT_EQ(graph->fanout(graph->bit_id(a)).size(), 1);
+		EXPECT_EQ(index.graph(other), other_graph);
+
+		design.remove(other);
+		EXPECT_FALSE(index.valid(other));
+	}
+
+	TEST_F(KernelNetGraphTest, UnreportedChanges)
+	{
+		Design design;
+		Module *module = design.addModule(ID(top));
+		Wire *a = module->addWire(ID(a));
+		Wire *n = module->addWire(ID(n));
+		Wire *y = module->addWire(ID(y));
+		Cell *inv = module->addNotGate(ID(inv), a, n);
+		module->addNotGate(ID(inv2), n, y);
+
+		NetGraphIndex &index = NetGraphIndex::get(&design);
+		auto graph = index.graph(module);
+
+		// removing wires rewrites connections without notification
+		module->remove(pool<Wire*>{n});
+		EXPECT_FALSE(index.valid(module));
+		graph = index.graph(module);
+		EXPECT_TRUE(index.valid(module));
+		EXPECT_EQ(graph->num_bits(), 4);
+		EXPECT_EQ(graph->fanout(graph->bit_id(inv->getPort(ID::Y)[0])).size(), 0);
+
+		inv->type = ID($_BUF_);
+		EXPECT_FALSE(index.valid(module));
+		graph = index.graph(module);
+		EXPECT_EQ(graph->fanout(graph->bit_id(a)).size(), 1);
+
+		module->addNotGate(ID(extra), y, a);
+		EXPECT_FALSE(index.valid(module));
+		graph = index.graph(module);
+		EXPECT_EQ(graph->num_cells(), 3);
+		EXPECT_EQ(graph->drivers(graph->bit_id(a)).size(), 1);
+	}
+}
+
+YOSYS_NAMESPACE_END
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include "kernel/topo_scc.h"
+
+#include <random>
+
+YOSYS_NAMESPACE_BEGIN
+
+namespace {
+
+	class KernelTopoSccTest : public testing::Test {};
+
+	TEST_F(KernelTopoSccTest, SmallGraph)
+	{
+		// 0 -> 1 -> 2 -> 0, 2 -> 3, 3 -> 3, 4 -> 5 -> 4
+		FrozenIntGraph graph(6, {{0, 1}, {1, 2}, {2, 0}, {2, 3}, {3, 3}, {4, 5}, {5, 4}, {0, 1}});
+		EXPECT_EQ(graph.num_edges(), 7);
+		EXPECT_TRUE(graph.has_edge(3, 3));
+		EXPECT_FALSE(graph.has_edge(1, 0));
+
+		std::vector<int> component;
+		EXPECT_EQ(find_sccs(graph, component), 3);
+		EXPECT_EQ(component, std::vector<int>({0, 0, 0, 1, 2, 2}));
+	}
+
+	TEST_F(KernelTopoSccTest, ParallelMatchesSequential)
+	{
+		std::mt19937 rng(1);
+		for (int round = 0; round < 4; round++) {
+			int num_nodes = 50000;
+			std::vector<std::pair<int, int>> edges;
+			// a long chain, which is deep enough to overflow a recursive
+			// search, closed into a few large loops
+			for (int node = 1; node < num_nodes; node++)
+				edges.emplace_back(node - 1, node);
+			for (int i = 0; i < 4; i++)
+				edges.emplace_back(rng() % num_nodes, rng() % num_nodes);
+			for (int i = 0; i < num_nodes / 2; i++) {
+				int src = rng() % num_nodes;
+				edges.emplace_back(src, std::max<int>(src - rng() % 16, 0));
+			}
+			FrozenIntGraph graph(num_nodes, edges);
+
+			std::vector<int> expected, component;
+			int count = find_sccs(graph, expected, 1);
+			EXPECT_EQ(find_sccs(graph, component, 8), count);
+			EXPECT_EQ(component, expected);
+
+			// every edge between two components must respect one order
+			std::vector<std::pair<int, int>> component_edges;
+			for (auto &edge : edges)
+				if (expected[edge.first] != expected[edge.second])
+					component_edges.emplace_back(expected[edge.first], expected[edge.second]);
+			std::vector<int> dummy;
+			EXPECT_EQ(find_sccs(FrozenIntGraph(count, component_edges), dummy, 1), count);
+		}
+	}
+}
+
+YOSYS_NAMESPACE_END
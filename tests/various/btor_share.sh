@@ -0,0 +1,134 @@
+#!/usr/bin/env bash
+
+trap 'echo "ERROR in btor_share.sh" >&2; exit 1' ERR
+
+# two identical $and cells and an $add with constant inputs
+cat > btor_share.il <<IL
+module \top
+  wire width 4 input 1 \a
+  wire width 4 input 2 \b
+  wire width 4 input 3 \c
+  wire width 4 output 4 \y1
+  wire width 4 output 5 \y2
+  wire width 4 output 6 \y3
+  wire width 4 \t2
+  wire width 4 \t3
+  cell \$and \n1
+    parameter \A_SIGNED 0
+    parameter \A_WIDTH 4
+    parameter \B_SIGNED 0
+    parameter \B_WIDTH 4
+    parameter \Y_WIDTH 4
+    connect \A \a
+    connect \B \b
+    connect \Y \y1
+  end
+  cell \$and \n2
+    parameter \A_SIGNED 0
+    parameter \A_WIDTH 4
+    parameter \B_SIGNED 0
+    parameter \B_WIDTH 4
+    parameter \Y_WIDTH 4
+    connect \A \a
+    connect \B \b
+    connect \Y \t2
+  end
+  cell \$xor \x
+    parameter \A_SIGNED 0
+    parameter \A_WIDTH 4
+    parameter \B_SIGNED 0
+    parameter \B_WIDTH 4
+    parameter \Y_WIDTH 4
+    connect \A \t2
+    connect \B \c
+    connect \Y \y2
+  end
+  cell \$add \k
+    parameter \A_SIGNED 0
+    parameter \A_WIDTH 4
+    parameter \B_SIGNED 0
+    parameter \B_WIDTH 4
+    parameter \Y_WIDTH 4
+    connect \A 4'0011
+    connect \B 4'0100
+    connect \Y \t3
+  end
+  cell \$add \o
+    parameter \A_SIGNED 0
+    parameter \A_WIDTH 4
+    parameter \B_SIGNED 0
+    parameter \B_WIDTH 4
+    parameter \Y_WIDTH 4
+    connect \A \t3
+    connect \B \c
+    connect \Y \y3
+  end
+end
+IL
+
+../../yosys -q -p 'read_rtlil btor_share.il; write_btor btor_share.btor; write_btor -noshare btor_share_noshare.btor'
+
+# the shared $and is written once and the constant $add is folded to 7
+test $(grep -c '^[0-9]* and ' btor_share.btor) -eq 1
+test $(grep -c '^[0-9]* add ' btor_share.btor) -eq 1
+grep -q '^[0-9]* const [0-9]* 0111$' btor_share.btor
+
+# -noshare writes every node as it is used
+test $(grep -c '^[0-9]* and ' btor_share_noshare.btor) -eq 2
+test $(grep -c '^[0-9]* add ' btor_share_noshare.btor) -eq 2
+if grep -q '^[0-9]* const [0-9]* 0111$' btor_share_noshare.btor; then false; fi
+
+# an ite is only folded when its select is a defined constant
+cat > btor_share_ite.il <<IL
+module \top
+  wire width 4 input 1 \a
+  wire width 4 input 2 \b
+  wire width 4 output 3 \y1
+  wire width 4 output 4 \y2
+  wire width 4 output 5 \y3
+  cell \$mux \m1
+    parameter \WIDTH 4
+    connect \A \a
+    connect \B \b
+    connect \S 1'1
+    connect \Y \y1
+  end
+  cell \$mux \m2
+    parameter \WIDTH 4
+    connect \A \a
+    connect \B \b
+    connect \S 1'x
+    connect \Y \y2
+  end
+  cell \$mux \m3
+    parameter \WIDTH 4
+    connect \A \a
+    connect \B \b
+    connect \S 1'z
+    connect \Y \y3
+  end
+end
+IL
+
+../../yosys -q -p 'read_rtlil btor_share_ite.il; write_btor btor_share_ite.btor'
+test $(grep -c '^[0-9]* ite ' btor_share_ite.btor) -eq 2
+
+# both models of a miter against the gate level netlist have no counterexample
+if command -v btormc > /dev/null; then
+	for opt in "" "-noshare"; do
+		../../yosys -q -p "
+			read_rtlil btor_share.il
+			rename top gold
+			read_rtlil btor_share.il
+			rename top gate
+			techmap gate
+			miter -equiv -make_assert -flatten gold gate main
+			hierarchy -top main
+			write_btor $opt btor_share_miter.btor
+		"
+		btormc -kmax 1 btor_share_miter.btor > btor_share_miter.out
+		if grep -q "^sat" btor_share_miter.out; then false; fi
+	done
+else
+	echo "btormc not found, skipping equivalence check in btor_share.sh"
+fi
@@ -0,0 +1,39 @@
+#!/usr/bin/env bash
+
+trap 'echo "ERROR in pass_stats.sh" >&2; exit 1' ERR
+
+cat > pass_stats.il <<IL
+module \top
+  wire input 1 \a
+  wire output 1 \y
+  wire \t
+  cell \$not \n1
+    parameter \A_SIGNED 0
+    parameter \A_WIDTH 1
+    parameter \Y_WIDTH 1
+    connect \A \a
+    connect \Y \t
+  end
+  cell \$not \n2
+    parameter \A_SIGNED 0
+    parameter \A_WIDTH 1
+    parameter \Y_WIDTH 1
+    connect \A \t
+    connect \Y \y
+  end
+end
+IL
+
+# without -d the footer carries no memory or design size summary
+../../yosys -p 'read_rtlil pass_stats.il' > pass_stats.log 2>&1
+if grep -q "Peak memory growth\|Design size" pass_stats.log; then false; fi
+
+# with -d it lists the design size, and the perffile has the per pass deltas
+../../yosys -d --perffile pass_stats.json -p 'read_rtlil pass_stats.il; delete top/n2; opt_clean' > pass_stats.log 2>&1
+grep -q "^Design size:" pass_stats.log
+grep -q "^ *2 wires  *2 bits  *0 cells top$" pass_stats.log
+grep -A 8 '"read_rtlil"' pass_stats.json | grep -q '"wires_delta": 3,'
+grep -A 8 '"read_rtlil"' pass_stats.json | grep -q '"cells_delta": 2$'
+grep -A 8 '"delete"' pass_stats.json | grep -q '"cells_delta": -1$'
+grep -A 8 '"opt_clean"' pass_stats.json | grep -q '"wires_delta": -1,'
+grep -A 8 '"opt_clean"' pass_stats.json | grep -q '"cells_delta": -1$'
@@ -0,0 +1,86 @@
+#!/usr/bin/env bash
+
+trap 'echo "ERROR in smt2_share.sh" >&2; exit 1' ERR
+
+# y1 and y2 are computed by two identical $and -> $xor chains, z by a single $or
+cat > smt2_share.il <<IL
+module \top
+  wire width 4 input 1 \a
+  wire width 4 input 2 \b
+  wire width 4 input 3 \c
+  wire width 4 output 4 \y1
+  wire width 4 output 5 \y2
+  wire width 4 output 6 \z
+  wire width 4 \t1
+  wire width 4 \t2
+  cell \$and \n1
+    parameter \A_SIGNED 0
+    parameter \A_WIDTH 4
+    parameter \B_SIGNED 0
+    parameter \B_WIDTH 4
+    parameter \Y_WIDTH 4
+    connect \A \a
+    connect \B \b
+    connect \Y \t1
+  end
+  cell \$and \n2
+    parameter \A_SIGNED 0
+    parameter \A_WIDTH 4
+    parameter \B_SIGNED 0
+    parameter \B_WIDTH 4
+    parameter \Y_WIDTH 4
+    connect \A \a
+    connect \B \b
+    connect \Y \t2
+  end
+  cell \$xor \x1
+    parameter \A_SIGNED 0
+    parameter \A_WIDTH 4
+    parameter \B_SIGNED 0
+    parameter \B_WIDTH 4
+    parameter \Y_WIDTH 4
+    connect \A \t1
+    connect \B \c
+    connect \Y \y1
+  end
+  cell \$xor \x2
+    parameter \A_SIGNED 0
+    parameter \A_WIDTH 4
+    parameter \B_SIGNED 0
+    parameter \B_WIDTH 4
+    parameter \Y_WIDTH 4
+    connect \A \t2
+    connect \B \c
+    connect \Y \y2
+  end
+  cell \$or \o
+    parameter \A_SIGNED 0
+    parameter \A_WIDTH 4
+    parameter \B_SIGNED 0
+    parameter \B_WIDTH 4
+    parameter \Y_WIDTH 4
+    connect \A \a
+    connect \B \c
+    connect \Y \z
+  end
+end
+IL
+
+../../yosys -p 'read_rtlil smt2_share.il; write_smt2 smt2_share.smt2; write_smt2 -noshare smt2_share_noshare.smt2' > smt2_share.log 2>&1
+
+# one define-fun per shared expression, both outputs use it
+grep -q "Shared 2 structurally identical functions" smt2_share.log
+test $(grep -c '^(define-fun |top#[0-9]*| .*(bvand ' smt2_share.smt2) -eq 1
+test $(grep -c '^(define-fun |top#[0-9]*| .*(bvxor ' smt2_share.smt2) -eq 1
+test $(grep -c '^(define-fun |top#[0-9]*| .*(bvor ' smt2_share.smt2) -eq 1
+xor_fun=$(grep '^(define-fun |top#[0-9]*| .*(bvxor ' smt2_share.smt2 | sed 's/^(define-fun \(|top#[0-9]*|\).*/\1/')
+test $(grep -c "^(define-fun |top_n y[12]| .*($xor_fun state))$" smt2_share.smt2) -eq 2
+
+# -noshare writes one function per cell as before
+test $(grep -c '^(define-fun |top#[0-9]*| .*(bvand ' smt2_share_noshare.smt2) -eq 2
+test $(grep -c '^(define-fun |top#[0-9]*| .*(bvxor ' smt2_share_noshare.smt2) -eq 2
+test $(grep -c '^(define-fun |top#[0-9]*| .*(bvor ' smt2_share_noshare.smt2) -eq 1
+
+# without identical cells both modes write the same output
+../../yosys -q -p 'read_rtlil smt2_share.il; delete top/n2 top/x2; write_smt2 smt2_share.smt2; write_smt2 -noshare smt2_share_noshare.smt2'
+cmp smt2_share.smt2 smt2_share_noshare.smt2
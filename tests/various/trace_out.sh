@@ -0,0 +1,23 @@
+#!/usr/bin/env bash
+
+trap 'echo "ERROR in trace_out.sh" >&2; exit 1' ERR
+
+# an executable in a directory with a space, so that its path must be quoted
+mkdir -p "temp/trace dir"
+printf '#!/bin/sh\necho "$@"\n' > "temp/trace dir/say"
+chmod +x "temp/trace dir/say"
+
+cat > temp/trace_out.ys <<YS
+design -reset
+!"temp/trace dir/say" hello
+!temp/trace\ dir/say world
+design -reset
+YS
+
+../../yosys -q --trace-out temp/trace_out.json -s temp/trace_out.ys > /dev/null
+
+# passes get begin and end events, external commands a complete event named
+# after the executable
+test $(grep -c '^{"name": "design", "cat": "pass", "ph": "B", ' temp/trace_out.json) -eq 2
+test $(grep -c '^{"name": "design", "cat": "pass", "ph": "E", ' temp/trace_out.json) -eq 2
+test $(grep -c '^{"name": "say", "cat": "exec", "ph": "X", .*"status": 0}}' temp/trace_out.json) -eq 2